@@ -0,0 +1,196 @@
+#include "bench_scene.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace vke {
+
+    bool BenchSceneConfig::from_preset(const std::string &name, BenchSceneConfig &config) {
+        if (name == "small") {
+            config.object_count = 100;
+            config.mesh_count = 4;
+            config.min_triangles = 100;
+            config.max_triangles = 1000;
+        } else if (name == "medium") {
+            config.object_count = 1000;
+            config.mesh_count = 16;
+            config.min_triangles = 200;
+            config.max_triangles = 5000;
+        } else if (name == "large") {
+            config.object_count = 10000;
+            config.mesh_count = 64;
+            config.min_triangles = 500;
+            config.max_triangles = 20000;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    VkeModel::Data generate_bench_mesh(uint32_t target_triangles, std::mt19937 &rng) {
+        // a uv sphere with s slices and t stacks has 2 * s * t triangles
+        uint32_t slices = std::max(3u, static_cast<uint32_t>(std::sqrt(static_cast<float>(target_triangles))));
+        uint32_t stacks = std::max(2u, target_triangles / (2 * slices));
+
+        float frequency = 1.f + std::floor(random_unit(rng) * 5.f);
+        float amplitude = .05f + .15f * random_unit(rng);
+        float phase = glm::two_pi<float>() * random_unit(rng);
+        glm::vec3 color{.3f + .7f * random_unit(rng), .3f + .7f * random_unit(rng), .3f + .7f * random_unit(rng)};
+
+        VkeModel::Data data{};
+        data.vertices.reserve((stacks + 1) * (slices + 1));
+        for (uint32_t stack = 0; stack <= stacks; stack++) {
+            float v = static_cast<float>(stack) / stacks;
+            float theta = glm::pi<float>() * v;
+            for (uint32_t slice = 0; slice <= slices; slice++) {
+                float u = static_cast<float>(slice) / slices;
+                float phi = glm::two_pi<float>() * u;
+
+                glm::vec3 normal{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+                float radius = .5f + amplitude * std::sin(frequency * phi + phase) * std::sin(frequency * theta);
+
+                VkeModel::Vertex vertex{};
+                vertex.position = normal * radius;
+                vertex.color = color;
+                vertex.normal = normal;
+                vertex.uv = {u, v};
+                data.vertices.push_back(vertex);
+            }
+        }
+
+        data.indices.reserve(6 * stacks * slices);
+        for (uint32_t stack = 0; stack < stacks; stack++) {
+            for (uint32_t slice = 0; slice < slices; slice++) {
+                uint32_t a = stack * (slices + 1) + slice;
+                uint32_t b = a + slices + 1;
+                data.indices.insert(data.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+            }
+        }
+        return data;
+    }
+
+    BenchScene generate_bench_scene(VkeDevice &device, const BenchSceneConfig &config, VkeAssetManager *assets) {
+        std::mt19937 rng{config.seed};
+        BenchScene scene{};
+
+        std::vector<uint32_t> mesh_triangles(config.mesh_count);
+        for (uint32_t i = 0; i < config.mesh_count; i++) {
+            float t = config.mesh_count > 1 ? static_cast<float>(i) / (config.mesh_count - 1) : 0.f;
+            uint32_t target = config.min_triangles + static_cast<uint32_t>(t * (config.max_triangles - config.min_triangles));
+
+            VkeModel::Data data = generate_bench_mesh(target, rng);
+            mesh_triangles[i] = static_cast<uint32_t>(data.indices.size() / 3);
+            scene.mesh_triangles += mesh_triangles[i];
+            if (assets) {
+                scene.mesh_handles.push_back(assets->create(std::move(data), false, config.with_positions));
+            } else {
+                if (config.with_positions) {
+                    data.build_positions();
+                }
+                scene.meshes.push_back(std::make_shared<VkeModel>(device, data));
+            }
+        }
+
+        // about one object per unit cube
+        scene.extent = .5f * std::max(std::cbrt(static_cast<float>(config.object_count)), 1.f);
+        uint32_t dynamic_count = static_cast<uint32_t>(std::round(config.dynamic_ratio * config.object_count));
+
+        for (uint32_t i = 0; i < config.object_count; i++) {
+            uint32_t mesh = config.mesh_count > 0 ? rng() % config.mesh_count : 0;
+
+            auto obj = VkeGameObject::create_game_object();
+            obj.transform.translation = {
+                scene.extent * (2.f * random_unit(rng) - 1.f),
+                scene.extent * (2.f * random_unit(rng) - 1.f),
+                scene.extent * (2.f * random_unit(rng) - 1.f)
+            };
+            obj.transform.rotation = {0.f, glm::two_pi<float>() * random_unit(rng), 0.f};
+            obj.transform.scale = glm::vec3(.5f + .5f * random_unit(rng));
+            if (!scene.mesh_handles.empty()) {
+                obj.mesh = scene.mesh_handles[mesh];
+                obj.model = assets->get_model(obj.mesh);
+                scene.scene_triangles += mesh_triangles[mesh];
+            } else if (!scene.meshes.empty()) {
+                obj.model = scene.meshes[mesh];
+                scene.scene_triangles += mesh_triangles[mesh];
+            }
+
+            // the first objects are the dynamic ones, positions are random anyway
+            if (i < dynamic_count) {
+                scene.dynamic_objects.push_back({
+                    obj.get_id(),
+                    obj.transform.translation,
+                    .5f + 2.f * random_unit(rng),
+                    glm::two_pi<float>() * random_unit(rng)
+                });
+            }
+            scene.objects.emplace(obj.get_id(), std::move(obj));
+        }
+        return scene;
+    }
+
+    void add_bench_props(BenchScene &scene, VkeAssetManager &assets, uint32_t count, uint32_t seed, bool with_positions) {
+        constexpr uint32_t PROP_MESHES = 4;
+        // a stream of its own, the scene stays the same with and without props
+        std::mt19937 rng{seed + 1};
+        std::vector<VkeModel::Data> meshes{};
+        for (uint32_t i = 0; i < PROP_MESHES; i++) {
+            meshes.push_back(generate_bench_mesh(300 + 200 * i, rng));
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            auto obj = VkeGameObject::create_game_object();
+            obj.transform.translation = {
+                scene.extent * (2.f * random_unit(rng) - 1.f),
+                scene.extent * (2.f * random_unit(rng) - 1.f),
+                scene.extent * (2.f * random_unit(rng) - 1.f)
+            };
+            obj.transform.scale = glm::vec3(.25f);
+            // a copy, like a level that names the same prop file for every placement
+            obj.mesh = assets.create(meshes[i % PROP_MESHES], false, with_positions);
+            obj.model = assets.get_model(obj.mesh);
+            scene.props.push_back(obj.get_id());
+            scene.objects.emplace(obj.get_id(), std::move(obj));
+        }
+    }
+
+    void release_bench_props(BenchScene &scene) {
+        for (auto id : scene.props) {
+            scene.objects.erase(id);
+        }
+        scene.props.clear();
+    }
+
+    std::vector<VkePointLight> generate_bench_lights(const BenchScene &scene, uint32_t count, uint32_t seed) {
+        std::mt19937 rng{seed};
+        std::vector<VkePointLight> lights{};
+        lights.reserve(count + 1);
+        float extent = std::max(scene.extent, 1.f);
+        lights.push_back({glm::vec4(glm::vec3(-extent), 4.f * extent), glm::vec4(1.f, 1.f, 1.f, extent * extent)});
+        for (uint32_t i = 0; i < count; i++) {
+            glm::vec3 position{
+                extent * (2.f * random_unit(rng) - 1.f),
+                extent * (2.f * random_unit(rng) - 1.f),
+                extent * (2.f * random_unit(rng) - 1.f)
+            };
+            glm::vec3 color{random_unit(rng), random_unit(rng), random_unit(rng)};
+            float radius = extent * (.05f + .1f * random_unit(rng));
+            lights.push_back({glm::vec4(position, radius), glm::vec4(color, .5f)});
+        }
+        return lights;
+    }
+
+    void animate_bench_scene(BenchScene &scene, float time) {
+        for (auto &dynamic : scene.dynamic_objects) {
+            auto &transform = scene.objects.at(dynamic.id).transform;
+            transform.rotation.y = dynamic.phase + dynamic.spin * time;
+            transform.translation = dynamic.base_translation + glm::vec3(0.f, .25f * std::sin(dynamic.phase + 2.f * time), 0.f);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef bench_scene_
+    #define bench_scene_
+
+    #include "src/vke_asset_manager.hpp"
+    #include "src/vke_device.hpp"
+    #include "src/vke_game_object.hpp"
+    #include "src/vke_light_clusters.hpp"
+    #include "src/vke_model.hpp"
+
+    // std
+    #include <cstdint>
+    #include <memory>
+    #include <random>
+    #include <string>
+    #include <vector>
+
+    namespace vke {
+
+        // parameters of a procedurally generated scene, the same config and seed always give the same scene
+        struct BenchSceneConfig {
+            uint32_t object_count = 1000;
+            uint32_t mesh_count = 16;
+            // triangle counts of the unique meshes are spread evenly over this range
+            uint32_t min_triangles = 200;
+            uint32_t max_triangles = 5000;
+            // fraction of objects whose transform changes every frame
+            float dynamic_ratio = 0.25f;
+            uint32_t seed = 1;
+            // the meshes get the position buffers of the depth pre-pass
+            bool with_positions = false;
+
+            // small, medium or large; returns false for unknown names
+            static bool from_preset(const std::string &name, BenchSceneConfig &config);
+        };
+
+        struct BenchScene {
+            struct DynamicObject {
+                VkeGameObject::id_t id;
+                glm::vec3 base_translation;
+                float spin;
+                float phase;
+            };
+
+            std::vector<std::shared_ptr<VkeModel>> meshes{};
+            // instead of meshes when the scene streams through a VkeAssetManager
+            std::vector<VkeAssetManager::Handle> mesh_handles{};
+            VkeGameObject::Map objects{};
+            std::vector<DynamicObject> dynamic_objects{};
+            // objects of add_bench_props, until release_bench_props
+            std::vector<VkeGameObject::id_t> props{};
+            // objects are placed inside a cube of this half size around the origin
+            float extent = 0.f;
+            uint64_t mesh_triangles = 0;
+            uint64_t scene_triangles = 0;
+        };
+
+        // mt19937 output is specified by the standard, unlike the std distributions
+        inline float random_unit(std::mt19937 &rng) {
+            return static_cast<float>(rng() >> 8) / static_cast<float>(1u << 24);
+        }
+
+        // a noisy uv sphere with roughly target_triangles triangles
+        VkeModel::Data generate_bench_mesh(uint32_t target_triangles, std::mt19937 &rng);
+
+        // with assets the meshes are handed to the asset manager and the objects start out with its
+        // placeholder, their mesh handles tell which model replaces it
+        BenchScene generate_bench_scene(VkeDevice &device, const BenchSceneConfig &config, VkeAssetManager *assets = nullptr);
+
+        // count objects using a few prop meshes, every object loads its mesh again so the asset manager
+        // shares the buffers by content
+        void add_bench_props(BenchScene &scene, VkeAssetManager &assets, uint32_t count, uint32_t seed, bool with_positions = false);
+        // drops the props and with them the last references to their models
+        void release_bench_props(BenchScene &scene);
+
+        // a key light over the whole scene followed by count small point lights spread through it
+        std::vector<VkePointLight> generate_bench_lights(const BenchScene &scene, uint32_t count, uint32_t seed);
+
+        // moves the dynamic objects to their pose at the given time
+        void animate_bench_scene(BenchScene &scene, float time);
+    }
+
+#endif
@@ -0,0 +1,651 @@
+// Micro-benchmarks of the cpu hot paths of the engine. Numbers are meant to be compared across commits
+// on the same machine, configure with -DCMAKE_BUILD_TYPE=Release for meaningful results.
+#include "micro_bench.hpp"
+
+#include "src/vke_buffer.hpp"
+#include "src/vke_camera.hpp"
+#include "src/vke_device.hpp"
+#include "src/vke_game_object.hpp"
+#include "src/vke_light_clusters.hpp"
+#include "src/vke_mesh_lod.hpp"
+#include "src/vke_meshlet.hpp"
+#include "src/vke_model.hpp"
+#include "src/vke_render_queue.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    using vke::micro::State;
+    using vke::micro::do_not_optimize;
+
+    // inputs are cycled through so the compiler can not hoist the work out of the loop
+    constexpr size_t INPUT_COUNT = 1024;
+
+    float random_float(std::mt19937 &rng, float min, float max) {
+        return min + (max - min) * static_cast<float>(rng() >> 8) / static_cast<float>(1u << 24);
+    }
+
+    std::vector<vke::TransformComponent> random_transforms() {
+        std::mt19937 rng{1};
+        std::vector<vke::TransformComponent> transforms(INPUT_COUNT);
+        for (auto &transform : transforms) {
+            transform.translation = {random_float(rng, -10.f, 10.f), random_float(rng, -10.f, 10.f), random_float(rng, -10.f, 10.f)};
+            transform.rotation = {random_float(rng, 0.f, 6.f), random_float(rng, 0.f, 6.f), random_float(rng, 0.f, 6.f)};
+            transform.scale = glm::vec3(random_float(rng, .5f, 2.f));
+        }
+        return transforms;
+    }
+
+    std::vector<vke::VkeModel::Vertex> random_vertices(size_t count, size_t unique) {
+        std::mt19937 rng{2};
+        std::vector<vke::VkeModel::Vertex> pool(unique);
+        for (auto &vertex : pool) {
+            vertex.position = {random_float(rng, -1.f, 1.f), random_float(rng, -1.f, 1.f), random_float(rng, -1.f, 1.f)};
+            vertex.color = glm::vec3(1.f);
+            vertex.normal = glm::normalize(vertex.position);
+            vertex.uv = {random_float(rng, 0.f, 1.f), random_float(rng, 0.f, 1.f)};
+        }
+        std::vector<vke::VkeModel::Vertex> vertices(count);
+        for (auto &vertex : vertices) {
+            vertex = pool[rng() % unique];
+        }
+        return vertices;
+    }
+
+    void transform_mat4(State &state) {
+        auto transforms = random_transforms();
+        size_t i = 0;
+        for (auto _ : state) {
+            do_not_optimize(transforms[i++ % INPUT_COUNT].mat4());
+        }
+        state.set_items_processed(state.get_iterations());
+    }
+    MICRO_BENCH(transform_mat4);
+
+    void transform_normal_matrix(State &state) {
+        auto transforms = random_transforms();
+        size_t i = 0;
+        for (auto _ : state) {
+            do_not_optimize(transforms[i++ % INPUT_COUNT].normal_matrix());
+        }
+        state.set_items_processed(state.get_iterations());
+    }
+    MICRO_BENCH(transform_normal_matrix);
+
+    void camera_set_perspective_projection(State &state) {
+        vke::VkeCamera camera{};
+        float aspect = 1.f;
+        for (auto _ : state) {
+            aspect = aspect > 3.f ? 1.f : aspect + .001f;
+            camera.set_perspective_projection(glm::radians(50.f), aspect, .1f, 100.f);
+            do_not_optimize(camera.get_projection());
+        }
+        state.set_items_processed(state.get_iterations());
+    }
+    MICRO_BENCH(camera_set_perspective_projection);
+
+    void camera_set_view_yxz(State &state) {
+        auto transforms = random_transforms();
+        vke::VkeCamera camera{};
+        size_t i = 0;
+        for (auto _ : state) {
+            auto &transform = transforms[i++ % INPUT_COUNT];
+            camera.set_view_yxz(transform.translation, transform.rotation);
+            do_not_optimize(camera.get_view());
+        }
+        state.set_items_processed(state.get_iterations());
+    }
+    MICRO_BENCH(camera_set_view_yxz);
+
+    // lights in a cube around the origin, about a third of them in view
+    void light_assign(State &state) {
+        size_t count = static_cast<size_t>(state.arg());
+        std::mt19937 rng{3};
+        std::vector<vke::VkePointLight> lights(count);
+        for (auto &light : lights) {
+            light.position_radius = {
+                random_float(rng, -10.f, 10.f),
+                random_float(rng, -10.f, 10.f),
+                random_float(rng, -10.f, 10.f),
+                random_float(rng, .2f, 1.7f)
+            };
+        }
+        vke::VkeCamera camera{};
+        camera.set_perspective_projection(glm::radians(50.f), 4.f / 3.f, .1f, 100.f);
+        camera.set_view_target({-3.f, -2.f, -6.f}, glm::vec3(0.f));
+        vke::VkeLightGrid grid{1u << 22};
+        grid.set_projection(camera.get_projection(), {800, 600});
+        for (auto _ : state) {
+            grid.assign(camera.get_view(), lights.data(), static_cast<uint32_t>(count));
+            do_not_optimize(grid.get_light_indices().data());
+        }
+        state.set_items_processed(state.get_iterations() * count);
+    }
+    MICRO_BENCH(light_assign, {1000, 4000, 10000});
+
+    // points sampled inside the lights fall into clusters that list the light, the lists may hold more
+    void light_clusters(vke::micro::Check &check) {
+        std::mt19937 rng{5};
+        // a count that is not a multiple of four, the last lights take the scalar path
+        std::vector<vke::VkePointLight> lights(1003);
+        for (auto &light : lights) {
+            light.position_radius = {
+                random_float(rng, -10.f, 10.f),
+                random_float(rng, -10.f, 10.f),
+                random_float(rng, -10.f, 10.f),
+                random_float(rng, .05f, 3.f)
+            };
+        }
+        vke::VkeCamera camera{};
+        camera.set_perspective_projection(glm::radians(50.f), 16.f / 9.f, .1f, 30.f);
+        camera.set_view_target({-3.f, -2.f, -6.f}, glm::vec3(0.f));
+        vke::VkeLightGrid grid{1u << 22};
+        grid.set_projection(camera.get_projection(), {1280, 720});
+        grid.assign(camera.get_view(), lights.data(), static_cast<uint32_t>(lights.size()));
+        if (!check.expect(grid.get_dropped_indices() == 0, "light indices dropped")) {
+            return;
+        }
+
+        const glm::mat4 &view = camera.get_view();
+        const glm::mat4 &projection = camera.get_projection();
+        const glm::vec4 scale = grid.get_cluster_scale();
+        // skips samples this close to a tile or slice border, where rounding may pick either side
+        constexpr float border = 1e-3f;
+        auto near_border = [&](float coordinate) { return std::abs(coordinate - std::round(coordinate)) < border; };
+        uint64_t tested = 0;
+        for (uint32_t light = 0; light < lights.size(); light++) {
+            glm::vec3 center{lights[light].position_radius};
+            float radius = lights[light].position_radius.w;
+            for (int sample = 0; sample < 64; sample++) {
+                glm::vec3 offset{random_float(rng, -1.f, 1.f), random_float(rng, -1.f, 1.f), random_float(rng, -1.f, 1.f)};
+                if (glm::dot(offset, offset) > 1.f) continue;
+                glm::vec4 point = view * glm::vec4(center + offset * radius, 1.f);
+                float ndc_x = projection[0][0] * point.x / point.z;
+                float ndc_y = projection[1][1] * point.y / point.z;
+                if (point.z < .1f || point.z > 30.f || std::abs(ndc_x) > 1.f || std::abs(ndc_y) > 1.f) continue;
+
+                float tile_x = (ndc_x * .5f + .5f) * vke::VkeLightGrid::TILES_X;
+                float tile_y = (ndc_y * .5f + .5f) * vke::VkeLightGrid::TILES_Y;
+                float slice = std::log(point.z) * scale.z + scale.w;
+                if (near_border(tile_x) || near_border(tile_y) || near_border(slice)) continue;
+                auto index = [](float coordinate, uint32_t count) {
+                    return static_cast<uint32_t>(std::clamp(static_cast<int>(std::floor(coordinate)), 0, static_cast<int>(count) - 1));
+                };
+                uint32_t cluster = (index(slice, vke::VkeLightGrid::DEPTH_SLICES) * vke::VkeLightGrid::TILES_Y
+                    + index(tile_y, vke::VkeLightGrid::TILES_Y)) * vke::VkeLightGrid::TILES_X + index(tile_x, vke::VkeLightGrid::TILES_X);
+                const auto &list = grid.get_clusters()[cluster];
+                auto first = grid.get_light_indices().begin() + list.offset;
+                if (!check.expect(std::find(first, first + list.count, light) != first + list.count, "a cluster misses a light reaching into it")) {
+                    return;
+                }
+                tested++;
+            }
+        }
+        check.expect(tested > 1000, "too few samples in view");
+    }
+    MICRO_CHECK(light_clusters);
+
+    // keys of a scene with 4 pipelines, 64 materials and 1000 meshes in random order
+    std::vector<uint64_t> random_draw_keys(size_t count) {
+        std::mt19937 rng{4};
+        std::vector<uint64_t> keys(count);
+        for (auto &key : keys) {
+            key = vke::VkeRenderQueue::make_key(1, rng() % 4, rng() % 64, rng() % 1000, random_float(rng, .1f, 100.f));
+        }
+        return keys;
+    }
+
+    // counts the binds left after sorting instead of recording them
+    struct CountingRecorder {
+        uint64_t pipeline_binds = 0;
+        uint64_t material_binds = 0;
+        uint64_t mesh_binds = 0;
+        uint64_t draws = 0;
+
+        void bind_pipeline(uint32_t, uint32_t) { pipeline_binds++; }
+        void bind_material(uint32_t, uint32_t) { material_binds++; }
+        void bind_mesh(uint32_t, uint32_t) { mesh_binds++; }
+        void draw(uint32_t draw) { draws += draw; }
+    };
+
+    void render_queue_sort(State &state) {
+        size_t count = static_cast<size_t>(state.arg());
+        auto keys = random_draw_keys(count);
+        vke::VkeRenderQueue queue{std::max(std::thread::hardware_concurrency() / 2, 1u)};
+        for (auto _ : state) {
+            queue.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                queue.add(keys[i], i);
+            }
+            queue.sort();
+            do_not_optimize(queue.get_items().data());
+        }
+        state.set_items_processed(state.get_iterations() * count);
+    }
+    MICRO_BENCH(render_queue_sort, {1000, 10000, 100000});
+
+    // the same keys through std::sort, for comparison
+    void render_queue_std_sort(State &state) {
+        size_t count = static_cast<size_t>(state.arg());
+        auto keys = random_draw_keys(count);
+        std::vector<vke::VkeRadixSorter::Item> items(count);
+        for (auto _ : state) {
+            for (uint32_t i = 0; i < count; i++) {
+                items[i] = {keys[i], i};
+            }
+            std::sort(items.begin(), items.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+            do_not_optimize(items.data());
+        }
+        state.set_items_processed(state.get_iterations() * count);
+    }
+    MICRO_BENCH(render_queue_std_sort, {1000, 10000, 100000});
+
+    void render_queue_sort_record(State &state) {
+        size_t count = static_cast<size_t>(state.arg());
+        auto keys = random_draw_keys(count);
+        vke::VkeRenderQueue queue{std::max(std::thread::hardware_concurrency() / 2, 1u)};
+        for (auto _ : state) {
+            queue.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                queue.add(keys[i], i);
+            }
+            queue.sort();
+            CountingRecorder recorder{};
+            queue.record(recorder);
+            do_not_optimize(recorder);
+        }
+        state.set_items_processed(state.get_iterations() * count);
+    }
+    MICRO_BENCH(render_queue_sort_record, {10000, 100000});
+
+    // the radix sort keeps the order of std::stable_sort, on draw keys and on keys with few distinct values
+    // where stability decides the order, with one thread and with chunks sorted in parallel
+    void check_radix_sort(vke::micro::Check &check, vke::VkeRadixSorter &sorter, std::vector<uint64_t> keys) {
+        std::vector<vke::VkeRadixSorter::Item> items(keys.size());
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            items[i] = {keys[i], i};
+        }
+        auto expected = items;
+        std::stable_sort(expected.begin(), expected.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+        sorter.sort(items);
+        for (size_t i = 0; i < items.size(); i++) {
+            if (!check.expect(items[i].key == expected[i].key && items[i].value == expected[i].value, "radix sort differs from std::stable_sort at " + std::to_string(keys.size()) + " keys")) {
+                return;
+            }
+        }
+    }
+
+    void radix_sort(vke::micro::Check &check) {
+        constexpr size_t threshold = vke::VkeRadixSorter::PARALLEL_THRESHOLD;
+        vke::VkeRadixSorter sorter{4};
+        std::mt19937 rng{7};
+        for (size_t count : {size_t{0}, size_t{1}, size_t{1000}, threshold - 1, threshold, threshold * 4 + 3}) {
+            check_radix_sort(check, sorter, random_draw_keys(count));
+            // small sorts never start the workers
+            check.expect((sorter.get_started_workers() > 0) == (count >= threshold), "sorter workers started below the threshold");
+            std::vector<uint64_t> few_values(count);
+            for (auto &key : few_values) {
+                // equal keys, and bytes both constant and varying across the keys
+                key = (uint64_t{rng() % 16} << 40) | (rng() % 4);
+            }
+            check_radix_sort(check, sorter, few_values);
+        }
+    }
+    MICRO_CHECK(radix_sort);
+
+    void vertex_hash(State &state) {
+        auto vertices = random_vertices(INPUT_COUNT, INPUT_COUNT);
+        std::hash<vke::VkeModel::Vertex> hasher{};
+        size_t i = 0;
+        for (auto _ : state) {
+            do_not_optimize(hasher(vertices[i++ % INPUT_COUNT]));
+        }
+        state.set_items_processed(state.get_iterations());
+    }
+    MICRO_BENCH(vertex_hash);
+
+    // the deduplication load_model does, every vertex appears about six times like in a closed mesh
+    void vertex_deduplicate(State &state) {
+        size_t count = static_cast<size_t>(state.arg());
+        auto vertices = random_vertices(count, std::max<size_t>(count / 6, 1));
+        for (auto _ : state) {
+            std::unordered_map<vke::VkeModel::Vertex, uint32_t> unique_vertices{};
+            std::vector<uint32_t> indices{};
+            indices.reserve(count);
+            for (auto &vertex : vertices) {
+                auto [it, inserted] = unique_vertices.try_emplace(vertex, static_cast<uint32_t>(unique_vertices.size()));
+                indices.push_back(it->second);
+            }
+            do_not_optimize(indices.data());
+        }
+        state.set_items_processed(state.get_iterations() * count);
+    }
+    MICRO_BENCH(vertex_deduplicate, {1024, 65536, 1048576});
+
+    // a wavy grid with about the requested number of triangles, written once per size
+    const std::string &grid_obj_path(int64_t triangles) {
+        static std::map<int64_t, std::string> paths{};
+        auto it = paths.find(triangles);
+        if (it != paths.end()) {
+            return it->second;
+        }
+
+        uint32_t side = std::max(1u, static_cast<uint32_t>(std::sqrt(triangles / 2.0)));
+        std::string path = (std::filesystem::temp_directory_path() / ("vke_micro_bench_grid_" + std::to_string(triangles) + ".obj")).string();
+        std::ofstream file{path};
+        for (uint32_t y = 0; y <= side; y++) {
+            for (uint32_t x = 0; x <= side; x++) {
+                float u = static_cast<float>(x) / side;
+                float v = static_cast<float>(y) / side;
+                file << "v " << u << " " << .1f * std::sin(10.f * u) * std::cos(10.f * v) << " " << v << '\n'
+                     << "vt " << u << " " << v << '\n'
+                     << "vn 0 1 0" << '\n';
+            }
+        }
+        for (uint32_t y = 0; y < side; y++) {
+            for (uint32_t x = 0; x < side; x++) {
+                // obj indices are one based
+                uint32_t a = y * (side + 1) + x + 1;
+                uint32_t b = a + side + 1;
+                file << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << '\n'
+                     << "f " << a + 1 << "/" << a + 1 << "/" << a + 1 << " " << b << "/" << b << "/" << b << " " << b + 1 << "/" << b + 1 << "/" << b + 1 << '\n';
+            }
+        }
+        return paths[triangles] = path;
+    }
+
+    void load_model(State &state) {
+        const std::string &path = grid_obj_path(state.arg());
+        uint64_t bytes = std::filesystem::file_size(path);
+        vke::VkeModel::Data data{};
+        for (auto _ : state) {
+            data.load_model(path);
+            do_not_optimize(data.vertices.data());
+        }
+        state.set_bytes_processed(state.get_iterations() * bytes);
+        state.set_items_processed(state.get_iterations() * data.indices.size() / 3);
+    }
+    MICRO_BENCH(load_model, {1024, 16384, 131072});
+
+    // a closed sphere of rings * segments * 2 triangles, wound like obj files (counter-clockwise)
+    vke::VkeModel::Data uv_sphere(uint32_t rings, uint32_t segments) {
+        vke::VkeModel::Data data{};
+        for (uint32_t ring = 0; ring <= rings; ring++) {
+            float theta = glm::pi<float>() * ring / rings;
+            for (uint32_t segment = 0; segment <= segments; segment++) {
+                float phi = glm::two_pi<float>() * segment / segments;
+                vke::VkeModel::Vertex vertex{};
+                vertex.position = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+                vertex.normal = vertex.position;
+                vertex.color = glm::vec3(1.f);
+                data.vertices.push_back(vertex);
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ring++) {
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                uint32_t a = ring * (segments + 1) + segment;
+                uint32_t b = a + segments + 1;
+                // the poles would get degenerate triangles
+                if (ring > 0) {
+                    data.indices.insert(data.indices.end(), {a, a + 1, b});
+                }
+                if (ring + 1 < rings) {
+                    data.indices.insert(data.indices.end(), {a + 1, b + 1, b});
+                }
+            }
+        }
+        return data;
+    }
+
+    // an open, wavy grid with back faces in view from most directions
+    vke::VkeModel::Data wavy_grid(uint32_t side) {
+        vke::VkeModel::Data data{};
+        for (uint32_t y = 0; y <= side; y++) {
+            for (uint32_t x = 0; x <= side; x++) {
+                float u = static_cast<float>(x) / side;
+                float v = static_cast<float>(y) / side;
+                vke::VkeModel::Vertex vertex{};
+                vertex.position = {u, .1f * std::sin(10.f * u) * std::cos(10.f * v), v};
+                vertex.normal = {0.f, 1.f, 0.f};
+                vertex.color = glm::vec3(1.f);
+                data.vertices.push_back(vertex);
+            }
+        }
+        for (uint32_t y = 0; y < side; y++) {
+            for (uint32_t x = 0; x < side; x++) {
+                uint32_t a = y * (side + 1) + x;
+                uint32_t b = a + side + 1;
+                data.indices.insert(data.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+            }
+        }
+        return data;
+    }
+
+    // meshlets stay within the limits of the mesh shader, hold every triangle exactly once with its winding,
+    // and cone culling only drops meshlets whose triangles all face away from the camera
+    void check_meshlets(vke::micro::Check &check, const vke::VkeModel::Data &mesh, uint64_t &cone_culled) {
+        std::vector<vke::VkeModel::Meshlet> meshlets{};
+        std::vector<uint32_t> meshlet_vertices{};
+        std::vector<uint8_t> meshlet_triangles{};
+        vke::build_meshlets(
+            mesh.vertices,
+            mesh.indices.data(),
+            mesh.indices.size(),
+            vke::VkeModel::MAX_MESHLET_VERTICES,
+            vke::VkeModel::MAX_MESHLET_TRIANGLES,
+            meshlets,
+            meshlet_vertices,
+            meshlet_triangles
+        );
+
+        std::map<std::array<uint32_t, 3>, int> unseen{};
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            unseen[{mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]}]++;
+        }
+        // source triangles of each meshlet, as vertex indices
+        std::vector<std::vector<std::array<uint32_t, 3>>> triangles(meshlets.size());
+        for (size_t m = 0; m < meshlets.size(); m++) {
+            const auto &meshlet = meshlets[m];
+            if (!check.expect(meshlet.vertex_count <= vke::VkeModel::MAX_MESHLET_VERTICES, "meshlet exceeds the vertex limit")
+                    || !check.expect(meshlet.triangle_count <= vke::VkeModel::MAX_MESHLET_TRIANGLES, "meshlet exceeds the triangle limit")
+                    || !check.expect(meshlet.triangle_count > 0, "empty meshlet")) {
+                return;
+            }
+            for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+                std::array<uint32_t, 3> triangle{};
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    uint32_t local = meshlet_triangles[(meshlet.triangle_offset + t) * 3 + corner];
+                    if (!check.expect(local < meshlet.vertex_count, "local index past the meshlet's vertices")) {
+                        return;
+                    }
+                    triangle[corner] = meshlet_vertices[meshlet.vertex_offset + local];
+                }
+                if (!check.expect(--unseen[triangle] >= 0, "triangle in several meshlets or not in the mesh")) {
+                    return;
+                }
+                triangles[m].push_back(triangle);
+            }
+        }
+        for (const auto &[triangle, count] : unseen) {
+            if (!check.expect(count == 0, "triangle missing from the meshlets")) {
+                return;
+            }
+        }
+
+        // cameras around and inside the bounds of the mesh
+        std::mt19937 rng{5};
+        for (uint32_t camera = 0; camera < 256; camera++) {
+            glm::vec3 direction = glm::normalize(glm::vec3{random_float(rng, -1.f, 1.f), random_float(rng, -1.f, 1.f), random_float(rng, -1.f, 1.f)} + 1e-3f);
+            glm::vec3 camera_position = glm::vec3(.5f) + direction * random_float(rng, .2f, 8.f);
+            for (size_t m = 0; m < meshlets.size(); m++) {
+                if (!vke::is_meshlet_backfacing(meshlets[m], camera_position)) continue;
+                cone_culled++;
+                for (const auto &triangle : triangles[m]) {
+                    const glm::vec3 &a = mesh.vertices[triangle[0]].position;
+                    const glm::vec3 &b = mesh.vertices[triangle[1]].position;
+                    const glm::vec3 &c = mesh.vertices[triangle[2]].position;
+                    // culled triangles face away or are seen edge on
+                    if (!check.expect(glm::dot(glm::cross(b - a, c - a), camera_position - a) <= 1e-6f, "cone culled a triangle facing the camera")) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    void meshlet_partition(vke::micro::Check &check) {
+        uint64_t cone_culled = 0;
+        check_meshlets(check, uv_sphere(48, 96), cone_culled);
+        check_meshlets(check, wavy_grid(96), cone_culled);
+        // a closed sphere seen from outside has whole meshlets facing away
+        check.expect(cone_culled > 0, "cone culling never culled anything");
+    }
+    MICRO_CHECK(meshlet_partition);
+
+    // every level of build_lods saves at least the share of triangles it accepts, indexes original vertices,
+    // and its error grows with the level, while a simplifier given a max error stays within it
+    void check_lods(vke::micro::Check &check, vke::VkeModel::Data mesh) {
+        const float reduction = .5f;
+        const size_t full_index_count = mesh.indices.size();
+        mesh.build_lods(6, reduction);
+        if (!check.expect(mesh.lods.size() > 2, "fewer than two simplified levels")
+                || !check.expect(mesh.lods[0].index_count == full_index_count && mesh.lods[0].error == 0.f, "lod 0 is not the full mesh")) {
+            return;
+        }
+        for (size_t level = 1; level < mesh.lods.size(); level++) {
+            const auto &lod = mesh.lods[level];
+            const auto &previous = mesh.lods[level - 1];
+            if (!check.expect(lod.first_index + lod.index_count <= mesh.indices.size() && lod.index_count % 3 == 0, "lod range outside the indices")
+                    || !check.expect(lod.index_count / 3 >= vke::VkeModel::Data::MIN_LOD_TRIANGLES, "lod below the minimum triangle count")
+                    || !check.expect(lod.index_count <= previous.index_count * (1.f + reduction) * .5f, "lod misses its reduction")
+                    || !check.expect(lod.error >= previous.error, "lod error is not monotonic")) {
+                return;
+            }
+            for (uint32_t i = 0; i < lod.index_count; i++) {
+                if (!check.expect(mesh.indices[lod.first_index + i] < mesh.vertices.size(), "lod index past the vertices")) {
+                    return;
+                }
+            }
+        }
+
+        // half of the coarsest error, the simplifier has to stop before it
+        std::vector<uint32_t> full_indices(mesh.indices.begin(), mesh.indices.begin() + full_index_count);
+        float max_error = mesh.lods.back().error * .5f;
+        vke::VkeMeshSimplifier simplifier{mesh.vertices, full_indices};
+        simplifier.simplify(vke::VkeModel::Data::MIN_LOD_TRIANGLES, max_error);
+        check.expect(simplifier.get_error() <= max_error, "simplifier exceeded its max error");
+        check.expect(simplifier.get_triangle_count() * 3 > mesh.lods.back().index_count, "simplifier went past its max error");
+    }
+
+    void lod_reduction(vke::micro::Check &check) {
+        check_lods(check, uv_sphere(48, 96));
+        check_lods(check, wavy_grid(96));
+    }
+    MICRO_CHECK(lod_reduction);
+
+    // created on first use so the cpu only cases run on machines without a vulkan device
+    vke::VkeDevice *headless_device(std::string &error) {
+        static std::unique_ptr<vke::VkeDevice> device{};
+        static std::string creation_error{};
+        if (!device && creation_error.empty()) {
+            try {
+                device = std::make_unique<vke::VkeDevice>(nullptr);
+            } catch (const std::exception &e) {
+                creation_error = e.what();
+            }
+        }
+        error = creation_error;
+        return device.get();
+    }
+
+    // reference for the mapped buffer cases
+    void host_memcpy(State &state) {
+        size_t size = static_cast<size_t>(state.arg());
+        std::vector<char> source(size, 1);
+        std::vector<char> destination(size);
+        for (auto _ : state) {
+            std::memcpy(destination.data(), source.data(), size);
+            vke::micro::clobber_memory();
+        }
+        state.set_bytes_processed(state.get_iterations() * size);
+    }
+    MICRO_BENCH(host_memcpy, {64, 4096, 65536, 1048576, 16777216});
+
+    void buffer_write_to_buffer(State &state) {
+        std::string error{};
+        vke::VkeDevice *device = headless_device(error);
+        if (!device) {
+            state.skip(error);
+            return;
+        }
+        size_t size = static_cast<size_t>(state.arg());
+        std::vector<char> source(size, 1);
+        vke::VkeBuffer buffer{
+            *device,
+            size,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        };
+        buffer.map();
+        for (auto _ : state) {
+            buffer.write_to_buffer(source.data());
+            vke::micro::clobber_memory();
+        }
+        state.set_bytes_processed(state.get_iterations() * size);
+    }
+    MICRO_BENCH(buffer_write_to_buffer, {64, 4096, 65536, 1048576, 16777216});
+
+    // per object uniform data, one aligned instance at a time
+    void buffer_write_to_index(State &state) {
+        std::string error{};
+        vke::VkeDevice *device = headless_device(error);
+        if (!device) {
+            state.skip(error);
+            return;
+        }
+        constexpr size_t INSTANCE_SIZE = 128;
+        uint32_t count = static_cast<uint32_t>(state.arg());
+        std::vector<char> source(INSTANCE_SIZE, 1);
+        vke::VkeBuffer buffer{
+            *device,
+            INSTANCE_SIZE,
+            count,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            device->properties.limits.minUniformBufferOffsetAlignment
+        };
+        buffer.map();
+        for (auto _ : state) {
+            for (uint32_t i = 0; i < count; i++) {
+                buffer.write_to_index(source.data(), i);
+            }
+            vke::micro::clobber_memory();
+        }
+        state.set_bytes_processed(state.get_iterations() * count * INSTANCE_SIZE);
+        state.set_items_processed(state.get_iterations() * count);
+    }
+    MICRO_BENCH(buffer_write_to_index, {16, 1024});
+}
+
+int main(int argc, char **argv) {
+    return vke::micro::run_main(argc, argv);
+}
@@ -0,0 +1,277 @@
+#include "micro_bench.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace vke::micro {
+
+    namespace {
+        struct Case {
+            std::string name;
+            BenchFunction function;
+            int64_t arg;
+        };
+
+        struct Result {
+            std::string name;
+            uint64_t iterations = 0;
+            double median_ns = 0.0;
+            double min_ns = 0.0;
+            double max_ns = 0.0;
+            // per second, from the median repetition
+            double bytes_per_second = 0.0;
+            double items_per_second = 0.0;
+            std::string skip_reason{};
+        };
+
+        struct CheckCase {
+            std::string name;
+            CheckFunction function;
+        };
+
+        struct CheckResult {
+            std::string name;
+            // empty if the check held
+            std::string failure;
+        };
+
+        std::vector<Case> &registry() {
+            static std::vector<Case> cases{};
+            return cases;
+        }
+
+        std::vector<CheckCase> &check_registry() {
+            static std::vector<CheckCase> checks{};
+            return checks;
+        }
+
+        CheckResult run_check(const CheckCase &check_case) {
+            Check check{};
+            try {
+                check_case.function(check);
+            } catch (const std::exception &e) {
+                check.expect(false, std::string{"threw "} + e.what());
+            }
+            return {check_case.name, check.get_failure()};
+        }
+
+        struct Run {
+            double seconds;
+            uint64_t bytes;
+            uint64_t items;
+            std::string skip_reason;
+        };
+
+        Run run_once(const Case &bench_case, uint64_t iterations) {
+            State state{iterations, bench_case.arg};
+            auto start = std::chrono::steady_clock::now();
+            bench_case.function(state);
+            auto end = std::chrono::steady_clock::now();
+            return {
+                std::chrono::duration<double>(end - start).count(),
+                state.get_bytes_processed(),
+                state.get_items_processed(),
+                state.get_skip_reason()
+            };
+        }
+
+        Result run_case(const Case &bench_case, double min_time, int repetitions) {
+            Result result{};
+            result.name = bench_case.name;
+
+            // grow the iteration count until a single run takes min_time
+            uint64_t iterations = 1;
+            while (true) {
+                Run run = run_once(bench_case, iterations);
+                if (!run.skip_reason.empty()) {
+                    result.skip_reason = run.skip_reason;
+                    return result;
+                }
+                if (run.seconds >= min_time || iterations >= (1ull << 40)) {
+                    break;
+                }
+                double factor = run.seconds > 0.0 ? min_time * 1.4 / run.seconds : 10.0;
+                iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * std::clamp(factor, 1.0, 10.0)));
+            }
+
+            std::vector<Run> runs{};
+            for (int i = 0; i < repetitions; i++) {
+                runs.push_back(run_once(bench_case, iterations));
+            }
+            std::sort(runs.begin(), runs.end(), [](const Run &a, const Run &b) { return a.seconds < b.seconds; });
+            const Run &median = runs[runs.size() / 2];
+
+            result.iterations = iterations;
+            result.median_ns = median.seconds * 1e9 / iterations;
+            result.min_ns = runs.front().seconds * 1e9 / iterations;
+            result.max_ns = runs.back().seconds * 1e9 / iterations;
+            result.bytes_per_second = median.bytes / median.seconds;
+            result.items_per_second = median.items / median.seconds;
+            return result;
+        }
+
+        void write_text(std::ostream &out, const std::vector<Result> &results, const std::vector<CheckResult> &checks) {
+            for (auto &check : checks) {
+                out << std::left << std::setw(44) << check.name
+                    << (check.failure.empty() ? "  ok" : "  FAILED: " + check.failure) << '\n';
+            }
+            if (!checks.empty()) {
+                out << '\n';
+            }
+            out << std::left << std::setw(44) << "benchmark"
+                << std::right << std::setw(14) << "median ns" << std::setw(14) << "min ns"
+                << std::setw(14) << "iterations" << "  throughput" << '\n';
+            for (auto &result : results) {
+                out << std::left << std::setw(44) << result.name << std::right;
+                if (!result.skip_reason.empty()) {
+                    out << "  skipped: " << result.skip_reason << '\n';
+                    continue;
+                }
+                out << std::fixed << std::setprecision(2)
+                    << std::setw(14) << result.median_ns << std::setw(14) << result.min_ns
+                    << std::setw(14) << result.iterations;
+                if (result.bytes_per_second > 0.0) {
+                    out << "  " << result.bytes_per_second / (1024.0 * 1024.0 * 1024.0) << " GiB/s";
+                }
+                if (result.items_per_second > 0.0) {
+                    out << "  " << result.items_per_second / 1e6 << " M items/s";
+                }
+                out << '\n';
+            }
+        }
+
+        void write_json(std::ostream &out, const std::vector<Result> &results, const std::vector<CheckResult> &checks) {
+            out << "{\n  \"checks\": [\n";
+            for (size_t i = 0; i < checks.size(); i++) {
+                auto &check = checks[i];
+                out << "    {\"name\": \"" << check.name << "\", \"passed\": " << (check.failure.empty() ? "true" : "false");
+                if (!check.failure.empty()) {
+                    out << ", \"failure\": \"" << check.failure << "\"";
+                }
+                out << "}" << (i + 1 < checks.size() ? "," : "") << "\n";
+            }
+            out << "  ],\n  \"benchmarks\": [\n";
+            for (size_t i = 0; i < results.size(); i++) {
+                auto &result = results[i];
+                out << "    {\"name\": \"" << result.name << "\"";
+                if (!result.skip_reason.empty()) {
+                    out << ", \"skipped\": \"" << result.skip_reason << "\"";
+                } else {
+                    out << ", \"iterations\": " << result.iterations
+                        << ", \"median_ns\": " << result.median_ns
+                        << ", \"min_ns\": " << result.min_ns
+                        << ", \"max_ns\": " << result.max_ns
+                        << ", \"bytes_per_second\": " << result.bytes_per_second
+                        << ", \"items_per_second\": " << result.items_per_second;
+                }
+                out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            out << "  ]\n}\n";
+        }
+    }
+
+    Registration::Registration(const std::string &name, BenchFunction function, std::vector<int64_t> args) {
+        if (args.empty()) {
+            registry().push_back({name, function, 0});
+            return;
+        }
+        for (int64_t arg : args) {
+            registry().push_back({name + "/" + std::to_string(arg), function, arg});
+        }
+    }
+
+    CheckRegistration::CheckRegistration(const std::string &name, CheckFunction function) {
+        check_registry().push_back({name, function});
+    }
+
+    int run_main(int argc, char **argv) {
+        std::string filter{};
+        double min_time = 0.2;
+        int repetitions = 5;
+        bool json = false;
+        std::string output_path{};
+        bool list = false;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--filter" && has_value) {
+                filter = argv[++i];
+            } else if (arg == "--min-time" && has_value) {
+                min_time = std::stod(argv[++i]);
+            } else if (arg == "--repetitions" && has_value) {
+                repetitions = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--json") {
+                json = true;
+            } else if (arg == "--output" && has_value) {
+                output_path = argv[++i];
+            } else if (arg == "--list") {
+                list = true;
+            } else {
+                std::cerr << "usage: " << argv[0] << " [--filter <substring>] [--min-time <s>] [--repetitions <n>]"
+                    << " [--json] [--output <file>] [--list]" << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+
+        // checks first, a failing one makes the timings below meaningless
+        std::vector<CheckResult> checks{};
+        bool failed = false;
+        for (auto &check_case : check_registry()) {
+            if (!filter.empty() && check_case.name.find(filter) == std::string::npos) {
+                continue;
+            }
+            if (list) {
+                std::cout << check_case.name << '\n';
+                continue;
+            }
+            checks.push_back(run_check(check_case));
+            failed = failed || !checks.back().failure.empty();
+            if (!checks.back().failure.empty()) {
+                std::cerr << "check " << check_case.name << " failed: " << checks.back().failure << '\n';
+            }
+        }
+
+        std::vector<Result> results{};
+        for (auto &bench_case : registry()) {
+            if (!filter.empty() && bench_case.name.find(filter) == std::string::npos) {
+                continue;
+            }
+            if (list) {
+                std::cout << bench_case.name << '\n';
+                continue;
+            }
+            results.push_back(run_case(bench_case, min_time, repetitions));
+            if (!json && output_path.empty()) {
+                // progress for long runs, the table is printed at the end
+                std::cerr << "ran " << bench_case.name << '\n';
+            }
+        }
+        if (list) {
+            return EXIT_SUCCESS;
+        }
+
+        std::ofstream file{};
+        if (!output_path.empty()) {
+            file.open(output_path);
+            if (!file) {
+                std::cerr << "failed to open " << output_path << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        std::ostream &out = output_path.empty() ? std::cout : file;
+        if (json) {
+            write_json(out, results, checks);
+        } else {
+            write_text(out, results, checks);
+        }
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+}
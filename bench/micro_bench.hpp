@@ -0,0 +1,110 @@
+#ifndef micro_bench_
+    #define micro_bench_
+
+    // std
+    #include <cstdint>
+    #include <functional>
+    #include <string>
+    #include <vector>
+
+    // A small harness in the style of google benchmark: cases are registered with MICRO_BENCH, loop with
+    // `for (auto _ : state)`, and the runner picks the iteration count so every repetition runs for at
+    // least the minimum time. Reports the median of the repetitions, as text or JSON.
+    // Checks registered with MICRO_CHECK verify the results of the code under benchmark once before the
+    // timed cases, the runner exits with a failure if one of them does not hold.
+    namespace vke::micro {
+
+        class State {
+            public:
+            // a non trivial destructor keeps `for (auto _ : state)` free of unused variable warnings
+            struct Token {
+                ~Token() {}
+            };
+
+            struct Iterator {
+                uint64_t remaining;
+                bool operator!=(const Iterator &other) const { return remaining != other.remaining; }
+                void operator++() { remaining--; }
+                Token operator*() const { return {}; }
+            };
+
+            State(uint64_t iterations, int64_t arg) : iterations{iterations}, argument{arg} {}
+
+            Iterator begin() { return {iterations}; }
+            Iterator end() { return {0}; }
+
+            uint64_t get_iterations() const { return iterations; }
+            int64_t arg() const { return argument; }
+
+            // totals over all iterations, reported as throughput
+            void set_bytes_processed(uint64_t bytes) { bytes_processed = bytes; }
+            void set_items_processed(uint64_t items) { items_processed = items; }
+            void skip(const std::string &reason) { skip_reason = reason; }
+
+            uint64_t get_bytes_processed() const { return bytes_processed; }
+            uint64_t get_items_processed() const { return items_processed; }
+            const std::string &get_skip_reason() const { return skip_reason; }
+
+            private:
+            uint64_t iterations;
+            int64_t argument;
+            uint64_t bytes_processed = 0;
+            uint64_t items_processed = 0;
+            std::string skip_reason{};
+        };
+
+        using BenchFunction = std::function<void(State&)>;
+
+        class Check {
+            public:
+            // keeps the first failure, later ones are usually its consequences. Returns condition so loops
+            // can stop at the first failure.
+            bool expect(bool condition, const std::string &what) {
+                if (!condition && failure.empty()) {
+                    failure = what;
+                }
+                return condition;
+            }
+
+            bool failed() const { return !failure.empty(); }
+            const std::string &get_failure() const { return failure; }
+
+            private:
+            std::string failure{};
+        };
+
+        using CheckFunction = std::function<void(Check&)>;
+
+        struct Registration {
+            // without args the case runs once with arg 0, otherwise once per arg as name/arg
+            Registration(const std::string &name, BenchFunction function, std::vector<int64_t> args = {});
+        };
+
+        struct CheckRegistration {
+            CheckRegistration(const std::string &name, CheckFunction function);
+        };
+
+        // keeps value and everything it depends on from being optimized away
+        template<typename T>
+        inline void do_not_optimize(T const &value) {
+            asm volatile("" : : "r,m"(value) : "memory");
+        }
+
+        inline void clobber_memory() {
+            asm volatile("" : : : "memory");
+        }
+
+        int run_main(int argc, char **argv);
+    }
+
+    #define MICRO_BENCH_CONCAT_(a, b) a##b
+    #define MICRO_BENCH_CONCAT(a, b) MICRO_BENCH_CONCAT_(a, b)
+    // MICRO_BENCH(function) or MICRO_BENCH(function, {args...})
+    #define MICRO_BENCH(function, ...) \
+        static vke::micro::Registration MICRO_BENCH_CONCAT(micro_bench_registration_, __LINE__){#function, function __VA_OPT__(,) __VA_ARGS__}
+
+    // MICRO_CHECK(function), function takes a Check&
+    #define MICRO_CHECK(function) \
+        static vke::micro::CheckRegistration MICRO_BENCH_CONCAT(micro_check_registration_, __LINE__){#function, function}
+
+#endif
@@ -0,0 +1,91 @@
+// Measures what VKE_CPU_SCOPE costs per scope, disabled and enabled, against the same loop without
+// instrumentation. Exits with a failure if the disabled overhead is above the budget.
+#include "src/vke_cpu_trace.hpp"
+
+// std
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+    // keeps the loop body from being optimized away
+    volatile uint64_t sink = 0;
+
+    template<typename Body>
+    double ns_per_iteration(uint64_t iterations, Body body) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            body(i);
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    }
+
+    // best of several runs, the minimum is the least disturbed by the scheduler
+    template<typename Body>
+    double best_of(int runs, uint64_t iterations, Body body) {
+        double best = 1e30;
+        for (int run = 0; run < runs; run++) {
+            best = std::min(best, ns_per_iteration(iterations, body));
+        }
+        return best;
+    }
+
+    void work(uint64_t i) {
+        sink = sink + i * 2654435761u;
+    }
+}
+
+int main(int argc, char **argv) {
+    // nanoseconds a disabled scope may add to a loop iteration
+    double budget_ns = 1.0;
+    uint64_t iterations = 20'000'000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--budget-ns") == 0 && i + 1 < argc) {
+            budget_ns = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "usage: vke_trace_bench [--budget-ns <ns>] [--iterations <n>]" << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    constexpr int RUNS = 5;
+
+    double baseline = best_of(RUNS, iterations, [](uint64_t i) { work(i); });
+
+    vke::VkeCpuTrace::set_enabled(false);
+    double disabled = best_of(RUNS, iterations, [](uint64_t i) {
+        VKE_CPU_SCOPE("bench");
+        work(i);
+    });
+
+    // the per thread buffer fills up after THREAD_CAPACITY events, measure the recording path only
+    uint64_t enabled_iterations = vke::VkeCpuTrace::THREAD_CAPACITY;
+    vke::VkeCpuTrace::set_enabled(true);
+    double enabled = 1e30;
+    for (int run = 0; run < RUNS; run++) {
+        vke::VkeCpuTrace::clear();
+        enabled = std::min(enabled, ns_per_iteration(enabled_iterations, [](uint64_t i) {
+            VKE_CPU_SCOPE("bench");
+            work(i);
+        }));
+    }
+    vke::VkeCpuTrace::set_enabled(false);
+
+    double disabled_overhead = disabled - baseline;
+    std::cout << "baseline:         " << baseline << " ns/iteration" << '\n'
+              << "disabled scope:   " << disabled << " ns/iteration (+" << disabled_overhead << " ns)" << '\n'
+              << "enabled scope:    " << enabled << " ns/iteration (+" << enabled - baseline << " ns)" << '\n'
+              << "disabled budget:  " << budget_ns << " ns" << '\n';
+
+    if (disabled_overhead > budget_ns) {
+        std::cout << "FAIL: disabled overhead above budget" << '\n';
+        return EXIT_FAILURE;
+    }
+    std::cout << "OK" << '\n';
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,776 @@
+// Renders a procedurally generated scene headless for a fixed number of frames and reports cpu frame
+// times, draw calls, device memory and uploads as JSON. Runs on any vulkan device including lavapipe,
+// start it from the build directory so the shaders are found.
+// A paced run doubles as the frame pacing check, it fails if the frame interval varies more than the bound:
+//   vke_bench --preset small --target-fps 60 --max-frame-stddev 1
+#include "bench_scene.hpp"
+
+#include "src/vke_buffer.hpp"
+#include "src/vke_camera.hpp"
+#include "src/vke_descriptors.hpp"
+#include "src/vke_device.hpp"
+#include "src/vke_frame_info.hpp"
+#include "src/vke_frame_pacer.hpp"
+#include "src/vke_multiview_target.hpp"
+#include "src/vke_overdraw_counter.hpp"
+#include "src/vke_renderer.hpp"
+#include "src/vke_simple_render_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct BenchOptions {
+        std::string preset = "medium";
+        vke::BenchSceneConfig scene{};
+        uint32_t frames = 300;
+        // not part of the statistics, lets pipelines and caches settle
+        uint32_t warmup_frames = 30;
+        uint32_t width = 640;
+        uint32_t height = 480;
+        uint32_t frames_in_flight = 2;
+        std::string output_path{};
+        // streams the meshes through a VkeAssetManager with this upload budget per frame, 0 uploads
+        // them all before the first frame
+        uint32_t stream_budget_kb = 0;
+        // streamed objects sharing a few meshes, released halfway through the measured frames
+        uint32_t props = 0;
+        // point lights besides the key light, assigned to clusters every frame
+        uint32_t lights = 0;
+        bool depth_prepass = false;
+        // re-executes recorded draws while the scene is unchanged, pair it with --dynamic-ratio 0
+        bool cache_commands = false;
+        // renders this many views of a stereo rig into the layers of an offscreen target before the swap
+        // chain pass, 0 renders the scene into the swap chain
+        uint32_t views = 0;
+        // passes: every view culls and draws in a render pass of its own
+        // shared: one cull for all views, then a render pass per view
+        // multiview: one cull and one multiview render pass drawing all views at once
+        std::string view_mode = "shared";
+        // paces the frames with a VkeFramePacer, 0 renders as fast as the frame slots allow
+        float target_fps = 0.f;
+        // fails the run if the stddev of the measured frame intervals exceeds this, 0 does not check
+        float max_frame_stddev_ms = 0.f;
+    };
+
+    struct FrameSample {
+        double frame_ms;
+        // frame time without waiting for the gpu
+        double cpu_ms;
+        // light assignment and the upload of the light buffers
+        double light_ms;
+        // culling and recording the draws of all views
+        double render_ms;
+        uint32_t visible_lights;
+        uint32_t light_indices;
+        uint32_t max_cluster_lights;
+        uint32_t draw_calls;
+        uint64_t triangles;
+        uint32_t pipeline_binds;
+        uint32_t vertex_binds;
+        vke::VkeCommandRecorder::Statistics commands;
+    };
+
+    struct TimeSummary {
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    // nearest rank percentiles
+    TimeSummary summarize(std::vector<double> values) {
+        TimeSummary summary{};
+        if (values.empty()) {
+            return summary;
+        }
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](double p) {
+            size_t rank = static_cast<size_t>(p / 100.0 * values.size() + 0.5);
+            return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+        };
+        for (double value : values) {
+            summary.mean += value;
+        }
+        summary.mean /= values.size();
+        summary.p50 = percentile(50.0);
+        summary.p90 = percentile(90.0);
+        summary.p99 = percentile(99.0);
+        summary.max = values.back();
+        return summary;
+    }
+
+    void write_summary(std::ostream &out, const char *name, const TimeSummary &summary) {
+        out << "    \"" << name << "\": {"
+            << "\"mean\": " << summary.mean
+            << ", \"p50\": " << summary.p50
+            << ", \"p90\": " << summary.p90
+            << ", \"p99\": " << summary.p99
+            << ", \"max\": " << summary.max << "},\n";
+    }
+
+    void print_usage() {
+        std::cerr << "usage: vke_bench [options]" << '\n'
+            << "  --preset <small|medium|large>  scene defaults, applied before the options below (medium)" << '\n'
+            << "  --objects <n>                  number of objects" << '\n'
+            << "  --meshes <n>                   number of unique meshes" << '\n'
+            << "  --min-triangles <n>            triangles of the smallest mesh" << '\n'
+            << "  --max-triangles <n>            triangles of the largest mesh" << '\n'
+            << "  --dynamic-ratio <0..1>         fraction of objects moving every frame (0.25)" << '\n'
+            << "  --seed <n>                     scene generator seed (1)" << '\n'
+            << "  --frames <n>                   measured frames (300)" << '\n'
+            << "  --warmup <n>                   frames rendered before measuring (30)" << '\n'
+            << "  --width <px>, --height <px>    render size (640x480)" << '\n'
+            << "  --frames-in-flight <n>         (2)" << '\n'
+            << "  --lights <n>                   point lights besides the key light (0)" << '\n'
+            << "  --depth-prepass                draw depth only first, then shade with an EQUAL depth test" << '\n'
+            << "  --cache-commands               re-submit the recorded draws while the scene is unchanged" << '\n'
+            << "  --views <n>                    render n views of a stereo rig into an offscreen target (off)" << '\n'
+            << "  --view-mode <passes|shared|multiview>  how the views are culled and drawn (shared)" << '\n'
+            << "  --stream-budget <kb>           load the meshes in the background, uploading at most kb per frame (off)" << '\n'
+            << "  --props <n>                    with --stream-budget, n objects loading the same few meshes, released halfway (0)" << '\n'
+            << "  --target-fps <fps>             pace the frames to this rate (off)" << '\n'
+            << "  --max-frame-stddev <ms>        with --target-fps, fail if the frame interval stddev exceeds ms (off)" << '\n'
+            << "  --output <file>                write the JSON report to a file instead of stdout" << '\n';
+    }
+
+    bool parse_options(int argc, char **argv, BenchOptions &options) {
+        // the preset goes first so explicit options override it wherever they appear
+        for (int i = 1; i + 1 < argc; i++) {
+            if (std::strcmp(argv[i], "--preset") == 0) {
+                options.preset = argv[i + 1];
+            }
+        }
+        if (!vke::BenchSceneConfig::from_preset(options.preset, options.scene)) {
+            std::cerr << "unknown preset '" << options.preset << "'" << '\n';
+            return false;
+        }
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--depth-prepass") {
+                options.depth_prepass = true;
+                continue;
+            }
+            if (arg == "--cache-commands") {
+                options.cache_commands = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                return false;
+            }
+            const char *value = argv[++i];
+            if (arg == "--preset") {
+                continue;
+            } else if (arg == "--objects") {
+                options.scene.object_count = std::stoul(value);
+            } else if (arg == "--meshes") {
+                options.scene.mesh_count = std::max(1ul, std::stoul(value));
+            } else if (arg == "--min-triangles") {
+                options.scene.min_triangles = std::stoul(value);
+            } else if (arg == "--max-triangles") {
+                options.scene.max_triangles = std::stoul(value);
+            } else if (arg == "--dynamic-ratio") {
+                options.scene.dynamic_ratio = std::clamp(std::stof(value), 0.f, 1.f);
+            } else if (arg == "--seed") {
+                options.scene.seed = std::stoul(value);
+            } else if (arg == "--frames") {
+                options.frames = std::max(1ul, std::stoul(value));
+            } else if (arg == "--warmup") {
+                options.warmup_frames = std::stoul(value);
+            } else if (arg == "--width") {
+                options.width = std::stoul(value);
+            } else if (arg == "--height") {
+                options.height = std::stoul(value);
+            } else if (arg == "--frames-in-flight") {
+                options.frames_in_flight = std::max(1ul, std::stoul(value));
+            } else if (arg == "--lights") {
+                options.lights = std::stoul(value);
+            } else if (arg == "--views") {
+                options.views = std::stoul(value);
+            } else if (arg == "--view-mode") {
+                options.view_mode = value;
+            } else if (arg == "--stream-budget") {
+                options.stream_budget_kb = std::stoul(value);
+            } else if (arg == "--props") {
+                options.props = std::stoul(value);
+            } else if (arg == "--target-fps") {
+                options.target_fps = std::max(std::stof(value), 0.f);
+            } else if (arg == "--max-frame-stddev") {
+                options.max_frame_stddev_ms = std::max(std::stof(value), 0.f);
+            } else if (arg == "--output") {
+                options.output_path = value;
+            } else {
+                return false;
+            }
+        }
+        options.scene.max_triangles = std::max(options.scene.max_triangles, options.scene.min_triangles);
+        options.scene.with_positions = options.depth_prepass;
+        if (options.view_mode != "passes" && options.view_mode != "shared" && options.view_mode != "multiview") {
+            std::cerr << "unknown view mode '" << options.view_mode << "'" << '\n';
+            return false;
+        }
+        if (options.views > vke::MAX_MULTIVIEW_VIEWS) {
+            std::cerr << "at most " << vke::MAX_MULTIVIEW_VIEWS << " views" << '\n';
+            return false;
+        }
+        if (options.props > 0 && options.stream_budget_kb == 0) {
+            std::cerr << "--props needs --stream-budget" << '\n';
+            return false;
+        }
+        if (options.max_frame_stddev_ms > 0.f && options.target_fps <= 0.f) {
+            std::cerr << "--max-frame-stddev needs --target-fps" << '\n';
+            return false;
+        }
+        if (options.views > 0 && options.cache_commands) {
+            std::cerr << "--cache-commands renders a single view" << '\n';
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options{};
+    try {
+        if (!parse_options(argc, argv, options)) {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    } catch (const std::logic_error&) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        vke::VkeDevice device{nullptr};
+
+        vke::SwapChainConfig swap_chain_config{};
+        swap_chain_config.framesInFlight = options.frames_in_flight;
+        vke::VkeRenderer renderer{nullptr, device, swap_chain_config, {options.width, options.height}};
+        const uint32_t frames_in_flight = renderer.get_frames_in_flight();
+
+        // uploads and allocations of the renderer itself are not part of the scene numbers
+        vke::DeviceStatistics before_scene = device.getStatistics();
+        auto build_start = std::chrono::steady_clock::now();
+        std::unique_ptr<vke::VkeAssetManager> assets{};
+        if (options.stream_budget_kb > 0) {
+            assets = std::make_unique<vke::VkeAssetManager>(
+                device,
+                frames_in_flight,
+                std::max(std::thread::hardware_concurrency() / 2, 1u),
+                static_cast<VkDeviceSize>(options.stream_budget_kb) * 1024
+            );
+        }
+        vke::BenchScene scene = vke::generate_bench_scene(device, options.scene, assets.get());
+        double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+        vke::DeviceStatistics after_scene = device.getStatistics();
+
+        // every view has its own camera constants and light clusters in each frame slot, a multiview pass
+        // only uses those of its first view
+        const uint32_t view_count = std::max(options.views, 1u);
+        const bool multiview = options.views > 0 && options.view_mode == "multiview";
+        auto view_slot = [&](int frame_index, uint32_t view) { return frame_index * view_count + view; };
+
+        std::vector<vke::VkePointLight> lights = vke::generate_bench_lights(scene, options.lights, options.scene.seed);
+        vke::VkeClusteredLights clustered_lights{
+            device,
+            frames_in_flight * view_count,
+            std::max(static_cast<uint32_t>(lights.size()), 16384u),
+            // room for each light to touch 64 clusters on average
+            std::max(static_cast<uint32_t>(lights.size()) * 64, 512u * 1024)
+        };
+
+        auto global_pool = vke::VkeDescriptorPool::Builder(device)
+            .set_max_sets(frames_in_flight * view_count)
+            .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frames_in_flight * view_count)
+            .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * frames_in_flight * view_count)
+            .build();
+        auto global_set_layout = vke::VkeDescriptorSetLayout::Builder(device)
+            .add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+            .add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .build();
+
+        std::vector<std::unique_ptr<vke::VkeBuffer>> ubo_buffers(frames_in_flight * view_count);
+        std::vector<VkDescriptorSet> global_descriptor_sets(frames_in_flight * view_count);
+        for (uint32_t i = 0; i < frames_in_flight * view_count; i++) {
+            ubo_buffers[i] = std::make_unique<vke::VkeBuffer>(
+                device,
+                sizeof(vke::GlobalUBO),
+                1,
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+            );
+            ubo_buffers[i]->map();
+            auto buffer_info = ubo_buffers[i]->descriptor_info();
+            auto light_infos = clustered_lights.get_buffer_infos(i);
+            vke::VkeDescriptorWriter(*global_set_layout, *global_pool)
+                .write_buffer(0, &buffer_info)
+                .write_buffer(1, &light_infos[0])
+                .write_buffer(2, &light_infos[1])
+                .write_buffer(3, &light_infos[2])
+                .build(global_descriptor_sets[i]);
+        }
+
+        std::unique_ptr<vke::VkeMultiviewTarget> view_target{};
+        VkRenderPass render_pass = renderer.get_swap_chain_render_pass();
+        if (options.views > 0) {
+            view_target = std::make_unique<vke::VkeMultiviewTarget>(device, VkExtent2D{options.width, options.height}, options.views);
+            if (multiview && !view_target->supports_multiview()) {
+                throw std::runtime_error("failed to find multiview support for " + std::to_string(options.views) + " views");
+            }
+            render_pass = multiview ? view_target->get_multiview_render_pass() : view_target->get_layer_render_pass();
+        }
+        vke::VkeSimpleRenderSystem render_system{
+            device,
+            render_pass,
+            global_set_layout->get_descriptor_set_layout(),
+            multiview ? options.views : 0
+        };
+        render_system.set_depth_prepass(options.depth_prepass);
+        render_system.set_command_caching(options.cache_commands, frames_in_flight);
+
+        // fragment shader invocations per pixel, the number the pre-pass and the sorting bring down
+        // the queries are recorded inline in the subpass, which a cached recording does not allow
+        std::unique_ptr<vke::VkeOverdrawCounter> overdraw_counter{};
+        // the counter covers the swap chain pass, which stays empty while views are rendered offscreen
+        if (device.supportsPipelineStatistics() && !options.cache_commands && !view_target) {
+            overdraw_counter = std::make_unique<vke::VkeOverdrawCounter>(device, frames_in_flight);
+        }
+
+        vke::VkeCamera camera{};
+        // the eyes of the stereo rig, parallel to the center camera
+        std::vector<vke::VkeCamera> view_cameras(options.views);
+        std::vector<vke::VkeView> views(options.views);
+        uint64_t sphere_tests = 0;
+        std::vector<uint64_t> visible_objects(options.views, 0);
+        // fixed time step, so every run animates and views the scene the same way
+        constexpr float TIME_STEP = 1.f / 60.f;
+        uint32_t total_frames = options.warmup_frames + options.frames;
+
+        if (options.props > 0) {
+            vke::add_bench_props(scene, *assets, options.props, options.scene.seed, options.depth_prepass);
+        }
+        const uint32_t props_release_frame = options.warmup_frames + options.frames / 2;
+        VkDeviceSize resident_bytes_with_props = 0;
+
+        vke::DeviceStatistics before_frames = device.getStatistics();
+        std::vector<FrameSample> samples{};
+        samples.reserve(options.frames);
+        // frames rendered while meshes were still streaming, warmup included
+        std::vector<double> loading_frame_times{};
+        uint32_t frames_to_load = 0;
+        double load_ms = 0.0;
+        uint32_t peak_queued_loads = 0;
+        uint32_t peak_pending_uploads = 0;
+        VkDeviceSize peak_frame_upload_bytes = 0;
+        bool loading = assets != nullptr;
+
+        vke::VkeFramePacer frame_pacer{options.target_fps, frames_in_flight};
+        uint32_t frame = 0;
+        auto run_start = std::chrono::steady_clock::now();
+        while (frame < total_frames) {
+            if (frame == options.warmup_frames) {
+                frame_pacer.reset_statistics();
+            }
+            // the pacing sleep is not part of the frame time
+            int next_frame_index = renderer.get_next_frame_index();
+            frame_pacer.wait_for_next_frame(next_frame_index);
+            auto frame_start = std::chrono::steady_clock::now();
+
+            if (!scene.props.empty() && frame == props_release_frame) {
+                resident_bytes_with_props = assets->get_statistics().resident_bytes;
+                vke::release_bench_props(scene);
+            }
+
+            frame_pacer.mark_gpu_complete(next_frame_index, renderer.wait_for_next_frame_slot());
+            double wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+
+            float time = frame * TIME_STEP;
+            vke::animate_bench_scene(scene, time);
+
+            float angle = glm::two_pi<float>() * frame / total_frames;
+            float distance = 2.5f * scene.extent + 2.f;
+            camera.set_view_target(
+                glm::vec3(distance * glm::sin(angle), -.5f * scene.extent, -distance * glm::cos(angle)),
+                glm::vec3(0.f)
+            );
+            camera.set_perspective_projection(glm::radians(50.f), renderer.get_aspect_ratio(), 0.1f, 4.f * distance);
+            if (view_target) {
+                glm::vec3 position{distance * glm::sin(angle), -.5f * scene.extent, -distance * glm::cos(angle)};
+                const glm::mat4 &view = camera.get_view();
+                glm::vec3 right{view[0][0], view[1][0], view[2][0]};
+                for (uint32_t v = 0; v < options.views; v++) {
+                    glm::vec3 offset = right * ((v - (options.views - 1) * .5f) * .02f * distance);
+                    view_cameras[v].set_view_target(position + offset, offset);
+                    view_cameras[v].set_perspective_projection(glm::radians(50.f), view_target->get_aspect_ratio(), 0.1f, 4.f * distance);
+                    views[v] = {&view_cameras[v], {{0, 0}, view_target->get_extent()}, VK_NULL_HANDLE, false};
+                }
+                if (multiview) {
+                    // the lights are clustered once for all eyes, the center camera widened to cover them
+                    camera.set_perspective_projection(glm::radians(55.f), view_target->get_aspect_ratio(), 0.1f, 4.f * distance);
+                }
+            }
+
+            VkCommandBuffer command_buffer = renderer.begin_frame();
+            if (!command_buffer) {
+                continue;
+            }
+            int frame_index = renderer.get_frame_index();
+            if (overdraw_counter) {
+                overdraw_counter->begin_frame(command_buffer, frame_index, {options.width, options.height});
+                if (frame == options.warmup_frames) {
+                    overdraw_counter->reset_statistics();
+                }
+            }
+
+            if (assets) {
+                // after loading only released models are left to destroy
+                assets->update(command_buffer, frame_index);
+                if (loading) {
+                    for (auto &[id, obj] : scene.objects) {
+                        obj.model = assets->get_model(obj.mesh);
+                    }
+                }
+            }
+
+            vke::FrameInfo frame_info{
+                frame_index,
+                TIME_STEP,
+                command_buffer,
+                camera,
+                global_descriptor_sets[view_slot(frame_index, 0)],
+                scene.objects,
+                nullptr,
+                // full meshes, the draws stay comparable between runs
+                0.f,
+                {options.width, options.height}
+            };
+
+            // separate views each cluster the lights for their own camera
+            const bool separate_views = view_target && !multiview;
+            double light_ms = 0.0;
+            for (uint32_t v = 0; v < (separate_views ? options.views : 1); v++) {
+                const vke::VkeCamera &light_camera = separate_views ? view_cameras[v] : camera;
+                uint32_t slot = view_slot(frame_index, v);
+                auto light_start = std::chrono::steady_clock::now();
+                clustered_lights.update(slot, light_camera, {options.width, options.height}, lights);
+                light_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - light_start).count();
+
+                vke::GlobalUBO ubo{};
+                ubo.projection_view = light_camera.get_projection() * light_camera.get_view();
+                ubo.view = light_camera.get_view();
+                ubo.viewport = {0.f, 0.f, static_cast<float>(options.width), static_cast<float>(options.height)};
+                clustered_lights.write_parameters(ubo);
+                if (multiview) {
+                    for (uint32_t eye = 0; eye < options.views; eye++) {
+                        ubo.view_projections[eye] = view_cameras[eye].get_projection() * view_cameras[eye].get_view();
+                    }
+                }
+                ubo_buffers[slot]->write_to_buffer(&ubo);
+                ubo_buffers[slot]->flush();
+                if (v < views.size()) {
+                    views[v].global_descriptor_set = global_descriptor_sets[slot];
+                }
+            }
+
+            // draws, triangles and commands of all passes
+            uint32_t draw_calls = 0;
+            uint64_t triangles = 0;
+            vke::VkeCommandRecorder::Statistics commands{};
+            auto add_statistics = [&]() {
+                draw_calls += render_system.get_draw_count();
+                triangles += render_system.get_triangle_count();
+                commands += render_system.get_command_statistics();
+            };
+            // what the last cull tested, first_view is the index of its view 0 in the rig
+            auto add_culling = [&](uint32_t first_view, uint32_t count) {
+                if (frame < options.warmup_frames) {
+                    return;
+                }
+                const auto &culler = render_system.get_view_culler();
+                sphere_tests += culler.get_sphere_tests();
+                for (uint32_t v = 0; v < count; v++) {
+                    visible_objects[first_view + v] += culler.get_visible_count(v);
+                }
+            };
+
+            auto render_start = std::chrono::steady_clock::now();
+            if (view_target && options.view_mode == "passes") {
+                for (uint32_t v = 0; v < options.views; v++) {
+                    view_target->begin_layer_pass(command_buffer, v);
+                    render_system.render_views(frame_info, {views[v]});
+                    view_target->end_pass(command_buffer);
+                    add_statistics();
+                    add_culling(v, 1);
+                }
+            } else if (view_target && options.view_mode == "shared") {
+                render_system.cull_views(frame_info, views);
+                add_culling(0, options.views);
+                for (uint32_t v = 0; v < options.views; v++) {
+                    view_target->begin_layer_pass(command_buffer, v);
+                    render_system.record_view(v);
+                    view_target->end_pass(command_buffer);
+                }
+                add_statistics();
+            } else if (view_target) {
+                view_target->begin_multiview_pass(command_buffer);
+                render_system.render_views(frame_info, views);
+                view_target->end_pass(command_buffer);
+                add_statistics();
+                add_culling(0, options.views);
+            }
+
+            // with views the swap chain pass stays empty, it only presents
+            renderer.begin_swap_chain_render_pass(
+                command_buffer,
+                options.cache_commands ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE
+            );
+            if (!view_target) {
+                if (overdraw_counter) {
+                    overdraw_counter->begin(command_buffer);
+                }
+                render_system.render_game_objects(frame_info);
+                if (overdraw_counter) {
+                    overdraw_counter->end(command_buffer);
+                }
+                add_statistics();
+            }
+            double render_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - render_start).count();
+            renderer.end_swap_chain_render_pass(command_buffer);
+            renderer.end_frame();
+            frame_pacer.mark_submitted(frame_index);
+
+            double frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+            if (loading) {
+                auto statistics = assets->get_statistics();
+                loading_frame_times.push_back(frame_ms);
+                peak_queued_loads = std::max(peak_queued_loads, statistics.queued_loads + statistics.active_loads);
+                peak_pending_uploads = std::max(peak_pending_uploads, statistics.pending_uploads);
+                peak_frame_upload_bytes = std::max(peak_frame_upload_bytes, statistics.last_frame_upload_bytes);
+                if (statistics.progress() >= 1.f) {
+                    loading = false;
+                    frames_to_load = frame + 1;
+                    load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+                }
+            }
+
+            if (frame >= options.warmup_frames) {
+                // any wait left inside begin_frame is gpu time as well
+                double gpu_wait_ms = wait_ms + renderer.get_last_wait_time() * 1000.0;
+                const auto &grid = clustered_lights.get_grid();
+                samples.push_back({
+                    frame_ms,
+                    std::max(frame_ms - gpu_wait_ms, 0.0),
+                    light_ms,
+                    render_ms,
+                    grid.get_visible_lights(),
+                    static_cast<uint32_t>(grid.get_light_indices().size()),
+                    grid.get_max_cluster_lights(),
+                    draw_calls,
+                    triangles,
+                    commands.get_issued(vke::VkeCommandRecorder::Command::BindPipeline),
+                    commands.get_issued(vke::VkeCommandRecorder::Command::BindVertexBuffers),
+                    commands
+                });
+            }
+            frame++;
+        }
+        vkDeviceWaitIdle(device.device());
+        double run_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+        vke::DeviceStatistics after_frames = device.getStatistics();
+
+        std::vector<double> frame_times{};
+        std::vector<double> cpu_times{};
+        std::vector<double> light_times{};
+        std::vector<double> render_times{};
+        uint64_t draw_calls = 0;
+        uint64_t triangles = 0;
+        uint64_t pipeline_binds = 0;
+        uint64_t vertex_binds = 0;
+        vke::VkeCommandRecorder::Statistics commands{};
+        uint64_t visible_lights = 0;
+        uint64_t light_indices = 0;
+        uint32_t max_cluster_lights = 0;
+        for (auto &sample : samples) {
+            frame_times.push_back(sample.frame_ms);
+            cpu_times.push_back(sample.cpu_ms);
+            light_times.push_back(sample.light_ms);
+            render_times.push_back(sample.render_ms);
+            visible_lights += sample.visible_lights;
+            light_indices += sample.light_indices;
+            max_cluster_lights = std::max(max_cluster_lights, sample.max_cluster_lights);
+            draw_calls += sample.draw_calls;
+            triangles += sample.triangles;
+            pipeline_binds += sample.pipeline_binds;
+            vertex_binds += sample.vertex_binds;
+            commands += sample.commands;
+        }
+
+        std::ofstream file{};
+        if (!options.output_path.empty()) {
+            file.open(options.output_path);
+            if (!file) {
+                throw std::runtime_error("failed to open " + options.output_path);
+            }
+        }
+        std::ostream &out = options.output_path.empty() ? std::cout : file;
+
+        out << "{\n"
+            << "  \"device\": \"" << device.properties.deviceName << "\",\n"
+            << "  \"config\": {\n"
+            << "    \"preset\": \"" << options.preset << "\",\n"
+            << "    \"objects\": " << options.scene.object_count << ",\n"
+            << "    \"meshes\": " << options.scene.mesh_count << ",\n"
+            << "    \"min_triangles\": " << options.scene.min_triangles << ",\n"
+            << "    \"max_triangles\": " << options.scene.max_triangles << ",\n"
+            << "    \"dynamic_ratio\": " << options.scene.dynamic_ratio << ",\n"
+            << "    \"seed\": " << options.scene.seed << ",\n"
+            << "    \"frames\": " << options.frames << ",\n"
+            << "    \"warmup_frames\": " << options.warmup_frames << ",\n"
+            << "    \"width\": " << options.width << ",\n"
+            << "    \"height\": " << options.height << ",\n"
+            << "    \"frames_in_flight\": " << frames_in_flight << ",\n"
+            << "    \"lights\": " << options.lights << ",\n"
+            << "    \"depth_prepass\": " << (options.depth_prepass ? "true" : "false") << ",\n"
+            << "    \"cache_commands\": " << (options.cache_commands ? "true" : "false") << ",\n"
+            << "    \"views\": " << options.views << ",\n"
+            << "    \"view_mode\": \"" << options.view_mode << "\",\n"
+            << "    \"stream_budget_kb\": " << options.stream_budget_kb << ",\n"
+            << "    \"props\": " << options.props << ",\n"
+            << "    \"target_fps\": " << options.target_fps << "\n"
+            << "  },\n"
+            << "  \"scene\": {\n"
+            << "    \"build_ms\": " << build_ms << ",\n"
+            << "    \"dynamic_objects\": " << scene.dynamic_objects.size() << ",\n"
+            << "    \"mesh_triangles\": " << scene.mesh_triangles << ",\n"
+            << "    \"scene_triangles\": " << scene.scene_triangles << ",\n"
+            << "    \"uploads\": " << after_scene.uploadCount - before_scene.uploadCount << ",\n"
+            << "    \"upload_bytes\": " << after_scene.uploadedBytes - before_scene.uploadedBytes << "\n"
+            << "  },\n";
+        if (assets) {
+            auto statistics = assets->get_statistics();
+            out << "  \"streaming\": {\n"
+                << "    \"models\": " << statistics.model_count << ",\n"
+                << "    \"ready_models\": " << statistics.ready_models << ",\n"
+                << "    \"failed_loads\": " << statistics.failed_loads << ",\n"
+                << "    \"frames_to_load\": " << frames_to_load << ",\n"
+                << "    \"load_ms\": " << load_ms << ",\n";
+            // spikes while loading show up in max and p99
+            write_summary(out, "loading_frame_ms", summarize(loading_frame_times));
+            out << "    \"peak_queued_loads\": " << peak_queued_loads << ",\n"
+                << "    \"peak_pending_uploads\": " << peak_pending_uploads << ",\n"
+                << "    \"peak_frame_upload_bytes\": " << peak_frame_upload_bytes << ",\n"
+                << "    \"shared_loads\": " << statistics.shared_loads << ",\n"
+                << "    \"resident_bytes\": " << statistics.resident_bytes << ",\n";
+            if (options.props > 0) {
+                // resident bytes drop by the prop meshes once the props are gone
+                out << "    \"props\": {"
+                    << "\"objects\": " << options.props
+                    << ", \"resident_bytes_with_props\": " << resident_bytes_with_props
+                    << ", \"released_models\": " << statistics.released_models
+                    << ", \"retired_bytes\": " << statistics.retired_bytes << "},\n";
+            }
+            out << "    \"uploaded_bytes\": " << statistics.uploaded_bytes << ",\n"
+                << "    \"upload_frames\": " << statistics.upload_frames << "\n"
+                << "  },\n";
+        }
+        out << "  \"lighting\": {\n"
+            << "    \"lights\": " << lights.size() << ",\n"
+            << "    \"clusters\": " << vke::VkeLightGrid::CLUSTER_COUNT << ",\n";
+        write_summary(out, "assign_ms", summarize(light_times));
+        out << "    \"visible_lights_per_frame\": " << (samples.empty() ? 0 : visible_lights / samples.size()) << ",\n"
+            << "    \"light_indices_per_frame\": " << (samples.empty() ? 0 : light_indices / samples.size()) << ",\n"
+            << "    \"max_cluster_lights\": " << max_cluster_lights << ",\n"
+            << "    \"dropped_indices\": " << clustered_lights.get_grid().get_dropped_indices() << "\n"
+            << "  },\n";
+        if (overdraw_counter) {
+            // frames still in flight at the end are not read back
+            out << "  \"overdraw\": {\n"
+                << "    \"fragments_per_pixel\": " << overdraw_counter->get_mean_overdraw() << "\n"
+                << "  },\n";
+        }
+        if (auto *cache = render_system.get_command_cache()) {
+            // warmup included, every frame executes the recording of its slot
+            out << "  \"command_cache\": {\n"
+                << "    \"recorded_frames\": " << cache->get_recorded_frames() << ",\n"
+                << "    \"reused_frames\": " << cache->get_reused_frames() << "\n"
+                << "  },\n";
+        }
+        if (view_target) {
+            // per frame, compare render_ms of the frames between the modes
+            out << "  \"views\": {\n"
+                << "    \"count\": " << options.views << ",\n"
+                << "    \"mode\": \"" << options.view_mode << "\",\n"
+                << "    \"visible_objects\": [";
+            for (uint32_t v = 0; v < options.views; v++) {
+                out << (v > 0 ? ", " : "") << (samples.empty() ? 0 : visible_objects[v] / samples.size());
+            }
+            out << "],\n"
+                << "    \"sphere_tests_per_frame\": " << (samples.empty() ? 0 : sphere_tests / samples.size()) << "\n"
+                << "  },\n";
+        }
+        // per frame, issued commands reach the driver, elided ones were dropped as redundant
+        out << "  \"commands\": {\n";
+        for (uint32_t i = 0; i < vke::VkeCommandRecorder::COMMAND_COUNT; i++) {
+            out << "    \"" << vke::VkeCommandRecorder::to_string(static_cast<vke::VkeCommandRecorder::Command>(i)) << "\": {"
+                << "\"issued\": " << (samples.empty() ? 0 : commands.issued[i] / samples.size())
+                << ", \"elided\": " << (samples.empty() ? 0 : commands.elided[i] / samples.size()) << "},\n";
+        }
+        out << "    \"issued\": " << (samples.empty() ? 0 : commands.total_issued() / samples.size()) << ",\n"
+            << "    \"elided\": " << (samples.empty() ? 0 : commands.total_elided() / samples.size()) << "\n"
+            << "  },\n";
+        out << "  \"frames\": {\n"
+            << "    \"count\": " << samples.size() << ",\n"
+            << "    \"fps\": " << total_frames / run_s << ",\n";
+        write_summary(out, "frame_ms", summarize(frame_times));
+        // start to start intervals of the measured frames, sleeps of the pacer included
+        out << "    \"interval_ms\": {"
+            << "\"mean\": " << frame_pacer.get_frame_time_mean() * 1000.f
+            << ", \"stddev\": " << frame_pacer.get_frame_time_stddev() * 1000.f << "},\n";
+        write_summary(out, "cpu_ms", summarize(cpu_times));
+        write_summary(out, "render_ms", summarize(render_times));
+        out << "    \"draw_calls_per_frame\": " << (samples.empty() ? 0 : draw_calls / samples.size()) << ",\n"
+            << "    \"triangles_per_frame\": " << (samples.empty() ? 0 : triangles / samples.size()) << ",\n"
+            << "    \"pipeline_binds_per_frame\": " << (samples.empty() ? 0 : pipeline_binds / samples.size()) << ",\n"
+            << "    \"vertex_binds_per_frame\": " << (samples.empty() ? 0 : vertex_binds / samples.size()) << ",\n"
+            << "    \"uploads\": " << after_frames.uploadCount - before_frames.uploadCount << ",\n"
+            << "    \"upload_bytes\": " << after_frames.uploadedBytes - before_frames.uploadedBytes << "\n"
+            << "  },\n"
+            << "  \"memory\": {\n"
+            << "    \"allocations\": " << after_frames.allocationCount << ",\n"
+            << "    \"allocated_bytes\": " << after_frames.allocatedBytes << ",\n"
+            << "    \"peak_allocated_bytes\": " << after_frames.peakAllocatedBytes << ",\n"
+            << "    \"scene_bytes\": " << after_scene.allocatedBytes - before_scene.allocatedBytes << "\n"
+            << "  }\n"
+            << "}\n";
+
+        float frame_stddev_ms = frame_pacer.get_frame_time_stddev() * 1000.f;
+        if (options.max_frame_stddev_ms > 0.f && frame_stddev_ms > options.max_frame_stddev_ms) {
+            std::cerr << "frame interval stddev " << frame_stddev_ms << " ms exceeds " << options.max_frame_stddev_ms
+                << " ms at " << options.target_fps << " fps" << '\n';
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
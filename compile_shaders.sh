@@ -7,4 +7,12 @@ echo "using glslc at $GLSLC_PATH"
 
 
 $GLSLC_PATH "$SCRIPT_DIR/shaders/simple_shader.vert" -o "$SCRIPT_DIR/shaders/simple_shader.vert.spv"
-$GLSLC_PATH "$SCRIPT_DIR/shaders/simple_shader.frag" -o "$SCRIPT_DIR/shaders/simple_shader.frag.spv"
\ No newline at end of file
+$GLSLC_PATH "$SCRIPT_DIR/shaders/simple_shader.frag" -o "$SCRIPT_DIR/shaders/simple_shader.frag.spv"
+$GLSLC_PATH "$SCRIPT_DIR/shaders/depth_shader.vert" -o "$SCRIPT_DIR/shaders/depth_shader.vert.spv"
+# the same sources broadcasting to the views of a multiview render pass
+$GLSLC_PATH --target-env=vulkan1.1 -DMULTIVIEW "$SCRIPT_DIR/shaders/simple_shader.vert" -o "$SCRIPT_DIR/shaders/simple_shader_multiview.vert.spv"
+$GLSLC_PATH --target-env=vulkan1.1 -DMULTIVIEW "$SCRIPT_DIR/shaders/simple_shader.frag" -o "$SCRIPT_DIR/shaders/simple_shader_multiview.frag.spv"
+$GLSLC_PATH --target-env=vulkan1.1 -DMULTIVIEW "$SCRIPT_DIR/shaders/depth_shader.vert" -o "$SCRIPT_DIR/shaders/depth_shader_multiview.vert.spv"
+$GLSLC_PATH "$SCRIPT_DIR/shaders/bindless_shader.vert" -o "$SCRIPT_DIR/shaders/bindless_shader.vert.spv"
+$GLSLC_PATH "$SCRIPT_DIR/shaders/bindless_shader.frag" -o "$SCRIPT_DIR/shaders/bindless_shader.frag.spv"
+$GLSLC_PATH --target-env=vulkan1.2 "$SCRIPT_DIR/shaders/meshlet_shader.mesh" -o "$SCRIPT_DIR/shaders/meshlet_shader.mesh.spv"
\ No newline at end of file
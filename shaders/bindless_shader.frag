@@ -0,0 +1,74 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 frag_color;
+layout(location = 1) in vec3 frag_pos_world;
+layout(location = 2) in vec3 frag_normal_world;
+layout(location = 3) in vec2 frag_uv;
+layout(location = 4) flat in uint frag_texture_slot;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 projection_view_matrix;
+    mat4 view_matrix;
+    vec4 ambient_light_color;
+    vec4 cluster_scale; // tiles per pixel (x,y), depth slice scale and bias (z,w)
+    uvec4 cluster_grid; // tiles x, tiles y, depth slices, light count
+} ubo;
+
+struct PointLight {
+    vec4 position_radius; // world space, w is the radius
+    vec4 color; // (r,g,b,intensity)
+};
+
+// clustered lights, see VkeLightGrid
+layout(set = 0, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+layout(set = 0, binding = 2) readonly buffer Clusters {
+    uvec2 clusters[]; // offset and count in light_indices
+};
+layout(set = 0, binding = 3) readonly buffer LightIndices {
+    uint light_indices[];
+};
+
+// bindless textures, partially bound so only slots that are written may be sampled
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+
+const uint INVALID_SLOT = 0xffffffffu;
+
+// diffuse light of the lights in the fragment's cluster
+vec3 point_lighting(vec3 normal) {
+    float view_depth = (ubo.view_matrix * vec4(frag_pos_world, 1.)).z;
+    uvec3 cell = uvec3(
+        min(uvec2(gl_FragCoord.xy * ubo.cluster_scale.xy), ubo.cluster_grid.xy - 1u),
+        uint(clamp(floor(log(view_depth) * ubo.cluster_scale.z + ubo.cluster_scale.w), 0., float(ubo.cluster_grid.z - 1u)))
+    );
+    uvec2 cluster = clusters[(cell.z * ubo.cluster_grid.y + cell.y) * ubo.cluster_grid.x + cell.x];
+
+    vec3 diffuse_light = vec3(0.);
+    for (uint i = 0; i < cluster.y; i++) {
+        PointLight light = lights[light_indices[cluster.x + i]];
+        vec3 direction_to_light = light.position_radius.xyz - frag_pos_world;
+        float distance_squared = dot(direction_to_light, direction_to_light);
+        // inverse square falloff, windowed to reach 0 at the radius the light was assigned with
+        float window = clamp(1. - distance_squared / (light.position_radius.w * light.position_radius.w), 0., 1.);
+        float attenuation = window * window / max(distance_squared, 1e-4);
+        vec3 light_color = light.color.xyz * light.color.w * attenuation;
+        diffuse_light += light_color * max(dot(normal, direction_to_light * inversesqrt(max(distance_squared, 1e-8))), 0.);
+    }
+    return diffuse_light;
+}
+
+void main() {
+    vec3 ambient_light = ubo.ambient_light_color.xyz * ubo.ambient_light_color.w;
+    vec3 diffuse_light = point_lighting(normalize(frag_normal_world));
+
+    vec3 albedo = frag_color;
+    if (frag_texture_slot != INVALID_SLOT) {
+        albedo *= texture(textures[nonuniformEXT(frag_texture_slot)], frag_uv).rgb;
+    }
+
+    outColor = vec4((diffuse_light + ambient_light) * albedo, 1);
+}
@@ -0,0 +1,52 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// attributes
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 frag_color;
+layout(location = 1) out vec3 frag_pos_world; 
+layout(location = 2) out vec3 frag_normal_world;
+layout(location = 3) out vec2 frag_uv;
+layout(location = 4) flat out uint frag_texture_slot;
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 projection_view_matrix;
+    mat4 view_matrix;
+    vec4 ambient_light_color;
+    vec4 cluster_scale; // tiles per pixel (x,y), depth slice scale and bias (z,w)
+    uvec4 cluster_grid; // tiles x, tiles y, depth slices, light count
+} ubo;
+
+struct ObjectData {
+    mat4 model_matrix;
+    mat4 normal_matrix;
+    uint texture_slot;
+};
+
+// bindless storage buffers, every frame's object data is one of them
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} object_buffers[];
+
+layout(push_constant) uniform Push {
+    uint object_buffer;
+    uint object_index;
+} push;
+
+
+void main() {
+    ObjectData object = object_buffers[push.object_buffer].objects[push.object_index];
+
+    vec4 position_world = object.model_matrix * vec4(position, 1.0);
+    gl_Position = ubo.projection_view_matrix * position_world;
+
+    frag_normal_world = normalize(mat3(object.normal_matrix) * normal);
+    frag_pos_world = position_world.xyz;
+    frag_color = color;
+    frag_uv = uv;
+    frag_texture_slot = object.texture_slot;
+}
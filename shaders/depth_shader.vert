@@ -0,0 +1,36 @@
+#version 450
+#ifdef MULTIVIEW
+#extension GL_EXT_multiview : require
+#endif
+
+#define MAX_VIEWS 4 // MAX_MULTIVIEW_VIEWS
+
+// depth pre-pass, reads only the position stream of VkeModel::bind_positions
+layout(location = 0) in vec3 position;
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 projection_view_matrix;
+    mat4 view_matrix;
+    vec4 ambient_light_color;
+    vec4 cluster_scale;
+    uvec4 cluster_grid;
+    vec4 viewport;
+    mat4 view_projections[MAX_VIEWS];
+} ubo;
+
+layout(push_constant) uniform Push {
+    mat4 model_matrix;
+    mat4 normal_mat;
+} push;
+
+// the shading pass tests against these depths with EQUAL, both have to compute them the same way
+invariant gl_Position;
+
+void main() {
+    vec4 position_world = push.model_matrix * vec4(position, 1.0);
+#ifdef MULTIVIEW
+    gl_Position = ubo.view_projections[gl_ViewIndex] * position_world;
+#else
+    gl_Position = ubo.projection_view_matrix * position_world;
+#endif
+}
@@ -1,4 +1,9 @@
 #version 450
+#ifdef MULTIVIEW
+#extension GL_EXT_multiview : require
+#endif
+
+#define MAX_VIEWS 4 // MAX_MULTIVIEW_VIEWS
 
 // attributes
 layout(location = 0) in vec3 position;
@@ -12,9 +17,12 @@ layout(location = 2) out vec3 frag_normal_world;
 
 layout(set = 0, binding = 0) uniform GlobalUBO {
     mat4 projection_view_matrix;
+    mat4 view_matrix;
     vec4 ambient_light_color;
-    vec3 light_position;
-    vec4 light_color;
+    vec4 cluster_scale; // tiles per pixel (x,y), depth slice scale and bias (z,w)
+    uvec4 cluster_grid; // tiles x, tiles y, depth slices, light count
+    vec4 viewport; // area of the view in pixels (x, y, width, height)
+    mat4 view_projections[MAX_VIEWS]; // projection * view of each view of a multiview pass
 } ubo;
 
 layout(push_constant) uniform Push {
@@ -22,10 +30,16 @@ layout(push_constant) uniform Push {
     mat4 normal_mat; // model
 } push;
 
+// matches depth_shader.vert exactly, the shading pass after a depth pre-pass tests with EQUAL
+invariant gl_Position;
 
 void main() {
     vec4 position_world = push.model_matrix * vec4(position, 1.0);
+#ifdef MULTIVIEW
+    gl_Position = ubo.view_projections[gl_ViewIndex] * position_world;
+#else
     gl_Position = ubo.projection_view_matrix * position_world;
+#endif
 
 
     frag_normal_world = normalize(mat3(push.normal_mat) * normal);
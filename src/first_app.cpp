@@ -2,9 +2,21 @@
 
 #include "vke_camera.hpp"
 #include "vke_simple_render_system.hpp"
+#include "vke_bindless_render_system.hpp"
+#include "vke_meshlet_render_system.hpp"
+#include "vke_light_clusters.hpp"
+#include "vke_texture_manager.hpp"
 #include "keyboard_movement_controller.hpp"
 #include "vke_definitions.hpp"
 #include "vke_buffer.hpp"
+#include "vke_frame_latency.hpp"
+#include "vke_present_policy.hpp"
+#include "vke_frame_pacer.hpp"
+#include "vke_frame_writer.hpp"
+#include "vke_gpu_profiler.hpp"
+#include "vke_overdraw_counter.hpp"
+#include "vke_trace.hpp"
+#include "vke_cpu_trace.hpp"
 
 #include <GLFW/glfw3.h>
 #include <iostream>
@@ -17,23 +29,23 @@
 // std
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstddef>
+#include <random>
 
 namespace vke {
 
-    struct GlobalUBO {
-        glm::mat4 projection_view{1.f};
-        glm::vec4 ambient_light_color{1.f, 1.f, 1.f, .02f};
-        glm::vec3 light_position{-1.f};
-        alignas(16) glm::vec4 light_color{1.f}; //(r,g,b,intensity)
-    };
-
-    FirstApp::FirstApp() {
-        global_pool = VkeDescriptorPool::Builder(vke_device)
-            .set_max_sets(VkeSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VkeSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .build();
+    FirstApp::FirstApp(const VkeSettings &settings) : settings{settings} {
+        layout_cache = std::make_unique<VkeDescriptorLayoutCache>(vke_device);
+        frame_descriptors = std::make_unique<VkeFrameDescriptorAllocator>(vke_device, vke_renderer.get_frames_in_flight());
+        asset_manager = std::make_unique<VkeAssetManager>(
+            vke_device,
+            vke_renderer.get_frames_in_flight(),
+            std::max(std::thread::hardware_concurrency() / 2, 1u),
+            static_cast<VkDeviceSize>(settings.upload_budget_kb) * 1024
+        );
         load_game_objects();
     }
 
@@ -44,7 +56,12 @@ namespace vke {
 
     void FirstApp::run() {
 
-        std::vector<std::unique_ptr<VkeBuffer>> ubo_buffers(VkeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        const uint32_t frames_in_flight = vke_renderer.get_frames_in_flight();
+        // every view has its own camera constants and light clusters in each frame slot
+        const uint32_t view_count = static_cast<uint32_t>(layout_view_areas(settings.view_layout, vke_renderer.get_extent()).size());
+        auto view_slot = [&](int frame_index, uint32_t view) { return frame_index * view_count + view; };
+
+        std::vector<std::unique_ptr<VkeBuffer>> ubo_buffers(frames_in_flight * view_count);
         for(int i = 0; i < ubo_buffers.size(); i++) {
             ubo_buffers[i] = std::make_unique<VkeBuffer>(
                 vke_device,
@@ -60,110 +77,565 @@ namespace vke {
         
         auto global_set_layout = VkeDescriptorSetLayout::Builder(vke_device)
             .add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-            .build();
-
-        
-        std::vector<VkDescriptorSet> global_descriptor_sets(VkeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i = 0; i < global_descriptor_sets.size(); i++) {
-            auto buffer_info = ubo_buffers[i] -> descriptor_info();
-            VkeDescriptorWriter(*global_set_layout, *global_pool)
-                .write_buffer(0, &buffer_info)
-                .build(global_descriptor_sets[i]);
+            .add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .build(*layout_cache);
+
+        // the global set is rewritten every frame, a template skips building the writes, otherwise
+        // the writes of the frame are submitted in one batch
+        struct GlobalSetData {
+            VkDescriptorBufferInfo ubo;
+            std::array<VkDescriptorBufferInfo, 3> lights;
+        };
+        std::unique_ptr<VkeDescriptorUpdateTemplate> global_set_template{};
+        if (vke_device.supportsDescriptorUpdateTemplates()) {
+            global_set_template = VkeDescriptorUpdateTemplate::Builder(vke_device, *global_set_layout)
+                .add_entry(0, offsetof(GlobalSetData, ubo))
+                .add_entry(1, offsetof(GlobalSetData, lights))
+                .add_entry(2, offsetof(GlobalSetData, lights) + sizeof(VkDescriptorBufferInfo))
+                .add_entry(3, offsetof(GlobalSetData, lights) + 2 * sizeof(VkDescriptorBufferInfo))
+                .build();
+        }
+        VkeDescriptorUpdateBatch descriptor_updates{vke_device};
+
+        // the scene's light plus --lights small ones scattered around it, assigned to clusters every frame
+        std::vector<VkePointLight> lights{};
+        lights.push_back({{-1.f, -1.f, -1.f, 10.f}, {1.f, 1.f, 1.f, 1.f}});
+        std::mt19937 light_rng{7};
+        std::uniform_real_distribution<float> unit{0.f, 1.f};
+        for (uint32_t i = 0; i < settings.light_count; i++) {
+            glm::vec3 position{8.f * unit(light_rng) - 4.f, -2.f * unit(light_rng), 8.f * unit(light_rng) - 4.f};
+            glm::vec3 color{unit(light_rng), unit(light_rng), unit(light_rng)};
+            lights.push_back({glm::vec4(position, .3f + .5f * unit(light_rng)), glm::vec4(color, .2f)});
         }
+        VkeClusteredLights clustered_lights{
+            vke_device,
+            frames_in_flight * view_count,
+            std::max(static_cast<uint32_t>(lights.size()), 16384u)
+        };
 
         VkeSimpleRenderSystem simple_render_system{
             vke_device, 
             vke_renderer.get_swap_chain_render_pass(), 
             global_set_layout->get_descriptor_set_layout()
         };
+        simple_render_system.set_lod_error(settings.lod_error);
+        simple_render_system.set_depth_prepass(settings.depth_prepass);
+
+        std::unique_ptr<VkeBindlessTable> bindless_table{};
+        std::unique_ptr<VkeBindlessRenderSystem> bindless_render_system{};
+        if (settings.bindless && !vke_device.supportsBindless()) {
+            std::cout << "Bindless descriptors are not supported by this device, using the simple render system" << '\n';
+        } else if (settings.bindless) {
+            bindless_table = std::make_unique<VkeBindlessTable>(vke_device, frames_in_flight);
+            bindless_render_system = std::make_unique<VkeBindlessRenderSystem>(
+                vke_device,
+                vke_renderer.get_swap_chain_render_pass(),
+                global_set_layout->get_descriptor_set_layout(),
+                *bindless_table,
+                frames_in_flight
+            );
+            bindless_render_system->set_lod_error(settings.lod_error);
+        }
+
+        std::unique_ptr<VkeMeshletRenderSystem> meshlet_render_system{};
+        if (settings.meshlets && !bindless_render_system) {
+            meshlet_render_system = std::make_unique<VkeMeshletRenderSystem>(
+                vke_device,
+                vke_renderer.get_swap_chain_render_pass(),
+                global_set_layout->get_descriptor_set_layout(),
+                frames_in_flight
+            );
+            std::cout << "Meshlets drawn with " << (meshlet_render_system->uses_mesh_shaders() ? "mesh shaders" : "indirect draws") << '\n';
+        }
+
+        bool multi_view = view_count > 1 && !bindless_render_system && !meshlet_render_system;
+        if (view_count > 1 && !multi_view) {
+            std::cout << "--views only applies to the simple render system" << '\n';
+        }
+
+        // a cached recording binds the global set of its frame slot, so those sets are written once and kept
+        bool cache_commands = settings.cache_commands && !bindless_render_system && !meshlet_render_system && !multi_view;
+        if (settings.cache_commands && !cache_commands) {
+            std::cout << "--cache-commands only applies to a single view of the simple render system" << '\n';
+        }
+        std::unique_ptr<VkeDescriptorAllocator> cached_set_allocator{};
+        std::vector<VkDescriptorSet> cached_global_sets{};
+        if (cache_commands) {
+            simple_render_system.set_command_caching(true, frames_in_flight);
+            cached_set_allocator = std::make_unique<VkeDescriptorAllocator>(vke_device, frames_in_flight);
+            cached_global_sets.resize(frames_in_flight);
+            for (uint32_t i = 0; i < frames_in_flight; i++) {
+                auto ubo_info = ubo_buffers[view_slot(i, 0)]->descriptor_info();
+                auto light_infos = clustered_lights.get_buffer_infos(view_slot(i, 0));
+                if (!VkeDescriptorWriter(*global_set_layout, *cached_set_allocator)
+                        .write_buffer(0, &ubo_info)
+                        .write_buffer(1, &light_infos[0])
+                        .write_buffer(2, &light_infos[1])
+                        .write_buffer(3, &light_infos[2])
+                        .build(cached_global_sets[i])) {
+                    throw std::runtime_error("failed to allocate global descriptor set");
+                }
+            }
+        }
+
+        // streamed textures need bindless slots, all objects share one texture for now
+        std::unique_ptr<VkeTextureManager> texture_manager{};
+        if (bindless_table) {
+            texture_manager = std::make_unique<VkeTextureManager>(
+                vke_device,
+                *bindless_table,
+                frames_in_flight,
+                static_cast<VkDeviceSize>(settings.texture_budget_mb) * 1024 * 1024,
+                std::max(std::thread::hardware_concurrency() / 2, 1u)
+            );
+            VkeTextureManager::TextureId texture = settings.texture_path.empty()
+                ? texture_manager->create(VkeImageData::checkerboard(1024, 64, 0xe0e0e0ff, 0x404040ff))
+                : texture_manager->load(settings.texture_path);
+            for (auto &kv : game_objects) {
+                kv.second.texture = texture;
+            }
+        }
 
         VkeCamera camera{};
         camera.set_view_direction(glm::vec3(0.f), glm::vec3(0.5f, 0.f, 1.f));
         camera.set_view_target(glm::vec3(-1.f, -2.f, -2.f), glm::vec3(0.f, 0.f, 2.5f));
 
+        // the second view of --views, looking down at the scene
+        VkeCamera overview_camera{};
+        overview_camera.set_view_target(glm::vec3(3.f, -3.f, -3.f), glm::vec3(0.f, .5f, 0.f));
+        std::array<VkeCamera*, 2> view_cameras{&camera, &overview_camera};
+        std::vector<VkeView> views{};
+
         auto viewer_object = VkeGameObject::create_game_object();
         viewer_object.transform.translation.z = -2.5f;
         KeyboardMovementController camera_controller{};
 
         auto current_time = std::chrono::high_resolution_clock::now();
 
+        VkePresentController present_controller{
+            settings.present_policy,
+            vke_window ? vke_window->get_refresh_rate() : 60.f,
+            vke_renderer.get_supported_present_modes()
+        };
+        bool present_key_down = false;
+
+        std::unique_ptr<VkeFrameLatencyMeter> latency_meter{};
+        if (settings.measure_latency) {
+            latency_meter = std::make_unique<VkeFrameLatencyMeter>(frames_in_flight, vke_renderer.get_image_count());
+        }
+
+        VkeFramePacer frame_pacer{settings.target_fps, frames_in_flight};
+
+        // headless runs have no window to close and stop after a fixed number of frames
+        uint32_t rendered_frames = 0;
+        auto run_start = std::chrono::steady_clock::now();
+        bool all_models_loaded = false;
+        auto keep_running = [&]() {
+            return vke_window ? !vke_window->should_close() : rendered_frames < settings.frame_count;
+        };
+
+        // headless frames are copied out of the slot's readback buffer once the slot comes around again,
+        // so the gpu renders the next frames while the writer encodes this one
+        std::unique_ptr<VkeFrameWriter> frame_writer{};
+        std::vector<int64_t> pending_frame_numbers(frames_in_flight, -1);
+        if (vke_renderer.is_headless() && !settings.output_directory.empty()) {
+            uint32_t threads = settings.writer_threads > 0 
+                ? settings.writer_threads 
+                : std::max(std::thread::hardware_concurrency() / 2, 1u);
+            frame_writer = std::make_unique<VkeFrameWriter>(settings.output_directory, settings.image_format, threads);
+        }
+        auto collect_frame = [&](int slot) {
+            auto *target = vke_renderer.get_offscreen_target();
+            VkExtent2D extent = target->get_extent();
+            const uint8_t *pixels = target->get_pixels(slot);
+            frame_writer->submit(
+                static_cast<uint32_t>(pending_frame_numbers[slot]), 
+                extent.width, 
+                extent.height, 
+                std::vector<uint8_t>(pixels, pixels + target->get_frame_size())
+            );
+            pending_frame_numbers[slot] = -1;
+        };
+
+        std::unique_ptr<VkeGpuProfiler> gpu_profiler{};
+        if (settings.gpu_profile || !settings.trace_path.empty()) {
+            gpu_profiler = std::make_unique<VkeGpuProfiler>(vke_device, frames_in_flight);
+        }
+        auto last_gpu_report = std::chrono::steady_clock::now();
+        // of the simple render system, reported with the gpu scopes
+        VkeCommandRecorder::Statistics command_statistics{};
+
+        std::unique_ptr<VkeOverdrawCounter> overdraw_counter{};
+        if (settings.overdraw && cache_commands) {
+            // the query would have to be recorded inline in the subpass of the cached draws
+            std::cout << "--overdraw is ignored with --cache-commands" << '\n';
+        } else if (settings.overdraw && !vke_device.supportsPipelineStatistics()) {
+            std::cout << "Pipeline statistics queries are not supported by this device, --overdraw is ignored" << '\n';
+        } else if (settings.overdraw) {
+            overdraw_counter = std::make_unique<VkeOverdrawCounter>(vke_device, frames_in_flight);
+        }
+        auto last_overdraw_report = std::chrono::steady_clock::now();
+
+        // --trace captures the whole run, otherwise T starts and stops a capture of cpu and gpu scopes
+        VkeCpuTrace::set_thread_name("main");
+        bool trace_key_down = false;
+        auto start_trace = [&]() {
+            VkeCpuTrace::clear();
+            VkeCpuTrace::set_enabled(true);
+            // a capture without --gpu-profile or --trace starts the timestamps with it
+            if (!gpu_profiler) {
+                gpu_profiler = std::make_unique<VkeGpuProfiler>(vke_device, frames_in_flight);
+            }
+            gpu_profiler->start_trace_capture();
+        };
+        auto write_trace = [&]() {
+            VkeCpuTrace::set_enabled(false);
+            std::string path = settings.trace_path.empty() ? "vke_trace.json" : settings.trace_path;
+            auto events = VkeCpuTrace::collect();
+            auto gpu_events = gpu_profiler->stop_trace_capture();
+            events.insert(events.end(), gpu_events.begin(), gpu_events.end());
+            write_chrome_trace(path, events);
+            std::cout << "Trace with " << events.size() << " events written to " << path << '\n';
+            size_t dropped = VkeCpuTrace::get_dropped_events() + gpu_profiler->get_dropped_trace_events();
+            if (dropped > 0) {
+                std::cout << dropped << " trace events did not fit the capture buffers" << '\n';
+            }
+        };
+        if (!settings.trace_path.empty()) {
+            start_trace();
+        }
 
-        while (!vke_window.should_close()) {
-            glfwPollEvents();
+        while (keep_running()) {
+            VKE_CPU_SCOPE("frame");
+
+            // wait for the frame slot first and sample input afterwards, so it is as fresh as possible when recorded
+            int next_frame_index = vke_renderer.get_next_frame_index();
+            float pacing_wait_time = 0.f;
+            {
+                VKE_CPU_SCOPE("wait_for_next_frame");
+                pacing_wait_time = frame_pacer.wait_for_next_frame(next_frame_index);
+            }
+
+            auto slot_wait_start = std::chrono::steady_clock::now();
+            bool slot_blocked = false;
+            {
+                VKE_CPU_SCOPE("wait_for_next_frame_slot");
+                slot_blocked = vke_renderer.wait_for_next_frame_slot();
+            }
+            frame_pacer.mark_gpu_complete(next_frame_index, slot_blocked);
+            float slot_wait_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - slot_wait_start).count();
+
+            if (frame_writer && pending_frame_numbers[next_frame_index] >= 0) {
+                collect_frame(next_frame_index);
+            }
+
+            if (vke_window) {
+                glfwPollEvents();
+            }
+            auto input_time = VkeFrameLatencyMeter::clock::now();
+
+            if (latency_meter) {
+                for (uint32_t i = 0; i < frames_in_flight; i++) {
+                    if (latency_meter->is_pending(i) && vke_renderer.is_frame_complete(i)) {
+                        latency_meter->mark_completed(i);
+                    }
+                }
+                latency_meter->set_image_count(vke_renderer.get_image_count());
+                if (latency_meter->report_if_due(std::cout)) {
+                    std::cout << "[pacing] target " << frame_pacer.get_target_fps() << " fps"
+                        << ": frame time " << frame_pacer.get_frame_time_mean() * 1000.f << " ms"
+                        << ", stddev " << frame_pacer.get_frame_time_stddev() * 1000.f << " ms"
+                        << ", gpu " << frame_pacer.get_gpu_frame_estimate() * 1000.f << " ms" << '\n';
+                    frame_pacer.reset_statistics();
+                }
+            }
 
             auto new_time = std::chrono::high_resolution_clock::now();
             float frame_time = std::chrono::duration<float, std::chrono::seconds::period>(new_time - current_time).count();
             current_time = new_time;
 
+            if (vke_window) {
+                bool key_down = glfwGetKey(vke_window->get_GLFW_window(), GLFW_KEY_V) == GLFW_PRESS;
+                if (key_down && !present_key_down) {
+                    present_controller.set_policy(next_present_policy(present_controller.get_policy()));
+                    std::cout << "Present policy: " << to_string(present_controller.get_policy()) << '\n';
+                }
+                present_key_down = key_down;
+
+                bool trace_down = glfwGetKey(vke_window->get_GLFW_window(), GLFW_KEY_T) == GLFW_PRESS;
+                if (trace_down && !trace_key_down) {
+                    if (VkeCpuTrace::is_enabled()) {
+                        write_trace();
+                    } else {
+                        start_trace();
+                        std::cout << "Capturing trace, press T again to write it" << '\n';
+                    }
+                }
+                trace_key_down = trace_down;
+            }
+
+            float idle_time = pacing_wait_time + slot_wait_time + vke_renderer.get_last_wait_time();
+            float work_time = glm::max(frame_time - idle_time, 0.f);
+            vke_renderer.set_present_mode(present_controller.update(work_time, frame_time));
+
             frame_time = glm::min(frame_time, MAX_FRAME_TIME);
 
-            camera_controller.move_in_plane_xz(vke_window.get_GLFW_window(), frame_time, viewer_object);
-            camera.set_view_yxz(viewer_object.transform.translation, viewer_object.transform.rotation);
+            if (vke_window) {
+                camera_controller.move_in_plane_xz(vke_window->get_GLFW_window(), frame_time, viewer_object);
+                camera.set_view_yxz(viewer_object.transform.translation, viewer_object.transform.rotation);
+            } else {
+                // scripted path for headless runs: one orbit around the scene over all frames
+                float angle = glm::two_pi<float>() * rendered_frames / std::max(settings.frame_count, 1u);
+                glm::vec3 position{2.5f * glm::sin(angle), -1.f, -2.5f * glm::cos(angle)};
+                camera.set_view_target(position, glm::vec3(0.f, .5f, 0.f));
+            }
 
 
-            float aspect = vke_renderer.get_aspect_ratio();
+            // the areas follow the window size
+            views.clear();
+            for (const VkRect2D &area : layout_view_areas(multi_view ? settings.view_layout : VkeViewLayout::Single, vke_renderer.get_extent())) {
+                VkeView view{};
+                view.camera = view_cameras[views.size()];
+                view.area = area;
+                // the inset of pip is drawn over the main view
+                view.clear = settings.view_layout == VkeViewLayout::PictureInPicture && !views.empty();
+                views.push_back(view);
+            }
+
+            float aspect = views[0].get_aspect_ratio();
             // orthographic view
             // camera.set_orthographic_projection(-aspect, aspect, -1, 1, -1, 1);
 
             // perspective view
             camera.set_perspective_projection(glm::radians(50.f), aspect, 0.1f, 250.f);
-            camera.set_perspective_projection(glm::radians(50.f), aspect, 0.1f, 250.f);
+            if (views.size() > 1) {
+                overview_camera.set_perspective_projection(glm::radians(50.f), views[1].get_aspect_ratio(), 0.1f, 250.f);
+            }
+
+            if (gpu_profiler && settings.gpu_profile && std::chrono::steady_clock::now() - last_gpu_report > std::chrono::seconds(2)) {
+                gpu_profiler->report(std::cout);
+                command_statistics.report(std::cout);
+                command_statistics = {};
+                if (auto *cache = simple_render_system.get_command_cache()) {
+                    std::cout << "[command cache] " << cache->get_recorded_frames() << " frames recorded, "
+                        << cache->get_reused_frames() << " reused" << '\n';
+                }
+                last_gpu_report = std::chrono::steady_clock::now();
+            }
+            if (overdraw_counter && std::chrono::steady_clock::now() - last_overdraw_report > std::chrono::seconds(2)) {
+                std::cout << "[overdraw] " << overdraw_counter->get_mean_overdraw() << " fragments per pixel"
+                    << (settings.depth_prepass ? " (depth pre-pass)" : "") << '\n';
+                overdraw_counter->reset_statistics();
+                last_overdraw_report = std::chrono::steady_clock::now();
+            }
 
             if (VkCommandBuffer command_buffer = vke_renderer.begin_frame()) {
                 int frame_index = vke_renderer.get_frame_index();
+                if (gpu_profiler) {
+                    gpu_profiler->begin_frame(command_buffer, frame_index);
+                }
+                if (overdraw_counter) {
+                    overdraw_counter->begin_frame(command_buffer, frame_index, vke_renderer.get_extent());
+                }
+                if (latency_meter) {
+                    // begin_frame waited for this slot, so its previous frame is done
+                    latency_meter->mark_completed(frame_index);
+                    latency_meter->mark_input(frame_index, input_time);
+                }
+
+                // the global sets are transient, allocated from the frame's pools after they were reset, except
+                // for cached recordings which keep the set of their slot
+                frame_descriptors->begin_frame(frame_index);
+                for (uint32_t v = 0; v < views.size(); v++) {
+                    uint32_t slot = view_slot(frame_index, v);
+                    VkDescriptorSet &global_descriptor_set = views[v].global_descriptor_set;
+                    GlobalSetData global_set_data{ubo_buffers[slot]->descriptor_info(), clustered_lights.get_buffer_infos(slot)};
+                    if (cache_commands) {
+                        global_descriptor_set = cached_global_sets[frame_index];
+                    } else if (global_set_template) {
+                        if (!frame_descriptors->allocate(global_set_layout->get_descriptor_set_layout(), global_descriptor_set)) {
+                            throw std::runtime_error("failed to allocate global descriptor set");
+                        }
+                        global_set_template->update(global_descriptor_set, &global_set_data);
+                    } else if (!VkeDescriptorWriter(*global_set_layout, frame_descriptors->get_allocator())
+                            .write_buffer(0, &global_set_data.ubo)
+                            .write_buffer(1, &global_set_data.lights[0])
+                            .write_buffer(2, &global_set_data.lights[1])
+                            .write_buffer(3, &global_set_data.lights[2])
+                            .build(global_descriptor_set, descriptor_updates)) {
+                        throw std::runtime_error("failed to allocate global descriptor set");
+                    }
+                }
+                descriptor_updates.flush();
+
                 FrameInfo frame_info{
                     frame_index,
                     frame_time,
                     command_buffer,
                     camera,
-                    global_descriptor_sets[frame_index],
-                    game_objects
+                    views[0].global_descriptor_set,
+                    game_objects,
+                    gpu_profiler.get(),
+                    static_cast<float>(vke_renderer.get_extent().height),
+                    vke_renderer.get_extent()
                 };
 
                 // update
-                GlobalUBO ubo{};
-                ubo.projection_view = camera.get_projection() * camera.get_view();
-                ubo_buffers[frame_index]->write_to_buffer(&ubo);
-                ubo_buffers[frame_index]->flush();
+                {
+                    VKE_CPU_SCOPE("ubo update");
+                    for (uint32_t v = 0; v < views.size(); v++) {
+                        uint32_t slot = view_slot(frame_index, v);
+                        const VkeView &view = views[v];
+                        clustered_lights.update(slot, *view.camera, view.area.extent, lights);
+                        GlobalUBO ubo{};
+                        ubo.projection_view = view.camera->get_projection() * view.camera->get_view();
+                        ubo.view = view.camera->get_view();
+                        ubo.viewport = {view.area.offset.x, view.area.offset.y, view.area.extent.width, view.area.extent.height};
+                        clustered_lights.write_parameters(ubo);
+                        ubo_buffers[slot]->write_to_buffer(&ubo);
+                        ubo_buffers[slot]->flush();
+                    }
+                }
                 
+                // model uploads are recorded before the render pass, like the texture uploads below
+                asset_manager->update(command_buffer, frame_index);
+                for (auto &kv : game_objects) {
+                    if (kv.second.mesh) {
+                        kv.second.model = asset_manager->get_model(kv.second.mesh);
+                    }
+                }
+                if (!all_models_loaded && asset_manager->get_statistics().progress() >= 1.f) {
+                    all_models_loaded = true;
+                    std::cout << "Models loaded after " << rendered_frames << " frames ("
+                        << std::chrono::duration<float>(std::chrono::steady_clock::now() - run_start).count() << " s)" << '\n';
+                }
+
+                // texture uploads are recorded before the render pass, the slots are final afterwards
+                if (texture_manager) {
+                    float viewport_height = static_cast<float>(vke_renderer.get_extent().height);
+                    for (auto &kv : game_objects) {
+                        auto &obj = kv.second;
+                        if (obj.texture == VkeTextureManager::INVALID_TEXTURE) continue;
+                        float radius = glm::max(obj.transform.scale.x, glm::max(obj.transform.scale.y, obj.transform.scale.z));
+                        texture_manager->request(
+                            obj.texture,
+                            VkeTextureManager::projected_size(camera, obj.transform.translation, radius, viewport_height)
+                        );
+                    }
+                    texture_manager->update(command_buffer, frame_index);
+                    for (auto &kv : game_objects) {
+                        if (kv.second.texture != VkeTextureManager::INVALID_TEXTURE) {
+                            kv.second.texture_slot = texture_manager->get_slot(kv.second.texture);
+                        }
+                    }
+                }
+
                 // render
-                vke_renderer.begin_swap_chain_render_pass(command_buffer);
-                simple_render_system.render_game_objects(frame_info);
+                int render_pass_scope = gpu_profiler ? gpu_profiler->begin_scope(command_buffer, "render pass") : -1;
+                vke_renderer.begin_swap_chain_render_pass(
+                    command_buffer,
+                    cache_commands ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE
+                );
+                if (overdraw_counter) {
+                    overdraw_counter->begin(command_buffer);
+                }
+                if (bindless_render_system) {
+                    bindless_table->next_frame();
+                    bindless_render_system->render_game_objects(frame_info);
+                } else if (meshlet_render_system) {
+                    meshlet_render_system->render_game_objects(frame_info);
+                } else if (multi_view) {
+                    simple_render_system.render_views(frame_info, views);
+                    command_statistics += simple_render_system.get_command_statistics();
+                } else {
+                    simple_render_system.render_game_objects(frame_info);
+                    command_statistics += simple_render_system.get_command_statistics();
+                }
+                if (overdraw_counter) {
+                    overdraw_counter->end(command_buffer);
+                }
                 vke_renderer.end_swap_chain_render_pass(command_buffer);
+                if (gpu_profiler) {
+                    gpu_profiler->end_scope(command_buffer, render_pass_scope);
+                }
                 vke_renderer.end_frame();
+
+                frame_pacer.mark_submitted(frame_index);
+                pending_frame_numbers[frame_index] = rendered_frames;
+                rendered_frames++;
+
+                if (latency_meter) {
+                    latency_meter->mark_submitted(frame_index);
+                }
+            } else if (vke_renderer.is_minimized()) {
+                // nothing to present to, sleep until the window is restored
+                glfwWaitEvents();
             }
             // std::cout << "FPS: " << 1 / frame_time << std::endl;
         }
 
         vkDeviceWaitIdle(vke_device.device());
-    }
 
-    void FirstApp::load_game_objects() {
-        std::shared_ptr<VkeModel> vke_model = VkeModel::create_model_from_file(vke_device, "../assets/flat_vase.obj");
-
-        auto game_obj = VkeGameObject::create_game_object();
-        game_obj.model = vke_model;
-        game_obj.transform.translation = {-.5f, .5f, 0.f};
-        game_obj.transform.scale = glm::vec3(3.f);
-
-        game_objects.emplace(game_obj.get_id(), std::move(game_obj));
-
-        vke_model = VkeModel::create_model_from_file(vke_device, "../assets/smooth_vase.obj");
+        if (gpu_profiler) {
+            gpu_profiler->resolve_pending();
+            if (settings.gpu_profile) {
+                gpu_profiler->report(std::cout);
+            }
+        }
+        if (VkeCpuTrace::is_enabled()) {
+            write_trace();
+        }
 
-        game_obj = VkeGameObject::create_game_object();
-        game_obj.model = vke_model;
-        game_obj.transform.translation = {.5f, .5f, 0.f};
-        game_obj.transform.scale = glm::vec3(3.f);
+        if (frame_writer) {
+            // the last frames in flight, oldest first
+            for (uint32_t i = 0; i < frames_in_flight; i++) {
+                int slot = (vke_renderer.get_next_frame_index() + i) % frames_in_flight;
+                if (pending_frame_numbers[slot] >= 0) {
+                    collect_frame(slot);
+                }
+            }
+            frame_writer->wait_idle();
+        }
 
-        game_objects.emplace(game_obj.get_id(), std::move(game_obj));
+        if (vke_renderer.is_headless()) {
+            float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - run_start).count();
+            VkExtent2D extent = vke_renderer.get_extent();
+            double read_back = static_cast<double>(vke_renderer.get_offscreen_target()->get_frame_size()) * rendered_frames;
+            std::cout << "Rendered " << rendered_frames << " frames at " << extent.width << "x" << extent.height
+                << " in " << elapsed << " s (" << rendered_frames / elapsed << " fps, "
+                << read_back / (1024.0 * 1024.0) / elapsed << " MiB/s read back)" << '\n';
+            if (frame_writer) {
+                std::cout << "Wrote " << frame_writer->get_written_frames() << " " << to_string(settings.image_format)
+                    << " files to " << settings.output_directory
+                    << " (" << frame_writer->get_written_bytes() / (1024.0 * 1024.0) << " MiB, "
+                    << frame_writer->get_encode_time() * 1000.f / std::max(frame_writer->get_written_frames(), 1u)
+                    << " ms per frame on the writer threads)" << '\n';
+            }
+        }
+    }
 
-        vke_model = VkeModel::create_model_from_file(vke_device, "../assets/quad.obj");
+    void FirstApp::load_game_objects() {
+        struct ObjectDesc {
+            const char *path;
+            glm::vec3 translation;
+        };
+        const ObjectDesc objects[] = {
+            {"../assets/flat_vase.obj", {-.5f, .5f, 0.f}},
+            {"../assets/smooth_vase.obj", {.5f, .5f, 0.f}},
+            {"../assets/quad.obj", {.0f, .5f, 0.f}},
+        };
 
-        game_obj = VkeGameObject::create_game_object();
-        game_obj.model = vke_model;
-        game_obj.transform.translation = {.0f, .5f, 0.f};
-        game_obj.transform.scale = glm::vec3(3.f);
+        // the files load on the asset workers, the first frames show placeholders
+        for (const auto &desc : objects) {
+            auto game_obj = VkeGameObject::create_game_object();
+            game_obj.mesh = asset_manager->load(desc.path, settings.meshlets, settings.depth_prepass);
+            game_obj.model = asset_manager->get_model(game_obj.mesh);
+            game_obj.transform.translation = desc.translation;
+            game_obj.transform.scale = glm::vec3(3.f);
 
-        game_objects.emplace(game_obj.get_id(), std::move(game_obj));
+            game_objects.emplace(game_obj.get_id(), std::move(game_obj));
+        }
     }
 }
\ No newline at end of file
@@ -1,11 +1,14 @@
 #ifndef first_app_
     #define first_app_
 
+    #include "vke_asset_manager.hpp"
     #include "vke_descriptors.hpp"
+    #include "vke_descriptor_allocator.hpp"
     #include "vke_window.hpp"
     #include "vke_device.hpp"
     #include "vke_game_object.hpp"
     #include "vke_renderer.hpp"
+    #include "vke_settings.hpp"
 
     // std
     #include <memory>
@@ -14,9 +17,7 @@
     namespace vke {
         class FirstApp {
             public:
-            const int WIDTH = 800;
-            const int HEIGHT = 600;
-            FirstApp();
+            explicit FirstApp(const VkeSettings &settings = {});
             ~FirstApp();
 
             FirstApp(const FirstApp&) = delete;
@@ -27,12 +28,20 @@
             private:
             void load_game_objects();;
 
-            VkeWindow vke_window{WIDTH, HEIGHT, "vulkantest"};
-            VkeDevice vke_device{vke_window};
-            VkeRenderer vke_renderer{vke_window, vke_device};
-
-            // order of declaration is important! global_pool needs to be destroyed after vke_device
-            std::unique_ptr<VkeDescriptorPool> global_pool{};
+            VkeSettings settings;
+            // null when running headless
+            std::unique_ptr<VkeWindow> vke_window{
+                settings.headless ? nullptr : std::make_unique<VkeWindow>(settings.width, settings.height, "vulkantest")
+            };
+            VkeDevice vke_device{vke_window.get()};
+            VkeRenderer vke_renderer{vke_window.get(), vke_device, settings.swap_chain_config(), {settings.width, settings.height}};
+
+            // order of declaration is important! descriptor objects need to be destroyed before vke_device
+            std::unique_ptr<VkeDescriptorLayoutCache> layout_cache{};
+            // transient sets, recycled when their frame slot comes around again
+            std::unique_ptr<VkeFrameDescriptorAllocator> frame_descriptors{};
+            // models load in the background, objects show a placeholder until theirs is uploaded
+            std::unique_ptr<VkeAssetManager> asset_manager{};
             VkeGameObject::Map game_objects;
         };
     }
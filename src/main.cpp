@@ -6,8 +6,21 @@
 
 // cmake doesnt create MakeFile, can't compile
 
-int main() {
-    vke::FirstApp app;
+int main(int argc, char **argv) {
+    vke::VkeSettings settings{};
+    try {
+        settings = vke::VkeSettings::from_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    if (settings.show_help) {
+        std::cout << vke::VkeSettings::usage();
+        return EXIT_SUCCESS;
+    }
+
+    vke::FirstApp app{settings};
 
     try {
         app.run();
@@ -0,0 +1,393 @@
+#include "vke_asset_manager.hpp"
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace vke {
+
+    // 128 bit fnv-1a, the prime is 2^88 + 0x13b so the multiplication only needs 64 bit words
+    VkeAssetManager::ContentHash VkeAssetManager::content_hash(const VkeModel::Data &data, bool with_meshlets, bool with_positions) {
+        uint64_t low = 0x62b821756295c58dull;
+        uint64_t high = 0x6c62272e07bb0142ull;
+        auto add = [&](const void *bytes, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                low ^= static_cast<const uint8_t*>(bytes)[i];
+                // low * 0x13b as 128 bits, from its two 32 bit halves
+                uint64_t product_low = (low & 0xffffffffull) * 0x13b;
+                uint64_t product_mid = (low >> 32) * 0x13b;
+                uint64_t next_low = product_low + (product_mid << 32);
+                uint64_t carry = (product_mid >> 32) + (next_low < product_low);
+                high = high * 0x13b + carry + (low << 24);
+                low = next_low;
+            }
+        };
+        add(data.vertices.data(), data.vertices.size() * sizeof(VkeModel::Vertex));
+        add(data.indices.data(), data.indices.size() * sizeof(uint32_t));
+        add(&with_meshlets, sizeof(with_meshlets));
+        add(&with_positions, sizeof(with_positions));
+        return {low, high};
+    }
+
+    VkeAssetManager::VkeAssetManager(
+        VkeDevice &device,
+        uint32_t frames_in_flight,
+        uint32_t worker_count,
+        VkDeviceSize upload_budget,
+        VkDeviceSize staging_size
+    ) :
+        vke_device{device},
+        frames_in_flight{frames_in_flight},
+        upload_budget{std::max<VkDeviceSize>(upload_budget, 1)},
+        staging{device, staging_size, frames_in_flight}
+    {
+        create_placeholder();
+
+        for (uint32_t i = 0; i < std::max(worker_count, 1u); i++) {
+            workers.emplace_back(&VkeAssetManager::worker_loop, this);
+        }
+    }
+
+    VkeAssetManager::~VkeAssetManager() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        jobs_changed.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void VkeAssetManager::create_placeholder() {
+        // a small grey cube, flat shaded
+        VkeModel::Data data{};
+        const glm::vec3 color{.5f};
+        const float size = .1f;
+        for (int axis = 0; axis < 3; axis++) {
+            for (float sign : {-1.f, 1.f}) {
+                glm::vec3 normal{0.f};
+                normal[axis] = sign;
+                glm::vec3 u{0.f};
+                glm::vec3 v{0.f};
+                u[(axis + 1) % 3] = 1.f;
+                v[(axis + 2) % 3] = sign;
+
+                uint32_t first = static_cast<uint32_t>(data.vertices.size());
+                for (glm::vec2 corner : {glm::vec2{-1.f, -1.f}, glm::vec2{1.f, -1.f}, glm::vec2{1.f, 1.f}, glm::vec2{-1.f, 1.f}}) {
+                    VkeModel::Vertex vertex{};
+                    vertex.position = size * (normal + corner.x * u + corner.y * v);
+                    vertex.color = color;
+                    vertex.normal = normal;
+                    vertex.uv = corner * .5f + .5f;
+                    data.vertices.push_back(vertex);
+                }
+                data.indices.insert(data.indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+            }
+        }
+        // drawn in the depth pre-pass like the models it stands in for
+        data.build_positions();
+        placeholder = std::make_shared<VkeModel>(vke_device, data);
+    }
+
+    VkeAssetManager::Handle VkeAssetManager::load(const std::string &path, bool with_meshlets, bool with_positions) {
+        std::string path_key = path + (with_meshlets ? "#meshlets" : "") + (with_positions ? "#positions" : "");
+        auto it = path_models.find(path_key);
+        if (it != path_models.end()) {
+            models[it->second].references++;
+            totals.shared_loads++;
+            return make_handle(it->second);
+        }
+
+        ModelId model = add_job(path, {}, with_meshlets, with_positions);
+        models[model].path_key = path_key;
+        path_models.emplace(std::move(path_key), model);
+        return make_handle(model);
+    }
+
+    VkeAssetManager::Handle VkeAssetManager::create(VkeModel::Data data, bool with_meshlets, bool with_positions) {
+        return make_handle(add_job({}, std::move(data), with_meshlets, with_positions));
+    }
+
+    VkeAssetManager::ModelId VkeAssetManager::add_job(std::string path, VkeModel::Data data, bool with_meshlets, bool with_positions) {
+        ModelId model = static_cast<ModelId>(models.size());
+        models.emplace_back();
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back({model, std::move(path), std::move(data), with_meshlets, with_positions});
+        }
+        jobs_changed.notify_one();
+        return model;
+    }
+
+    void VkeAssetManager::release(ModelId model) {
+        auto &entry = models[model];
+        if (entry.state == State::Released || --entry.references > 0) {
+            return;
+        }
+
+        if (!entry.path_key.empty()) {
+            path_models.erase(entry.path_key);
+        }
+        if (entry.hashed) {
+            content_models.erase(entry.content_hash);
+        }
+        if (entry.state == State::Loading) {
+            // a result that is still on its way is dropped in collect_loads
+            std::lock_guard<std::mutex> lock{mutex};
+            auto job = std::find_if(jobs.begin(), jobs.end(), [&](const LoadJob &job) { return job.model == model; });
+            if (job != jobs.end()) {
+                jobs.erase(job);
+            }
+        } else if (entry.state == State::Uploading) {
+            auto upload = std::find_if(uploads.begin(), uploads.end(), [&](const Upload &upload) { return upload.model == model; });
+            if (upload->gpu_model) {
+                // copies into the buffers may still be in flight
+                VkDeviceSize bytes = 0;
+                for (const auto &buffer : upload->buffers) {
+                    bytes += buffer.size;
+                }
+                retire(std::move(upload->gpu_model), bytes);
+            }
+            uploads.erase(upload);
+        }
+        if (entry.model) {
+            retire(std::move(entry.model), entry.bytes);
+        }
+
+        ModelId shared_with = entry.shared_with;
+        entry = Model{};
+        entry.state = State::Released;
+        entry.references = 0;
+        if (shared_with != INVALID_MODEL) {
+            release(shared_with);
+        }
+    }
+
+    VkeAssetManager::ModelId VkeAssetManager::resolve(ModelId model) const {
+        ModelId shared_with = models[model].shared_with;
+        return shared_with == INVALID_MODEL ? model : shared_with;
+    }
+
+    void VkeAssetManager::retire(std::shared_ptr<VkeModel> model, VkDeviceSize bytes) {
+        retired_models.push_back({std::move(model), bytes, frame_number});
+    }
+
+    void VkeAssetManager::worker_loop() {
+        VkeCpuTrace::set_thread_name("model loader");
+        while (true) {
+            std::unique_lock<std::mutex> lock{mutex};
+            jobs_changed.wait(lock, [&]() { return !jobs.empty() || stopping; });
+            if (stopping) {
+                return;
+            }
+            LoadJob job = std::move(jobs.front());
+            jobs.pop_front();
+            active_loads++;
+            lock.unlock();
+
+            LoadResult result{job.model, {}, {}, {}};
+            try {
+                VKE_CPU_SCOPE("load model");
+                VkeModel::Data data = std::move(job.data);
+                if (!job.path.empty()) {
+                    data.load_model(job.path);
+                }
+                if (data.vertices.size() < 3) {
+                    throw std::runtime_error("model has less than 3 vertices " + job.path);
+                }
+                result.content_hash = content_hash(data, job.with_meshlets, job.with_positions);
+                if (data.lods.empty()) {
+                    data.build_lods();
+                }
+                if (job.with_meshlets && data.meshlets.empty()) {
+                    data.build_meshlets();
+                }
+                if (job.with_positions && data.positions.empty()) {
+                    data.build_positions();
+                }
+                result.data = std::move(data);
+            } catch (const std::exception &e) {
+                result.error = e.what();
+            }
+
+            lock.lock();
+            results.push_back(std::move(result));
+            active_loads--;
+        }
+    }
+
+    void VkeAssetManager::collect_loads() {
+        std::vector<LoadResult> finished{};
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            finished.swap(results);
+        }
+        for (auto &result : finished) {
+            auto &model = models[result.model];
+            if (model.state == State::Released) {
+                continue;
+            }
+            if (!result.error.empty()) {
+                // the model keeps showing the placeholder
+                std::cerr << "failed to load model: " << result.error << '\n';
+                model.state = State::Failed;
+                continue;
+            }
+
+            auto shared = content_models.find(result.content_hash);
+            if (shared != content_models.end()) {
+                // state and buffers follow the model loaded first
+                model.shared_with = shared->second;
+                model.state = State::Ready;
+                models[shared->second].references++;
+                totals.shared_loads++;
+                continue;
+            }
+            model.content_hash = result.content_hash;
+            model.hashed = true;
+            content_models.emplace(result.content_hash, result.model);
+            model.state = State::Uploading;
+
+            // exact once the buffers exist, the meshlet buffers are only made with mesh shader support
+            Upload upload{result.model, std::move(result.data)};
+            upload.remaining_bytes = upload.data.vertices.size() * sizeof(VkeModel::Vertex)
+                + upload.data.positions.size() * sizeof(glm::vec3)
+                + upload.data.indices.size() * sizeof(uint32_t);
+            uploads.push_back(std::move(upload));
+        }
+    }
+
+    VkDeviceSize VkeAssetManager::record_copies(VkCommandBuffer command_buffer, Upload &upload, VkDeviceSize budget) {
+        VkDeviceSize recorded = 0;
+        while (upload.next_buffer < upload.buffers.size() && recorded < budget) {
+            const auto &buffer = upload.buffers[upload.next_buffer];
+            // pieces of at most half the ring, so one large buffer can not block the ring for a whole frame
+            VkDeviceSize size = std::min({buffer.size - upload.next_offset, budget - recorded, staging.get_capacity() / 2});
+            if (size > 0) {
+                VkDeviceSize staging_offset;
+                if (!staging.allocate(size, 16, staging_offset)) {
+                    break;
+                }
+                std::memcpy(staging.get_mapped(staging_offset), static_cast<const uint8_t*>(buffer.data) + upload.next_offset, size);
+
+                VkBufferCopy region{};
+                region.srcOffset = staging_offset;
+                region.dstOffset = upload.next_offset;
+                region.size = size;
+                vkCmdCopyBuffer(command_buffer, staging.get_buffer(), buffer.buffer, 1, &region);
+
+                upload.next_offset += size;
+                upload.remaining_bytes -= size;
+                recorded += size;
+            }
+            if (upload.next_offset == buffer.size) {
+                upload.next_buffer++;
+                upload.next_offset = 0;
+            }
+        }
+        return recorded;
+    }
+
+    void VkeAssetManager::update(VkCommandBuffer command_buffer, int frame_index) {
+        VKE_CPU_SCOPE("asset uploads");
+        frame_number++;
+        staging.begin_frame(frame_index);
+        // begin_frame waited for the frame that last used this slot, so every frame before is done too
+        retired_models.erase(
+            std::remove_if(retired_models.begin(), retired_models.end(), [&](const RetiredModel &retired) {
+                return retired.frame + frames_in_flight <= frame_number;
+            }),
+            retired_models.end()
+        );
+        collect_loads();
+
+        VkDeviceSize recorded = 0;
+        uint32_t creations = 0;
+        for (auto &upload : uploads) {
+            if (recorded >= upload_budget) break;
+            if (!upload.gpu_model) {
+                if (creations == MAX_MODEL_CREATIONS_PER_FRAME) break;
+                upload.gpu_model = std::make_shared<VkeModel>(vke_device, upload.data, upload.buffers);
+                upload.remaining_bytes = 0;
+                for (const auto &buffer : upload.buffers) {
+                    upload.remaining_bytes += buffer.size;
+                }
+                creations++;
+            }
+            recorded += record_copies(command_buffer, upload, upload_budget - recorded);
+            // budget used up or the staging ring is full, the next uploads wait for their turn
+            if (upload.remaining_bytes > 0) break;
+        }
+
+        if (recorded > 0) {
+            // the copied buffers are read by this frame's draws already
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(
+                command_buffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr
+            );
+            totals.uploaded_bytes += recorded;
+            totals.upload_frames++;
+        }
+        totals.last_frame_upload_bytes = recorded;
+
+        // uploads complete in order, a finished one replaces its placeholder from this frame on
+        while (!uploads.empty() && uploads.front().gpu_model && uploads.front().remaining_bytes == 0) {
+            auto &upload = uploads.front();
+            auto &model = models[upload.model];
+            model.model = std::move(upload.gpu_model);
+            model.state = State::Ready;
+            for (const auto &buffer : upload.buffers) {
+                model.bytes += buffer.size;
+            }
+            uploads.pop_front();
+        }
+    }
+
+    std::shared_ptr<VkeModel> VkeAssetManager::get_model(const Handle &model) const {
+        if (!model) {
+            return placeholder;
+        }
+        const auto &entry = models[resolve(model.get_id())];
+        return entry.state == State::Ready ? entry.model : placeholder;
+    }
+
+    VkeAssetManager::Statistics VkeAssetManager::get_statistics() const {
+        Statistics statistics = totals;
+        statistics.model_count = static_cast<uint32_t>(models.size());
+        statistics.pending_uploads = static_cast<uint32_t>(uploads.size());
+        for (const auto &upload : uploads) {
+            statistics.queued_upload_bytes += upload.remaining_bytes;
+        }
+        for (ModelId model = 0; model < models.size(); model++) {
+            if (models[model].state == State::Released) {
+                statistics.released_models++;
+                continue;
+            }
+            const auto &entry = models[resolve(model)];
+            statistics.ready_models += entry.state == State::Ready;
+            statistics.failed_loads += entry.state == State::Failed;
+            statistics.resident_bytes += models[model].bytes;
+        }
+        for (const auto &retired : retired_models) {
+            statistics.retired_bytes += retired.bytes;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        statistics.queued_loads = static_cast<uint32_t>(jobs.size());
+        statistics.active_loads = active_loads;
+        return statistics;
+    }
+}
@@ -0,0 +1,227 @@
+#ifndef vke_asset_manager_
+    #define vke_asset_manager_
+
+    #include "vke_device.hpp"
+    #include "vke_model.hpp"
+    #include "vke_staging_ring.hpp"
+
+    // std
+    #include <condition_variable>
+    #include <cstdint>
+    #include <deque>
+    #include <memory>
+    #include <mutex>
+    #include <string>
+    #include <thread>
+    #include <unordered_map>
+    #include <vector>
+
+    namespace vke {
+        // Loads models in the background. Files are parsed and their lods and meshlets built on worker
+        // threads, load and create return an id right away and get_model hands out a small placeholder
+        // until the model is on the gpu. The render loop never waits for a load: update creates the
+        // buffers of finished models and records their copies from a staging ring into the frame's command
+        // buffer, at most upload_budget bytes per frame. Models larger than the budget are copied in
+        // pieces over several frames and only replace the placeholder after their last piece.
+        // Models are shared: loading a path again returns the same model, and a model whose vertices and
+        // indices have the same 128 bit hash as those of one already loaded reuses its buffers. Every load and create returns a
+        // Handle holding a reference, the buffers of a model without references are destroyed once no
+        // frame in flight can draw them and every shared_ptr handed out by get_model is gone.
+        class VkeAssetManager {
+            public:
+            using ModelId = uint32_t;
+            static constexpr ModelId INVALID_MODEL = ~0u;
+
+            // A reference to a loaded or created model, shared by all copies of the handle. The last copy
+            // releases the model, it has to go on the render thread and before the manager.
+            class Handle {
+                public:
+                Handle() = default;
+
+                ModelId get_id() const { return reference ? reference->model : INVALID_MODEL; }
+                explicit operator bool() const { return reference != nullptr; }
+
+                private:
+                friend class VkeAssetManager;
+
+                struct Reference {
+                    Reference(VkeAssetManager &manager, ModelId model) : manager{manager}, model{model} {}
+                    ~Reference() { manager.release(model); }
+
+                    Reference(const Reference&) = delete;
+                    Reference& operator=(const Reference&) = delete;
+
+                    VkeAssetManager &manager;
+                    ModelId model;
+                };
+
+                explicit Handle(std::shared_ptr<const Reference> reference) : reference{std::move(reference)} {}
+
+                std::shared_ptr<const Reference> reference{};
+            };
+
+            struct Statistics {
+                uint32_t model_count = 0;
+                // waiting for a worker
+                uint32_t queued_loads = 0;
+                // on a worker right now
+                uint32_t active_loads = 0;
+                // loaded, waiting for their gpu copies
+                uint32_t pending_uploads = 0;
+                uint32_t ready_models = 0;
+                uint32_t failed_loads = 0;
+                // loads answered with the buffers of another model, by path or by content
+                uint32_t shared_loads = 0;
+                uint32_t released_models = 0;
+                // buffers of the models that have their own, and of released ones not destroyed yet
+                VkDeviceSize resident_bytes = 0;
+                VkDeviceSize retired_bytes = 0;
+                // bytes the pending uploads still have to copy
+                VkDeviceSize queued_upload_bytes = 0;
+                VkDeviceSize last_frame_upload_bytes = 0;
+                // totals since creation
+                VkDeviceSize uploaded_bytes = 0;
+                uint64_t upload_frames = 0;
+
+                // share of the models that finished loading, successfully or not
+                float progress() const {
+                    uint32_t loading = model_count - released_models;
+                    return loading == 0 ? 1.f : static_cast<float>(ready_models + failed_loads) / loading;
+                }
+            };
+
+            VkeAssetManager(
+                VkeDevice &device,
+                uint32_t frames_in_flight,
+                uint32_t worker_count,
+                VkDeviceSize upload_budget = 4 * 1024 * 1024,
+                VkDeviceSize staging_size = 16 * 1024 * 1024
+            );
+            ~VkeAssetManager();
+
+            VkeAssetManager(const VkeAssetManager&) = delete;
+            VkeAssetManager& operator=(const VkeAssetManager&) = delete;
+
+            // both return immediately, with_meshlets also splits the model into meshlets, see build_meshlets,
+            // and with_positions adds the positions the depth pre-pass draws with, see build_positions
+            Handle load(const std::string &path, bool with_meshlets = false, bool with_positions = false);
+            // lods are built unless data already has them
+            Handle create(VkeModel::Data data, bool with_meshlets = false, bool with_positions = false);
+
+            // records this frame's uploads, call after begin_frame and before the render pass
+            void update(VkCommandBuffer command_buffer, int frame_index);
+
+            // the placeholder until the model is uploaded, and for failed loads
+            std::shared_ptr<VkeModel> get_model(const Handle &model) const;
+
+            Statistics get_statistics() const;
+
+            private:
+            enum class State {
+                Loading,
+                Uploading,
+                Ready,
+                Failed,
+                Released
+            };
+
+            // of the vertices and indices as loaded or created, before lods and meshlets are added. 128 bits
+            // make an accidental collision unlikely enough that no copy of the content is kept to compare.
+            struct ContentHash {
+                uint64_t low = 0;
+                uint64_t high = 0;
+
+                bool operator==(const ContentHash &other) const { return low == other.low && high == other.high; }
+            };
+            struct ContentHasher {
+                size_t operator()(const ContentHash &hash) const { return static_cast<size_t>(hash.low ^ hash.high); }
+            };
+
+            struct Model {
+                State state = State::Loading;
+                std::shared_ptr<VkeModel> model{};
+                uint32_t references = 1;
+                // the model whose buffers this one uses when its content was loaded before
+                ModelId shared_with = INVALID_MODEL;
+                // keys in path_models and content_models, removed on release
+                std::string path_key{};
+                ContentHash content_hash{};
+                bool hashed = false;
+                VkDeviceSize bytes = 0;
+            };
+
+            struct LoadJob {
+                ModelId model;
+                std::string path;
+                VkeModel::Data data;
+                bool with_meshlets;
+                bool with_positions;
+            };
+
+            struct LoadResult {
+                ModelId model;
+                VkeModel::Data data;
+                ContentHash content_hash;
+                std::string error;
+            };
+
+            // a model whose buffers exist but are not filled yet, the copies read from data
+            struct Upload {
+                ModelId model;
+                VkeModel::Data data;
+                std::shared_ptr<VkeModel> gpu_model{};
+                std::vector<VkeModel::BufferUpload> buffers{};
+                size_t next_buffer = 0;
+                VkDeviceSize next_offset = 0;
+                VkDeviceSize remaining_bytes = 0;
+            };
+
+            struct RetiredModel {
+                std::shared_ptr<VkeModel> model;
+                VkDeviceSize bytes;
+                uint64_t frame;
+            };
+
+            static ContentHash content_hash(const VkeModel::Data &data, bool with_meshlets, bool with_positions);
+            ModelId add_job(std::string path, VkeModel::Data data, bool with_meshlets, bool with_positions);
+            Handle make_handle(ModelId model) { return Handle{std::make_shared<const Handle::Reference>(*this, model)}; }
+            // drops the reference of one load or create, called by the last copy of its handle
+            void release(ModelId model);
+            ModelId resolve(ModelId model) const;
+            void retire(std::shared_ptr<VkeModel> model, VkDeviceSize bytes);
+            void worker_loop();
+            void collect_loads();
+            // records copies of upload until budget bytes are used or the staging ring is full,
+            // returns the bytes recorded
+            VkDeviceSize record_copies(VkCommandBuffer command_buffer, Upload &upload, VkDeviceSize budget);
+            void create_placeholder();
+
+            // buffer creations per frame at most, they allocate device memory on the render thread
+            static constexpr uint32_t MAX_MODEL_CREATIONS_PER_FRAME = 8;
+
+            VkeDevice &vke_device;
+            uint32_t frames_in_flight;
+            VkDeviceSize upload_budget;
+            VkeStagingRing staging;
+
+            std::shared_ptr<VkeModel> placeholder{};
+            std::vector<Model> models{};
+            // loaded models in load order, the front one is uploaded first
+            std::deque<Upload> uploads{};
+            std::unordered_map<std::string, ModelId> path_models{};
+            std::unordered_map<ContentHash, ModelId, ContentHasher> content_models{};
+            std::vector<RetiredModel> retired_models{};
+            uint64_t frame_number = 0;
+            Statistics totals{};
+
+            mutable std::mutex mutex;
+            std::condition_variable jobs_changed;
+            std::deque<LoadJob> jobs;
+            std::vector<LoadResult> results;
+            uint32_t active_loads = 0;
+            bool stopping = false;
+            std::vector<std::thread> workers;
+        };
+    }
+
+#endif
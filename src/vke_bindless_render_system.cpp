@@ -0,0 +1,175 @@
+#include "vke_bindless_render_system.hpp"
+#include "vke_cpu_trace.hpp"
+#include "vke_mesh_lod.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+
+    // std430 layout of ObjectData in bindless_shader
+    struct BindlessObjectData {
+        glm::mat4 model_matrix{1.f};
+        glm::mat4 normal_matrix{1.f};
+        uint32_t texture_slot = VkeBindlessTable::INVALID_SLOT;
+        uint32_t padding[3];
+    };
+
+    struct BindlessPushConstantData {
+        uint32_t object_buffer;
+        uint32_t object_index;
+    };
+
+    VkeBindlessRenderSystem::VkeBindlessRenderSystem(
+        VkeDevice &device,
+        VkRenderPass render_pass,
+        VkDescriptorSetLayout global_set_layout,
+        VkeBindlessTable &bindless_table,
+        uint32_t frames_in_flight
+    ) :
+        vke_device{device},
+        bindless_table{bindless_table},
+        frame_objects(frames_in_flight)
+    {
+        create_pipeline_layout(global_set_layout);
+        create_pipeline(render_pass);
+    }
+
+    VkeBindlessRenderSystem::~VkeBindlessRenderSystem() {
+        for (auto &frame : frame_objects) {
+            bindless_table.release_storage_buffer(frame.slot);
+        }
+        vkDestroyPipelineLayout(vke_device.device(), pipeline_layout, nullptr);
+    }
+
+    void VkeBindlessRenderSystem::create_pipeline_layout(VkDescriptorSetLayout global_set_layout) {
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        push_constant_range.offset = 0;
+        push_constant_range.size = sizeof(BindlessPushConstantData);
+
+        std::vector<VkDescriptorSetLayout> descriptor_set_layouts{global_set_layout, bindless_table.get_descriptor_set_layout()};
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info{};
+        pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
+        pipeline_layout_info.pSetLayouts = descriptor_set_layouts.data();
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+        if (vkCreatePipelineLayout(vke_device.device(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout");
+        }
+    }
+
+    void VkeBindlessRenderSystem::create_pipeline(VkRenderPass render_pass) {
+        assert(pipeline_layout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        PipelineConfigInfo pipeline_config{};
+        VkePipeline::defaultPipelineConfigInfo(pipeline_config);
+
+        pipeline_config.render_pass = render_pass;
+        pipeline_config.pipeline_layout = pipeline_layout;
+        vke_pipeline = std::make_unique<VkePipeline>(
+            vke_device,
+            "../shaders/bindless_shader.vert.spv",
+            "../shaders/bindless_shader.frag.spv",
+            pipeline_config
+        );
+    }
+
+    void VkeBindlessRenderSystem::reserve_objects(FrameObjects &frame, uint32_t count) {
+        if (frame.buffer && frame.buffer->get_instance_count() >= count) {
+            return;
+        }
+
+        // grow by half to avoid reallocating every frame while the scene is filling up
+        uint32_t capacity = std::max(count + count / 2, 64u);
+        frame.buffer = std::make_unique<VkeBuffer>(
+            vke_device,
+            sizeof(BindlessObjectData),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        frame.buffer->map();
+
+        auto buffer_info = frame.buffer->descriptor_info();
+        if (frame.slot == VkeBindlessTable::INVALID_SLOT) {
+            frame.slot = bindless_table.add_storage_buffer(buffer_info);
+        } else {
+            bindless_table.update_storage_buffer(frame.slot, buffer_info);
+        }
+    }
+
+    void VkeBindlessRenderSystem::render_game_objects(FrameInfo frame_info) {
+        VKE_CPU_SCOPE("render_game_objects");
+        VkeGpuScope gpu_scope{frame_info.profiler, frame_info.command_buffer, "render_game_objects"};
+
+        draw_count = 0;
+        triangle_count = 0;
+
+        // all object data of the frame in one write
+        auto &frame = frame_objects[frame_info.frame_index];
+        reserve_objects(frame, static_cast<uint32_t>(frame_info.game_objects.size()));
+
+        auto *objects = static_cast<BindlessObjectData*>(frame.buffer->get_mapped_memory());
+        struct Draw {
+            VkeGameObject *object;
+            uint32_t index;
+            uint32_t lod;
+        };
+        std::vector<Draw> draws{};
+        draws.reserve(frame_info.game_objects.size());
+        uint32_t object_index = 0;
+        for (auto &kv : frame_info.game_objects) {
+            auto &obj = kv.second;
+            if (obj.model == nullptr) continue;
+
+            BindlessObjectData data{};
+            data.model_matrix = obj.transform.mat4();
+            data.normal_matrix = obj.transform.normal_matrix();
+            data.texture_slot = obj.texture_slot;
+            objects[object_index] = data;
+            uint32_t lod = lod_error > 0.f
+                ? select_lod(*obj.model, data.model_matrix, frame_info.camera, frame_info.viewport_height, lod_error)
+                : 0;
+            draws.push_back({&obj, object_index, lod});
+            object_index++;
+        }
+
+        vke_pipeline->bind(frame_info.command_buffer);
+
+        VkDescriptorSet descriptor_sets[] = {frame_info.global_descriptor_set, bindless_table.get_descriptor_set()};
+        vkCmdBindDescriptorSets(
+            frame_info.command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipeline_layout,
+            0, 2,
+            descriptor_sets,
+            0,
+            nullptr
+        );
+
+        for (auto &[obj, index, lod] : draws) {
+            BindlessPushConstantData push{frame.slot, index};
+            vkCmdPushConstants(
+                frame_info.command_buffer,
+                pipeline_layout,
+                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                0,
+                sizeof(BindlessPushConstantData),
+                &push
+            );
+            obj->model->bind(frame_info.command_buffer);
+            obj->model->draw(frame_info.command_buffer, lod);
+            draw_count++;
+            triangle_count += obj->model->get_triangle_count(lod);
+        }
+    }
+}
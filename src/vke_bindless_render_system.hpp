@@ -0,0 +1,67 @@
+#ifndef vke_bindless_render_system_
+    #define vke_bindless_render_system_
+
+    #include "vke_pipeline.hpp"
+    #include "vke_device.hpp"
+    #include "vke_buffer.hpp"
+    #include "vke_bindless_table.hpp"
+    #include "vke_frame_info.hpp"
+
+    // std
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+        // Renders the same scene as VkeSimpleRenderSystem, but writes all per object data into one storage
+        // buffer per frame and binds the global and bindless sets once. Each draw only pushes the index
+        // of its object, the texture slot comes from the object data.
+        class VkeBindlessRenderSystem {
+            public:
+            VkeBindlessRenderSystem(
+                VkeDevice &device,
+                VkRenderPass render_pass,
+                VkDescriptorSetLayout global_set_layout,
+                VkeBindlessTable &bindless_table,
+                uint32_t frames_in_flight
+            );
+            ~VkeBindlessRenderSystem();
+
+            VkeBindlessRenderSystem(const VkeBindlessRenderSystem&) = delete;
+            VkeBindlessRenderSystem& operator=(const VkeBindlessRenderSystem&) = delete;
+
+            void render_game_objects(FrameInfo frame_info);
+
+            // largest simplification error in pixels a selected lod may show, 0 draws the full meshes
+            void set_lod_error(float pixels) { lod_error = pixels; }
+
+            // statistics of the last render_game_objects call
+            uint32_t get_draw_count() const { return draw_count; }
+            uint64_t get_triangle_count() const { return triangle_count; }
+
+            private:
+            struct FrameObjects {
+                std::unique_ptr<VkeBuffer> buffer;
+                uint32_t slot = VkeBindlessTable::INVALID_SLOT;
+            };
+
+            void create_pipeline_layout(VkDescriptorSetLayout global_set_layout);
+            void create_pipeline(VkRenderPass render_pass);
+            // grows the frame's object buffer, the frame slot is not in flight when this is called
+            void reserve_objects(FrameObjects &frame_objects, uint32_t count);
+
+            VkeDevice &vke_device;
+            VkeBindlessTable &bindless_table;
+
+            std::unique_ptr<VkePipeline> vke_pipeline;
+            VkPipelineLayout pipeline_layout;
+
+            std::vector<FrameObjects> frame_objects;
+
+            float lod_error = 1.f;
+
+            uint32_t draw_count = 0;
+            uint64_t triangle_count = 0;
+        };
+    }
+
+#endif
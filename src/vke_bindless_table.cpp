@@ -0,0 +1,168 @@
+#include "vke_bindless_table.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace vke {
+
+    uint32_t VkeBindlessTable::SlotAllocator::allocate() {
+        if (!free_slots.empty()) {
+            uint32_t slot = free_slots.back();
+            free_slots.pop_back();
+            return slot;
+        }
+        if (next_slot >= capacity) {
+            return INVALID_SLOT;
+        }
+        return next_slot++;
+    }
+
+    void VkeBindlessTable::SlotAllocator::release(uint32_t slot, uint64_t frame) {
+        pending_slots.push_back({slot, frame});
+    }
+
+    void VkeBindlessTable::SlotAllocator::recycle(uint64_t completed_frame) {
+        size_t recycled = 0;
+        while (recycled < pending_slots.size() && pending_slots[recycled].frame <= completed_frame) {
+            free_slots.push_back(pending_slots[recycled].slot);
+            recycled++;
+        }
+        pending_slots.erase(pending_slots.begin(), pending_slots.begin() + recycled);
+    }
+
+    namespace {
+        // descriptors of each kind left to the other sets of a pipeline layout, the limits count all of them
+        constexpr uint32_t RESERVED_DESCRIPTORS = 16;
+
+        uint32_t below_limit(uint32_t count, uint32_t limit) {
+            return std::min(count, limit > RESERVED_DESCRIPTORS ? limit - RESERVED_DESCRIPTORS : 0u);
+        }
+
+        // the update after bind limits, per stage and per set, a combined image sampler counts as sampled
+        // image and as sampler
+        uint32_t storage_buffer_capacity(const VkeDevice &device, uint32_t requested) {
+            if (!device.supportsBindless()) {
+                return 0;
+            }
+            const auto &limits = device.getDescriptorIndexingProperties();
+            uint32_t capacity = below_limit(requested, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers);
+            return below_limit(capacity, limits.maxDescriptorSetUpdateAfterBindStorageBuffers);
+        }
+
+        uint32_t sampled_image_capacity(const VkeDevice &device, uint32_t requested, uint32_t storage_buffers) {
+            if (!device.supportsBindless()) {
+                return 0;
+            }
+            const auto &limits = device.getDescriptorIndexingProperties();
+            uint32_t capacity = below_limit(requested, limits.maxPerStageDescriptorUpdateAfterBindSampledImages);
+            capacity = below_limit(capacity, limits.maxPerStageDescriptorUpdateAfterBindSamplers);
+            capacity = below_limit(capacity, limits.maxDescriptorSetUpdateAfterBindSampledImages);
+            capacity = below_limit(capacity, limits.maxDescriptorSetUpdateAfterBindSamplers);
+            // both arrays share the resources of a stage
+            uint32_t resources = limits.maxPerStageUpdateAfterBindResources;
+            return below_limit(capacity, resources > storage_buffers ? resources - storage_buffers : 0u);
+        }
+    }
+
+    VkeBindlessTable::VkeBindlessTable(
+        VkeDevice &device,
+        uint32_t frames_in_flight,
+        uint32_t max_storage_buffers,
+        uint32_t max_sampled_images
+    ) :
+        vke_device{device},
+        frames_in_flight{frames_in_flight},
+        storage_buffers{storage_buffer_capacity(device, max_storage_buffers)},
+        sampled_images{sampled_image_capacity(device, max_sampled_images, storage_buffers.get_capacity())}
+    {
+        if (!device.supportsBindless()) {
+            throw std::runtime_error("bindless descriptors are not supported by this device");
+        }
+
+        VkDescriptorBindingFlags binding_flags =
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+        set_layout = VkeDescriptorSetLayout::Builder(device)
+            .add_binding(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS, storage_buffers.get_capacity())
+            .set_binding_flags(STORAGE_BUFFER_BINDING, binding_flags)
+            .add_binding(SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_ALL_GRAPHICS, sampled_images.get_capacity())
+            .set_binding_flags(SAMPLED_IMAGE_BINDING, binding_flags)
+            .build();
+
+        pool = VkeDescriptorPool::Builder(device)
+            .set_max_sets(1)
+            .set_pool_flags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+            .add_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storage_buffers.get_capacity())
+            .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, sampled_images.get_capacity())
+            .build();
+
+        if (!pool->allocate_descriptor(set_layout->get_descriptor_set_layout(), descriptor_set)) {
+            throw std::runtime_error("failed to allocate bindless descriptor set");
+        }
+    }
+
+    void VkeBindlessTable::write(
+        uint32_t binding,
+        uint32_t slot,
+        const VkDescriptorBufferInfo *buffer_info,
+        const VkDescriptorImageInfo *image_info
+    ) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptor_set;
+        write.dstBinding = binding;
+        write.dstArrayElement = slot;
+        write.descriptorCount = 1;
+        write.descriptorType = buffer_info ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pBufferInfo = buffer_info;
+        write.pImageInfo = image_info;
+        vkUpdateDescriptorSets(vke_device.device(), 1, &write, 0, nullptr);
+    }
+
+    uint32_t VkeBindlessTable::add_storage_buffer(const VkDescriptorBufferInfo &buffer_info) {
+        uint32_t slot = storage_buffers.allocate();
+        if (slot == INVALID_SLOT) {
+            throw std::runtime_error("bindless storage buffer slots exhausted");
+        }
+        write(STORAGE_BUFFER_BINDING, slot, &buffer_info, nullptr);
+        return slot;
+    }
+
+    uint32_t VkeBindlessTable::add_sampled_image(const VkDescriptorImageInfo &image_info) {
+        uint32_t slot = sampled_images.allocate();
+        if (slot == INVALID_SLOT) {
+            throw std::runtime_error("bindless sampled image slots exhausted");
+        }
+        write(SAMPLED_IMAGE_BINDING, slot, nullptr, &image_info);
+        return slot;
+    }
+
+    void VkeBindlessTable::update_storage_buffer(uint32_t slot, const VkDescriptorBufferInfo &buffer_info) {
+        write(STORAGE_BUFFER_BINDING, slot, &buffer_info, nullptr);
+    }
+
+    void VkeBindlessTable::update_sampled_image(uint32_t slot, const VkDescriptorImageInfo &image_info) {
+        write(SAMPLED_IMAGE_BINDING, slot, nullptr, &image_info);
+    }
+
+    void VkeBindlessTable::release_storage_buffer(uint32_t slot) {
+        if (slot != INVALID_SLOT) {
+            storage_buffers.release(slot, frame_number);
+        }
+    }
+
+    void VkeBindlessTable::release_sampled_image(uint32_t slot) {
+        if (slot != INVALID_SLOT) {
+            sampled_images.release(slot, frame_number);
+        }
+    }
+
+    void VkeBindlessTable::next_frame() {
+        frame_number++;
+        if (frame_number >= frames_in_flight) {
+            storage_buffers.recycle(frame_number - frames_in_flight);
+            sampled_images.recycle(frame_number - frames_in_flight);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef vke_bindless_table_
+    #define vke_bindless_table_
+
+    #include "vke_descriptors.hpp"
+    #include "vke_device.hpp"
+
+    // std
+    #include <cstdint>
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+
+        // One descriptor set with large, partially bound, update after bind arrays of storage buffers and
+        // sampled images. Resources are registered once and referenced by their slot index (usually
+        // through push constants), so draws never rebind descriptor sets.
+        // Released slots are only reused after frames_in_flight calls to next_frame, command buffers
+        // still in flight may reference them until then.
+        class VkeBindlessTable {
+            public:
+            static constexpr uint32_t INVALID_SLOT = ~0u;
+            static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+            static constexpr uint32_t SAMPLED_IMAGE_BINDING = 1;
+
+            // capacities are clamped to the update after bind limits of the device, leaving some descriptors
+            // to the other sets of a pipeline layout
+            VkeBindlessTable(
+                VkeDevice &device,
+                uint32_t frames_in_flight,
+                uint32_t max_storage_buffers = 1024,
+                uint32_t max_sampled_images = 4096
+            );
+
+            VkeBindlessTable(const VkeBindlessTable&) = delete;
+            VkeBindlessTable& operator=(const VkeBindlessTable&) = delete;
+
+            uint32_t add_storage_buffer(const VkDescriptorBufferInfo &buffer_info);
+            uint32_t add_sampled_image(const VkDescriptorImageInfo &image_info);
+
+            // the slot must not be used by a frame in flight
+            void update_storage_buffer(uint32_t slot, const VkDescriptorBufferInfo &buffer_info);
+            void update_sampled_image(uint32_t slot, const VkDescriptorImageInfo &image_info);
+
+            void release_storage_buffer(uint32_t slot);
+            void release_sampled_image(uint32_t slot);
+
+            // once per frame, makes slots released frames_in_flight frames ago available again
+            void next_frame();
+
+            VkDescriptorSetLayout get_descriptor_set_layout() const { return set_layout->get_descriptor_set_layout(); }
+            VkDescriptorSet get_descriptor_set() const { return descriptor_set; }
+
+            uint32_t get_storage_buffer_capacity() const { return storage_buffers.get_capacity(); }
+            uint32_t get_sampled_image_capacity() const { return sampled_images.get_capacity(); }
+            uint32_t get_storage_buffer_count() const { return storage_buffers.get_used(); }
+            uint32_t get_sampled_image_count() const { return sampled_images.get_used(); }
+
+            private:
+            class SlotAllocator {
+                public:
+                explicit SlotAllocator(uint32_t capacity) : capacity{capacity} {}
+
+                uint32_t allocate();
+                void release(uint32_t slot, uint64_t frame);
+                void recycle(uint64_t completed_frame);
+
+                uint32_t get_capacity() const { return capacity; }
+                uint32_t get_used() const { return next_slot - static_cast<uint32_t>(free_slots.size()); }
+
+                private:
+                struct PendingSlot {
+                    uint32_t slot;
+                    uint64_t frame;
+                };
+
+                uint32_t capacity;
+                uint32_t next_slot = 0;
+                std::vector<uint32_t> free_slots{};
+                // in release order, so frames are increasing
+                std::vector<PendingSlot> pending_slots{};
+            };
+
+            void write(uint32_t binding, uint32_t slot, const VkDescriptorBufferInfo *buffer_info, const VkDescriptorImageInfo *image_info);
+
+            VkeDevice &vke_device;
+            uint32_t frames_in_flight;
+            uint64_t frame_number = 0;
+
+            SlotAllocator storage_buffers;
+            SlotAllocator sampled_images;
+
+            std::unique_ptr<VkeDescriptorSetLayout> set_layout;
+            std::unique_ptr<VkeDescriptorPool> pool;
+            VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+        };
+    }
+
+#endif
@@ -42,7 +42,7 @@ VkeBuffer::VkeBuffer(
 VkeBuffer::~VkeBuffer() {
   unmap();
   vkDestroyBuffer(vke_device.device(), buffer, nullptr);
-  vkFreeMemory(vke_device.device(), memory, nullptr);
+  vke_device.freeMemory(memory);
 }
 
 
@@ -82,5 +82,11 @@ void VkeCamera::set_view_yxz(glm::vec3 position, glm::vec3 rotation) {
   view_matrix[3][2] = -glm::dot(w, position);
 }
 
-
+glm::vec3 VkeCamera::get_position() const {
+    // the rotation rows are orthonormal, so the translation -R * position is undone by R^T
+    const glm::vec3 u{view_matrix[0][0], view_matrix[1][0], view_matrix[2][0]};
+    const glm::vec3 v{view_matrix[0][1], view_matrix[1][1], view_matrix[2][1]};
+    const glm::vec3 w{view_matrix[0][2], view_matrix[1][2], view_matrix[2][2]};
+    return -(view_matrix[3][0] * u + view_matrix[3][1] * v + view_matrix[3][2] * w);
+}
 }
\ No newline at end of file
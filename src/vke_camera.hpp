@@ -19,6 +19,8 @@ namespace vke {
 
         const glm::mat4& get_projection() const { return projection_matrix; }
         const glm::mat4& get_view() const { return view_matrix; }
+        // world space position, recovered from the view matrix
+        glm::vec3 get_position() const;
 
         private:
         glm::mat4 projection_matrix{1.f};
@@ -0,0 +1,209 @@
+#include "vke_command_recorder.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+
+namespace vke {
+
+    const char *VkeCommandRecorder::to_string(Command command) {
+        switch (command) {
+            case Command::BindPipeline: return "bind_pipeline";
+            case Command::BindDescriptorSets: return "bind_descriptor_sets";
+            case Command::BindVertexBuffers: return "bind_vertex_buffers";
+            case Command::BindIndexBuffer: return "bind_index_buffer";
+            case Command::SetViewport: return "set_viewport";
+            case Command::SetScissor: return "set_scissor";
+            case Command::PushConstants: return "push_constants";
+            case Command::Draw: return "draw";
+            default: return "unknown";
+        }
+    }
+
+    uint32_t VkeCommandRecorder::Statistics::total_issued() const {
+        uint32_t total = 0;
+        for (uint32_t count : issued) {
+            total += count;
+        }
+        return total;
+    }
+
+    uint32_t VkeCommandRecorder::Statistics::total_elided() const {
+        uint32_t total = 0;
+        for (uint32_t count : elided) {
+            total += count;
+        }
+        return total;
+    }
+
+    VkeCommandRecorder::Statistics &VkeCommandRecorder::Statistics::operator+=(const Statistics &other) {
+        for (uint32_t i = 0; i < COMMAND_COUNT; i++) {
+            issued[i] += other.issued[i];
+            elided[i] += other.elided[i];
+        }
+        return *this;
+    }
+
+    void VkeCommandRecorder::Statistics::report(std::ostream &out) const {
+        out << "[commands] issued " << total_issued() << ", elided " << total_elided() << '\n';
+        for (uint32_t i = 0; i < COMMAND_COUNT; i++) {
+            if (issued[i] + elided[i] == 0) continue;
+            out << "  " << to_string(static_cast<Command>(i)) << ": " << issued[i] << " issued, " << elided[i] << " elided" << '\n';
+        }
+    }
+
+    void VkeCommandRecorder::begin(VkCommandBuffer command_buffer) {
+        this->command_buffer = command_buffer;
+        invalidate();
+    }
+
+    void VkeCommandRecorder::invalidate() {
+        bind_points = {};
+        vertex_buffers.fill(VK_NULL_HANDLE);
+        index_buffer = VK_NULL_HANDLE;
+        viewport_set.reset();
+        scissor_set.reset();
+        push_layout = VK_NULL_HANDLE;
+        push_set.reset();
+    }
+
+    bool VkeCommandRecorder::elide(Command command, bool redundant) {
+        (redundant ? statistics.elided : statistics.issued)[static_cast<uint32_t>(command)]++;
+        return redundant;
+    }
+
+    void VkeCommandRecorder::bind_pipeline(VkPipelineBindPoint bind_point, VkPipeline pipeline) {
+        auto &state = bind_point_state(bind_point);
+        if (elide(Command::BindPipeline, state.pipeline == pipeline)) {
+            return;
+        }
+        state.pipeline = pipeline;
+        vkCmdBindPipeline(command_buffer, bind_point, pipeline);
+    }
+
+    void VkeCommandRecorder::bind_descriptor_sets(
+        VkPipelineBindPoint bind_point,
+        VkPipelineLayout layout,
+        uint32_t first_set,
+        uint32_t set_count,
+        const VkDescriptorSet *sets,
+        uint32_t dynamic_offset_count,
+        const uint32_t *dynamic_offsets
+    ) {
+        auto &state = bind_point_state(bind_point);
+        // compatibility of two layouts is not tracked, sets bound with another layout count as unknown
+        bool tracked = first_set + set_count <= MAX_DESCRIPTOR_SETS;
+        bool redundant = tracked && dynamic_offset_count == 0 && state.layout == layout
+            && std::equal(sets, sets + set_count, state.sets.begin() + first_set);
+        if (elide(Command::BindDescriptorSets, redundant)) {
+            return;
+        }
+
+        if (state.layout != layout) {
+            state.sets.fill(VK_NULL_HANDLE);
+            state.layout = layout;
+        }
+        for (uint32_t i = 0; i < set_count && first_set + i < MAX_DESCRIPTOR_SETS; i++) {
+            state.sets[first_set + i] = dynamic_offset_count == 0 ? sets[i] : VK_NULL_HANDLE;
+        }
+        vkCmdBindDescriptorSets(command_buffer, bind_point, layout, first_set, set_count, sets, dynamic_offset_count, dynamic_offsets);
+    }
+
+    void VkeCommandRecorder::bind_vertex_buffers(uint32_t first_binding, uint32_t binding_count, const VkBuffer *buffers, const VkDeviceSize *offsets) {
+        bool redundant = first_binding + binding_count <= MAX_VERTEX_BINDINGS;
+        for (uint32_t i = 0; redundant && i < binding_count; i++) {
+            redundant = buffers[i] != VK_NULL_HANDLE
+                && vertex_buffers[first_binding + i] == buffers[i]
+                && vertex_offsets[first_binding + i] == offsets[i];
+        }
+        if (elide(Command::BindVertexBuffers, redundant)) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < binding_count && first_binding + i < MAX_VERTEX_BINDINGS; i++) {
+            vertex_buffers[first_binding + i] = buffers[i];
+            vertex_offsets[first_binding + i] = offsets[i];
+        }
+        vkCmdBindVertexBuffers(command_buffer, first_binding, binding_count, buffers, offsets);
+    }
+
+    void VkeCommandRecorder::bind_index_buffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type) {
+        bool redundant = index_buffer != VK_NULL_HANDLE && index_buffer == buffer && index_offset == offset && index_type == type;
+        if (elide(Command::BindIndexBuffer, redundant)) {
+            return;
+        }
+        index_buffer = buffer;
+        index_offset = offset;
+        index_type = type;
+        vkCmdBindIndexBuffer(command_buffer, buffer, offset, type);
+    }
+
+    void VkeCommandRecorder::set_viewport(uint32_t first_viewport, uint32_t viewport_count, const VkViewport *new_viewports) {
+        bool redundant = first_viewport + viewport_count <= MAX_VIEWPORTS;
+        for (uint32_t i = 0; redundant && i < viewport_count; i++) {
+            redundant = viewport_set[first_viewport + i]
+                && std::memcmp(&viewports[first_viewport + i], &new_viewports[i], sizeof(VkViewport)) == 0;
+        }
+        if (elide(Command::SetViewport, redundant)) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < viewport_count && first_viewport + i < MAX_VIEWPORTS; i++) {
+            viewports[first_viewport + i] = new_viewports[i];
+            viewport_set[first_viewport + i] = true;
+        }
+        vkCmdSetViewport(command_buffer, first_viewport, viewport_count, new_viewports);
+    }
+
+    void VkeCommandRecorder::set_scissor(uint32_t first_scissor, uint32_t scissor_count, const VkRect2D *new_scissors) {
+        bool redundant = first_scissor + scissor_count <= MAX_VIEWPORTS;
+        for (uint32_t i = 0; redundant && i < scissor_count; i++) {
+            redundant = scissor_set[first_scissor + i]
+                && std::memcmp(&scissors[first_scissor + i], &new_scissors[i], sizeof(VkRect2D)) == 0;
+        }
+        if (elide(Command::SetScissor, redundant)) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < scissor_count && first_scissor + i < MAX_VIEWPORTS; i++) {
+            scissors[first_scissor + i] = new_scissors[i];
+            scissor_set[first_scissor + i] = true;
+        }
+        vkCmdSetScissor(command_buffer, first_scissor, scissor_count, new_scissors);
+    }
+
+    void VkeCommandRecorder::push_constants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void *data) {
+        bool tracked = offset + size <= MAX_PUSH_CONSTANT_SIZE;
+        bool redundant = tracked && layout == push_layout && stages == push_stages;
+        for (uint32_t i = offset; redundant && i < offset + size; i++) {
+            redundant = push_set[i];
+        }
+        redundant = redundant && std::memcmp(push_data.data() + offset, data, size) == 0;
+        if (elide(Command::PushConstants, redundant)) {
+            return;
+        }
+
+        if (layout != push_layout || stages != push_stages) {
+            push_set.reset();
+            push_layout = layout;
+            push_stages = stages;
+        }
+        if (tracked) {
+            std::memcpy(push_data.data() + offset, data, size);
+            for (uint32_t i = offset; i < offset + size; i++) {
+                push_set[i] = true;
+            }
+        }
+        vkCmdPushConstants(command_buffer, layout, stages, offset, size, data);
+    }
+
+    void VkeCommandRecorder::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance) {
+        elide(Command::Draw, false);
+        vkCmdDraw(command_buffer, vertex_count, instance_count, first_vertex, first_instance);
+    }
+
+    void VkeCommandRecorder::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) {
+        elide(Command::Draw, false);
+        vkCmdDrawIndexed(command_buffer, index_count, instance_count, first_index, vertex_offset, first_instance);
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef vke_command_recorder_
+    #define vke_command_recorder_
+
+    // std
+    #include <array>
+    #include <bitset>
+    #include <cstdint>
+    #include <ostream>
+    #include <vulkan/vulkan_core.h>
+
+    namespace vke {
+        // Thin wrapper around a command buffer that remembers the bound state and drops binds that would not
+        // change it: pipelines, descriptor sets, vertex and index buffers, viewports, scissors and push
+        // constants. Everything recorded into the command buffer past the recorder is unknown to it, call
+        // invalidate afterwards. Sets bound with dynamic offsets are always recorded.
+        class VkeCommandRecorder {
+            public:
+            enum class Command : uint32_t {
+                BindPipeline,
+                BindDescriptorSets,
+                BindVertexBuffers,
+                BindIndexBuffer,
+                SetViewport,
+                SetScissor,
+                PushConstants,
+                Draw,
+                COUNT
+            };
+            static constexpr uint32_t COMMAND_COUNT = static_cast<uint32_t>(Command::COUNT);
+            static const char *to_string(Command command);
+
+            struct Statistics {
+                std::array<uint32_t, COMMAND_COUNT> issued{};
+                std::array<uint32_t, COMMAND_COUNT> elided{};
+
+                uint32_t get_issued(Command command) const { return issued[static_cast<uint32_t>(command)]; }
+                uint32_t get_elided(Command command) const { return elided[static_cast<uint32_t>(command)]; }
+                uint32_t total_issued() const;
+                uint32_t total_elided() const;
+                Statistics &operator+=(const Statistics &other);
+                void report(std::ostream &out) const;
+            };
+
+            static constexpr uint32_t MAX_DESCRIPTOR_SETS = 8;
+            static constexpr uint32_t MAX_VERTEX_BINDINGS = 16;
+            static constexpr uint32_t MAX_VIEWPORTS = 4;
+            // the limit every device supports
+            static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
+            VkeCommandRecorder() = default;
+            explicit VkeCommandRecorder(VkCommandBuffer command_buffer) { begin(command_buffer); }
+
+            // starts over with a command buffer in the initial state, the statistics are kept
+            void begin(VkCommandBuffer command_buffer);
+            // forgets the bound state, the next call of every kind is recorded
+            void invalidate();
+
+            VkCommandBuffer get_command_buffer() const { return command_buffer; }
+            const Statistics &get_statistics() const { return statistics; }
+            void reset_statistics() { statistics = {}; }
+
+            void bind_pipeline(VkPipelineBindPoint bind_point, VkPipeline pipeline);
+            void bind_descriptor_sets(
+                VkPipelineBindPoint bind_point,
+                VkPipelineLayout layout,
+                uint32_t first_set,
+                uint32_t set_count,
+                const VkDescriptorSet *sets,
+                uint32_t dynamic_offset_count = 0,
+                const uint32_t *dynamic_offsets = nullptr
+            );
+            void bind_vertex_buffers(uint32_t first_binding, uint32_t binding_count, const VkBuffer *buffers, const VkDeviceSize *offsets);
+            void bind_index_buffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType index_type);
+            void set_viewport(uint32_t first_viewport, uint32_t viewport_count, const VkViewport *viewports);
+            void set_scissor(uint32_t first_scissor, uint32_t scissor_count, const VkRect2D *scissors);
+            void push_constants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void *data);
+
+            // never elided, counted so the elided binds can be put in relation to the draws
+            void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+            void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
+
+            private:
+            struct BindPointState {
+                VkPipeline pipeline = VK_NULL_HANDLE;
+                VkPipelineLayout layout = VK_NULL_HANDLE;
+                std::array<VkDescriptorSet, MAX_DESCRIPTOR_SETS> sets{};
+            };
+
+            // graphics and compute
+            BindPointState &bind_point_state(VkPipelineBindPoint bind_point) {
+                return bind_points[bind_point == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0];
+            }
+            bool elide(Command command, bool redundant);
+
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            Statistics statistics{};
+
+            std::array<BindPointState, 2> bind_points{};
+            std::array<VkBuffer, MAX_VERTEX_BINDINGS> vertex_buffers{};
+            std::array<VkDeviceSize, MAX_VERTEX_BINDINGS> vertex_offsets{};
+            VkBuffer index_buffer = VK_NULL_HANDLE;
+            VkDeviceSize index_offset = 0;
+            VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+            std::array<VkViewport, MAX_VIEWPORTS> viewports{};
+            std::array<VkRect2D, MAX_VIEWPORTS> scissors{};
+            std::bitset<MAX_VIEWPORTS> viewport_set{};
+            std::bitset<MAX_VIEWPORTS> scissor_set{};
+
+            // bytes last pushed with push_layout and push_stages, push_set marks the ones that are known
+            VkPipelineLayout push_layout = VK_NULL_HANDLE;
+            VkShaderStageFlags push_stages = 0;
+            std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> push_data{};
+            std::bitset<MAX_PUSH_CONSTANT_SIZE> push_set{};
+        };
+    }
+
+#endif
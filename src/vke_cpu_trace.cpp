@@ -0,0 +1,91 @@
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <memory>
+#include <mutex>
+
+namespace vke {
+
+    namespace {
+        struct CpuEvent {
+            const char *name;
+            int64_t start_ns;
+            int64_t duration_ns;
+        };
+
+        struct ThreadBuffer {
+            std::string name;
+            std::unique_ptr<CpuEvent[]> events{new CpuEvent[VkeCpuTrace::THREAD_CAPACITY]};
+            std::atomic<size_t> count{0};
+            std::atomic<size_t> dropped{0};
+        };
+
+        // buffers stay registered after their thread exits so its events can still be collected
+        std::mutex registry_mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+        ThreadBuffer& thread_buffer() {
+            thread_local std::shared_ptr<ThreadBuffer> buffer = []() {
+                auto buffer = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock{registry_mutex};
+                buffer->name = "CPU thread " + std::to_string(registry.size());
+                registry.push_back(buffer);
+                return buffer;
+            }();
+            return *buffer;
+        }
+    }
+
+    std::atomic<bool> VkeCpuTrace::enabled{false};
+
+    void VkeCpuTrace::set_enabled(bool enable) {
+        enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    void VkeCpuTrace::set_thread_name(const std::string &name) {
+        auto &buffer = thread_buffer();
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        buffer.name = name;
+    }
+
+    void VkeCpuTrace::record(const char *name, int64_t start_ns, int64_t end_ns) {
+        auto &buffer = thread_buffer();
+        size_t index = buffer.count.load(std::memory_order_relaxed);
+        if (index >= THREAD_CAPACITY) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[index] = {name, start_ns, end_ns - start_ns};
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    std::vector<TraceEvent> VkeCpuTrace::collect() {
+        std::vector<TraceEvent> events{};
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        for (auto &buffer : registry) {
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++) {
+                auto &event = buffer->events[i];
+                events.push_back({event.name, buffer->name, event.start_ns, event.duration_ns});
+            }
+        }
+        return events;
+    }
+
+    size_t VkeCpuTrace::get_dropped_events() {
+        size_t dropped = 0;
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        for (auto &buffer : registry) {
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+    void VkeCpuTrace::clear() {
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        for (auto &buffer : registry) {
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+}
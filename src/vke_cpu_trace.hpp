@@ -0,0 +1,72 @@
+#ifndef vke_cpu_trace_
+    #define vke_cpu_trace_
+
+    #include "vke_trace.hpp"
+
+    // std
+    #include <atomic>
+    #include <string>
+    #include <vector>
+
+    namespace vke {
+        // Records cpu scopes into a fixed size buffer per thread. Only the owning thread writes to its buffer and
+        // publishes the event count with a release store, so recording takes no lock and collect can run
+        // concurrently. While disabled a scope costs a relaxed load and a branch that is predicted not taken in
+        // its constructor and destructor, built with VKE_NO_CPU_TRACE the scopes compile away.
+        class VkeCpuTrace {
+            public:
+            // events per thread, later events are counted as dropped
+            static constexpr size_t THREAD_CAPACITY = 1 << 16;
+
+            static void set_enabled(bool enabled);
+            static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+            // track name of the calling thread in exported traces
+            static void set_thread_name(const std::string &name);
+
+            // name must outlive the trace, pass string literals
+            static void record(const char *name, int64_t start_ns, int64_t end_ns);
+
+            // events of all threads recorded so far
+            static std::vector<TraceEvent> collect();
+            static size_t get_dropped_events();
+            // only safe while no other thread records
+            static void clear();
+
+            private:
+            static std::atomic<bool> enabled;
+        };
+
+        class VkeCpuScope {
+            public:
+            explicit VkeCpuScope(const char *name) {
+                if (VkeCpuTrace::is_enabled()) [[unlikely]] {
+                    this->name = name;
+                    start_ns = trace_clock_ns();
+                }
+            }
+            ~VkeCpuScope() {
+                if (name) [[unlikely]] {
+                    VkeCpuTrace::record(name, start_ns, trace_clock_ns());
+                }
+            }
+
+            VkeCpuScope(const VkeCpuScope&) = delete;
+            VkeCpuScope& operator=(const VkeCpuScope&) = delete;
+
+            private:
+            const char *name = nullptr;
+            int64_t start_ns = 0;
+        };
+    }
+
+    #define VKE_CPU_SCOPE_CONCAT_(a, b) a##b
+    #define VKE_CPU_SCOPE_CONCAT(a, b) VKE_CPU_SCOPE_CONCAT_(a, b)
+    // times the rest of the enclosing block
+    #ifdef VKE_NO_CPU_TRACE
+        #define VKE_CPU_SCOPE(name) static_cast<void>(0)
+    #else
+        #define VKE_CPU_SCOPE(name) ::vke::VkeCpuScope VKE_CPU_SCOPE_CONCAT(vke_cpu_scope_, __LINE__){name}
+    #endif
+
+#endif
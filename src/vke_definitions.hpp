@@ -1,10 +1,8 @@
 #ifndef vke_definitions_
     #define vke_definitions_
 
-#define SYNC_MAILBOX
- //#define SYNC_IMMEDIATE
-
-
 #define MAX_FRAME_TIME 0.2f
 
-#endif
\ No newline at end of file
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+
+#endif
@@ -0,0 +1,122 @@
+#include "vke_descriptor_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vke {
+
+    std::vector<VkeDescriptorAllocator::PoolSizeRatio> VkeDescriptorAllocator::default_pool_ratios() {
+        return {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+        };
+    }
+
+    VkeDescriptorAllocator::VkeDescriptorAllocator(
+        VkeDevice &device,
+        uint32_t initial_sets_per_pool,
+        std::vector<PoolSizeRatio> ratios
+    ) :
+        vke_device{device},
+        ratios{std::move(ratios)},
+        sets_per_pool{std::max(initial_sets_per_pool, 1u)}
+    {}
+
+    VkeDescriptorAllocator::~VkeDescriptorAllocator() {
+        for (auto pool : ready_pools) {
+            vkDestroyDescriptorPool(vke_device.device(), pool, nullptr);
+        }
+        for (auto pool : full_pools) {
+            vkDestroyDescriptorPool(vke_device.device(), pool, nullptr);
+        }
+    }
+
+    VkDescriptorPool VkeDescriptorAllocator::create_pool(uint32_t set_count) {
+        std::vector<VkDescriptorPoolSize> pool_sizes{};
+        for (auto &ratio : ratios) {
+            uint32_t count = static_cast<uint32_t>(std::ceil(ratio.ratio * set_count));
+            if (count > 0) {
+                pool_sizes.push_back({ratio.type, count});
+            }
+        }
+
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = set_count;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes = pool_sizes.data();
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(vke_device.device(), &pool_info, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    VkDescriptorPool VkeDescriptorAllocator::next_pool() {
+        if (!ready_pools.empty()) {
+            return ready_pools.back();
+        }
+
+        VkDescriptorPool pool = create_pool(sets_per_pool);
+        sets_per_pool = std::min(sets_per_pool * 2, MAX_SETS_PER_POOL);
+        ready_pools.push_back(pool);
+        return pool;
+    }
+
+    bool VkeDescriptorAllocator::allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set) {
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.pSetLayouts = &layout;
+        alloc_info.descriptorSetCount = 1;
+
+        // a full pool is retired and the allocation retried once in a fresh pool
+        for (int attempt = 0; attempt < 2; attempt++) {
+            alloc_info.descriptorPool = next_pool();
+            VkResult result = vkAllocateDescriptorSets(vke_device.device(), &alloc_info, &set);
+            if (result == VK_SUCCESS) {
+                allocated_sets++;
+                return true;
+            }
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+                throw std::runtime_error("failed to allocate descriptor set!");
+            }
+            full_pools.push_back(ready_pools.back());
+            ready_pools.pop_back();
+        }
+        // the layout needs more descriptors than a new pool holds
+        return false;
+    }
+
+    void VkeDescriptorAllocator::reset() {
+        for (auto pool : ready_pools) {
+            vkResetDescriptorPool(vke_device.device(), pool, 0);
+        }
+        for (auto pool : full_pools) {
+            vkResetDescriptorPool(vke_device.device(), pool, 0);
+            ready_pools.push_back(pool);
+        }
+        full_pools.clear();
+        allocated_sets = 0;
+    }
+
+    VkeFrameDescriptorAllocator::VkeFrameDescriptorAllocator(
+        VkeDevice &device,
+        uint32_t frames_in_flight,
+        uint32_t initial_sets_per_pool,
+        std::vector<VkeDescriptorAllocator::PoolSizeRatio> ratios
+    ) {
+        for (uint32_t i = 0; i < frames_in_flight; i++) {
+            frames.push_back(std::make_unique<VkeDescriptorAllocator>(device, initial_sets_per_pool, ratios));
+        }
+    }
+
+    void VkeFrameDescriptorAllocator::begin_frame(int frame_index) {
+        current_frame = frame_index;
+        frames[current_frame]->reset();
+    }
+}
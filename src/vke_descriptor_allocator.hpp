@@ -0,0 +1,91 @@
+#ifndef vke_descriptor_allocator_
+    #define vke_descriptor_allocator_
+
+    #include "vke_device.hpp"
+
+    // std
+    #include <cstdint>
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+
+        // Allocates descriptor sets from a chain of pools. When the current pool reports
+        // VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL a new, larger pool is started, so
+        // allocation only fails for layouts no pool can hold. Sets are not freed one by one, reset
+        // returns all of them at once and keeps the pools for reuse.
+        class VkeDescriptorAllocator {
+            public:
+            // descriptors of a type per set, pool sizes are ratio * sets_per_pool
+            struct PoolSizeRatio {
+                VkDescriptorType type;
+                float ratio;
+            };
+
+            static std::vector<PoolSizeRatio> default_pool_ratios();
+
+            VkeDescriptorAllocator(
+                VkeDevice &device,
+                uint32_t initial_sets_per_pool = 64,
+                std::vector<PoolSizeRatio> ratios = default_pool_ratios()
+            );
+            ~VkeDescriptorAllocator();
+
+            VkeDescriptorAllocator(const VkeDescriptorAllocator&) = delete;
+            VkeDescriptorAllocator& operator=(const VkeDescriptorAllocator&) = delete;
+            VkeDescriptorAllocator(VkeDescriptorAllocator&&) = delete;
+            VkeDescriptorAllocator& operator=(VkeDescriptorAllocator&&) = delete;
+
+            bool allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set);
+
+            // all sets allocated so far must no longer be in use by the gpu
+            void reset();
+
+            size_t get_pool_count() const { return full_pools.size() + ready_pools.size(); }
+            uint32_t get_allocated_sets() const { return allocated_sets; }
+
+            private:
+            VkDescriptorPool create_pool(uint32_t set_count);
+            VkDescriptorPool next_pool();
+
+            // sets_per_pool doubles with every new pool up to this
+            static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+            VkeDevice &vke_device;
+            std::vector<PoolSizeRatio> ratios;
+            uint32_t sets_per_pool;
+            uint32_t allocated_sets = 0;
+
+            // pools with space left, the back one is allocated from
+            std::vector<VkDescriptorPool> ready_pools{};
+            std::vector<VkDescriptorPool> full_pools{};
+        };
+
+        // One VkeDescriptorAllocator per frame in flight. Sets allocated while recording a frame live
+        // until the frame slot comes around again, its pools are reset in bulk once the slot's fence
+        // signalled, which makes transient per frame sets about as cheap as a pointer bump.
+        class VkeFrameDescriptorAllocator {
+            public:
+            VkeFrameDescriptorAllocator(
+                VkeDevice &device,
+                uint32_t frames_in_flight,
+                uint32_t initial_sets_per_pool = 64,
+                std::vector<VkeDescriptorAllocator::PoolSizeRatio> ratios = VkeDescriptorAllocator::default_pool_ratios()
+            );
+
+            VkeFrameDescriptorAllocator(const VkeFrameDescriptorAllocator&) = delete;
+            VkeFrameDescriptorAllocator& operator=(const VkeFrameDescriptorAllocator&) = delete;
+
+            // after the renderer waited for the frame slot, releases everything the slot allocated last time
+            void begin_frame(int frame_index);
+
+            VkeDescriptorAllocator &get_allocator() { return *frames[current_frame]; }
+            bool allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set) { return get_allocator().allocate(layout, set); }
+
+            private:
+            std::vector<std::unique_ptr<VkeDescriptorAllocator>> frames;
+            int current_frame = 0;
+        };
+    }
+
+#endif
@@ -1,6 +1,9 @@
 #include "vke_descriptors.hpp"
+#include "vke_descriptor_allocator.hpp"
+#include "vke_utils.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -25,24 +28,97 @@ VkeDescriptorSetLayout::Builder &VkeDescriptorSetLayout::Builder::add_binding(
     return *this;
 }
 
+VkeDescriptorSetLayout::Builder &VkeDescriptorSetLayout::Builder::set_binding_flags(
+    uint32_t binding, VkDescriptorBindingFlags flags) 
+{
+    assert(bindings.count(binding) == 1 && "Flags set for a binding that was not added");
+    binding_flags[binding] = flags;
+    return *this;
+}
+
 std::unique_ptr<VkeDescriptorSetLayout> VkeDescriptorSetLayout::Builder::build() const {
-  return std::make_unique<VkeDescriptorSetLayout>(vke_device, bindings);
+  return std::make_unique<VkeDescriptorSetLayout>(
+      vke_device, VkeDescriptorSetLayoutKey::make(bindings, binding_flags));
+}
+
+std::shared_ptr<VkeDescriptorSetLayout> VkeDescriptorSetLayout::Builder::build(
+    VkeDescriptorLayoutCache &cache) const {
+  return cache.get_layout(VkeDescriptorSetLayoutKey::make(bindings, binding_flags));
+}
+
+// *************** Descriptor Set Layout Key *********************
+
+VkeDescriptorSetLayoutKey VkeDescriptorSetLayoutKey::make(
+    const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+    const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &binding_flags) {
+  VkeDescriptorSetLayoutKey key{};
+  key.bindings.reserve(bindings.size());
+  for (auto &kv : bindings) {
+    key.bindings.push_back(kv.second);
+  }
+  std::sort(key.bindings.begin(), key.bindings.end(), [](const auto &a, const auto &b) {
+    return a.binding < b.binding;
+  });
+
+  key.hash = key.bindings.size();
+  for (auto &binding : key.bindings) {
+    auto flags = binding_flags.find(binding.binding);
+    key.flags.push_back(flags != binding_flags.end() ? flags->second : 0);
+    hash_combine(
+        key.hash,
+        binding.binding,
+        static_cast<uint32_t>(binding.descriptorType),
+        binding.descriptorCount,
+        static_cast<uint32_t>(binding.stageFlags),
+        static_cast<uint32_t>(key.flags.back()));
+  }
+  return key;
+}
+
+bool VkeDescriptorSetLayoutKey::operator==(const VkeDescriptorSetLayoutKey &other) const {
+  if (hash != other.hash || bindings.size() != other.bindings.size() || flags != other.flags) {
+    return false;
+  }
+  for (size_t i = 0; i < bindings.size(); i++) {
+    const auto &a = bindings[i];
+    const auto &b = other.bindings[i];
+    if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+        a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags) {
+      return false;
+    }
+  }
+  return true;
 }
 
 // *************** Descriptor Set Layout *********************
 
-VkeDescriptorSetLayout::VkeDescriptorSetLayout(
-    VkeDevice &vke_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-    : vke_device{vke_device}, bindings{bindings} {
-  std::vector<VkDescriptorSetLayoutBinding> set_layout_bindings{};
-  for (auto kv : bindings) {
-    set_layout_bindings.push_back(kv.second);
+VkeDescriptorSetLayout::VkeDescriptorSetLayout(VkeDevice &vke_device, VkeDescriptorSetLayoutKey key)
+    : vke_device{vke_device}, key{std::move(key)} {
+  VkDescriptorSetLayoutCreateFlags layout_flags = 0;
+  bool has_binding_flags = false;
+  for (auto flags : this->key.flags) {
+    has_binding_flags |= flags != 0;
+    if (flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+      layout_flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    }
   }
+  const auto &set_layout_bindings = this->key.bindings;
+  const auto &set_layout_binding_flags = this->key.flags;
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+  binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  binding_flags_info.bindingCount = static_cast<uint32_t>(set_layout_binding_flags.size());
+  binding_flags_info.pBindingFlags = set_layout_binding_flags.data();
 
   VkDescriptorSetLayoutCreateInfo descriptor_set_layout_info{};
   descriptor_set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
   descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(set_layout_bindings.size());
   descriptor_set_layout_info.pBindings = set_layout_bindings.data();
+  descriptor_set_layout_info.flags = layout_flags;
+  // only chained when used, so layouts keep working on devices without descriptor indexing
+  if (has_binding_flags) {
+    descriptor_set_layout_info.pNext = &binding_flags_info;
+  }
 
   if (vkCreateDescriptorSetLayout(
           vke_device.device(),
@@ -57,6 +133,30 @@ VkeDescriptorSetLayout::~VkeDescriptorSetLayout() {
   vkDestroyDescriptorSetLayout(vke_device.device(), descriptor_set_layout, nullptr);
 }
 
+const VkDescriptorSetLayoutBinding *VkeDescriptorSetLayout::find_binding(uint32_t binding) const {
+  auto it = std::lower_bound(
+      key.bindings.begin(), key.bindings.end(), binding, [](const auto &layout_binding, uint32_t value) {
+        return layout_binding.binding < value;
+      });
+  if (it == key.bindings.end() || it->binding != binding) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+// *************** Descriptor Layout Cache *********************
+
+std::shared_ptr<VkeDescriptorSetLayout> VkeDescriptorLayoutCache::get_layout(VkeDescriptorSetLayoutKey key) {
+  auto it = layouts.find(key);
+  if (it != layouts.end()) {
+    return it->second;
+  }
+
+  auto layout = std::make_shared<VkeDescriptorSetLayout>(vke_device, key);
+  layouts.emplace(std::move(key), layout);
+  return layout;
+}
+
 // *************** Descriptor Pool Builder *********************
 
 VkeDescriptorPool::Builder &VkeDescriptorPool::Builder::add_pool_size(
@@ -112,8 +212,7 @@ bool VkeDescriptorPool::allocate_descriptor(
   alloc_info.pSetLayouts = &descriptor_set_layout;
   alloc_info.descriptorSetCount = 1;
 
-  // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-  // a new pool whenever an old pool fills up. But this is beyond our current scope
+  // fixed size pool, VkeDescriptorAllocator chains new pools when one fills up instead
   if (vkAllocateDescriptorSets(vke_device.device(), &alloc_info, &descriptor) != VK_SUCCESS) {
     return false;
   }
@@ -135,21 +234,24 @@ void VkeDescriptorPool::reset_pool() {
 // *************** Descriptor Writer *********************
 
 VkeDescriptorWriter::VkeDescriptorWriter(VkeDescriptorSetLayout &set_layout, VkeDescriptorPool &pool)
-    : set_layout{set_layout}, pool{pool} {}
+    : set_layout{set_layout}, pool{&pool} {}
+
+VkeDescriptorWriter::VkeDescriptorWriter(
+    VkeDescriptorSetLayout &set_layout, VkeDescriptorAllocator &allocator)
+    : set_layout{set_layout}, allocator{&allocator} {}
 
 VkeDescriptorWriter &VkeDescriptorWriter::write_buffer(
     uint32_t binding, VkDescriptorBufferInfo *buffer_info) {
-  assert(set_layout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
-
-  auto &binding_description = set_layout.bindings[binding];
+  const auto *binding_description = set_layout.find_binding(binding);
+  assert(binding_description && "Layout does not contain specified binding");
 
   assert(
-      binding_description.descriptorCount == 1 &&
+      binding_description->descriptorCount == 1 &&
       "Binding single descriptor info, but binding expects multiple");
 
   VkWriteDescriptorSet write{};
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  write.descriptorType = binding_description.descriptorType;
+  write.descriptorType = binding_description->descriptorType;
   write.dstBinding = binding;
   write.pBufferInfo = buffer_info;
   write.descriptorCount = 1;
@@ -160,17 +262,16 @@ VkeDescriptorWriter &VkeDescriptorWriter::write_buffer(
 
 VkeDescriptorWriter &VkeDescriptorWriter::write_image(
     uint32_t binding, VkDescriptorImageInfo *image_info) {
-  assert(set_layout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
-
-  auto &binding_description = set_layout.bindings[binding];
+  const auto *binding_description = set_layout.find_binding(binding);
+  assert(binding_description && "Layout does not contain specified binding");
 
   assert(
-      binding_description.descriptorCount == 1 &&
+      binding_description->descriptorCount == 1 &&
       "Binding single descriptor info, but binding expects multiple");
 
   VkWriteDescriptorSet write{};
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  write.descriptorType = binding_description.descriptorType;
+  write.descriptorType = binding_description->descriptorType;
   write.dstBinding = binding;
   write.pImageInfo = image_info;
   write.descriptorCount = 1;
@@ -180,7 +281,9 @@ VkeDescriptorWriter &VkeDescriptorWriter::write_image(
 }
 
 bool VkeDescriptorWriter::build(VkDescriptorSet &set) {
-  bool success = pool.allocate_descriptor(set_layout.get_descriptor_set_layout(), set);
+  bool success = allocator 
+      ? allocator->allocate(set_layout.get_descriptor_set_layout(), set)
+      : pool->allocate_descriptor(set_layout.get_descriptor_set_layout(), set);
   if (!success) {
     return false;
   }
@@ -192,7 +295,113 @@ void VkeDescriptorWriter::overwrite(VkDescriptorSet &set) {
   for (auto &write : writes) {
     write.dstSet = set;
   }
-  vkUpdateDescriptorSets(pool.vke_device.device(), writes.size(), writes.data(), 0, nullptr);
+  vkUpdateDescriptorSets(set_layout.vke_device.device(), writes.size(), writes.data(), 0, nullptr);
+}
+
+bool VkeDescriptorWriter::build(VkDescriptorSet &set, VkeDescriptorUpdateBatch &batch) {
+  bool success = allocator 
+      ? allocator->allocate(set_layout.get_descriptor_set_layout(), set)
+      : pool->allocate_descriptor(set_layout.get_descriptor_set_layout(), set);
+  if (!success) {
+    return false;
+  }
+  overwrite(set, batch);
+  return true;
+}
+
+void VkeDescriptorWriter::overwrite(VkDescriptorSet &set, VkeDescriptorUpdateBatch &batch) {
+  for (auto &write : writes) {
+    write.dstSet = set;
+    batch.add(write);
+  }
+}
+
+// *************** Descriptor Update Batch *********************
+
+void VkeDescriptorUpdateBatch::add(const VkWriteDescriptorSet &write) {
+  if (write.pBufferInfo) {
+    info_offsets.push_back(buffer_infos.size());
+    buffer_infos.insert(buffer_infos.end(), write.pBufferInfo, write.pBufferInfo + write.descriptorCount);
+  } else if (write.pImageInfo) {
+    info_offsets.push_back(image_infos.size());
+    image_infos.insert(image_infos.end(), write.pImageInfo, write.pImageInfo + write.descriptorCount);
+  } else {
+    info_offsets.push_back(0);
+  }
+  writes.push_back(write);
+}
+
+void VkeDescriptorUpdateBatch::flush() {
+  if (writes.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < writes.size(); i++) {
+    if (writes[i].pBufferInfo) {
+      writes[i].pBufferInfo = buffer_infos.data() + info_offsets[i];
+    } else if (writes[i].pImageInfo) {
+      writes[i].pImageInfo = image_infos.data() + info_offsets[i];
+    }
+  }
+  vkUpdateDescriptorSets(
+      vke_device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  writes.clear();
+  info_offsets.clear();
+  buffer_infos.clear();
+  image_infos.clear();
+}
+
+// *************** Descriptor Update Template *********************
+
+VkeDescriptorUpdateTemplate::Builder &VkeDescriptorUpdateTemplate::Builder::add_entry(
+    uint32_t binding, size_t offset, uint32_t count, size_t stride) {
+  const auto *binding_description = set_layout.find_binding(binding);
+  assert(binding_description && "Layout does not contain specified binding");
+
+  bool is_image = binding_description->descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+                  binding_description->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+                  binding_description->descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+                  binding_description->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER;
+
+  VkDescriptorUpdateTemplateEntry entry{};
+  entry.dstBinding = binding;
+  entry.dstArrayElement = 0;
+  entry.descriptorCount = count;
+  entry.descriptorType = binding_description->descriptorType;
+  entry.offset = offset;
+  entry.stride = stride > 0 ? stride : (is_image ? sizeof(VkDescriptorImageInfo) : sizeof(VkDescriptorBufferInfo));
+  entries.push_back(entry);
+  return *this;
+}
+
+std::unique_ptr<VkeDescriptorUpdateTemplate> VkeDescriptorUpdateTemplate::Builder::build() const {
+  return std::make_unique<VkeDescriptorUpdateTemplate>(vke_device, set_layout, entries);
+}
+
+VkeDescriptorUpdateTemplate::VkeDescriptorUpdateTemplate(
+    VkeDevice &vke_device,
+    const VkeDescriptorSetLayout &set_layout,
+    const std::vector<VkDescriptorUpdateTemplateEntry> &entries)
+    : vke_device{vke_device} {
+  VkDescriptorUpdateTemplateCreateInfo template_info{};
+  template_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+  template_info.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+  template_info.pDescriptorUpdateEntries = entries.data();
+  template_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+  template_info.descriptorSetLayout = set_layout.get_descriptor_set_layout();
+
+  if (vkCreateDescriptorUpdateTemplate(vke_device.device(), &template_info, nullptr, &update_template) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor update template!");
+  }
+}
+
+VkeDescriptorUpdateTemplate::~VkeDescriptorUpdateTemplate() {
+  vkDestroyDescriptorUpdateTemplate(vke_device.device(), update_template, nullptr);
+}
+
+void VkeDescriptorUpdateTemplate::update(VkDescriptorSet set, const void *data) const {
+  vkUpdateDescriptorSetWithTemplate(vke_device.device(), set, update_template, data);
 }
 
 }
@@ -9,6 +9,28 @@
 
 namespace vke {
 
+class VkeDescriptorLayoutCache;
+class VkeDescriptorAllocator;
+class VkeDescriptorUpdateBatch;
+
+// Bindings sorted by binding number with their flags in the same order. This is the identity of a
+// layout, the hash is computed once when the key is made.
+struct VkeDescriptorSetLayoutKey {
+  std::vector<VkDescriptorSetLayoutBinding> bindings{};
+  std::vector<VkDescriptorBindingFlags> flags{};
+  size_t hash = 0;
+
+  static VkeDescriptorSetLayoutKey make(
+      const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+      const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &binding_flags);
+
+  bool operator==(const VkeDescriptorSetLayoutKey &other) const;
+};
+
+struct VkeDescriptorSetLayoutKeyHash {
+  size_t operator()(const VkeDescriptorSetLayoutKey &key) const { return key.hash; }
+};
+
 class VkeDescriptorSetLayout {
     public:
         class Builder {
@@ -20,29 +42,53 @@ class VkeDescriptorSetLayout {
         VkDescriptorType descriptor_type,
         VkShaderStageFlags stage_flags,
         uint32_t count = 1);
+    // descriptor indexing flags, update after bind bindings need a pool created with the matching flag
+    Builder &set_binding_flags(uint32_t binding, VkDescriptorBindingFlags flags);
     std::unique_ptr<VkeDescriptorSetLayout> build() const;
+    // returns the cached layout if an identical one was built before
+    std::shared_ptr<VkeDescriptorSetLayout> build(VkeDescriptorLayoutCache &cache) const;
 
    private:
     VkeDevice &vke_device;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, VkDescriptorBindingFlags> binding_flags{};
   };
 
-  VkeDescriptorSetLayout(
-      VkeDevice &vke_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+  VkeDescriptorSetLayout(VkeDevice &vke_device, VkeDescriptorSetLayoutKey key);
   ~VkeDescriptorSetLayout();
   VkeDescriptorSetLayout(const VkeDescriptorSetLayout &) = delete;
   VkeDescriptorSetLayout &operator=(const VkeDescriptorSetLayout &) = delete;
 
   VkDescriptorSetLayout get_descriptor_set_layout() const { return descriptor_set_layout; }
+  const VkeDescriptorSetLayoutKey &get_key() const { return key; }
+  // nullptr if the layout has no such binding
+  const VkDescriptorSetLayoutBinding *find_binding(uint32_t binding) const;
 
  private:
   VkeDevice &vke_device;
   VkDescriptorSetLayout descriptor_set_layout;
-  std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+  VkeDescriptorSetLayoutKey key;
 
   friend class VkeDescriptorWriter;
 };
 
+// Deduplicates descriptor set layouts by their canonical key, so the order bindings were added in
+// does not matter and identical layouts share one vulkan object.
+class VkeDescriptorLayoutCache {
+ public:
+  explicit VkeDescriptorLayoutCache(VkeDevice &vke_device) : vke_device{vke_device} {}
+  VkeDescriptorLayoutCache(const VkeDescriptorLayoutCache &) = delete;
+  VkeDescriptorLayoutCache &operator=(const VkeDescriptorLayoutCache &) = delete;
+
+  std::shared_ptr<VkeDescriptorSetLayout> get_layout(VkeDescriptorSetLayoutKey key);
+
+  size_t get_layout_count() const { return layouts.size(); }
+
+ private:
+  VkeDevice &vke_device;
+  std::unordered_map<VkeDescriptorSetLayoutKey, std::shared_ptr<VkeDescriptorSetLayout>, VkeDescriptorSetLayoutKeyHash> layouts{};
+};
+
 class VkeDescriptorPool {
  public:
   class Builder {
@@ -84,20 +130,84 @@ class VkeDescriptorPool {
   friend class VkeDescriptorWriter;
 };
 
+// Collects the descriptor writes of many sets, typically a frame, and submits them with a single
+// vkUpdateDescriptorSets. Buffer and image infos are copied, they don't need to outlive the batch.
+class VkeDescriptorUpdateBatch {
+ public:
+  explicit VkeDescriptorUpdateBatch(VkeDevice &vke_device) : vke_device{vke_device} {}
+  VkeDescriptorUpdateBatch(const VkeDescriptorUpdateBatch &) = delete;
+  VkeDescriptorUpdateBatch &operator=(const VkeDescriptorUpdateBatch &) = delete;
+
+  void add(const VkWriteDescriptorSet &write);
+  void flush();
+
+  size_t get_pending_writes() const { return writes.size(); }
+
+ private:
+  VkeDevice &vke_device;
+  std::vector<VkWriteDescriptorSet> writes{};
+  // index of each write's first info, the pointers are resolved in flush since the vectors grow
+  std::vector<size_t> info_offsets{};
+  std::vector<VkDescriptorBufferInfo> buffer_infos{};
+  std::vector<VkDescriptorImageInfo> image_infos{};
+};
+
 class VkeDescriptorWriter {
  public:
   VkeDescriptorWriter(VkeDescriptorSetLayout &set_layout, VkeDescriptorPool &pool);
+  // build allocates from the allocator, which grows instead of failing when its pools are full
+  VkeDescriptorWriter(VkeDescriptorSetLayout &set_layout, VkeDescriptorAllocator &allocator);
 
   VkeDescriptorWriter &write_buffer(uint32_t binding, VkDescriptorBufferInfo *buffer_info);
   VkeDescriptorWriter &write_image(uint32_t binding, VkDescriptorImageInfo *image_info);
 
   bool build(VkDescriptorSet &set);
   void overwrite(VkDescriptorSet &set);
+  // like build and overwrite, but the writes are only queued in the batch
+  bool build(VkDescriptorSet &set, VkeDescriptorUpdateBatch &batch);
+  void overwrite(VkDescriptorSet &set, VkeDescriptorUpdateBatch &batch);
 
  private:
   VkeDescriptorSetLayout &set_layout;
-  VkeDescriptorPool &pool;
+  // exactly one of them is set
+  VkeDescriptorPool *pool = nullptr;
+  VkeDescriptorAllocator *allocator = nullptr;
   std::vector<VkWriteDescriptorSet> writes;
 };
 
+// Writes a whole set from one struct with vkUpdateDescriptorSetWithTemplate, which skips building
+// and validating VkWriteDescriptorSets on every update. Entries point at offsets in that struct.
+// Needs a vulkan 1.1 device, see VkeDevice::supportsDescriptorUpdateTemplates.
+class VkeDescriptorUpdateTemplate {
+ public:
+  class Builder {
+   public:
+    Builder(VkeDevice &vke_device, const VkeDescriptorSetLayout &set_layout)
+        : vke_device{vke_device}, set_layout{set_layout} {}
+
+    // count descriptors of the binding, stride apart from offset (0 = tightly packed)
+    Builder &add_entry(uint32_t binding, size_t offset, uint32_t count = 1, size_t stride = 0);
+    std::unique_ptr<VkeDescriptorUpdateTemplate> build() const;
+
+   private:
+    VkeDevice &vke_device;
+    const VkeDescriptorSetLayout &set_layout;
+    std::vector<VkDescriptorUpdateTemplateEntry> entries{};
+  };
+
+  VkeDescriptorUpdateTemplate(
+      VkeDevice &vke_device,
+      const VkeDescriptorSetLayout &set_layout,
+      const std::vector<VkDescriptorUpdateTemplateEntry> &entries);
+  ~VkeDescriptorUpdateTemplate();
+  VkeDescriptorUpdateTemplate(const VkeDescriptorUpdateTemplate &) = delete;
+  VkeDescriptorUpdateTemplate &operator=(const VkeDescriptorUpdateTemplate &) = delete;
+
+  void update(VkDescriptorSet set, const void *data) const;
+
+ private:
+  VkeDevice &vke_device;
+  VkDescriptorUpdateTemplate update_template;
+};
+
 }
\ No newline at end of file
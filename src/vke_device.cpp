@@ -1,6 +1,8 @@
 #include "vke_device.hpp"
 
 // std headers
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -47,10 +49,16 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-VkeDevice::VkeDevice(VkeWindow& window) : window{window} {
+VkeDevice::VkeDevice(VkeWindow *window) : window{window} {
+  if (isHeadless()) {
+    deviceExtensions.clear();
+  }
+
   createInstance();
   setupDebugMessenger();
-  createSurface();
+  if (!isHeadless()) {
+    createSurface();
+  }
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
@@ -64,7 +72,9 @@ VkeDevice::~VkeDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (!isHeadless()) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -79,7 +89,15 @@ void VkeDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // 1.2 for descriptor indexing in core, older loaders get the version they report and the device simply
+  // runs without the features that need more. 1.0 loaders lack vkEnumerateInstanceVersion
+  auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+      vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+  if (enumerateInstanceVersion == nullptr || enumerateInstanceVersion(&instanceApiVersion) != VK_SUCCESS) {
+    instanceApiVersion = VK_API_VERSION_1_0;
+  }
+  instanceApiVersion = std::min(instanceApiVersion, static_cast<uint32_t>(VK_API_VERSION_1_2));
+  appInfo.apiVersion = instanceApiVersion;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -131,6 +149,15 @@ void VkeDevice::pickPhysicalDevice() {
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
   std::cout << "physical device: " << properties.deviceName << std::endl;
+
+  bindlessSupported = checkBindlessSupport(physicalDevice);
+  meshShaderSupported = checkMeshShaderSupport(physicalDevice);
+  multiviewSupported = checkMultiviewSupport(physicalDevice);
+
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect;
+  pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery;
 }
 
 void VkeDevice::createLogicalDevice() {
@@ -151,16 +178,52 @@ void VkeDevice::createLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+  deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;
+
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+  indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  if (bindlessSupported) {
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  }
+
+  VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+  meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+  meshShaderFeatures.meshShader = VK_TRUE;
+  meshShaderFeatures.pNext = bindlessSupported ? &indexingFeatures : nullptr;
+
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  if (meshShaderSupported) {
+    enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+  }
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  if (meshShaderSupported) {
+    createInfo.pNext = &meshShaderFeatures;
+  } else {
+    createInfo.pNext = bindlessSupported ? &indexingFeatures : nullptr;
+  }
+
+  VkPhysicalDeviceMultiviewFeatures multiviewFeatures = {};
+  multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+  multiviewFeatures.multiview = VK_TRUE;
+  if (multiviewSupported) {
+    multiviewFeatures.pNext = const_cast<void *>(createInfo.pNext);
+    createInfo.pNext = &multiviewFeatures;
+  }
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -177,6 +240,11 @@ void VkeDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+  if (meshShaderSupported) {
+    drawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT) vkGetDeviceProcAddr(device_, "vkCmdDrawMeshTasksEXT");
+    meshShaderSupported = drawMeshTasks != nullptr;
+  }
 }
 
 void VkeDevice::createCommandPool() {
@@ -193,15 +261,102 @@ void VkeDevice::createCommandPool() {
   }
 }
 
-void VkeDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void VkeDevice::createSurface() { window->createWindowSurface(instance, &surface_); }
+
+uint32_t VkeDevice::usableApiVersion(VkPhysicalDevice device) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  return std::min(deviceProperties.apiVersion, instanceApiVersion);
+}
+
+bool VkeDevice::checkBindlessSupport(VkPhysicalDevice device) {
+  if (usableApiVersion(device) < VK_API_VERSION_1_2) {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+  indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &indexingFeatures;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties2 = {};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &descriptorIndexingProperties;
+  vkGetPhysicalDeviceProperties2(device, &properties2);
+
+  return indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+         indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+         indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+         indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+         indexingFeatures.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+bool VkeDevice::checkMultiviewSupport(VkPhysicalDevice device) {
+  if (usableApiVersion(device) < VK_API_VERSION_1_1) {
+    return false;
+  }
+
+  VkPhysicalDeviceMultiviewFeatures multiviewFeatures = {};
+  multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &multiviewFeatures;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  VkPhysicalDeviceMultiviewProperties multiviewProperties = {};
+  multiviewProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties2 = {};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &multiviewProperties;
+  vkGetPhysicalDeviceProperties2(device, &properties2);
+  maxMultiviewViewCount = multiviewProperties.maxMultiviewViewCount;
+
+  return multiviewFeatures.multiview == VK_TRUE;
+}
+
+bool VkeDevice::checkMeshShaderSupport(VkPhysicalDevice device) {
+  // mesh shaders are spir-v 1.4, which needs 1.2
+  if (usableApiVersion(device) < VK_API_VERSION_1_2) {
+    return false;
+  }
+
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+  bool extensionFound = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const auto &extension) {
+    return strcmp(extension.extensionName, VK_EXT_MESH_SHADER_EXTENSION_NAME) == 0;
+  });
+  if (!extensionFound) {
+    return false;
+  }
+
+  VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+  meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &meshShaderFeatures;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  return meshShaderFeatures.meshShader;
+}
+
+void VkeDevice::cmdDrawMeshTasks(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+  assert(drawMeshTasks != nullptr && "mesh shaders are not supported by this device");
+  drawMeshTasks(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
 
 bool VkeDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // headless devices render into offscreen images only
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -261,11 +416,15 @@ bool VkeDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> VkeDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+
+  // glfw is never initialized without a window
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -334,7 +493,12 @@ QueueFamilyIndices VkeDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) {
+      // nothing is presented, the graphics queue stands in for the present queue
+      presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == i;
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -392,16 +556,26 @@ VkFormat VkeDevice::findSupportedFormat(
 }
 
 uint32_t VkeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  uint32_t typeIndex;
+  if (tryFindMemoryType(typeFilter, properties, typeIndex)) {
+    return typeIndex;
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool VkeDevice::tryFindMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t &typeIndex) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
     if ((typeFilter & (1 << i)) &&
         (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-      return i;
+      typeIndex = i;
+      return true;
     }
   }
-
-  throw std::runtime_error("failed to find suitable memory type!");
+  return false;
 }
 
 void VkeDevice::createBuffer(
@@ -429,7 +603,7 @@ void VkeDevice::createBuffer(
   allocInfo.allocationSize = memRequirements.size;
   allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+  if (allocateMemory(allocInfo, bufferMemory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate vertex buffer memory!");
   }
 
@@ -478,6 +652,10 @@ void VkeDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
   endSingleTimeCommands(commandBuffer);
+
+  std::lock_guard<std::mutex> lock{statisticsMutex};
+  statistics.uploadCount++;
+  statistics.uploadedBytes += size;
 }
 
 void VkeDevice::copyBufferToImage(
@@ -505,6 +683,11 @@ void VkeDevice::copyBufferToImage(
       1,
       &region);
   endSingleTimeCommands(commandBuffer);
+
+  // the buffer is tightly packed 4 byte texels
+  std::lock_guard<std::mutex> lock{statisticsMutex};
+  statistics.uploadCount++;
+  statistics.uploadedBytes += static_cast<VkDeviceSize>(width) * height * layerCount * 4;
 }
 
 void VkeDevice::createImageWithInfo(
@@ -524,7 +707,7 @@ void VkeDevice::createImageWithInfo(
   allocInfo.allocationSize = memRequirements.size;
   allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+  if (allocateMemory(allocInfo, imageMemory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate image memory!");
   }
 
@@ -533,4 +716,46 @@ void VkeDevice::createImageWithInfo(
   }
 }
 
-}  // namespace lve
\ No newline at end of file
+VkResult VkeDevice::allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory &memory) {
+  VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  std::lock_guard<std::mutex> lock{statisticsMutex};
+  allocationSizes[memory] = allocInfo.allocationSize;
+  statistics.allocationCount++;
+  statistics.allocatedBytes += allocInfo.allocationSize;
+  statistics.peakAllocatedBytes = std::max(statistics.peakAllocatedBytes, statistics.allocatedBytes);
+  return result;
+}
+
+void VkeDevice::freeMemory(VkDeviceMemory memory) {
+  if (memory == VK_NULL_HANDLE) {
+    return;
+  }
+  vkFreeMemory(device_, memory, nullptr);
+
+  std::lock_guard<std::mutex> lock{statisticsMutex};
+  auto it = allocationSizes.find(memory);
+  if (it != allocationSizes.end()) {
+    statistics.allocationCount--;
+    statistics.allocatedBytes -= it->second;
+    allocationSizes.erase(it);
+  }
+}
+
+uint32_t VkeDevice::getTimestampValidBits() {
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+  return queueFamilies[findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+}
+
+DeviceStatistics VkeDevice::getStatistics() {
+  std::lock_guard<std::mutex> lock{statisticsMutex};
+  return statistics;
+}
+
+}  // namespace lve
@@ -4,7 +4,9 @@
 #include "vke_window.hpp"
 
 // std lib headers
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace vke {
@@ -23,6 +25,15 @@ struct QueueFamilyIndices {
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+// live device memory and transfer upload counters, used by the benchmarks
+struct DeviceStatistics {
+  uint64_t allocationCount = 0;
+  VkDeviceSize allocatedBytes = 0;
+  VkDeviceSize peakAllocatedBytes = 0;
+  uint64_t uploadCount = 0;
+  VkDeviceSize uploadedBytes = 0;
+};
+
 class VkeDevice {
  public:
 #ifdef NDEBUG
@@ -31,7 +42,9 @@ class VkeDevice {
   const bool enableValidationLayers = true;
 #endif
 
-  VkeDevice(VkeWindow &window);
+  // a null window creates a headless device without surface, present queue or swap chain support
+  explicit VkeDevice(VkeWindow *window);
+  VkeDevice(VkeWindow &window) : VkeDevice(&window) {}
   ~VkeDevice();
 
   // Not copyable or movable
@@ -43,12 +56,36 @@ class VkeDevice {
   VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  bool isHeadless() const { return window == nullptr; }
+  // descriptor indexing with update after bind, partially bound and non uniform indexing, see VkeBindlessTable
+  bool supportsBindless() const { return bindlessSupported; }
+  // update after bind limits of the bindless table, only filled in if supportsBindless
+  const VkPhysicalDeviceDescriptorIndexingProperties &getDescriptorIndexingProperties() const {
+    return descriptorIndexingProperties;
+  }
+  // core since 1.1, see VkeDescriptorUpdateTemplate
+  bool supportsDescriptorUpdateTemplates() const {
+    return properties.apiVersion >= VK_API_VERSION_1_1 && instanceApiVersion >= VK_API_VERSION_1_1;
+  }
+  // VK_EXT_mesh_shader with mesh shaders enabled, task shaders are not used
+  bool supportsMeshShaders() const { return meshShaderSupported; }
+  // more than one draw per vkCmdDraw*Indirect call
+  bool supportsMultiDrawIndirect() const { return multiDrawIndirectSupported; }
+  // fragment shader invocation counts for the overdraw counter
+  bool supportsPipelineStatistics() const { return pipelineStatisticsSupported; }
+  // render passes broadcasting to several layers, core since 1.1, see VkeMultiviewTarget
+  bool supportsMultiview() const { return multiviewSupported; }
+  uint32_t getMaxMultiviewViewCount() const { return maxMultiviewViewCount; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  // like findMemoryType, but returns false instead of throwing if no type matches
+  bool tryFindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t &typeIndex);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
+  // meaningful low bits of timestamps written on the graphics queue, 0 if it can't write timestamps
+  uint32_t getTimestampValidBits();
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -62,6 +99,8 @@ class VkeDevice {
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  // vkCmdDrawMeshTasksEXT, only valid if supportsMeshShaders
+  void cmdDrawMeshTasks(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
   void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -71,6 +110,11 @@ class VkeDevice {
       VkImage &image,
       VkDeviceMemory &imageMemory);
 
+  // all device memory should be allocated and freed through these so the statistics stay exact
+  VkResult allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory &memory);
+  void freeMemory(VkDeviceMemory memory);
+  DeviceStatistics getStatistics();
+
   VkPhysicalDeviceProperties properties;
 
  private:
@@ -83,6 +127,11 @@ class VkeDevice {
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
+  // the lower of the instance and the device version
+  uint32_t usableApiVersion(VkPhysicalDevice device);
+  bool checkBindlessSupport(VkPhysicalDevice device);
+  bool checkMeshShaderSupport(VkPhysicalDevice device);
+  bool checkMultiviewSupport(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
@@ -92,18 +141,32 @@ class VkeDevice {
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
+  uint32_t instanceApiVersion = VK_API_VERSION_1_0;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  VkeWindow &window;
+  VkeWindow *window;
   VkCommandPool commandPool;
+  bool bindlessSupported = false;
+  VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+  bool meshShaderSupported = false;
+  bool multiDrawIndirectSupported = false;
+  bool pipelineStatisticsSupported = false;
+  bool multiviewSupported = false;
+  uint32_t maxMultiviewViewCount = 0;
+  PFN_vkCmdDrawMeshTasksEXT drawMeshTasks = nullptr;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  std::mutex statisticsMutex;
+  DeviceStatistics statistics{};
+  std::unordered_map<VkDeviceMemory, VkDeviceSize> allocationSizes;
+
+  // emptied for headless devices
+  std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
 }
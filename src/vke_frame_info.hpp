@@ -3,11 +3,35 @@
 
 #include "vke_camera.hpp"
 #include "vke_game_object.hpp"
+#include "vke_gpu_profiler.hpp"
 
 // lib
 #include <vulkan/vulkan.hpp>
 
+// std
+#include <array>
+
 namespace vke { 
+    // views a multiview render pass may broadcast to, the shaders declare as many view matrices
+    constexpr uint32_t MAX_MULTIVIEW_VIEWS = 4;
+
+    // layout of the global uniform buffer in simple_shader, the point lights are in the storage
+    // buffers of VkeClusteredLights
+    struct GlobalUBO {
+        glm::mat4 projection_view{1.f};
+        glm::mat4 view{1.f};
+        glm::vec4 ambient_light_color{1.f, 1.f, 1.f, .02f};
+        // see VkeLightGrid::get_cluster_scale
+        glm::vec4 cluster_scale{0.f};
+        // tiles x, tiles y, depth slices, light count
+        glm::uvec4 cluster_grid{0u, 0u, 0u, 0u};
+        // area of the view in pixels (x, y, width, height), the cluster tiles start at its origin
+        glm::vec4 viewport{0.f};
+        // projection * view of every view of a multiview render pass, indexed by gl_ViewIndex. The members
+        // above then describe the camera the clusters were built for, which has to see what all views see.
+        std::array<glm::mat4, MAX_MULTIVIEW_VIEWS> view_projections{};
+    };
+
     struct FrameInfo {
         int frame_index;
         float frame_time;
@@ -15,6 +39,12 @@ namespace vke {
         VkeCamera &camera;
         VkDescriptorSet global_descriptor_set;
         VkeGameObject::Map &game_objects;
+        // null unless gpu profiling is enabled
+        VkeGpuProfiler *profiler = nullptr;
+        // height of the render area in pixels for lod selection, 0 always draws the full meshes
+        float viewport_height = 0.f;
+        // render area, systems recording secondary command buffers set their viewport from it
+        VkExtent2D extent{0, 0};
     };
 }
 
@@ -0,0 +1,69 @@
+#include "vke_frame_latency.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace vke {
+
+    VkeFrameLatencyMeter::VkeFrameLatencyMeter(uint32_t frames_in_flight, size_t image_count, float report_interval) :
+        frames_in_flight(frames_in_flight),
+        image_count(image_count),
+        report_interval(report_interval),
+        slots(frames_in_flight),
+        last_report(clock::now())
+    {}
+
+    void VkeFrameLatencyMeter::mark_input(int frame_index, clock::time_point input_time) {
+        auto &slot = slots[frame_index];
+        slot.input_time = input_time;
+        slot.has_input = true;
+    }
+
+    void VkeFrameLatencyMeter::mark_submitted(int frame_index) {
+        auto &slot = slots[frame_index];
+        // frames skipped because the swap chain was out of date never sampled input for this slot
+        slot.submitted = slot.has_input;
+    }
+
+    void VkeFrameLatencyMeter::mark_completed(int frame_index) {
+        auto &slot = slots[frame_index];
+        if (!slot.submitted) {
+            return;
+        }
+
+        float latency = std::chrono::duration<float, std::milli>(clock::now() - slot.input_time).count();
+        latencies_ms.push_back(latency);
+        presented_frames++;
+
+        slot.submitted = false;
+        slot.has_input = false;
+    }
+
+    bool VkeFrameLatencyMeter::report_if_due(std::ostream &out) {
+        auto now = clock::now();
+        float elapsed = std::chrono::duration<float>(now - last_report).count();
+        if (elapsed < report_interval || latencies_ms.empty()) {
+            return false;
+        }
+
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        float average = std::accumulate(latencies_ms.begin(), latencies_ms.end(), 0.f) / latencies_ms.size();
+        float p95 = latencies_ms[static_cast<size_t>(0.95f * (latencies_ms.size() - 1))];
+
+        out << std::fixed << std::setprecision(2)
+            << "[latency] frames in flight " << frames_in_flight
+            << ", images " << image_count
+            << ": avg " << average << " ms"
+            << ", min " << latencies_ms.front() << " ms"
+            << ", p95 " << p95 << " ms"
+            << ", max " << latencies_ms.back() << " ms"
+            << " (" << presented_frames / elapsed << " fps)" << '\n';
+
+        latencies_ms.clear();
+        presented_frames = 0;
+        last_report = now;
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef vke_frame_latency_
+    #define vke_frame_latency_
+
+    // std
+    #include <chrono>
+    #include <cstdint>
+    #include <ostream>
+    #include <vector>
+
+    namespace vke {
+        // Measures the time from sampling input for a frame until the gpu has finished that frame and
+        // it was handed to the presentation engine. Completion is only observed when polled, so the
+        // numbers are an upper bound with the resolution of one main loop iteration.
+        class VkeFrameLatencyMeter {
+            public:
+            using clock = std::chrono::steady_clock;
+
+            VkeFrameLatencyMeter(uint32_t frames_in_flight, size_t image_count, float report_interval = 2.f);
+
+            void mark_input(int frame_index, clock::time_point input_time);
+            void mark_submitted(int frame_index);
+            // call with the frame slot once its fence is known to be signalled
+            void mark_completed(int frame_index);
+
+            bool is_pending(int frame_index) const { return slots[frame_index].submitted; }
+
+            void set_image_count(size_t count) { image_count = count; }
+            // returns true if a report was written
+            bool report_if_due(std::ostream &out);
+
+            private:
+            struct Slot {
+                clock::time_point input_time{};
+                bool has_input{false};
+                bool submitted{false};
+            };
+
+            uint32_t frames_in_flight;
+            size_t image_count;
+            float report_interval;
+
+            std::vector<Slot> slots;
+            std::vector<float> latencies_ms;
+            uint32_t presented_frames{0};
+            clock::time_point last_report;
+        };
+    }
+
+#endif
@@ -0,0 +1,126 @@
+#include "vke_frame_pacer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace vke {
+
+    namespace {
+        constexpr auto MIN_SPIN_MARGIN = std::chrono::microseconds(200);
+        constexpr auto MAX_SPIN_MARGIN = std::chrono::microseconds(4000);
+        // exponential moving average factor for the gpu frame estimate
+        constexpr float GPU_SMOOTHING = 0.1f;
+    }
+
+    VkeFramePacer::VkeFramePacer(float target_fps, size_t frames_in_flight) :
+        submit_times(frames_in_flight),
+        submitted(frames_in_flight, false)
+    {
+        set_target_fps(target_fps);
+    }
+
+    void VkeFramePacer::set_target_fps(float fps) {
+        target_fps = fps;
+        period = fps > 0.f 
+            ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps)) 
+            : clock::duration::zero();
+        next_deadline = clock::now();
+    }
+
+    float VkeFramePacer::wait_for_next_frame(int next_frame_index) {
+        auto start = clock::now();
+        auto deadline = start;
+
+        if (target_fps > 0.f) {
+            next_deadline += period;
+            // fell more than a frame behind (stall, resize): don't try to catch up with a burst of frames
+            if (next_deadline + period < start) {
+                next_deadline = start;
+            }
+            deadline = next_deadline;
+        }
+
+        // no point in waking up before the gpu is expected to release the frame slot
+        if (submitted[next_frame_index]) {
+            auto gpu_ready = submit_times[next_frame_index] 
+                + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(gpu_frame_estimate));
+            deadline = std::max(deadline, gpu_ready);
+        }
+
+        if (deadline > start) {
+            sleep_until(deadline);
+        }
+
+        auto frame_start = clock::now();
+        if (has_last_frame) {
+            double frame_time = std::chrono::duration<double>(frame_start - last_frame_start).count();
+            frame_time_sum += frame_time;
+            frame_time_square_sum += frame_time * frame_time;
+            frame_count++;
+        }
+        last_frame_start = frame_start;
+        has_last_frame = true;
+
+        return std::chrono::duration<float>(frame_start - start).count();
+    }
+
+    void VkeFramePacer::sleep_until(clock::time_point deadline) {
+        auto sleep_target = deadline - spin_margin;
+        auto now = clock::now();
+
+        if (sleep_target > now) {
+            std::this_thread::sleep_until(sleep_target);
+
+            // widen the margin if the scheduler woke us up late, narrow it slowly otherwise
+            auto oversleep = clock::now() - sleep_target;
+            if (oversleep > spin_margin / 2) {
+                spin_margin = std::min<std::chrono::nanoseconds>(spin_margin * 2, MAX_SPIN_MARGIN);
+            } else {
+                spin_margin = std::max<std::chrono::nanoseconds>(spin_margin - spin_margin / 16, MIN_SPIN_MARGIN);
+            }
+        }
+
+        while (clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    void VkeFramePacer::mark_submitted(int frame_index) {
+        submit_times[frame_index] = clock::now();
+        submitted[frame_index] = true;
+    }
+
+    void VkeFramePacer::mark_gpu_complete(int frame_index, bool blocked) {
+        if (!submitted[frame_index]) {
+            return;
+        }
+        submitted[frame_index] = false;
+
+        float observed = std::chrono::duration<float>(clock::now() - submit_times[frame_index]).count();
+        // if we did not block the fence signalled some time before we looked, which only bounds the gpu time from above
+        if (blocked || observed < gpu_frame_estimate) {
+            gpu_frame_estimate += GPU_SMOOTHING * (observed - gpu_frame_estimate);
+        }
+    }
+
+    float VkeFramePacer::get_frame_time_mean() const {
+        return frame_count > 0 ? static_cast<float>(frame_time_sum / frame_count) : 0.f;
+    }
+
+    float VkeFramePacer::get_frame_time_stddev() const {
+        if (frame_count < 2) {
+            return 0.f;
+        }
+        double mean = frame_time_sum / frame_count;
+        double variance = frame_time_square_sum / frame_count - mean * mean;
+        return static_cast<float>(std::sqrt(std::max(variance, 0.)));
+    }
+
+    void VkeFramePacer::reset_statistics() {
+        frame_time_sum = 0.;
+        frame_time_square_sum = 0.;
+        frame_count = 0;
+    }
+}
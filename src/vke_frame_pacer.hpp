@@ -0,0 +1,58 @@
+#ifndef vke_frame_pacer_
+    #define vke_frame_pacer_
+
+    // std
+    #include <chrono>
+    #include <vector>
+
+    namespace vke {
+        // Limits the main loop to a target frame rate. Waits coarse sleep until shortly before the deadline and
+        // spin the rest, the spin margin adapts to the observed oversleep of the os scheduler. Also tracks how
+        // long the gpu needs from submission until a frame slot's fence signals, so the loop can sleep until
+        // the slot is expected to be free and sample input as late as possible.
+        class VkeFramePacer {
+            public:
+            using clock = std::chrono::steady_clock;
+
+            // 0 disables limiting, only gpu estimates and statistics are kept
+            explicit VkeFramePacer(float target_fps = 0.f, size_t frames_in_flight = 2);
+
+            void set_target_fps(float fps);
+            float get_target_fps() const { return target_fps; }
+
+            // sleeps until the next frame should start, returns the seconds spent waiting
+            float wait_for_next_frame(int next_frame_index);
+
+            void mark_submitted(int frame_index);
+            // the fence of frame_index was observed signalled, blocked tells if the caller had to wait for it
+            void mark_gpu_complete(int frame_index, bool blocked);
+            float get_gpu_frame_estimate() const { return gpu_frame_estimate; }
+
+            // frame interval statistics since the last reset (seconds)
+            float get_frame_time_mean() const;
+            float get_frame_time_stddev() const;
+            void reset_statistics();
+
+            private:
+            void sleep_until(clock::time_point deadline);
+
+            float target_fps{0.f};
+            clock::duration period{};
+            clock::time_point next_deadline{};
+            clock::time_point last_frame_start{};
+            bool has_last_frame{false};
+
+            // margin before the deadline that is busy waited instead of slept
+            std::chrono::nanoseconds spin_margin{std::chrono::microseconds(1000)};
+
+            std::vector<clock::time_point> submit_times;
+            std::vector<bool> submitted;
+            float gpu_frame_estimate{0.f};
+
+            double frame_time_sum{0.};
+            double frame_time_square_sum{0.};
+            size_t frame_count{0};
+        };
+    }
+
+#endif
@@ -0,0 +1,265 @@
+#include "vke_frame_writer.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace vke {
+
+    namespace {
+        constexpr size_t MAX_STORED_BLOCK = 65535;
+
+        std::array<uint32_t, 256> make_crc_table() {
+            std::array<uint32_t, 256> table{};
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[n] = c;
+            }
+            return table;
+        }
+
+        uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+            static const auto table = make_crc_table();
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++) {
+                crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+            }
+            return ~crc;
+        }
+
+        void put_u32_be(std::vector<uint8_t> &out, uint32_t value) {
+            out.push_back(static_cast<uint8_t>(value >> 24));
+            out.push_back(static_cast<uint8_t>(value >> 16));
+            out.push_back(static_cast<uint8_t>(value >> 8));
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        void put_chunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data) {
+            put_u32_be(out, static_cast<uint32_t>(data.size()));
+            size_t type_offset = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data.begin(), data.end());
+            put_u32_be(out, crc32(out.data() + type_offset, data.size() + 4));
+        }
+
+        std::vector<uint8_t> encode_png(uint32_t width, uint32_t height, const std::vector<uint8_t> &pixels) {
+            size_t row_size = static_cast<size_t>(width) * 4;
+
+            // every row starts with filter type 0
+            std::vector<uint8_t> raw{};
+            raw.reserve((row_size + 1) * height);
+            for (uint32_t y = 0; y < height; y++) {
+                raw.push_back(0);
+                raw.insert(raw.end(), pixels.begin() + y * row_size, pixels.begin() + (y + 1) * row_size);
+            }
+
+            // zlib stream of stored deflate blocks
+            std::vector<uint8_t> idat{0x78, 0x01};
+            idat.reserve(raw.size() + raw.size() / MAX_STORED_BLOCK * 5 + 16);
+            uint32_t adler_a = 1, adler_b = 0;
+            for (size_t offset = 0; offset < raw.size() || offset == 0; offset += MAX_STORED_BLOCK) {
+                size_t size = std::min(MAX_STORED_BLOCK, raw.size() - offset);
+                bool last = offset + size >= raw.size();
+                idat.push_back(last ? 1 : 0);
+                idat.push_back(static_cast<uint8_t>(size));
+                idat.push_back(static_cast<uint8_t>(size >> 8));
+                idat.push_back(static_cast<uint8_t>(~size));
+                idat.push_back(static_cast<uint8_t>(~size >> 8));
+                idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + size);
+
+                for (size_t i = offset; i < offset + size; i++) {
+                    adler_a = (adler_a + raw[i]) % 65521;
+                    adler_b = (adler_b + adler_a) % 65521;
+                }
+                if (last) {
+                    break;
+                }
+            }
+            put_u32_be(idat, (adler_b << 16) | adler_a);
+
+            std::vector<uint8_t> header{};
+            put_u32_be(header, width);
+            put_u32_be(header, height);
+            // 8 bit rgba, deflate, adaptive filtering, no interlace
+            header.insert(header.end(), {8, 6, 0, 0, 0});
+
+            std::vector<uint8_t> png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+            put_chunk(png, "IHDR", header);
+            put_chunk(png, "IDAT", idat);
+            put_chunk(png, "IEND", {});
+            return png;
+        }
+
+        std::vector<uint8_t> encode_ppm(uint32_t width, uint32_t height, const std::vector<uint8_t> &pixels) {
+            std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+            std::vector<uint8_t> ppm(header.begin(), header.end());
+            ppm.reserve(header.size() + static_cast<size_t>(width) * height * 3);
+            for (size_t i = 0; i + 3 < pixels.size(); i += 4) {
+                ppm.insert(ppm.end(), pixels.begin() + i, pixels.begin() + i + 3);
+            }
+            return ppm;
+        }
+    }
+
+    const char* to_string(ImageFileFormat format) {
+        switch (format) {
+            case ImageFileFormat::Ppm: return "ppm";
+            case ImageFileFormat::Png: return "png";
+            case ImageFileFormat::Raw: return "raw";
+        }
+        return "unknown";
+    }
+
+    const char* file_extension(ImageFileFormat format) {
+        switch (format) {
+            case ImageFileFormat::Ppm: return ".ppm";
+            case ImageFileFormat::Png: return ".png";
+            case ImageFileFormat::Raw: return ".rgba";
+        }
+        return "";
+    }
+
+    bool parse_image_file_format(const std::string &name, ImageFileFormat &format) {
+        for (auto candidate : {ImageFileFormat::Ppm, ImageFileFormat::Png, ImageFileFormat::Raw}) {
+            if (name == to_string(candidate)) {
+                format = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    VkeFrameWriter::VkeFrameWriter(std::string directory, ImageFileFormat format, uint32_t thread_count) :
+        directory{std::move(directory)},
+        format{format},
+        max_queued{2 * static_cast<size_t>(std::max(thread_count, 1u))}
+    {
+        for (uint32_t i = 0; i < std::max(thread_count, 1u); i++) {
+            workers.emplace_back(&VkeFrameWriter::worker_loop, this);
+        }
+    }
+
+    VkeFrameWriter::~VkeFrameWriter() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        queue_changed.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void VkeFrameWriter::submit(uint32_t frame_number, uint32_t width, uint32_t height, std::vector<uint8_t> pixels) {
+        std::unique_lock<std::mutex> lock{mutex};
+        queue_changed.wait(lock, [&]() { return queue.size() < max_queued || !error.empty(); });
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        queue.push_back({frame_number, width, height, std::move(pixels)});
+        lock.unlock();
+        queue_changed.notify_all();
+    }
+
+    void VkeFrameWriter::wait_idle() {
+        std::unique_lock<std::mutex> lock{mutex};
+        queue_changed.wait(lock, [&]() { return (queue.empty() && active_jobs == 0) || !error.empty(); });
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    void VkeFrameWriter::worker_loop() {
+        while (true) {
+            std::unique_lock<std::mutex> lock{mutex};
+            queue_changed.wait(lock, [&]() { return !queue.empty() || stopping; });
+            if (queue.empty()) {
+                return;
+            }
+            Job job = std::move(queue.front());
+            queue.pop_front();
+            active_jobs++;
+            lock.unlock();
+            queue_changed.notify_all();
+
+            auto start = std::chrono::steady_clock::now();
+            std::string failure{};
+            uint64_t size = 0;
+            try {
+                size = write_image(frame_path(job.frame_number), format, job.width, job.height, job.pixels);
+            } catch (const std::exception &e) {
+                failure = e.what();
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            lock.lock();
+            active_jobs--;
+            if (failure.empty()) {
+                written_frames++;
+                written_bytes += size;
+                encode_time += elapsed;
+            } else if (error.empty()) {
+                error = failure;
+            }
+            lock.unlock();
+            queue_changed.notify_all();
+        }
+    }
+
+    std::string VkeFrameWriter::frame_path(uint32_t frame_number) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%05u", frame_number);
+        return directory + "/" + name + file_extension(format);
+    }
+
+    uint64_t VkeFrameWriter::write_image(
+        const std::string &path, 
+        ImageFileFormat format, 
+        uint32_t width, 
+        uint32_t height, 
+        const std::vector<uint8_t> &pixels
+    ) {
+        std::ofstream file{path, std::ios::binary};
+        if (!file) {
+            throw std::runtime_error("failed to open " + path);
+        }
+
+        std::vector<uint8_t> encoded{};
+        const std::vector<uint8_t> *data = &pixels;
+        if (format == ImageFileFormat::Ppm) {
+            encoded = encode_ppm(width, height, pixels);
+            data = &encoded;
+        } else if (format == ImageFileFormat::Png) {
+            encoded = encode_png(width, height, pixels);
+            data = &encoded;
+        }
+
+        file.write(reinterpret_cast<const char*>(data->data()), data->size());
+        if (!file) {
+            throw std::runtime_error("failed to write " + path);
+        }
+        return data->size();
+    }
+
+    uint32_t VkeFrameWriter::get_written_frames() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return written_frames;
+    }
+
+    uint64_t VkeFrameWriter::get_written_bytes() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return written_bytes;
+    }
+
+    float VkeFrameWriter::get_encode_time() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return static_cast<float>(encode_time);
+    }
+}
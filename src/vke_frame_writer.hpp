@@ -0,0 +1,85 @@
+#ifndef vke_frame_writer_
+    #define vke_frame_writer_
+
+    // std
+    #include <condition_variable>
+    #include <cstdint>
+    #include <deque>
+    #include <mutex>
+    #include <string>
+    #include <thread>
+    #include <vector>
+
+    namespace vke {
+        enum class ImageFileFormat {
+            Ppm,
+            // uncompressed deflate, fast to write and readable by every decoder
+            Png,
+            // tightly packed rgba8 rows without header
+            Raw
+        };
+
+        const char* to_string(ImageFileFormat format);
+        const char* file_extension(ImageFileFormat format);
+        bool parse_image_file_format(const std::string &name, ImageFileFormat &format);
+
+        // Encodes rgba8 frames and writes them to disk on worker threads. submit blocks while too many frames
+        // are queued, so a renderer that is faster than the disk slows down instead of buffering every frame.
+        class VkeFrameWriter {
+            public:
+            VkeFrameWriter(std::string directory, ImageFileFormat format, uint32_t thread_count);
+            ~VkeFrameWriter();
+
+            VkeFrameWriter(const VkeFrameWriter&) = delete;
+            VkeFrameWriter& operator=(const VkeFrameWriter&) = delete;
+
+            void submit(uint32_t frame_number, uint32_t width, uint32_t height, std::vector<uint8_t> pixels);
+            // blocks until every submitted frame is written, rethrows the first write error
+            void wait_idle();
+
+            uint32_t get_written_frames() const;
+            // size of the written files
+            uint64_t get_written_bytes() const;
+            // summed over all workers
+            float get_encode_time() const;
+
+            // returns the file size
+            static uint64_t write_image(
+                const std::string &path, 
+                ImageFileFormat format, 
+                uint32_t width, 
+                uint32_t height, 
+                const std::vector<uint8_t> &pixels
+            );
+
+            private:
+            struct Job {
+                uint32_t frame_number;
+                uint32_t width;
+                uint32_t height;
+                std::vector<uint8_t> pixels;
+            };
+
+            void worker_loop();
+            std::string frame_path(uint32_t frame_number) const;
+
+            std::string directory;
+            ImageFileFormat format;
+            size_t max_queued;
+
+            mutable std::mutex mutex;
+            std::condition_variable queue_changed;
+            std::deque<Job> queue;
+            uint32_t active_jobs{0};
+            bool stopping{false};
+            std::string error;
+
+            uint32_t written_frames{0};
+            uint64_t written_bytes{0};
+            double encode_time{0.};
+
+            std::vector<std::thread> workers;
+        };
+    }
+
+#endif
@@ -0,0 +1,32 @@
+#include "vke_frustum.hpp"
+
+namespace vke {
+
+    VkeFrustum::VkeFrustum(const glm::mat4 &clip_from_world) {
+        // rows of the matrix, a point is inside if -w <= x, y <= w and 0 <= z <= w
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = {clip_from_world[0][i], clip_from_world[1][i], clip_from_world[2][i], clip_from_world[3][i]};
+        }
+
+        planes[0] = rows[3] + rows[0];
+        planes[1] = rows[3] - rows[0];
+        planes[2] = rows[3] + rows[1];
+        planes[3] = rows[3] - rows[1];
+        planes[4] = rows[2];
+        planes[5] = rows[3] - rows[2];
+
+        for (auto &plane : planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    bool VkeFrustum::intersects_sphere(const glm::vec3 &center, float radius) const {
+        for (const auto &plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
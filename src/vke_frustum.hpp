@@ -0,0 +1,26 @@
+#ifndef vke_frustum_
+    #define vke_frustum_
+
+    #define GLM_FORCE_RADIANS
+    #define GLM_FORCE_DEPTH_ZERO_TO_ONE
+    #include <glm/glm.hpp>
+
+    // std
+    #include <array>
+
+    namespace vke {
+        // The six planes of a view frustum, extracted from a projection * view (* model) matrix with the
+        // 0 to 1 depth range of vulkan. Planes point inwards and are normalized, so plane distances are in
+        // the units of the space the matrix maps from.
+        struct VkeFrustum {
+            std::array<glm::vec4, 6> planes{};
+
+            VkeFrustum() = default;
+            explicit VkeFrustum(const glm::mat4 &clip_from_world);
+
+            // conservative, spheres near a frustum corner can pass although they are outside
+            bool intersects_sphere(const glm::vec3 &center, float radius) const;
+        };
+    }
+
+#endif
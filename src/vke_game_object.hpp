@@ -1,6 +1,7 @@
 #ifndef vke_game_object_
     #define vke_game_object_
 
+    #include "vke_asset_manager.hpp"
     #include "vke_model.hpp"
     #include <glm/gtc/matrix_transform.hpp>
 
@@ -56,6 +57,13 @@
             std::shared_ptr<VkeModel> model{};
             glm::vec3 color{};
             TransformComponent transform{};
+            // bindless sampled image slot, ~0u for untextured objects
+            uint32_t texture_slot = ~0u;
+            // VkeTextureManager texture, its current slot is copied to texture_slot every frame
+            uint32_t texture = ~0u;
+            // VkeAssetManager model, model follows it every frame until it is loaded. Dropping the object
+            // drops its reference to the model.
+            VkeAssetManager::Handle mesh{};
 
             private:
             VkeGameObject(id_t obj_id) : id(obj_id) {}
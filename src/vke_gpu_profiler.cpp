@@ -0,0 +1,190 @@
+#include "vke_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+
+namespace vke {
+
+    VkeGpuProfiler::VkeGpuProfiler(VkeDevice &device, uint32_t frames_in_flight, uint32_t max_scopes, size_t history) :
+        vke_device{device},
+        supported{device.properties.limits.timestampComputeAndGraphics == VK_TRUE},
+        max_scopes{max_scopes},
+        history{history},
+        timestamp_period_ns{device.properties.limits.timestampPeriod},
+        frames(frames_in_flight)
+    {
+        if (!supported) {
+            return;
+        }
+        uint32_t valid_bits = device.getTimestampValidBits();
+        supported = valid_bits > 0;
+        if (!supported) {
+            return;
+        }
+        timestamp_mask = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+
+        VkQueryPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        // begin and end of every scope
+        pool_info.queryCount = 2 * max_scopes;
+
+        for (auto &frame : frames) {
+            if (vkCreateQueryPool(vke_device.device(), &pool_info, nullptr, &frame.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timestamp query pool");
+            }
+            frame.scopes.reserve(max_scopes);
+        }
+    }
+
+    VkeGpuProfiler::~VkeGpuProfiler() {
+        for (auto &frame : frames) {
+            if (frame.pool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(vke_device.device(), frame.pool, nullptr);
+            }
+        }
+    }
+
+    void VkeGpuProfiler::begin_frame(VkCommandBuffer command_buffer, int frame_index) {
+        if (!supported) {
+            return;
+        }
+
+        current_frame = frame_index;
+        auto &frame = frames[frame_index];
+        resolve(frame);
+
+        // a query has to be reset before it is written again
+        vkCmdResetQueryPool(command_buffer, frame.pool, 0, 2 * max_scopes);
+        frame.cpu_begin_ns = trace_clock_ns();
+    }
+
+    int VkeGpuProfiler::begin_scope(VkCommandBuffer command_buffer, const char *name) {
+        if (!supported || current_frame < 0) {
+            return -1;
+        }
+
+        auto &frame = frames[current_frame];
+        if (frame.used_queries + 2 > 2 * max_scopes) {
+            return -1;
+        }
+
+        uint32_t query = frame.used_queries;
+        frame.used_queries += 2;
+        frame.scopes.push_back({name, query});
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, query);
+        return static_cast<int>(frame.scopes.size() - 1);
+    }
+
+    void VkeGpuProfiler::end_scope(VkCommandBuffer command_buffer, int scope) {
+        if (scope < 0) {
+            return;
+        }
+
+        auto &frame = frames[current_frame];
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, frame.scopes[scope].query + 1);
+    }
+
+    void VkeGpuProfiler::resolve(FrameQueries &frame) {
+        if (frame.used_queries == 0) {
+            return;
+        }
+
+        std::vector<uint64_t> timestamps(frame.used_queries);
+        // no wait bit: the slot's fence signalled already, anything not available is dropped
+        VkResult result = vkGetQueryPoolResults(
+            vke_device.device(),
+            frame.pool,
+            0,
+            frame.used_queries,
+            timestamps.size() * sizeof(uint64_t),
+            timestamps.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+        frame.used_queries = 0;
+        if (result != VK_SUCCESS) {
+            frame.scopes.clear();
+            return;
+        }
+
+        // only the valid bits count, differences are taken modulo them so a counter wrapping mid frame still
+        // gives the right durations. the first query of the frame is its earliest
+        uint64_t frame_origin = timestamps[0] & timestamp_mask;
+        for (auto &scope : frame.scopes) {
+            uint64_t begin = (timestamps[scope.query] - frame_origin) & timestamp_mask;
+            uint64_t end = (timestamps[scope.query + 1] - frame_origin) & timestamp_mask;
+            if (end < begin) {
+                continue;
+            }
+
+            double duration_ns = (end - begin) * timestamp_period_ns;
+            auto &samples = durations_ms[scope.name];
+            samples.push_back(static_cast<float>(duration_ns / 1e6));
+            if (samples.size() > history) {
+                samples.pop_front();
+            }
+
+            if (capture_trace && trace_events.size() >= TRACE_CAPACITY) {
+                dropped_trace_events++;
+            } else if (capture_trace) {
+                // the gpu clock has its own time base, anchor the frame at the cpu time it started recording
+                int64_t start_ns = frame.cpu_begin_ns + static_cast<int64_t>(begin * timestamp_period_ns);
+                trace_events.push_back({scope.name, "GPU", start_ns, static_cast<int64_t>(duration_ns)});
+            }
+        }
+        frame.scopes.clear();
+    }
+
+    void VkeGpuProfiler::resolve_pending() {
+        for (auto &frame : frames) {
+            resolve(frame);
+        }
+    }
+
+    void VkeGpuProfiler::start_trace_capture() {
+        trace_events.clear();
+        dropped_trace_events = 0;
+        capture_trace = true;
+    }
+
+    std::vector<TraceEvent> VkeGpuProfiler::stop_trace_capture() {
+        capture_trace = false;
+        std::vector<TraceEvent> events{};
+        events.swap(trace_events);
+        return events;
+    }
+
+    std::vector<VkeGpuProfiler::ScopeStatistics> VkeGpuProfiler::get_statistics() const {
+        std::vector<ScopeStatistics> statistics{};
+        for (auto &[name, samples] : durations_ms) {
+            if (samples.empty()) {
+                continue;
+            }
+            auto [min, max] = std::minmax_element(samples.begin(), samples.end());
+            float avg = std::accumulate(samples.begin(), samples.end(), 0.f) / samples.size();
+            statistics.push_back({name, *min, avg, *max, samples.size()});
+        }
+        return statistics;
+    }
+
+    void VkeGpuProfiler::report(std::ostream &out) const {
+        if (!supported) {
+            out << "[gpu] timestamps are not supported on the graphics queue" << '\n';
+            return;
+        }
+
+        out << std::fixed << std::setprecision(3);
+        for (auto &stats : get_statistics()) {
+            out << "[gpu] " << stats.name
+                << ": avg " << stats.avg_ms << " ms"
+                << ", min " << stats.min_ms << " ms"
+                << ", max " << stats.max_ms << " ms"
+                << " (" << stats.samples << " frames)" << '\n';
+        }
+    }
+}
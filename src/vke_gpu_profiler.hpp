@@ -0,0 +1,119 @@
+#ifndef vke_gpu_profiler_
+    #define vke_gpu_profiler_
+
+    #include "vke_device.hpp"
+    #include "vke_trace.hpp"
+
+    // std
+    #include <deque>
+    #include <map>
+    #include <ostream>
+    #include <string>
+    #include <vector>
+
+    namespace vke {
+        // Measures named scopes of a command buffer with timestamp queries. Every frame slot owns a query pool,
+        // its results are read back when the slot is reused, which happens after its fence was waited for,
+        // so reading never stalls.
+        class VkeGpuProfiler {
+            public:
+            struct ScopeStatistics {
+                std::string name;
+                float min_ms;
+                float avg_ms;
+                float max_ms;
+                size_t samples;
+            };
+
+            VkeGpuProfiler(VkeDevice &device, uint32_t frames_in_flight, uint32_t max_scopes = 64, size_t history = 120);
+            ~VkeGpuProfiler();
+
+            VkeGpuProfiler(const VkeGpuProfiler&) = delete;
+            VkeGpuProfiler& operator=(const VkeGpuProfiler&) = delete;
+
+            // false if the graphics queue can't write timestamps, all calls are no-ops then
+            bool is_supported() const { return supported; }
+
+            // resolves the slot's previous frame and resets its queries, must be called outside a render pass
+            void begin_frame(VkCommandBuffer command_buffer, int frame_index);
+
+            // names are not copied until the frame is resolved, pass string literals. returns -1 if the
+            // frame ran out of queries
+            int begin_scope(VkCommandBuffer command_buffer, const char *name);
+            void end_scope(VkCommandBuffer command_buffer, int scope);
+
+            // resolves the frames still in flight, only valid once the device is idle
+            void resolve_pending();
+
+            // rolling statistics over the last frames, ordered by name
+            std::vector<ScopeStatistics> get_statistics() const;
+            void report(std::ostream &out) const;
+
+            // scope events kept per capture, later ones are counted as dropped
+            static constexpr size_t TRACE_CAPACITY = 1 << 16;
+
+            // resolved scopes are kept as trace events until the capture stops, which hands them over and
+            // forgets them. frames still in flight at the stop are not part of the capture
+            void start_trace_capture();
+            std::vector<TraceEvent> stop_trace_capture();
+            bool is_capturing_trace() const { return capture_trace; }
+            size_t get_dropped_trace_events() const { return dropped_trace_events; }
+
+            private:
+            struct Scope {
+                const char *name;
+                uint32_t query;
+            };
+
+            struct FrameQueries {
+                VkQueryPool pool = VK_NULL_HANDLE;
+                std::vector<Scope> scopes;
+                uint32_t used_queries = 0;
+                // cpu time the frame started recording, gpu times are placed relative to it in traces
+                int64_t cpu_begin_ns = 0;
+            };
+
+            void resolve(FrameQueries &frame);
+
+            VkeDevice &vke_device;
+            bool supported;
+            uint32_t max_scopes;
+            size_t history;
+            double timestamp_period_ns;
+            // timestampValidBits of the graphics queue as a mask
+            uint64_t timestamp_mask{~uint64_t{0}};
+
+            std::vector<FrameQueries> frames;
+            int current_frame{-1};
+
+            std::map<std::string, std::deque<float>> durations_ms;
+            bool capture_trace{false};
+            std::vector<TraceEvent> trace_events;
+            size_t dropped_trace_events{0};
+        };
+
+        // opens a scope for the lifetime of the object, profiler may be null
+        class VkeGpuScope {
+            public:
+            VkeGpuScope(VkeGpuProfiler *profiler, VkCommandBuffer command_buffer, const char *name) :
+                profiler{profiler},
+                command_buffer{command_buffer},
+                scope{profiler ? profiler->begin_scope(command_buffer, name) : -1}
+            {}
+            ~VkeGpuScope() {
+                if (profiler) {
+                    profiler->end_scope(command_buffer, scope);
+                }
+            }
+
+            VkeGpuScope(const VkeGpuScope&) = delete;
+            VkeGpuScope& operator=(const VkeGpuScope&) = delete;
+
+            private:
+            VkeGpuProfiler *profiler;
+            VkCommandBuffer command_buffer;
+            int scope;
+        };
+    }
+
+#endif
@@ -0,0 +1,167 @@
+#include "vke_image_data.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace vke {
+
+    namespace {
+        // skips whitespace and comments, then reads one header number
+        uint32_t read_ppm_value(const std::vector<uint8_t> &file, size_t &position, const std::string &path) {
+            while (position < file.size()) {
+                if (file[position] == '#') {
+                    while (position < file.size() && file[position] != '\n') position++;
+                } else if (std::isspace(file[position])) {
+                    position++;
+                } else {
+                    break;
+                }
+            }
+            if (position >= file.size() || !std::isdigit(file[position])) {
+                throw std::runtime_error("invalid ppm header in " + path);
+            }
+            uint64_t value = 0;
+            while (position < file.size() && std::isdigit(file[position])) {
+                value = value * 10 + (file[position] - '0');
+                if (value > 1u << 16) {
+                    throw std::runtime_error("invalid ppm header in " + path);
+                }
+                position++;
+            }
+            return static_cast<uint32_t>(value);
+        }
+
+        const std::array<float, 256> &srgb_to_linear_table() {
+            static const std::array<float, 256> table = []() {
+                std::array<float, 256> values{};
+                for (size_t i = 0; i < values.size(); i++) {
+                    float c = i / 255.f;
+                    values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        uint8_t linear_to_srgb(float c) {
+            c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+            return static_cast<uint8_t>(std::clamp(c * 255.f + .5f, 0.f, 255.f));
+        }
+
+        VkeImageData downsample(const VkeImageData &source) {
+            const auto &to_linear = srgb_to_linear_table();
+
+            VkeImageData result{};
+            result.width = std::max(source.width / 2, 1u);
+            result.height = std::max(source.height / 2, 1u);
+            result.pixels.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+            for (uint32_t y = 0; y < result.height; y++) {
+                uint32_t y0 = std::min(2 * y, source.height - 1);
+                uint32_t y1 = std::min(2 * y + 1, source.height - 1);
+                for (uint32_t x = 0; x < result.width; x++) {
+                    uint32_t x0 = std::min(2 * x, source.width - 1);
+                    uint32_t x1 = std::min(2 * x + 1, source.width - 1);
+                    const uint8_t *texels[] = {
+                        &source.pixels[(static_cast<size_t>(y0) * source.width + x0) * 4],
+                        &source.pixels[(static_cast<size_t>(y0) * source.width + x1) * 4],
+                        &source.pixels[(static_cast<size_t>(y1) * source.width + x0) * 4],
+                        &source.pixels[(static_cast<size_t>(y1) * source.width + x1) * 4],
+                    };
+
+                    uint8_t *target = &result.pixels[(static_cast<size_t>(y) * result.width + x) * 4];
+                    for (int channel = 0; channel < 3; channel++) {
+                        float sum = 0.f;
+                        for (auto *texel : texels) sum += to_linear[texel[channel]];
+                        target[channel] = linear_to_srgb(sum * .25f);
+                    }
+                    uint32_t alpha = 0;
+                    for (auto *texel : texels) alpha += texel[3];
+                    target[3] = static_cast<uint8_t>((alpha + 2) / 4);
+                }
+            }
+            return result;
+        }
+    }
+
+    VkeImageData VkeImageData::load(const std::string &path) {
+        std::ifstream stream{path, std::ios::binary};
+        if (!stream) {
+            throw std::runtime_error("failed to open " + path);
+        }
+        std::vector<uint8_t> file{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+
+        if (file.size() < 2 || file[0] != 'P' || file[1] != '6') {
+            throw std::runtime_error(path + " is not a binary ppm file");
+        }
+        size_t position = 2;
+        VkeImageData image{};
+        image.width = read_ppm_value(file, position, path);
+        image.height = read_ppm_value(file, position, path);
+        uint32_t max_value = read_ppm_value(file, position, path);
+        // exactly one whitespace separates the header from the texels
+        position++;
+        if (image.width == 0 || image.height == 0 || max_value != 255) {
+            throw std::runtime_error("unsupported ppm image " + path);
+        }
+
+        size_t texel_count = static_cast<size_t>(image.width) * image.height;
+        if (file.size() < position + texel_count * 3) {
+            throw std::runtime_error("truncated ppm image " + path);
+        }
+        image.pixels.resize(texel_count * 4);
+        for (size_t i = 0; i < texel_count; i++) {
+            image.pixels[i * 4 + 0] = file[position + i * 3 + 0];
+            image.pixels[i * 4 + 1] = file[position + i * 3 + 1];
+            image.pixels[i * 4 + 2] = file[position + i * 3 + 2];
+            image.pixels[i * 4 + 3] = 255;
+        }
+        return image;
+    }
+
+    VkeImageData VkeImageData::checkerboard(uint32_t size, uint32_t cell_size, uint32_t color_a, uint32_t color_b) {
+        VkeImageData image{};
+        image.width = size;
+        image.height = size;
+        image.pixels.resize(static_cast<size_t>(size) * size * 4);
+        cell_size = std::max(cell_size, 1u);
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                // colors are 0xRRGGBBAA
+                uint32_t color = ((x / cell_size + y / cell_size) % 2 == 0) ? color_a : color_b;
+                uint8_t *texel = &image.pixels[(static_cast<size_t>(y) * size + x) * 4];
+                texel[0] = static_cast<uint8_t>(color >> 24);
+                texel[1] = static_cast<uint8_t>(color >> 16);
+                texel[2] = static_cast<uint8_t>(color >> 8);
+                texel[3] = static_cast<uint8_t>(color);
+            }
+        }
+        return image;
+    }
+
+    uint32_t mip_level_count(uint32_t width, uint32_t height) {
+        uint32_t levels = 1;
+        uint32_t size = std::max(width, height);
+        while (size > 1) {
+            size /= 2;
+            levels++;
+        }
+        return levels;
+    }
+
+    std::vector<VkeImageData> generate_mip_chain(VkeImageData base) {
+        std::vector<VkeImageData> levels{};
+        levels.reserve(mip_level_count(base.width, base.height));
+        levels.push_back(std::move(base));
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            levels.push_back(downsample(levels.back()));
+        }
+        return levels;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef vke_image_data_
+    #define vke_image_data_
+
+    // std
+    #include <cstdint>
+    #include <string>
+    #include <vector>
+
+    namespace vke {
+        // tightly packed srgb rgba8 texels on the cpu
+        struct VkeImageData {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<uint8_t> pixels{};
+
+            size_t get_size() const { return pixels.size(); }
+
+            // binary ppm (P6) with 8 bit channels, the format VkeFrameWriter writes
+            static VkeImageData load(const std::string &path);
+            // two colored squares of cell_size texels, useful as default texture
+            static VkeImageData checkerboard(uint32_t size, uint32_t cell_size, uint32_t color_a, uint32_t color_b);
+        };
+
+        // number of levels down to 1x1
+        uint32_t mip_level_count(uint32_t width, uint32_t height);
+
+        // Full mip chain with a 2x2 box filter, base level first. Colors are averaged in linear space so
+        // the smaller levels don't darken, odd sizes repeat the last row or column.
+        std::vector<VkeImageData> generate_mip_chain(VkeImageData base);
+    }
+
+#endif
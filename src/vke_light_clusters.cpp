@@ -0,0 +1,261 @@
+#include "vke_light_clusters.hpp"
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vke {
+
+    VkeLightGrid::VkeLightGrid(uint32_t max_light_indices) :
+        max_light_indices{max_light_indices},
+        clusters(CLUSTER_COUNT, Cluster{0, 0})
+    {}
+
+    void VkeLightGrid::set_projection(const glm::mat4 &projection, VkExtent2D extent) {
+        // inverse of set_perspective_projection, view depth is positive in front of the camera
+        projection_scale = {projection[0][0], projection[1][1]};
+        near = -projection[3][2] / projection[2][2];
+        far = -projection[3][2] / (projection[2][2] - 1.f);
+
+        float log_ratio = std::log(far / near);
+        slice_scale = static_cast<float>(DEPTH_SLICES) / log_ratio;
+        slice_bias = -slice_scale * std::log(near);
+        for (uint32_t slice = 0; slice <= DEPTH_SLICES; slice++) {
+            slice_depths[slice] = near * std::pow(far / near, static_cast<float>(slice) / DEPTH_SLICES);
+        }
+
+        tiles_per_pixel = {
+            static_cast<float>(TILES_X) / std::max(extent.width, 1u),
+            static_cast<float>(TILES_Y) / std::max(extent.height, 1u)
+        };
+    }
+
+    glm::vec4 VkeLightGrid::get_cluster_scale() const {
+        return {tiles_per_pixel.x, tiles_per_pixel.y, slice_scale, slice_bias};
+    }
+
+    uint32_t VkeLightGrid::slice_of(float depth) const {
+        int slice = static_cast<int>(std::floor(std::log(depth) * slice_scale + slice_bias));
+        return static_cast<uint32_t>(std::clamp(slice, 0, static_cast<int>(DEPTH_SLICES) - 1));
+    }
+
+    bool VkeLightGrid::tile_box(const LightBounds &bounds, float near_depth, float far_depth, std::array<uint32_t, 4> &box) const {
+        // the lanes are (low x, low y, high x, high y) of the sphere's bounding box between the two depths, it
+        // is widest on screen at the near depth where it reaches across the view axis and at the far depth
+        // elsewhere. a clamped tile coordinate truncates to the same tile as its floor
+#if defined(__SSE2__)
+        const __m128 side = _mm_setr_ps(-1.f, -1.f, 1.f, 1.f);
+        __m128 center = _mm_setr_ps(bounds.center.x, bounds.center.y, bounds.center.x, bounds.center.y);
+        __m128 edge = _mm_add_ps(center, _mm_mul_ps(side, _mm_set1_ps(bounds.radius)));
+        __m128 across = _mm_cmpgt_ps(_mm_mul_ps(edge, side), _mm_setzero_ps());
+        __m128 depth = _mm_or_ps(_mm_and_ps(across, _mm_set1_ps(near_depth)), _mm_andnot_ps(across, _mm_set1_ps(far_depth)));
+        __m128 scale = _mm_setr_ps(projection_scale.x, projection_scale.y, projection_scale.x, projection_scale.y);
+        __m128 ndc = _mm_div_ps(_mm_mul_ps(scale, edge), depth);
+        // low edges right of the screen or high edges left of it
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_mul_ps(ndc, side), _mm_set1_ps(-1.f))) != 0) {
+            return false;
+        }
+        const __m128 tiles = _mm_setr_ps(TILES_X, TILES_Y, TILES_X, TILES_Y);
+        __m128 tile = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ndc, _mm_set1_ps(.5f)), _mm_set1_ps(.5f)), tiles);
+        tile = _mm_min_ps(_mm_max_ps(tile, _mm_setzero_ps()), _mm_sub_ps(tiles, _mm_set1_ps(1.f)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(box.data()), _mm_cvttps_epi32(tile));
+        return true;
+#else
+        constexpr std::array<float, 4> side{-1.f, -1.f, 1.f, 1.f};
+        const std::array<float, 4> tiles{TILES_X, TILES_Y, TILES_X, TILES_Y};
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            float edge = bounds.center[lane % 2] + side[lane] * bounds.radius;
+            float ndc = projection_scale[lane % 2] * edge / (edge * side[lane] > 0.f ? near_depth : far_depth);
+            if (ndc * side[lane] < -1.f) {
+                return false;
+            }
+            float tile = std::clamp((ndc * .5f + .5f) * tiles[lane], 0.f, tiles[lane] - 1.f);
+            box[lane] = static_cast<uint32_t>(tile);
+        }
+        return true;
+#endif
+    }
+
+    void VkeLightGrid::cull(const glm::mat4 &view, const VkePointLight *lights, uint32_t light_count) {
+        // view space centers and the depth range in front of the near plane, four lights at a time
+        bounds.clear();
+        uint32_t light = 0;
+#if defined(__SSE2__)
+        // a row of the view matrix, each element broadcast to all lanes
+        struct Row {
+            __m128 x, y, z, w;
+        };
+        auto row = [&](uint32_t i) {
+            return Row{_mm_set1_ps(view[0][i]), _mm_set1_ps(view[1][i]), _mm_set1_ps(view[2][i]), _mm_set1_ps(view[3][i])};
+        };
+        const Row row_x = row(0);
+        const Row row_y = row(1);
+        const Row row_z = row(2);
+        auto transform = [](const Row &row, __m128 x, __m128 y, __m128 z) {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(row.x, x), _mm_mul_ps(row.y, y)), _mm_add_ps(_mm_mul_ps(row.z, z), row.w));
+        };
+        for (; light + 4 <= light_count; light += 4) {
+            // the position_radius of four lights, transposed to x, y, z and radius of all four
+            __m128 x = _mm_loadu_ps(&lights[light].position_radius.x);
+            __m128 y = _mm_loadu_ps(&lights[light + 1].position_radius.x);
+            __m128 z = _mm_loadu_ps(&lights[light + 2].position_radius.x);
+            __m128 radius = _mm_loadu_ps(&lights[light + 3].position_radius.x);
+            _MM_TRANSPOSE4_PS(x, y, z, radius);
+
+            alignas(16) std::array<float, 4> center_x, center_y, center_z, first_depth, last_depth;
+            __m128 depth = transform(row_z, x, y, z);
+            __m128 first = _mm_max_ps(_mm_sub_ps(depth, radius), _mm_set1_ps(near));
+            __m128 last = _mm_min_ps(_mm_add_ps(depth, radius), _mm_set1_ps(far));
+            int visible = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(radius, _mm_setzero_ps()), _mm_cmple_ps(first, last)));
+            if (visible == 0) {
+                continue;
+            }
+            _mm_store_ps(center_x.data(), transform(row_x, x, y, z));
+            _mm_store_ps(center_y.data(), transform(row_y, x, y, z));
+            _mm_store_ps(center_z.data(), depth);
+            _mm_store_ps(first_depth.data(), first);
+            _mm_store_ps(last_depth.data(), last);
+            for (uint32_t lane = 0; lane < 4; lane++) {
+                if (visible & (1 << lane)) {
+                    bounds.push_back({
+                        {center_x[lane], center_y[lane], center_z[lane]},
+                        lights[light + lane].position_radius.w,
+                        first_depth[lane],
+                        last_depth[lane],
+                        light + lane
+                    });
+                }
+            }
+        }
+#endif
+        for (; light < light_count; light++) {
+            float radius = lights[light].position_radius.w;
+            glm::vec4 center = view * glm::vec4(glm::vec3(lights[light].position_radius), 1.f);
+            float first_depth = std::max(center.z - radius, near);
+            float last_depth = std::min(center.z + radius, far);
+            if (radius > 0.f && first_depth <= last_depth) {
+                bounds.push_back({glm::vec3(center), radius, first_depth, last_depth, light});
+            }
+        }
+    }
+
+    void VkeLightGrid::assign(const glm::mat4 &view, const VkePointLight *lights, uint32_t light_count) {
+        VKE_CPU_SCOPE("light assignment");
+        std::fill(clusters.begin(), clusters.end(), Cluster{0, 0});
+        pairs.clear();
+        visible_lights = 0;
+
+        cull(view, lights, light_count);
+        for (const auto &light : bounds) {
+            // (first x, first y, last x, last y)
+            std::array<uint32_t, 4> box;
+            if (!tile_box(light, light.first_depth, light.last_depth, box)) {
+                continue;
+            }
+
+            bool visible = false;
+            for (uint32_t slice = slice_of(light.first_depth); slice <= slice_of(light.last_depth); slice++) {
+                float near_depth = std::max(light.first_depth, slice_depths[slice]);
+                float far_depth = std::min(light.last_depth, slice_depths[slice + 1]);
+                if (near_depth > far_depth || !tile_box(light, near_depth, far_depth, box)) {
+                    continue;
+                }
+
+                for (uint32_t y = box[1]; y <= box[3]; y++) {
+                    for (uint32_t x = box[0]; x <= box[2]; x++) {
+                        uint32_t cluster = (slice * TILES_Y + y) * TILES_X + x;
+                        clusters[cluster].count++;
+                        pairs.push_back({cluster, light.light});
+                    }
+                }
+                visible = true;
+            }
+            visible_lights += visible;
+        }
+
+        // counting sort of the pairs, lists that do not fit anymore are cut off
+        uint32_t offset = 0;
+        max_cluster_lights = 0;
+        dropped_indices = 0;
+        for (auto &cluster : clusters) {
+            max_cluster_lights = std::max(max_cluster_lights, cluster.count);
+            uint32_t count = std::min(cluster.count, max_light_indices - offset);
+            dropped_indices += cluster.count - count;
+            cluster.offset = offset;
+            cluster.count = count;
+            offset += count;
+        }
+
+        light_indices.resize(offset);
+        filled.assign(CLUSTER_COUNT, 0);
+        for (auto [cluster, light] : pairs) {
+            if (filled[cluster] < clusters[cluster].count) {
+                light_indices[clusters[cluster].offset + filled[cluster]++] = light;
+            }
+        }
+    }
+
+    VkeClusteredLights::VkeClusteredLights(
+        VkeDevice &device,
+        uint32_t frames_in_flight,
+        uint32_t max_lights,
+        uint32_t max_light_indices
+    ) :
+        max_lights{std::max(max_lights, 1u)},
+        grid{std::max(max_light_indices, 1u)},
+        frames(frames_in_flight)
+    {
+        auto create_buffer = [&](VkDeviceSize instance_size, uint32_t instance_count) {
+            auto buffer = std::make_unique<VkeBuffer>(
+                device,
+                instance_size,
+                instance_count,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            buffer->map();
+            return buffer;
+        };
+        for (auto &frame : frames) {
+            frame.lights = create_buffer(sizeof(VkePointLight), this->max_lights);
+            frame.clusters = create_buffer(sizeof(VkeLightGrid::Cluster), VkeLightGrid::CLUSTER_COUNT);
+            frame.light_indices = create_buffer(sizeof(uint32_t), std::max(max_light_indices, 1u));
+        }
+    }
+
+    void VkeClusteredLights::update(int frame_index, const VkeCamera &camera, VkExtent2D extent, const std::vector<VkePointLight> &lights) {
+        light_count = std::min(static_cast<uint32_t>(lights.size()), max_lights);
+        grid.set_projection(camera.get_projection(), extent);
+        grid.assign(camera.get_view(), lights.data(), light_count);
+
+        auto &frame = frames[frame_index];
+        if (light_count > 0) {
+            frame.lights->write_to_buffer(const_cast<VkePointLight*>(lights.data()), light_count * sizeof(VkePointLight));
+        }
+        frame.clusters->write_to_buffer(
+            const_cast<VkeLightGrid::Cluster*>(grid.get_clusters().data()),
+            grid.get_clusters().size() * sizeof(VkeLightGrid::Cluster)
+        );
+        if (!grid.get_light_indices().empty()) {
+            frame.light_indices->write_to_buffer(
+                const_cast<uint32_t*>(grid.get_light_indices().data()),
+                grid.get_light_indices().size() * sizeof(uint32_t)
+            );
+        }
+    }
+
+    void VkeClusteredLights::write_parameters(GlobalUBO &ubo) const {
+        ubo.cluster_scale = grid.get_cluster_scale();
+        ubo.cluster_grid = {VkeLightGrid::TILES_X, VkeLightGrid::TILES_Y, VkeLightGrid::DEPTH_SLICES, light_count};
+    }
+
+    std::array<VkDescriptorBufferInfo, 3> VkeClusteredLights::get_buffer_infos(int frame_index) const {
+        auto &frame = frames[frame_index];
+        return {frame.lights->descriptor_info(), frame.clusters->descriptor_info(), frame.light_indices->descriptor_info()};
+    }
+}
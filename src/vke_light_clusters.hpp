@@ -0,0 +1,135 @@
+#ifndef vke_light_clusters_
+    #define vke_light_clusters_
+
+    #include "vke_buffer.hpp"
+    #include "vke_camera.hpp"
+    #include "vke_device.hpp"
+    #include "vke_frame_info.hpp"
+
+    // std
+    #include <array>
+    #include <cstdint>
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+        // layout of a light in the lights buffer of simple_shader.frag
+        struct VkePointLight {
+            // world space position, w is the radius the light reaches
+            glm::vec4 position_radius{0.f, 0.f, 0.f, 1.f};
+            // (r,g,b,intensity)
+            glm::vec4 color{1.f};
+        };
+
+        // Froxel grid over the view frustum of a perspective camera: TILES_X * TILES_Y screen tiles, each
+        // split into DEPTH_SLICES slices whose thickness grows exponentially from near to far plane.
+        // assign collects for every cluster the lights whose sphere touches it, the fragment shader then
+        // only loops over the lights of the cluster its pixel and depth fall into. With SSE2 the lights are
+        // culled four at a time and the tile box of a slice is one four lane operation.
+        class VkeLightGrid {
+            public:
+            static constexpr uint32_t TILES_X = 16;
+            static constexpr uint32_t TILES_Y = 9;
+            static constexpr uint32_t DEPTH_SLICES = 24;
+            static constexpr uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * DEPTH_SLICES;
+
+            // layout of a cluster in the clusters buffer, its lights are light_indices[offset, offset + count)
+            struct Cluster {
+                uint32_t offset;
+                uint32_t count;
+            };
+
+            // lists longer than max_light_indices in total are cut off
+            explicit VkeLightGrid(uint32_t max_light_indices);
+
+            // near and far plane are read back from the projection, extent is the render area in pixels
+            void set_projection(const glm::mat4 &projection, VkExtent2D extent);
+            void assign(const glm::mat4 &view, const VkePointLight *lights, uint32_t light_count);
+
+            const std::vector<Cluster> &get_clusters() const { return clusters; }
+            const std::vector<uint32_t> &get_light_indices() const { return light_indices; }
+            // gl_FragCoord.xy * xy is the tile, log(view depth) * z + w the depth slice
+            glm::vec4 get_cluster_scale() const;
+
+            // statistics of the last assign call
+            uint32_t get_visible_lights() const { return visible_lights; }
+            uint32_t get_max_cluster_lights() const { return max_cluster_lights; }
+            uint32_t get_dropped_indices() const { return dropped_indices; }
+
+            private:
+            // a light in front of the near plane, center in view space
+            struct LightBounds {
+                glm::vec3 center;
+                float radius;
+                float first_depth;
+                float last_depth;
+                uint32_t light;
+            };
+
+            uint32_t slice_of(float depth) const;
+            // fills bounds with the lights that reach between the near and far plane
+            void cull(const glm::mat4 &view, const VkePointLight *lights, uint32_t light_count);
+            // screen tiles covered by the light between two depths as (first x, first y, last x, last y), false
+            // if it misses the screen
+            bool tile_box(const LightBounds &bounds, float near_depth, float far_depth, std::array<uint32_t, 4> &box) const;
+
+            uint32_t max_light_indices;
+            glm::vec2 projection_scale{1.f};
+            float near = .1f;
+            float far = 100.f;
+            float slice_scale = 0.f;
+            float slice_bias = 0.f;
+            glm::vec2 tiles_per_pixel{0.f};
+            std::array<float, DEPTH_SLICES + 1> slice_depths{};
+
+            std::vector<Cluster> clusters;
+            std::vector<LightBounds> bounds{};
+            std::vector<uint32_t> light_indices{};
+            // (cluster, light) pairs of assign, sorted into light_indices by cluster
+            std::vector<std::array<uint32_t, 2>> pairs{};
+            std::vector<uint32_t> filled{};
+            uint32_t visible_lights = 0;
+            uint32_t max_cluster_lights = 0;
+            uint32_t dropped_indices = 0;
+        };
+
+        // Per frame storage buffers holding the lights and their clusters, bound at bindings 1 to 3 of the
+        // global set. Lights are assigned on the cpu every frame and written to host visible memory.
+        class VkeClusteredLights {
+            public:
+            VkeClusteredLights(
+                VkeDevice &device,
+                uint32_t frames_in_flight,
+                uint32_t max_lights = 16384,
+                uint32_t max_light_indices = 512 * 1024
+            );
+
+            VkeClusteredLights(const VkeClusteredLights&) = delete;
+            VkeClusteredLights& operator=(const VkeClusteredLights&) = delete;
+
+            // lights past max_lights are ignored
+            void update(int frame_index, const VkeCamera &camera, VkExtent2D extent, const std::vector<VkePointLight> &lights);
+            // grid parameters and light count for the shaders
+            void write_parameters(GlobalUBO &ubo) const;
+
+            // lights, clusters and light indices of the frame
+            std::array<VkDescriptorBufferInfo, 3> get_buffer_infos(int frame_index) const;
+
+            const VkeLightGrid &get_grid() const { return grid; }
+            uint32_t get_light_count() const { return light_count; }
+
+            private:
+            struct FrameBuffers {
+                std::unique_ptr<VkeBuffer> lights;
+                std::unique_ptr<VkeBuffer> clusters;
+                std::unique_ptr<VkeBuffer> light_indices;
+            };
+
+            uint32_t max_lights;
+            VkeLightGrid grid;
+            std::vector<FrameBuffers> frames{};
+            uint32_t light_count = 0;
+        };
+    }
+
+#endif
@@ -0,0 +1,150 @@
+#include "vke_memory_pool.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace vke {
+
+    VkeMemoryPool::VkeMemoryPool(VkeDevice &device, VkDeviceSize block_size) :
+        vke_device{device},
+        block_size{block_size}
+    {}
+
+    VkeMemoryPool::~VkeMemoryPool() {
+        for (auto &block : blocks) {
+            vke_device.freeMemory(block.memory);
+        }
+    }
+
+    bool VkeMemoryPool::try_allocate(Block &block, const VkMemoryRequirements &requirements, VkDeviceSize &offset) {
+        for (size_t i = 0; i < block.free_ranges.size(); i++) {
+            Range range = block.free_ranges[i];
+            VkDeviceSize aligned = (range.offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+            if (aligned + requirements.size > range.offset + range.size) {
+                continue;
+            }
+
+            // split the range into the alignment padding before and the remainder after the allocation
+            std::vector<Range> split{};
+            if (aligned > range.offset) {
+                split.push_back({range.offset, aligned - range.offset});
+            }
+            VkDeviceSize end = aligned + requirements.size;
+            if (end < range.offset + range.size) {
+                split.push_back({end, range.offset + range.size - end});
+            }
+            block.free_ranges.erase(block.free_ranges.begin() + i);
+            block.free_ranges.insert(block.free_ranges.begin() + i, split.begin(), split.end());
+
+            offset = aligned;
+            return true;
+        }
+        return false;
+    }
+
+    VkePoolAllocation VkeMemoryPool::allocate(const VkMemoryRequirements &requirements, uint32_t memory_type) {
+        VkePoolAllocation allocation{};
+        allocation.size = requirements.size;
+
+        for (uint32_t i = 0; i < blocks.size(); i++) {
+            if (blocks[i].memory_type == memory_type && try_allocate(blocks[i], requirements, allocation.offset)) {
+                allocation.memory = blocks[i].memory;
+                allocation.block = i;
+                used_size += allocation.size;
+                return allocation;
+            }
+        }
+
+        Block block{};
+        block.size = std::max(block_size, requirements.size);
+        block.memory_type = memory_type;
+        block.free_ranges.push_back({0, block.size});
+
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = block.size;
+        alloc_info.memoryTypeIndex = memory_type;
+
+        if (vke_device.allocateMemory(alloc_info, block.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate memory pool block");
+        }
+
+        blocks.push_back(std::move(block));
+        try_allocate(blocks.back(), requirements, allocation.offset);
+        allocation.memory = blocks.back().memory;
+        allocation.block = static_cast<uint32_t>(blocks.size() - 1);
+        used_size += allocation.size;
+        return allocation;
+    }
+
+    void VkeMemoryPool::free(const VkePoolAllocation &allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        auto &ranges = blocks[allocation.block].free_ranges;
+        auto it = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset, 
+            [](const Range &range, VkDeviceSize offset) { return range.offset < offset; });
+        it = ranges.insert(it, {allocation.offset, allocation.size});
+
+        // merge with the following and the preceding range
+        auto next = it + 1;
+        if (next != ranges.end() && it->offset + it->size == next->offset) {
+            it->size += next->size;
+            ranges.erase(next);
+        }
+        if (it != ranges.begin()) {
+            auto previous = it - 1;
+            if (previous->offset + previous->size == it->offset) {
+                previous->size += it->size;
+                ranges.erase(it);
+            }
+        }
+
+        used_size -= allocation.size;
+    }
+
+    VkePoolAllocation VkeMemoryPool::create_image(
+        const VkImageCreateInfo &image_info,
+        VkMemoryPropertyFlags properties,
+        VkImage &image,
+        VkMemoryPropertyFlags preferred
+    ) {
+        // only optimal tiling images live in the pool, so buffer image granularity does not need to be respected
+        if (image_info.tiling != VK_IMAGE_TILING_OPTIMAL) {
+            throw std::runtime_error("memory pool only supports optimal tiling images");
+        }
+
+        if (vkCreateImage(vke_device.device(), &image_info, nullptr, &image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(vke_device.device(), image, &requirements);
+
+        uint32_t memory_type;
+        if (preferred != 0 && vke_device.tryFindMemoryType(requirements.memoryTypeBits, properties | preferred, memory_type)) {
+            properties |= preferred;
+        } else {
+            memory_type = vke_device.findMemoryType(requirements.memoryTypeBits, properties);
+        }
+
+        auto allocation = allocate(requirements, memory_type);
+        allocation.properties = properties;
+
+        if (vkBindImageMemory(vke_device.device(), image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory");
+        }
+
+        return allocation;
+    }
+
+    VkDeviceSize VkeMemoryPool::get_reserved_size() const {
+        VkDeviceSize size = 0;
+        for (auto &block : blocks) {
+            size += block.size;
+        }
+        return size;
+    }
+}
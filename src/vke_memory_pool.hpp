@@ -0,0 +1,68 @@
+#ifndef vke_memory_pool_
+    #define vke_memory_pool_
+
+    #include "vke_device.hpp"
+
+    // std
+    #include <vector>
+
+    namespace vke {
+        struct VkePoolAllocation {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            uint32_t block = 0;
+            // properties the memory was found with, see create_image
+            VkMemoryPropertyFlags properties = 0;
+        };
+
+        // Sub-allocates optimal tiling images from a few large blocks per memory type. Freed ranges are returned
+        // to the block and empty blocks are kept, so recreating attachments of the same size after a resize does
+        // not go through vkAllocateMemory again.
+        class VkeMemoryPool {
+            public:
+            explicit VkeMemoryPool(VkeDevice &device, VkDeviceSize block_size = 64 * 1024 * 1024);
+            ~VkeMemoryPool();
+
+            VkeMemoryPool(const VkeMemoryPool&) = delete;
+            VkeMemoryPool& operator=(const VkeMemoryPool&) = delete;
+
+            VkePoolAllocation allocate(const VkMemoryRequirements &requirements, uint32_t memory_type);
+            void free(const VkePoolAllocation &allocation);
+
+            // creates the image and binds it to pooled memory, memory with the preferred properties in addition
+            // to the required ones is used if the device has it
+            VkePoolAllocation create_image(
+                const VkImageCreateInfo &image_info,
+                VkMemoryPropertyFlags properties,
+                VkImage &image,
+                VkMemoryPropertyFlags preferred = 0
+            );
+
+            VkDeviceSize get_reserved_size() const;
+            VkDeviceSize get_used_size() const { return used_size; }
+
+            private:
+            struct Range {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+            };
+
+            struct Block {
+                VkDeviceMemory memory;
+                VkDeviceSize size;
+                uint32_t memory_type;
+                // sorted by offset, neighbours are merged on free
+                std::vector<Range> free_ranges;
+            };
+
+            bool try_allocate(Block &block, const VkMemoryRequirements &requirements, VkDeviceSize &offset);
+
+            VkeDevice &vke_device;
+            VkDeviceSize block_size;
+            VkDeviceSize used_size{0};
+            std::vector<Block> blocks;
+        };
+    }
+
+#endif
@@ -0,0 +1,320 @@
+#include "vke_mesh_lod.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+
+namespace vke {
+
+    void VkeMeshSimplifier::Quadric::add_plane(const glm::vec3 &normal, float distance, float area) {
+        // accumulated in double, large meshes sum many planes into one position
+        double nx = normal.x, ny = normal.y, nz = normal.z, d = distance, w = area;
+        a[0] += w * nx * nx; a[1] += w * nx * ny; a[2] += w * nx * nz; a[3] += w * nx * d;
+        a[4] += w * ny * ny; a[5] += w * ny * nz; a[6] += w * ny * d;
+        a[7] += w * nz * nz; a[8] += w * nz * d;
+        a[9] += w * d * d;
+        weight += w;
+    }
+
+    VkeMeshSimplifier::Quadric &VkeMeshSimplifier::Quadric::operator+=(const Quadric &other) {
+        for (int i = 0; i < 10; i++) {
+            a[i] += other.a[i];
+        }
+        weight += other.weight;
+        return *this;
+    }
+
+    double VkeMeshSimplifier::Quadric::evaluate(const glm::vec3 &point) const {
+        if (weight <= 0.0) {
+            return 0.0;
+        }
+        double x = point.x, y = point.y, z = point.z;
+        return (a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+            + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+            + a[7] * z * z + 2.0 * a[8] * z
+            + a[9]) / weight;
+    }
+
+    VkeMeshSimplifier::VkeMeshSimplifier(const std::vector<VkeModel::Vertex> &vertices, const std::vector<uint32_t> &indices) :
+        vertices{vertices}
+    {
+        // weld by position, the attribute seams of the loader would otherwise cut the mesh into islands
+        std::unordered_map<glm::vec3, uint32_t> position_ids{};
+        vertex_positions.resize(vertices.size());
+        for (uint32_t i = 0; i < vertices.size(); i++) {
+            auto [it, inserted] = position_ids.try_emplace(vertices[i].position, static_cast<uint32_t>(positions.size()));
+            if (inserted) {
+                positions.push_back(vertices[i].position);
+                position_vertices.emplace_back();
+            }
+            vertex_positions[i] = it->second;
+            position_vertices[it->second].push_back(i);
+        }
+
+        const size_t position_count = positions.size();
+        position_triangles.resize(position_count);
+        quadrics.resize(position_count);
+        versions.resize(position_count, 0);
+        removed_positions.resize(position_count, false);
+        border_positions.resize(position_count, false);
+
+        // edges used by one triangle only are on a border
+        std::unordered_map<uint64_t, uint32_t> edge_use{};
+        auto edge_key = [](uint32_t a, uint32_t b) { return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b); };
+
+        triangles.reserve(indices.size() / 3);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::array<uint32_t, 3> triangle{indices[i], indices[i + 1], indices[i + 2]};
+            uint32_t p0 = vertex_positions[triangle[0]];
+            uint32_t p1 = vertex_positions[triangle[1]];
+            uint32_t p2 = vertex_positions[triangle[2]];
+            if (p0 == p1 || p1 == p2 || p2 == p0) {
+                continue;
+            }
+
+            uint32_t id = static_cast<uint32_t>(triangles.size());
+            triangles.push_back(triangle);
+            for (uint32_t p : {p0, p1, p2}) {
+                position_triangles[p].push_back(id);
+            }
+            edge_use[edge_key(p0, p1)]++;
+            edge_use[edge_key(p1, p2)]++;
+            edge_use[edge_key(p2, p0)]++;
+
+            glm::vec3 a = positions[p0], b = positions[p1], c = positions[p2];
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+            if (length > 0.f) {
+                normal /= length;
+                Quadric plane{};
+                plane.add_plane(normal, -glm::dot(normal, a), .5f * length);
+                for (uint32_t p : {p0, p1, p2}) {
+                    quadrics[p] += plane;
+                }
+            }
+        }
+        removed_triangles.resize(triangles.size(), false);
+        live_triangle_count = triangles.size();
+
+        for (auto &[key, count] : edge_use) {
+            if (count == 1) {
+                border_positions[static_cast<uint32_t>(key >> 32)] = true;
+                border_positions[static_cast<uint32_t>(key)] = true;
+            }
+        }
+
+        for (uint32_t p = 0; p < position_count; p++) {
+            push_collapses(p);
+        }
+    }
+
+    void VkeMeshSimplifier::push_collapse(uint32_t from, uint32_t to) {
+        if (border_positions[from]) {
+            return;
+        }
+        Quadric quadric = quadrics[from];
+        quadric += quadrics[to];
+        double cost = std::max(quadric.evaluate(positions[to]), 0.0);
+        heap.push_back({cost, from, to, versions[from], versions[to]});
+        std::push_heap(heap.begin(), heap.end(), std::greater<Collapse>{});
+    }
+
+    void VkeMeshSimplifier::push_collapses(uint32_t position) {
+        for (uint32_t triangle : position_triangles[position]) {
+            if (removed_triangles[triangle]) continue;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t other = position_of(triangle, corner);
+                if (other == position) continue;
+                push_collapse(position, other);
+                push_collapse(other, position);
+            }
+        }
+    }
+
+    bool VkeMeshSimplifier::flips_triangle(uint32_t from, uint32_t to) const {
+        for (uint32_t triangle : position_triangles[from]) {
+            if (removed_triangles[triangle]) continue;
+
+            glm::vec3 before[3];
+            glm::vec3 after[3];
+            bool removed = false;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t position = position_of(triangle, corner);
+                removed |= position == to;
+                before[corner] = positions[position];
+                after[corner] = position == from ? positions[to] : positions[position];
+            }
+            // triangles on the collapsed edge disappear
+            if (removed) continue;
+
+            glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(normal_before, normal_after) <= 0.f) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool VkeMeshSimplifier::pinches_surface(uint32_t from, uint32_t to) const {
+        std::vector<uint32_t> from_neighbours{};
+        std::vector<uint32_t> to_neighbours{};
+        uint32_t edge_triangles = 0;
+        for (uint32_t triangle : position_triangles[from]) {
+            if (removed_triangles[triangle]) continue;
+            bool on_edge = false;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t position = position_of(triangle, corner);
+                on_edge |= position == to;
+                if (position != from && position != to) from_neighbours.push_back(position);
+            }
+            edge_triangles += on_edge;
+        }
+        for (uint32_t triangle : position_triangles[to]) {
+            if (removed_triangles[triangle]) continue;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t position = position_of(triangle, corner);
+                if (position != from && position != to) to_neighbours.push_back(position);
+            }
+        }
+
+        std::sort(from_neighbours.begin(), from_neighbours.end());
+        from_neighbours.erase(std::unique(from_neighbours.begin(), from_neighbours.end()), from_neighbours.end());
+        std::sort(to_neighbours.begin(), to_neighbours.end());
+        to_neighbours.erase(std::unique(to_neighbours.begin(), to_neighbours.end()), to_neighbours.end());
+
+        std::vector<uint32_t> shared{};
+        std::set_intersection(
+            from_neighbours.begin(), from_neighbours.end(),
+            to_neighbours.begin(), to_neighbours.end(),
+            std::back_inserter(shared)
+        );
+        return shared.size() > edge_triangles;
+    }
+
+    uint32_t VkeMeshSimplifier::closest_vertex(uint32_t vertex, uint32_t position) const {
+        const auto &source = vertices[vertex];
+        uint32_t best = position_vertices[position][0];
+        float best_distance = std::numeric_limits<float>::max();
+        for (uint32_t candidate : position_vertices[position]) {
+            const auto &target = vertices[candidate];
+            glm::vec3 normal = source.normal - target.normal;
+            glm::vec3 color = source.color - target.color;
+            glm::vec2 uv = source.uv - target.uv;
+            float distance = glm::dot(normal, normal) + glm::dot(color, color) + glm::dot(uv, uv);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best = candidate;
+            }
+        }
+        return best;
+    }
+
+    void VkeMeshSimplifier::collapse(uint32_t from, uint32_t to) {
+        quadrics[to] += quadrics[from];
+
+        std::unordered_map<uint32_t, uint32_t> moved_vertices{};
+        for (uint32_t triangle : position_triangles[from]) {
+            if (removed_triangles[triangle]) continue;
+
+            bool on_edge = false;
+            for (int corner = 0; corner < 3; corner++) {
+                on_edge |= position_of(triangle, corner) == to;
+            }
+            if (on_edge) {
+                removed_triangles[triangle] = true;
+                live_triangle_count--;
+                continue;
+            }
+
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = triangles[triangle][corner];
+                if (vertex_positions[vertex] != from) continue;
+                auto it = moved_vertices.find(vertex);
+                if (it == moved_vertices.end()) {
+                    it = moved_vertices.emplace(vertex, closest_vertex(vertex, to)).first;
+                }
+                triangles[triangle][corner] = it->second;
+            }
+            position_triangles[to].push_back(triangle);
+        }
+        position_triangles[from].clear();
+        removed_positions[from] = true;
+
+        auto &remaining = position_triangles[to];
+        remaining.erase(
+            std::remove_if(remaining.begin(), remaining.end(), [&](uint32_t triangle) { return removed_triangles[triangle]; }),
+            remaining.end()
+        );
+
+        // collapses queued with the old quadric of to are skipped from now on
+        versions[to]++;
+        push_collapses(to);
+    }
+
+    void VkeMeshSimplifier::simplify(size_t target_triangle_count, float max_error) {
+        while (live_triangle_count > target_triangle_count && !heap.empty()) {
+            const Collapse next = heap.front();
+            bool stale = removed_positions[next.from] || removed_positions[next.to]
+                || versions[next.from] != next.from_version || versions[next.to] != next.to_version;
+            float next_error = static_cast<float>(std::sqrt(next.cost));
+            if (!stale && next_error > max_error) {
+                // stays queued for a later call with a larger error
+                return;
+            }
+
+            std::pop_heap(heap.begin(), heap.end(), std::greater<Collapse>{});
+            heap.pop_back();
+            if (stale || flips_triangle(next.from, next.to) || pinches_surface(next.from, next.to)) {
+                continue;
+            }
+
+            collapse(next.from, next.to);
+            error = std::max(error, next_error);
+        }
+    }
+
+    std::vector<uint32_t> VkeMeshSimplifier::get_indices() const {
+        std::vector<uint32_t> indices{};
+        indices.reserve(live_triangle_count * 3);
+        for (size_t i = 0; i < triangles.size(); i++) {
+            if (removed_triangles[i]) continue;
+            indices.insert(indices.end(), triangles[i].begin(), triangles[i].end());
+        }
+        return indices;
+    }
+
+    uint32_t select_lod(
+        const VkeModel &model,
+        const glm::mat4 &model_matrix,
+        const VkeCamera &camera,
+        float viewport_height,
+        float max_pixel_error
+    ) {
+        if (viewport_height <= 0.f || model.get_lod_count() <= 1) {
+            return 0;
+        }
+
+        float scale = glm::max(
+            glm::length(glm::vec3(model_matrix[0])),
+            glm::max(glm::length(glm::vec3(model_matrix[1])), glm::length(glm::vec3(model_matrix[2])))
+        );
+        glm::vec4 center = camera.get_view() * model_matrix * glm::vec4(model.get_bounding_center(), 1.f);
+        // the nearest point of the bounding sphere shows the largest error
+        float distance = center.z - model.get_bounding_radius() * scale;
+        if (distance <= 0.f) {
+            return 0;
+        }
+
+        // projection[1][1] maps a view space height at distance 1 to half the viewport
+        float pixels_per_unit = scale * camera.get_projection()[1][1] * .5f * viewport_height / distance;
+        uint32_t lod = 0;
+        while (lod + 1 < model.get_lod_count() && model.get_lod_error(lod + 1) * pixels_per_unit <= max_pixel_error) {
+            lod++;
+        }
+        return lod;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef vke_mesh_lod_
+    #define vke_mesh_lod_
+
+    #include "vke_model.hpp"
+    #include "vke_camera.hpp"
+
+    // std
+    #include <array>
+    #include <cstdint>
+    #include <limits>
+    #include <vector>
+
+    namespace vke {
+        // Reduces a triangle list with quadric error metric edge collapses. Only half edge collapses are done,
+        // a position moves onto a neighbouring position, so the simplified indices still address the
+        // original vertex buffer. Vertices that share a position but differ in normal, uv or color are
+        // collapsed together, each one moves to the most similar vertex at the target position.
+        // Border positions of open meshes are never moved, so silhouettes and holes keep their outline,
+        // and collapses that would flip a triangle or fold the surface onto itself are rejected.
+        class VkeMeshSimplifier {
+            public:
+            VkeMeshSimplifier(const std::vector<VkeModel::Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+            // collapses the cheapest edges until target_triangle_count is reached or the next collapse would
+            // exceed max_error, calling it again continues from the current state
+            void simplify(size_t target_triangle_count, float max_error = std::numeric_limits<float>::max());
+
+            std::vector<uint32_t> get_indices() const;
+            size_t get_triangle_count() const { return live_triangle_count; }
+            // largest error of the collapses so far, a root mean square distance in model units
+            float get_error() const { return error; }
+
+            private:
+            // symmetric 4x4 matrix of area weighted squared plane distances
+            struct Quadric {
+                double a[10]{};
+                double weight = 0.0;
+
+                void add_plane(const glm::vec3 &normal, float distance, float area);
+                Quadric &operator+=(const Quadric &other);
+                // mean squared distance of point to the planes
+                double evaluate(const glm::vec3 &point) const;
+            };
+
+            struct Collapse {
+                double cost;
+                uint32_t from;
+                uint32_t to;
+                uint32_t from_version;
+                uint32_t to_version;
+
+                bool operator>(const Collapse &other) const { return cost > other.cost; }
+            };
+
+            uint32_t position_of(uint32_t triangle, int corner) const { return vertex_positions[triangles[triangle][corner]]; }
+            void push_collapses(uint32_t position);
+            void push_collapse(uint32_t from, uint32_t to);
+            bool flips_triangle(uint32_t from, uint32_t to) const;
+            // the link condition, positions next to both ends may only be the tips of the edge's triangles
+            bool pinches_surface(uint32_t from, uint32_t to) const;
+            void collapse(uint32_t from, uint32_t to);
+            uint32_t closest_vertex(uint32_t vertex, uint32_t position) const;
+
+            const std::vector<VkeModel::Vertex> &vertices;
+            // unique positions, vertices with equal positions collapse together
+            std::vector<uint32_t> vertex_positions;
+            std::vector<glm::vec3> positions;
+            std::vector<std::vector<uint32_t>> position_vertices;
+            std::vector<std::vector<uint32_t>> position_triangles;
+            std::vector<Quadric> quadrics;
+            std::vector<uint32_t> versions;
+            std::vector<bool> removed_positions;
+            std::vector<bool> border_positions;
+
+            std::vector<std::array<uint32_t, 3>> triangles;
+            std::vector<bool> removed_triangles;
+            size_t live_triangle_count = 0;
+
+            std::vector<Collapse> heap;
+            float error = 0.f;
+        };
+
+        // Coarsest lod of model whose error, projected at the distance of the model's bounding sphere,
+        // covers at most max_pixel_error pixels. Returns 0 if viewport_height is 0.
+        uint32_t select_lod(
+            const VkeModel &model,
+            const glm::mat4 &model_matrix,
+            const VkeCamera &camera,
+            float viewport_height,
+            float max_pixel_error
+        );
+    }
+
+#endif
@@ -0,0 +1,215 @@
+#include "vke_meshlet.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace vke {
+
+    namespace {
+        constexpr uint32_t NO_SLOT = ~0u;
+
+        // sphere around the box of the vertices and the cone of the triangle normals
+        void compute_meshlet_bounds(
+            const std::vector<VkeModel::Vertex> &vertices,
+            const uint32_t *local_vertices,
+            const uint8_t *local_triangles,
+            VkeModel::Meshlet &meshlet
+        ) {
+            glm::vec3 min_position{std::numeric_limits<float>::max()};
+            glm::vec3 max_position{std::numeric_limits<float>::lowest()};
+            for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                min_position = glm::min(min_position, vertices[local_vertices[i]].position);
+                max_position = glm::max(max_position, vertices[local_vertices[i]].position);
+            }
+            meshlet.center = (min_position + max_position) * .5f;
+            meshlet.radius = 0.f;
+            for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                meshlet.radius = glm::max(meshlet.radius, glm::length(vertices[local_vertices[i]].position - meshlet.center));
+            }
+
+            std::vector<glm::vec3> normals{};
+            normals.reserve(meshlet.triangle_count);
+            glm::vec3 normal_sum{0.f};
+            for (uint32_t i = 0; i < meshlet.triangle_count; i++) {
+                const glm::vec3 &a = vertices[local_vertices[local_triangles[i * 3 + 0]]].position;
+                const glm::vec3 &b = vertices[local_vertices[local_triangles[i * 3 + 1]]].position;
+                const glm::vec3 &c = vertices[local_vertices[local_triangles[i * 3 + 2]]].position;
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float length = glm::length(normal);
+                // degenerate triangles face nowhere
+                if (length <= 0.f) continue;
+                normals.push_back(normal / length);
+                normal_sum += normals.back();
+            }
+
+            // no culling unless the normals are within a half angle of about 84 degrees around their mean
+            meshlet.cone_axis = glm::vec3{0.f, 0.f, 1.f};
+            meshlet.cone_cutoff = 1.f;
+            float sum_length = glm::length(normal_sum);
+            if (normals.empty() || sum_length <= 0.f) {
+                return;
+            }
+            glm::vec3 axis = normal_sum / sum_length;
+            float min_dot = 1.f;
+            for (const auto &normal : normals) {
+                min_dot = glm::min(min_dot, glm::dot(normal, axis));
+            }
+            if (min_dot <= .1f) {
+                return;
+            }
+            meshlet.cone_axis = axis;
+            meshlet.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+        }
+    }
+
+    void build_meshlets(
+        const std::vector<VkeModel::Vertex> &vertices,
+        const uint32_t *indices,
+        size_t index_count,
+        uint32_t max_vertices,
+        uint32_t max_triangles,
+        std::vector<VkeModel::Meshlet> &meshlets,
+        std::vector<uint32_t> &meshlet_vertices,
+        std::vector<uint8_t> &meshlet_triangles
+    ) {
+        // local indices are bytes
+        max_vertices = std::clamp(max_vertices, 3u, 256u);
+        max_triangles = std::max(max_triangles, 1u);
+
+        const uint32_t triangle_count = static_cast<uint32_t>(index_count / 3);
+        const size_t vertex_count = vertices.size();
+
+        // triangles around each vertex
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for (uint32_t i = 0; i < triangle_count * 3; i++) {
+            adjacency_offsets[indices[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertex_count; v++) {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+        std::vector<uint32_t> adjacency(triangle_count * 3);
+        std::vector<uint32_t> live_triangles(vertex_count, 0);
+        {
+            std::vector<uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (uint32_t i = 0; i < triangle_count * 3; i++) {
+                adjacency[cursor[indices[i]]++] = i / 3;
+                live_triangles[indices[i]]++;
+            }
+        }
+
+        std::vector<bool> emitted(triangle_count, false);
+        // slot of a vertex in the open meshlet
+        std::vector<uint32_t> slots(vertex_count, NO_SLOT);
+
+        VkeModel::Meshlet meshlet{};
+        meshlet.vertex_offset = static_cast<uint32_t>(meshlet_vertices.size());
+        meshlet.triangle_offset = static_cast<uint32_t>(meshlet_triangles.size() / 3);
+
+        auto new_vertices = [&](uint32_t triangle) {
+            uint32_t count = 0;
+            for (int corner = 0; corner < 3; corner++) {
+                count += slots[indices[triangle * 3 + corner]] == NO_SLOT;
+            }
+            return count;
+        };
+
+        auto flush = [&]() {
+            if (meshlet.triangle_count == 0) {
+                return;
+            }
+            compute_meshlet_bounds(
+                vertices,
+                meshlet_vertices.data() + meshlet.vertex_offset,
+                meshlet_triangles.data() + meshlet.triangle_offset * 3,
+                meshlet
+            );
+            for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+                slots[meshlet_vertices[meshlet.vertex_offset + i]] = NO_SLOT;
+            }
+            meshlets.push_back(meshlet);
+
+            meshlet = {};
+            meshlet.vertex_offset = static_cast<uint32_t>(meshlet_vertices.size());
+            meshlet.triangle_offset = static_cast<uint32_t>(meshlet_triangles.size() / 3);
+        };
+
+        auto add = [&](uint32_t triangle) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                if (slots[vertex] == NO_SLOT) {
+                    slots[vertex] = meshlet.vertex_count++;
+                    meshlet_vertices.push_back(vertex);
+                }
+                meshlet_triangles.push_back(static_cast<uint8_t>(slots[vertex]));
+                live_triangles[vertex]--;
+            }
+            meshlet.triangle_count++;
+            emitted[triangle] = true;
+        };
+
+        // fewest new vertices first, then the triangle whose vertices have the fewest triangles left,
+        // which finishes vertices off instead of leaving single triangles behind
+        auto best_neighbour = [&](const uint32_t *candidates, uint32_t candidate_count) {
+            uint32_t best = NO_SLOT;
+            uint32_t best_new = 4;
+            uint32_t best_live = std::numeric_limits<uint32_t>::max();
+            for (uint32_t c = 0; c < candidate_count; c++) {
+                uint32_t vertex = candidates[c];
+                for (uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex + 1]; a++) {
+                    uint32_t triangle = adjacency[a];
+                    if (emitted[triangle]) continue;
+                    uint32_t added = new_vertices(triangle);
+                    uint32_t live = live_triangles[indices[triangle * 3]]
+                        + live_triangles[indices[triangle * 3 + 1]]
+                        + live_triangles[indices[triangle * 3 + 2]];
+                    if (added < best_new || (added == best_new && live < best_live)) {
+                        best = triangle;
+                        best_new = added;
+                        best_live = live;
+                    }
+                }
+            }
+            return best;
+        };
+
+        uint32_t next_seed = 0;
+        uint32_t last_triangle = NO_SLOT;
+        for (uint32_t done = 0; done < triangle_count; done++) {
+            uint32_t triangle = NO_SLOT;
+            if (meshlet.triangle_count > 0) {
+                // the neighbourhood of the last triangle is usually enough, the whole meshlet otherwise
+                triangle = best_neighbour(&indices[last_triangle * 3], 3);
+                if (triangle == NO_SLOT) {
+                    triangle = best_neighbour(&meshlet_vertices[meshlet.vertex_offset], meshlet.vertex_count);
+                }
+                if (triangle == NO_SLOT && meshlet.triangle_count * 2 >= max_triangles) {
+                    flush();
+                }
+            }
+            if (triangle == NO_SLOT) {
+                while (emitted[next_seed]) {
+                    next_seed++;
+                }
+                triangle = next_seed;
+            }
+
+            if (meshlet.vertex_count + new_vertices(triangle) > max_vertices || meshlet.triangle_count == max_triangles) {
+                flush();
+            }
+            add(triangle);
+            last_triangle = triangle;
+        }
+        flush();
+    }
+
+    bool is_meshlet_backfacing(const VkeModel::Meshlet &meshlet, const glm::vec3 &camera_position) {
+        if (meshlet.cone_cutoff >= 1.f) {
+            return false;
+        }
+        // the view direction to every point of the sphere lies within the cone's opening
+        glm::vec3 to_center = meshlet.center - camera_position;
+        return glm::dot(to_center, meshlet.cone_axis) >= meshlet.cone_cutoff * glm::length(to_center) + meshlet.radius;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef vke_meshlet_
+    #define vke_meshlet_
+
+    #include "vke_model.hpp"
+
+    // std
+    #include <cstdint>
+    #include <vector>
+
+    namespace vke {
+        // Splits a triangle list into meshlets of at most max_vertices vertices and max_triangles triangles
+        // and appends them to meshlets. The vertex indices of each meshlet are appended to meshlet_vertices,
+        // its triangles to meshlet_triangles as three local indices into those.
+        // Meshlets grow over shared edges, preferring the triangle that adds the fewest new vertices, so
+        // they stay compact and their normal cones narrow. A meshlet that runs out of neighbours is closed
+        // once it is half full, smaller ones continue with the next unused triangle.
+        void build_meshlets(
+            const std::vector<VkeModel::Vertex> &vertices,
+            const uint32_t *indices,
+            size_t index_count,
+            uint32_t max_vertices,
+            uint32_t max_triangles,
+            std::vector<VkeModel::Meshlet> &meshlets,
+            std::vector<uint32_t> &meshlet_vertices,
+            std::vector<uint8_t> &meshlet_triangles
+        );
+
+        // True if every triangle of the meshlet faces away from camera_position, from the meshlet's
+        // bounding sphere and normal cone. Conservative, camera_position must be in model space.
+        bool is_meshlet_backfacing(const VkeModel::Meshlet &meshlet, const glm::vec3 &camera_position);
+    }
+
+#endif
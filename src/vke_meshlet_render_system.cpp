@@ -0,0 +1,345 @@
+#include "vke_meshlet_render_system.hpp"
+#include "vke_cpu_trace.hpp"
+#include "vke_frustum.hpp"
+#include "vke_meshlet.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+
+    // the vertex pipeline only sees the matrices, the same layout as in simple_shader
+    struct MeshletPushConstantData {
+        glm::mat4 model_matrix{1.f};
+        glm::mat4 normal_matrix{1.f};
+    };
+
+    // the layout of meshlet_shader.mesh in the same bytes, the first visible meshlet takes the place of the
+    // normal matrix's last column, which only the vertex pipeline reads
+    struct MeshTaskPushConstantData {
+        glm::mat4 model_matrix{1.f};
+        glm::vec4 normal_columns[3]{};
+        uint32_t first_visible = 0;
+        uint32_t padding[3]{};
+    };
+    // the smallest maxPushConstantsSize vulkan guarantees
+    static_assert(sizeof(MeshletPushConstantData) == 128 && sizeof(MeshTaskPushConstantData) == 128, "push constants must fit in 128 bytes");
+
+    // mesh shader workgroups per vkCmdDrawMeshTasksEXT, the smallest maxMeshWorkGroupCount[0] allowed
+    static constexpr uint32_t MAX_MESH_TASKS_PER_DRAW = 65535;
+
+    VkeMeshletRenderSystem::VkeMeshletRenderSystem(
+        VkeDevice &device,
+        VkRenderPass render_pass,
+        VkDescriptorSetLayout global_set_layout,
+        uint32_t frames_in_flight
+    ) :
+        vke_device{device},
+        meshlet_descriptors{device, frames_in_flight, 64, {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5.f}}},
+        frames(frames_in_flight)
+    {
+        if (vke_device.supportsMeshShaders()) {
+            meshlet_set_layout = VkeDescriptorSetLayout::Builder(vke_device)
+                .add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT)
+                .add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT)
+                .add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT)
+                .add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT)
+                .add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT)
+                .build();
+        }
+        create_pipeline_layouts(global_set_layout);
+        create_pipelines(render_pass);
+    }
+
+    VkeMeshletRenderSystem::~VkeMeshletRenderSystem() {
+        vkDestroyPipelineLayout(vke_device.device(), vertex_pipeline_layout, nullptr);
+        if (mesh_pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(vke_device.device(), mesh_pipeline_layout, nullptr);
+        }
+    }
+
+    void VkeMeshletRenderSystem::create_pipeline_layouts(VkDescriptorSetLayout global_set_layout) {
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        push_constant_range.offset = 0;
+        push_constant_range.size = sizeof(MeshletPushConstantData);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info{};
+        pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount = 1;
+        pipeline_layout_info.pSetLayouts = &global_set_layout;
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+        if (vkCreatePipelineLayout(vke_device.device(), &pipeline_layout_info, nullptr, &vertex_pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout");
+        }
+
+        if (!meshlet_set_layout) {
+            return;
+        }
+
+        push_constant_range.stageFlags = VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        push_constant_range.size = sizeof(MeshTaskPushConstantData);
+        std::vector<VkDescriptorSetLayout> descriptor_set_layouts{global_set_layout, meshlet_set_layout->get_descriptor_set_layout()};
+        pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
+        pipeline_layout_info.pSetLayouts = descriptor_set_layouts.data();
+
+        if (vkCreatePipelineLayout(vke_device.device(), &pipeline_layout_info, nullptr, &mesh_pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout");
+        }
+    }
+
+    void VkeMeshletRenderSystem::create_pipelines(VkRenderPass render_pass) {
+        assert(vertex_pipeline_layout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        PipelineConfigInfo pipeline_config{};
+        VkePipeline::defaultPipelineConfigInfo(pipeline_config);
+
+        pipeline_config.render_pass = render_pass;
+        pipeline_config.pipeline_layout = vertex_pipeline_layout;
+        vertex_pipeline = std::make_unique<VkePipeline>(
+            vke_device,
+            "../shaders/simple_shader.vert.spv",
+            "../shaders/simple_shader.frag.spv",
+            pipeline_config
+        );
+
+        if (mesh_pipeline_layout == VK_NULL_HANDLE) {
+            return;
+        }
+
+        pipeline_config.pipeline_layout = mesh_pipeline_layout;
+        pipeline_config.mesh_shader = true;
+        mesh_pipeline = std::make_unique<VkePipeline>(
+            vke_device,
+            "../shaders/meshlet_shader.mesh.spv",
+            "../shaders/simple_shader.frag.spv",
+            pipeline_config
+        );
+    }
+
+    void VkeMeshletRenderSystem::reserve(FrameData &frame, uint32_t meshlet_count) {
+        if (frame.draw_commands && frame.draw_commands->get_instance_count() >= meshlet_count) {
+            return;
+        }
+
+        // the visible meshlet count changes with the camera, the slack keeps small changes from reallocating
+        uint32_t capacity = std::max(meshlet_count + meshlet_count / 2, 256u);
+        frame.draw_commands = std::make_unique<VkeBuffer>(
+            vke_device,
+            sizeof(VkDrawIndexedIndirectCommand),
+            capacity,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        frame.draw_commands->map();
+
+        if (mesh_pipeline) {
+            frame.visible_ids = std::make_unique<VkeBuffer>(
+                vke_device,
+                sizeof(uint32_t),
+                capacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            frame.visible_ids->map();
+        }
+    }
+
+    void VkeMeshletRenderSystem::render_game_objects(FrameInfo frame_info) {
+        VKE_CPU_SCOPE("render_game_objects");
+        VkeGpuScope gpu_scope{frame_info.profiler, frame_info.command_buffer, "render_game_objects"};
+
+        draw_count = 0;
+        triangle_count = 0;
+        visible_meshlets = 0;
+        frustum_culled_meshlets = 0;
+        cone_culled_meshlets = 0;
+        object_draws.clear();
+
+        auto &frame = frames[frame_info.frame_index];
+        uint32_t meshlet_count = 0;
+        for (auto &kv : frame_info.game_objects) {
+            if (kv.second.model) {
+                meshlet_count += static_cast<uint32_t>(kv.second.model->get_meshlets().size());
+            }
+        }
+        reserve(frame, meshlet_count);
+        auto *draw_commands = static_cast<VkDrawIndexedIndirectCommand*>(frame.draw_commands->get_mapped_memory());
+        auto *visible_ids = frame.visible_ids ? static_cast<uint32_t*>(frame.visible_ids->get_mapped_memory()) : nullptr;
+
+        // culling happens in model space, where the bounds and cones of the meshlets are
+        {
+            VKE_CPU_SCOPE("cull_meshlets");
+            const glm::mat4 projection_view = frame_info.camera.get_projection() * frame_info.camera.get_view();
+            const glm::vec4 camera_position{frame_info.camera.get_position(), 1.f};
+            for (auto &kv : frame_info.game_objects) {
+                auto &obj = kv.second;
+                if (obj.model == nullptr) continue;
+                if (!obj.model->has_meshlets()) {
+                    object_draws.push_back({&obj, 0, 0});
+                    triangle_count += obj.model->get_triangle_count();
+                    continue;
+                }
+
+                glm::mat4 model_matrix = obj.transform.mat4();
+                VkeFrustum frustum{projection_view * model_matrix};
+                glm::vec3 camera_in_model{glm::inverse(model_matrix) * camera_position};
+                bool mesh_tasks = mesh_pipeline && obj.model->has_meshlet_buffers();
+                uint32_t first_index = obj.model->get_meshlet_first_index();
+
+                const auto &meshlets = obj.model->get_meshlets();
+                uint32_t first = visible_meshlets;
+                for (uint32_t i = 0; i < meshlets.size(); i++) {
+                    const auto &meshlet = meshlets[i];
+                    if (!frustum.intersects_sphere(meshlet.center, meshlet.radius)) {
+                        frustum_culled_meshlets++;
+                        continue;
+                    }
+                    if (cone_culling && is_meshlet_backfacing(meshlet, camera_in_model)) {
+                        cone_culled_meshlets++;
+                        continue;
+                    }
+
+                    if (mesh_tasks) {
+                        visible_ids[visible_meshlets] = i;
+                    } else {
+                        draw_commands[visible_meshlets] = {meshlet.triangle_count * 3, 1, first_index + meshlet.triangle_offset * 3, 0, 0};
+                    }
+                    visible_meshlets++;
+                    triangle_count += meshlet.triangle_count;
+                }
+                if (visible_meshlets > first) {
+                    object_draws.push_back({&obj, first, visible_meshlets - first});
+                }
+            }
+        }
+
+        vertex_pipeline->bind(frame_info.command_buffer);
+        vkCmdBindDescriptorSets(
+            frame_info.command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            vertex_pipeline_layout,
+            0, 1,
+            &frame_info.global_descriptor_set,
+            0,
+            nullptr
+        );
+        for (const auto &draw : object_draws) {
+            if (draw.count > 0 && mesh_pipeline && draw.object->model->has_meshlet_buffers()) continue;
+            MeshletPushConstantData push{};
+            push.model_matrix = draw.object->transform.mat4();
+            push.normal_matrix = draw.object->transform.normal_matrix();
+            vkCmdPushConstants(
+                frame_info.command_buffer,
+                vertex_pipeline_layout,
+                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                0,
+                sizeof(MeshletPushConstantData),
+                &push
+            );
+            draw.object->model->bind(frame_info.command_buffer);
+            if (draw.count == 0) {
+                draw.object->model->draw(frame_info.command_buffer);
+                draw_count++;
+            } else {
+                draw_indirect(frame_info, frame, draw);
+            }
+        }
+
+        if (!mesh_pipeline) {
+            return;
+        }
+
+        meshlet_descriptors.begin_frame(frame_info.frame_index);
+        mesh_pipeline->bind(frame_info.command_buffer);
+        vkCmdBindDescriptorSets(
+            frame_info.command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            mesh_pipeline_layout,
+            0, 1,
+            &frame_info.global_descriptor_set,
+            0,
+            nullptr
+        );
+        for (const auto &draw : object_draws) {
+            if (draw.count > 0 && draw.object->model->has_meshlet_buffers()) {
+                draw_mesh_tasks(frame_info, frame, draw);
+            }
+        }
+    }
+
+    void VkeMeshletRenderSystem::draw_indirect(FrameInfo &frame_info, FrameData &frame, const ObjectDraw &draw) {
+        const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (!vke_device.supportsMultiDrawIndirect()) {
+            for (uint32_t i = 0; i < draw.count; i++) {
+                vkCmdDrawIndexedIndirect(frame_info.command_buffer, frame.draw_commands->get_buffer(), (draw.first + i) * stride, 1, stride);
+                draw_count++;
+            }
+            return;
+        }
+
+        const uint32_t max_draws = std::max(vke_device.properties.limits.maxDrawIndirectCount, 1u);
+        for (uint32_t offset = 0; offset < draw.count; offset += max_draws) {
+            vkCmdDrawIndexedIndirect(
+                frame_info.command_buffer,
+                frame.draw_commands->get_buffer(),
+                (draw.first + offset) * stride,
+                std::min(draw.count - offset, max_draws),
+                static_cast<uint32_t>(stride)
+            );
+            draw_count++;
+        }
+    }
+
+    void VkeMeshletRenderSystem::draw_mesh_tasks(FrameInfo &frame_info, FrameData &frame, const ObjectDraw &draw) {
+        auto buffer_infos = draw.object->model->get_meshlet_buffer_infos();
+        auto visible_info = frame.visible_ids->descriptor_info();
+        VkDescriptorSet meshlet_set;
+        if (!VkeDescriptorWriter(*meshlet_set_layout, meshlet_descriptors.get_allocator())
+                .write_buffer(0, &buffer_infos[0])
+                .write_buffer(1, &buffer_infos[1])
+                .write_buffer(2, &buffer_infos[2])
+                .write_buffer(3, &buffer_infos[3])
+                .write_buffer(4, &visible_info)
+                .build(meshlet_set)) {
+            throw std::runtime_error("failed to allocate meshlet descriptor set");
+        }
+        vkCmdBindDescriptorSets(
+            frame_info.command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            mesh_pipeline_layout,
+            1, 1,
+            &meshlet_set,
+            0,
+            nullptr
+        );
+
+        MeshTaskPushConstantData push{};
+        push.model_matrix = draw.object->transform.mat4();
+        glm::mat4 normal_matrix = draw.object->transform.normal_matrix();
+        for (int column = 0; column < 3; column++) {
+            push.normal_columns[column] = normal_matrix[column];
+        }
+        for (uint32_t offset = 0; offset < draw.count; offset += MAX_MESH_TASKS_PER_DRAW) {
+            push.first_visible = draw.first + offset;
+            vkCmdPushConstants(
+                frame_info.command_buffer,
+                mesh_pipeline_layout,
+                VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                0,
+                sizeof(MeshTaskPushConstantData),
+                &push
+            );
+            vke_device.cmdDrawMeshTasks(frame_info.command_buffer, std::min(draw.count - offset, MAX_MESH_TASKS_PER_DRAW), 1, 1);
+            draw_count++;
+        }
+    }
+}
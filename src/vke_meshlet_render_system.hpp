@@ -0,0 +1,93 @@
+#ifndef vke_meshlet_render_system_
+    #define vke_meshlet_render_system_
+
+    #include "vke_pipeline.hpp"
+    #include "vke_device.hpp"
+    #include "vke_buffer.hpp"
+    #include "vke_descriptors.hpp"
+    #include "vke_descriptor_allocator.hpp"
+    #include "vke_frame_info.hpp"
+
+    // std
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+        // Renders models with meshlets cluster by cluster. Every frame the meshlets of each object are
+        // culled on the cpu against the view frustum and, unless disabled, by their normal cones, both in
+        // model space. With VK_EXT_mesh_shader the visible meshlet ids are written to a buffer and each one
+        // becomes a mesh shader workgroup, otherwise their index ranges are drawn from an indirect buffer.
+        // Models without meshlets are drawn whole like in VkeSimpleRenderSystem.
+        class VkeMeshletRenderSystem {
+            public:
+            VkeMeshletRenderSystem(
+                VkeDevice &device,
+                VkRenderPass render_pass,
+                VkDescriptorSetLayout global_set_layout,
+                uint32_t frames_in_flight
+            );
+            ~VkeMeshletRenderSystem();
+
+            VkeMeshletRenderSystem(const VkeMeshletRenderSystem&) = delete;
+            VkeMeshletRenderSystem& operator=(const VkeMeshletRenderSystem&) = delete;
+
+            void render_game_objects(FrameInfo frame_info);
+
+            // cone culling drops clusters that face away from the camera, which is only right for closed
+            // meshes since the pipeline itself does not cull back faces, so it is off by default
+            void set_cone_culling(bool enabled) { cone_culling = enabled; }
+            bool uses_mesh_shaders() const { return mesh_pipeline != nullptr; }
+
+            // statistics of the last render_game_objects call
+            uint32_t get_draw_count() const { return draw_count; }
+            uint64_t get_triangle_count() const { return triangle_count; }
+            uint32_t get_visible_meshlets() const { return visible_meshlets; }
+            uint32_t get_frustum_culled_meshlets() const { return frustum_culled_meshlets; }
+            uint32_t get_cone_culled_meshlets() const { return cone_culled_meshlets; }
+
+            private:
+            struct FrameData {
+                // indexed draws without mesh shaders, visible meshlet ids with them
+                std::unique_ptr<VkeBuffer> draw_commands;
+                std::unique_ptr<VkeBuffer> visible_ids;
+            };
+
+            // one object's visible meshlets in the frame buffers
+            struct ObjectDraw {
+                VkeGameObject *object;
+                uint32_t first;
+                uint32_t count;
+            };
+
+            void create_pipeline_layouts(VkDescriptorSetLayout global_set_layout);
+            void create_pipelines(VkRenderPass render_pass);
+            // grows the frame's buffers, the frame slot is not in flight when this is called
+            void reserve(FrameData &frame, uint32_t meshlet_count);
+            void draw_indirect(FrameInfo &frame_info, FrameData &frame, const ObjectDraw &draw);
+            void draw_mesh_tasks(FrameInfo &frame_info, FrameData &frame, const ObjectDraw &draw);
+
+            VkeDevice &vke_device;
+
+            std::unique_ptr<VkePipeline> vertex_pipeline;
+            VkPipelineLayout vertex_pipeline_layout;
+
+            // only with mesh shader support
+            std::unique_ptr<VkePipeline> mesh_pipeline;
+            VkPipelineLayout mesh_pipeline_layout = VK_NULL_HANDLE;
+            std::unique_ptr<VkeDescriptorSetLayout> meshlet_set_layout;
+            VkeFrameDescriptorAllocator meshlet_descriptors;
+
+            std::vector<FrameData> frames;
+            std::vector<ObjectDraw> object_draws{};
+
+            bool cone_culling = false;
+
+            uint32_t draw_count = 0;
+            uint64_t triangle_count = 0;
+            uint32_t visible_meshlets = 0;
+            uint32_t frustum_culled_meshlets = 0;
+            uint32_t cone_culled_meshlets = 0;
+        };
+    }
+
+#endif
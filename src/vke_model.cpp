@@ -1,44 +1,67 @@
 #include "vke_model.hpp"
-#include "vke_utils.hpp"
+#include "vke_mesh_lod.hpp"
+#include "vke_meshlet.hpp"
 
 //libs
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tinyobjloader.h>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
 //std
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <limits>
 #include <vulkan/vulkan_core.h>
 #include <unordered_map>
 
-namespace std {
-    template <>
-    struct hash<vke::VkeModel::Vertex> {
-        size_t operator()(vke::VkeModel::Vertex const &vertex) const {
-            size_t seed = 0;
-            vke::hash_combine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-}
-
 namespace vke {
+    static_assert(sizeof(VkeModel::Meshlet) == 48, "Meshlet must match the std430 layout in meshlet_shader.mesh");
+
     VkeModel::VkeModel(VkeDevice &device, const VkeModel::Data &data) :
         vke_device(device)
     {
-        create_vertex_buffers(data.vertices);
-        create_index_buffers(data.indices);
+        create_buffers(data, nullptr);
+    }
+
+    VkeModel::VkeModel(VkeDevice &device, const VkeModel::Data &data, std::vector<BufferUpload> &uploads) :
+        vke_device(device)
+    {
+        create_buffers(data, &uploads);
+    }
+
+    void VkeModel::create_buffers(const Data &data, std::vector<BufferUpload> *uploads) {
+        // the mesh shader reads the vertices as a storage buffer
+        bool meshlet_buffers = !data.meshlets.empty() && vke_device.supportsMeshShaders();
+        create_vertex_buffers(data.vertices, meshlet_buffers ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0, uploads);
+        if (!data.positions.empty()) {
+            create_position_buffer(data.positions, uploads);
+        }
+        create_index_buffers(data.indices, uploads);
+        compute_bounds(data.vertices);
+
+        meshlets = data.meshlets;
+        meshlet_first_index = data.meshlet_first_index;
+        if (meshlet_buffers) {
+            create_meshlet_buffers(data, uploads);
+        }
+
+        // all levels share the vertex buffer and live in the one index buffer
+        lods = data.lods;
+        if (lods.empty()) {
+            // the meshlet indices are not part of the mesh
+            lods.push_back({0, data.meshlets.empty() ? index_count : data.meshlet_first_index, 0.f});
+        }
     }
             
     VkeModel::~VkeModel() {}
 
-    std::unique_ptr<VkeModel> VkeModel::create_model_from_file(VkeDevice &device, const std::string &filepath) {
+    std::unique_ptr<VkeModel> VkeModel::create_model_from_file(VkeDevice &device, const std::string &filepath, bool with_meshlets) {
         Data data{};
         data.load_model(filepath);
+        data.build_lods();
+        if (with_meshlets) {
+            data.build_meshlets();
+        }
 
         // std::cout << "[i] Vertex Count " << data.vertices.size() << "\n";
 
@@ -46,40 +69,35 @@ namespace vke {
     }
 
 
-    void VkeModel::create_vertex_buffers(const std::vector<Vertex> &vertices) {
+    void VkeModel::create_vertex_buffers(const std::vector<Vertex> &vertices, VkBufferUsageFlags extra_usage, std::vector<BufferUpload> *uploads) {
         vertex_count = static_cast<uint32_t>(vertices.size());
         
         // there must exist at least 3 vertices
         assert(vertex_count >= 3 && "The vertex count is less than 3");
 
-        VkDeviceSize buffer_size = sizeof(vertices[0]) * vertex_count;
-        // host: cpu, device: gpu
-
-        uint32_t vertex_size = sizeof(vertices[0]);
-        VkeBuffer staging_buffer {
-            vke_device,
-            vertex_size,
+        vertex_buffer = create_device_buffer(
+            vertices.data(),
+            sizeof(vertices[0]) * vertex_count,
+            sizeof(vertices[0]),
             vertex_count,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-
-        };
-
-        staging_buffer.map();
-        staging_buffer.write_to_buffer((void *) vertices.data());
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extra_usage,
+            uploads
+        );
+    }
 
-        vertex_buffer = std::make_unique<VkeBuffer>(
-            vke_device,
-            vertex_size,
+    void VkeModel::create_position_buffer(const std::vector<glm::vec3> &positions, std::vector<BufferUpload> *uploads) {
+        assert(positions.size() == vertex_count && "Positions do not match the vertices");
+        position_buffer = create_device_buffer(
+            positions.data(),
+            sizeof(positions[0]) * vertex_count,
+            sizeof(positions[0]),
             vertex_count,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            uploads
         );
-
-        vke_device.copyBuffer(staging_buffer.get_buffer(), vertex_buffer->get_buffer(), buffer_size);
     }
 
-    void VkeModel::create_index_buffers(const std::vector<uint32_t> &indices) {
+    void VkeModel::create_index_buffers(const std::vector<uint32_t> &indices, std::vector<BufferUpload> *uploads) {
         index_count = static_cast<uint32_t>(indices.size());
         has_index_buffer = index_count > 0;
 
@@ -87,34 +105,108 @@ namespace vke {
             return;
         }
 
-        VkDeviceSize buffer_size = sizeof(indices[0]) * index_count;
-        uint32_t index_size = sizeof(indices[0]);
+        index_buffer = create_device_buffer(
+            indices.data(),
+            sizeof(indices[0]) * index_count,
+            sizeof(indices[0]),
+            index_count,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            uploads
+        );
+    }
+
+    std::unique_ptr<VkeBuffer> VkeModel::create_device_buffer(
+        const void *data,
+        VkDeviceSize size,
+        uint32_t instance_size,
+        uint32_t instance_count,
+        VkBufferUsageFlags usage,
+        std::vector<BufferUpload> *uploads
+    ) {
+        // host: cpu, device: gpu
+        auto buffer = std::make_unique<VkeBuffer>(
+            vke_device,
+            instance_size,
+            instance_count,
+            usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+        if (uploads) {
+            uploads->push_back({buffer->get_buffer(), data, size});
+            return buffer;
+        }
 
         VkeBuffer staging_buffer {
             vke_device,
-            index_size,
-            index_count,
+            instance_size,
+            instance_count,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
         };
-
         staging_buffer.map();
-        staging_buffer.write_to_buffer((void *) indices.data());
-        
-        index_buffer = std::make_unique<VkeBuffer>(
-            vke_device,
-            index_size,
-            index_count,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        staging_buffer.write_to_buffer(const_cast<void *>(data), size);
+
+        vke_device.copyBuffer(staging_buffer.get_buffer(), buffer->get_buffer(), size);
+        return buffer;
+    }
+
+    void VkeModel::create_meshlet_buffers(const Data &data, std::vector<BufferUpload> *uploads) {
+        meshlet_buffer = create_device_buffer(
+            data.meshlets.data(),
+            sizeof(Meshlet) * data.meshlets.size(),
+            sizeof(Meshlet),
+            static_cast<uint32_t>(data.meshlets.size()),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            uploads
+        );
+        meshlet_vertex_buffer = create_device_buffer(
+            data.meshlet_vertices.data(),
+            sizeof(uint32_t) * data.meshlet_vertices.size(),
+            sizeof(uint32_t),
+            static_cast<uint32_t>(data.meshlet_vertices.size()),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            uploads
         );
+        // the shader reads the local indices as words, the bytes after the last triangle are never used
+        meshlet_triangle_buffer = create_device_buffer(
+            data.meshlet_triangles.data(),
+            data.meshlet_triangles.size(),
+            sizeof(uint32_t),
+            static_cast<uint32_t>((data.meshlet_triangles.size() + 3) / 4),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            uploads
+        );
+    }
 
-        vke_device.copyBuffer(staging_buffer.get_buffer(), index_buffer->get_buffer(), buffer_size);
+    std::array<VkDescriptorBufferInfo, 4> VkeModel::get_meshlet_buffer_infos() const {
+        assert(has_meshlet_buffers() && "model has no meshlet buffers");
+        return {
+            vertex_buffer->descriptor_info(),
+            meshlet_buffer->descriptor_info(),
+            meshlet_vertex_buffer->descriptor_info(),
+            meshlet_triangle_buffer->descriptor_info()
+        };
     }
 
-    void VkeModel::draw(VkCommandBuffer command_buffer) {
+    void VkeModel::compute_bounds(const std::vector<Vertex> &vertices) {
+        glm::vec3 min_position{std::numeric_limits<float>::max()};
+        glm::vec3 max_position{std::numeric_limits<float>::lowest()};
+        for (const auto &vertex : vertices) {
+            min_position = glm::min(min_position, vertex.position);
+            max_position = glm::max(max_position, vertex.position);
+        }
+
+        // centered on the box, the radius reaches the farthest vertex
+        bounding_center = (min_position + max_position) * .5f;
+        bounding_radius = 0.f;
+        for (const auto &vertex : vertices) {
+            bounding_radius = glm::max(bounding_radius, glm::length(vertex.position - bounding_center));
+        }
+    }
+
+    void VkeModel::draw(VkCommandBuffer command_buffer, uint32_t lod) {
         if(has_index_buffer) {
-            vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
+            vkCmdDrawIndexed(command_buffer, lods[lod].index_count, 1, lods[lod].first_index, 0, 0);
         } else {
             // 1 instance, 0 first vertex index, 0 first instance index
             vkCmdDraw(command_buffer, vertex_count, 1, 0, 0);
@@ -132,6 +224,46 @@ namespace vke {
         }
     }
 
+    void VkeModel::bind_positions(VkCommandBuffer command_buffer) {
+        assert(has_position_buffer() && "model has no position buffer");
+        VkBuffer buffers[] = {position_buffer->get_buffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+
+        if(has_index_buffer) {
+            vkCmdBindIndexBuffer(command_buffer, index_buffer->get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        }
+    }
+
+    void VkeModel::bind(VkeCommandRecorder &recorder) {
+        VkBuffer buffers[] = {vertex_buffer->get_buffer()};
+        VkDeviceSize offsets[] = {0};
+        recorder.bind_vertex_buffers(0, 1, buffers, offsets);
+
+        if(has_index_buffer) {
+            recorder.bind_index_buffer(index_buffer->get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        }
+    }
+
+    void VkeModel::bind_positions(VkeCommandRecorder &recorder) {
+        assert(has_position_buffer() && "model has no position buffer");
+        VkBuffer buffers[] = {position_buffer->get_buffer()};
+        VkDeviceSize offsets[] = {0};
+        recorder.bind_vertex_buffers(0, 1, buffers, offsets);
+
+        if(has_index_buffer) {
+            recorder.bind_index_buffer(index_buffer->get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        }
+    }
+
+    void VkeModel::draw(VkeCommandRecorder &recorder, uint32_t lod) {
+        if(has_index_buffer) {
+            recorder.draw_indexed(lods[lod].index_count, 1, lods[lod].first_index, 0, 0);
+        } else {
+            recorder.draw(vertex_count, 1, 0, 0);
+        }
+    }
+
     std::vector<VkVertexInputBindingDescription> VkeModel::Vertex::get_binding_descriptions() {
         std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
         binding_descriptions[0].binding = 0;
@@ -153,6 +285,18 @@ namespace vke {
         return attribute_descriptions;
     }
 
+    std::vector<VkVertexInputBindingDescription> VkeModel::Vertex::get_position_binding_descriptions() {
+        std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
+        binding_descriptions[0].binding = 0;
+        binding_descriptions[0].stride = sizeof(glm::vec3);
+        binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return binding_descriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> VkeModel::Vertex::get_position_attribute_descriptions() {
+        return {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+    }
+
 
     void VkeModel::Data::load_model(const std::string &filepath) {
         tinyobj::attrib_t attrib;
@@ -213,4 +357,70 @@ namespace vke {
         }
     }
 
-}
+    void VkeModel::Data::build_lods(uint32_t max_levels, float reduction) {
+        lods.clear();
+        if (indices.empty()) {
+            return;
+        }
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.f});
+
+        VkeMeshSimplifier simplifier{vertices, indices};
+        size_t previous_triangles = simplifier.get_triangle_count();
+        for (uint32_t level = 1; level < max_levels; level++) {
+            size_t target = static_cast<size_t>(previous_triangles * reduction);
+            if (target < MIN_LOD_TRIANGLES) {
+                break;
+            }
+            simplifier.simplify(target);
+
+            // a level that barely saves triangles is not worth switching to
+            size_t triangles = simplifier.get_triangle_count();
+            if (triangles > previous_triangles * (1.f + reduction) * .5f) {
+                break;
+            }
+
+            std::vector<uint32_t> lod_indices = simplifier.get_indices();
+            lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod_indices.size()), simplifier.get_error()});
+            indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+            previous_triangles = triangles;
+        }
+    }
+
+    void VkeModel::Data::build_positions() {
+        positions.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].position;
+        }
+    }
+
+    void VkeModel::Data::build_meshlets(uint32_t max_vertices, uint32_t max_triangles) {
+        meshlets.clear();
+        meshlet_vertices.clear();
+        meshlet_triangles.clear();
+        if (indices.empty()) {
+            return;
+        }
+
+        uint32_t first_index = lods.empty() ? 0 : lods[0].first_index;
+        uint32_t index_count = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].index_count;
+        vke::build_meshlets(
+            vertices,
+            indices.data() + first_index,
+            index_count,
+            max_vertices,
+            max_triangles,
+            meshlets,
+            meshlet_vertices,
+            meshlet_triangles
+        );
+
+        // without mesh shaders each visible meshlet is an indexed draw of its own range
+        meshlet_first_index = static_cast<uint32_t>(indices.size());
+        indices.reserve(indices.size() + meshlet_triangles.size());
+        for (const auto &meshlet : meshlets) {
+            for (uint32_t i = 0; i < meshlet.triangle_count * 3; i++) {
+                indices.push_back(meshlet_vertices[meshlet.vertex_offset + meshlet_triangles[meshlet.triangle_offset * 3 + i]]);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -3,11 +3,18 @@
 
 #include "vke_device.hpp"
 #include "vke_buffer.hpp"
+#include "vke_command_recorder.hpp"
+#include "vke_utils.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#ifndef GLM_ENABLE_EXPERIMENTAL
+    #define GLM_ENABLE_EXPERIMENTAL
+#endif
+#include <glm/gtx/hash.hpp>
 
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -23,41 +30,168 @@ namespace vke {
 
                 static std::vector<VkVertexInputBindingDescription> get_binding_descriptions();
                 static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions();
+                // the separate position stream of bind_positions, for depth only pipelines
+                static std::vector<VkVertexInputBindingDescription> get_position_binding_descriptions();
+                static std::vector<VkVertexInputAttributeDescription> get_position_attribute_descriptions();
 
                 bool operator==(const Vertex &other) const {
                     return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
                 }
             };
 
+            // index range of one level of detail, error is the simplification error in model units
+            struct Lod {
+                uint32_t first_index;
+                uint32_t index_count;
+                float error;
+            };
+
+            // cluster of at most MAX_MESHLET_VERTICES vertices and MAX_MESHLET_TRIANGLES triangles, the first
+            // four members and the layout match Meshlet in meshlet_shader.mesh (std430)
+            struct Meshlet {
+                uint32_t vertex_offset = 0;
+                uint32_t vertex_count = 0;
+                // in triangles, meshlet_triangles holds three bytes per triangle
+                uint32_t triangle_offset = 0;
+                uint32_t triangle_count = 0;
+                // bounding sphere in model space
+                glm::vec3 center{0.f};
+                float radius = 0.f;
+                // all triangle normals are within the cone, a cutoff of 1 disables cone culling
+                glm::vec3 cone_axis{0.f, 0.f, 1.f};
+                float cone_cutoff = 1.f;
+            };
+
+            // the limits of meshlet_shader.mesh, 124 keeps the primitive indices of a meshlet under 128 words
+            static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+            static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
             struct Data {
+                // build_lods does not go below this
+                static constexpr size_t MIN_LOD_TRIANGLES = 32;
+
                 std::vector<Vertex> vertices{};
                 std::vector<uint32_t> indices{};
+                // empty, or lods[0] is the full mesh and the simplified levels follow it in indices
+                std::vector<Lod> lods{};
+
+                // the vertex positions tightly packed for the depth pre-pass, empty unless build_positions
+                // was called
+                std::vector<glm::vec3> positions{};
+
+                // meshlets of lod 0, empty unless build_meshlets was called
+                std::vector<Meshlet> meshlets{};
+                std::vector<uint32_t> meshlet_vertices{};
+                std::vector<uint8_t> meshlet_triangles{};
+                // the meshlet triangles again as indices into vertices, appended to indices in meshlet order
+                uint32_t meshlet_first_index = 0;
 
                 void load_model(const std::string &filepath);
+                // appends up to max_levels - 1 simplified index lists, each with about reduction times the
+                // triangles of the previous one, stops early once simplification stalls
+                void build_lods(uint32_t max_levels = 6, float reduction = .5f);
+                // gathers the positions out of vertices, the model then gets a buffer for bind_positions
+                void build_positions();
+                // splits lod 0 into meshlets, see vke_meshlet.hpp
+                void build_meshlets(uint32_t max_vertices = MAX_MESHLET_VERTICES, uint32_t max_triangles = MAX_MESHLET_TRIANGLES);
+            };
+
+            // copy of data into a device local buffer of the model, see the deferred constructor
+            struct BufferUpload {
+                VkBuffer buffer;
+                const void *data;
+                VkDeviceSize size;
             };
 
             VkeModel(VkeDevice &device, const VkeModel::Data &model);
+            // creates the buffers without filling them, the copies into them are appended to uploads and must
+            // be recorded, followed by a barrier, before the model is drawn; model has to outlive the copies
+            VkeModel(VkeDevice &device, const VkeModel::Data &model, std::vector<BufferUpload> &uploads);
             ~VkeModel();
             VkeModel(const VkeModel&) = delete;
             VkeModel& operator=(const VkeModel&) = delete;
 
-            static std::unique_ptr<VkeModel> create_model_from_file(VkeDevice &device, const std::string &filepath);
+            static std::unique_ptr<VkeModel> create_model_from_file(VkeDevice &device, const std::string &filepath, bool with_meshlets = false);
 
             void bind(VkCommandBuffer command_buffer);
-            void draw(VkCommandBuffer command_buffer);
+            // binds the tightly packed positions and the index buffer, draw works the same after it; only
+            // for models made from data with positions, see has_position_buffer
+            void bind_positions(VkCommandBuffer command_buffer);
+            void draw(VkCommandBuffer command_buffer, uint32_t lod = 0);
+            // the same through a recorder, binds of buffers that are bound already are dropped
+            void bind(VkeCommandRecorder &recorder);
+            void bind_positions(VkeCommandRecorder &recorder);
+            void draw(VkeCommandRecorder &recorder, uint32_t lod = 0);
+            bool has_position_buffer() const { return position_buffer != nullptr; }
+
+            uint32_t get_triangle_count(uint32_t lod = 0) const { return (has_index_buffer ? lods[lod].index_count : vertex_count) / 3; }
+            uint32_t get_lod_count() const { return has_index_buffer ? static_cast<uint32_t>(lods.size()) : 1; }
+            float get_lod_error(uint32_t lod) const { return has_index_buffer ? lods[lod].error : 0.f; }
+
+            bool has_meshlets() const { return !meshlets.empty(); }
+            const std::vector<Meshlet> &get_meshlets() const { return meshlets; }
+            // first index of meshlet i in the bound index buffer is this plus meshlets[i].triangle_offset * 3
+            uint32_t get_meshlet_first_index() const { return meshlet_first_index; }
+            // vertices, meshlets, meshlet vertices and meshlet triangles as storage buffers in the binding order
+            // of meshlet_shader.mesh, only created on devices with mesh shader support
+            bool has_meshlet_buffers() const { return meshlet_buffer != nullptr; }
+            std::array<VkDescriptorBufferInfo, 4> get_meshlet_buffer_infos() const;
+
+            // bounding sphere of the vertices in model space
+            glm::vec3 get_bounding_center() const { return bounding_center; }
+            float get_bounding_radius() const { return bounding_radius; }
 
         private:
-            void create_vertex_buffers(const std::vector<Vertex> &vertices);
-            void create_index_buffers(const std::vector<uint32_t> &indices);
+            // uploads is null for models filled right away
+            void create_buffers(const Data &data, std::vector<BufferUpload> *uploads);
+            void create_vertex_buffers(const std::vector<Vertex> &vertices, VkBufferUsageFlags extra_usage, std::vector<BufferUpload> *uploads);
+            void create_position_buffer(const std::vector<glm::vec3> &positions, std::vector<BufferUpload> *uploads);
+            void create_index_buffers(const std::vector<uint32_t> &indices, std::vector<BufferUpload> *uploads);
+            void create_meshlet_buffers(const Data &data, std::vector<BufferUpload> *uploads);
+            // device local buffer, filled through a staging buffer unless the copy is deferred to uploads
+            std::unique_ptr<VkeBuffer> create_device_buffer(
+                const void *data,
+                VkDeviceSize size,
+                uint32_t instance_size,
+                uint32_t instance_count,
+                VkBufferUsageFlags usage,
+                std::vector<BufferUpload> *uploads
+            );
+            void compute_bounds(const std::vector<Vertex> &vertices);
 
             VkeDevice& vke_device;
             
             std::unique_ptr<VkeBuffer> vertex_buffer;
             uint32_t vertex_count;
+            // only the positions, fetching 12 instead of 44 bytes per vertex in the depth pre-pass, null
+            // unless the data had them
+            std::unique_ptr<VkeBuffer> position_buffer;
 
             bool has_index_buffer{false};
             std::unique_ptr<VkeBuffer> index_buffer;
             uint32_t index_count;
+            std::vector<Lod> lods{};
+
+            std::vector<Meshlet> meshlets{};
+            uint32_t meshlet_first_index = 0;
+            std::unique_ptr<VkeBuffer> meshlet_buffer;
+            std::unique_ptr<VkeBuffer> meshlet_vertex_buffer;
+            std::unique_ptr<VkeBuffer> meshlet_triangle_buffer;
+
+            glm::vec3 bounding_center{0.f};
+            float bounding_radius = 0.f;
+    };
+}
+
+// in the header so the vertex deduplication can be benchmarked and reused outside of load_model
+namespace std {
+    template <>
+    struct hash<vke::VkeModel::Vertex> {
+        size_t operator()(vke::VkeModel::Vertex const &vertex) const {
+            size_t seed = 0;
+            vke::hash_combine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+            return seed;
+        }
     };
 }
 
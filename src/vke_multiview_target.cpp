@@ -0,0 +1,247 @@
+#include "vke_multiview_target.hpp"
+
+// std
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+
+    VkeMultiviewTarget::VkeMultiviewTarget(VkeDevice &device, VkExtent2D extent, uint32_t layer_count) :
+        vke_device{device},
+        extent{extent},
+        layer_count{layer_count}
+    {
+        depth_format = vke_device.findSupportedFormat(
+            {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        );
+
+        create_images();
+
+        layer_render_pass = create_render_pass(0);
+        for (uint32_t layer = 0; layer < layer_count; layer++) {
+            color_layer_views.push_back(create_view(color_image, COLOR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, layer, 1));
+            depth_layer_views.push_back(create_view(depth_image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, layer, 1));
+            layer_framebuffers.push_back(create_framebuffer(layer_render_pass, color_layer_views.back(), depth_layer_views.back()));
+        }
+
+        if (vke_device.supportsMultiview() && layer_count <= vke_device.getMaxMultiviewViewCount()) {
+            multiview_render_pass = create_render_pass((1u << layer_count) - 1);
+            // the layers come from the view mask, the framebuffer itself has one
+            multiview_framebuffer = create_framebuffer(multiview_render_pass, color_view, depth_view);
+        }
+    }
+
+    VkeMultiviewTarget::~VkeMultiviewTarget() {
+        for (auto framebuffer : layer_framebuffers) {
+            vkDestroyFramebuffer(vke_device.device(), framebuffer, nullptr);
+        }
+        vkDestroyFramebuffer(vke_device.device(), multiview_framebuffer, nullptr);
+        vkDestroyRenderPass(vke_device.device(), layer_render_pass, nullptr);
+        vkDestroyRenderPass(vke_device.device(), multiview_render_pass, nullptr);
+
+        for (uint32_t layer = 0; layer < layer_count; layer++) {
+            vkDestroyImageView(vke_device.device(), color_layer_views[layer], nullptr);
+            vkDestroyImageView(vke_device.device(), depth_layer_views[layer], nullptr);
+        }
+        vkDestroyImageView(vke_device.device(), color_view, nullptr);
+        vkDestroyImageView(vke_device.device(), depth_view, nullptr);
+
+        vkDestroyImage(vke_device.device(), color_image, nullptr);
+        vke_device.freeMemory(color_memory);
+        vkDestroyImage(vke_device.device(), depth_image, nullptr);
+        vke_device.freeMemory(depth_memory);
+    }
+
+    void VkeMultiviewTarget::create_images() {
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent.width = extent.width;
+        image_info.extent.height = extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = layer_count;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        image_info.format = COLOR_FORMAT;
+        image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        vke_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, color_image, color_memory);
+        color_view = create_view(color_image, COLOR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, layer_count);
+
+        image_info.format = depth_format;
+        image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        vke_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image, depth_memory);
+        depth_view = create_view(depth_image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 0, layer_count);
+    }
+
+    VkImageView VkeMultiviewTarget::create_view(
+        VkImage image,
+        VkFormat format,
+        VkImageAspectFlags aspect,
+        uint32_t first_layer,
+        uint32_t count
+    ) {
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        view_info.format = format;
+        view_info.subresourceRange.aspectMask = aspect;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = first_layer;
+        view_info.subresourceRange.layerCount = count;
+
+        VkImageView view;
+        if (vkCreateImageView(vke_device.device(), &view_info, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create multiview image view");
+        }
+        return view;
+    }
+
+    VkRenderPass VkeMultiviewTarget::create_render_pass(uint32_t view_mask) {
+        // same attachments as the swap chain render pass, except that color ends up ready for sampling
+        VkAttachmentDescription color_attachment{};
+        color_attachment.format = COLOR_FORMAT;
+        color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkAttachmentDescription depth_attachment{};
+        depth_attachment.format = depth_format;
+        depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference color_attachment_ref{};
+        color_attachment_ref.attachment = 0;
+        color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depth_attachment_ref{};
+        depth_attachment_ref.attachment = 1;
+        depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &color_attachment_ref;
+        subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        // the previous frame's reads of the color layers and its depth writes come first
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT 
+            | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT 
+            | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = {color_attachment, depth_attachment};
+        VkRenderPassCreateInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        render_pass_info.pAttachments = attachments.data();
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &subpass;
+        render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        render_pass_info.pDependencies = dependencies.data();
+
+        // the views see nearly the same, which the correlation mask lets the driver exploit
+        VkRenderPassMultiviewCreateInfo multiview_info{};
+        multiview_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+        multiview_info.subpassCount = 1;
+        multiview_info.pViewMasks = &view_mask;
+        multiview_info.correlationMaskCount = 1;
+        multiview_info.pCorrelationMasks = &view_mask;
+        if (view_mask != 0) {
+            render_pass_info.pNext = &multiview_info;
+        }
+
+        VkRenderPass render_pass;
+        if (vkCreateRenderPass(vke_device.device(), &render_pass_info, nullptr, &render_pass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create multiview render pass");
+        }
+        return render_pass;
+    }
+
+    VkFramebuffer VkeMultiviewTarget::create_framebuffer(VkRenderPass render_pass, VkImageView color, VkImageView depth) {
+        std::array<VkImageView, 2> attachments = {color, depth};
+
+        VkFramebufferCreateInfo framebuffer_info{};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = render_pass;
+        framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebuffer_info.pAttachments = attachments.data();
+        framebuffer_info.width = extent.width;
+        framebuffer_info.height = extent.height;
+        framebuffer_info.layers = 1;
+
+        VkFramebuffer framebuffer;
+        if (vkCreateFramebuffer(vke_device.device(), &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create multiview framebuffer");
+        }
+        return framebuffer;
+    }
+
+    void VkeMultiviewTarget::begin_multiview_pass(VkCommandBuffer command_buffer) {
+        assert(supports_multiview() && "Cannot begin a multiview pass without multiview support");
+        begin_pass(command_buffer, multiview_render_pass, multiview_framebuffer);
+    }
+
+    void VkeMultiviewTarget::begin_layer_pass(VkCommandBuffer command_buffer, uint32_t layer) {
+        assert(layer < layer_count && "Layer out of range");
+        begin_pass(command_buffer, layer_render_pass, layer_framebuffers[layer]);
+    }
+
+    void VkeMultiviewTarget::begin_pass(VkCommandBuffer command_buffer, VkRenderPass render_pass, VkFramebuffer framebuffer) {
+        VkRenderPassBeginInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        render_pass_info.renderPass = render_pass;
+        render_pass_info.framebuffer = framebuffer;
+        render_pass_info.renderArea.offset = {0, 0};
+        render_pass_info.renderArea.extent = extent;
+
+        std::array<VkClearValue, 2> clear_values{};
+        clear_values[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+        clear_values[1].depthStencil = {1.0f, 0};
+        render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+        render_pass_info.pClearValues = clear_values.data();
+
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.maxDepth = 1.f;
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    }
+
+    void VkeMultiviewTarget::end_pass(VkCommandBuffer command_buffer) {
+        vkCmdEndRenderPass(command_buffer);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef vke_multiview_target_
+    #define vke_multiview_target_
+
+    #include "vke_device.hpp"
+
+    // std
+    #include <vector>
+
+    namespace vke {
+        // Layered color and depth images for views that each render into a layer of their own, the eyes of
+        // a stereo pair for example. The multiview render pass broadcasts every draw to all layers at once,
+        // the shaders tell the views apart by gl_ViewIndex. The layer render pass draws into a single layer,
+        // for devices without multiview and to compare both ways. The color layers end up ready to be
+        // sampled by whatever composes them. Frames in flight share the images, the render pass
+        // dependencies order their writes.
+        class VkeMultiviewTarget {
+            public:
+            static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+            VkeMultiviewTarget(VkeDevice &device, VkExtent2D extent, uint32_t layer_count);
+            ~VkeMultiviewTarget();
+
+            VkeMultiviewTarget(const VkeMultiviewTarget&) = delete;
+            VkeMultiviewTarget& operator=(const VkeMultiviewTarget&) = delete;
+
+            // VK_NULL_HANDLE if the device does not support multiview or that many views
+            VkRenderPass get_multiview_render_pass() const { return multiview_render_pass; }
+            VkRenderPass get_layer_render_pass() const { return layer_render_pass; }
+            bool supports_multiview() const { return multiview_render_pass != VK_NULL_HANDLE; }
+
+            VkExtent2D get_extent() const { return extent; }
+            float get_aspect_ratio() const { return static_cast<float>(extent.width) / static_cast<float>(extent.height); }
+            uint32_t get_layer_count() const { return layer_count; }
+            VkImage get_color_image() const { return color_image; }
+            // all layers, for sampling the result
+            VkImageView get_color_view() const { return color_view; }
+
+            // both begin with viewport and scissor covering the extent
+            void begin_multiview_pass(VkCommandBuffer command_buffer);
+            void begin_layer_pass(VkCommandBuffer command_buffer, uint32_t layer);
+            void end_pass(VkCommandBuffer command_buffer);
+
+            private:
+            void create_images();
+            // a view mask of 0 makes a regular render pass
+            VkRenderPass create_render_pass(uint32_t view_mask);
+            VkImageView create_view(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t first_layer, uint32_t count);
+            VkFramebuffer create_framebuffer(VkRenderPass render_pass, VkImageView color, VkImageView depth);
+            void begin_pass(VkCommandBuffer command_buffer, VkRenderPass render_pass, VkFramebuffer framebuffer);
+
+            VkeDevice &vke_device;
+            VkExtent2D extent;
+            uint32_t layer_count;
+            VkFormat depth_format;
+
+            VkImage color_image = VK_NULL_HANDLE;
+            VkDeviceMemory color_memory = VK_NULL_HANDLE;
+            VkImage depth_image = VK_NULL_HANDLE;
+            VkDeviceMemory depth_memory = VK_NULL_HANDLE;
+            VkImageView color_view = VK_NULL_HANDLE;
+            VkImageView depth_view = VK_NULL_HANDLE;
+            // single layer views of the layer render pass
+            std::vector<VkImageView> color_layer_views{};
+            std::vector<VkImageView> depth_layer_views{};
+
+            VkRenderPass multiview_render_pass = VK_NULL_HANDLE;
+            VkRenderPass layer_render_pass = VK_NULL_HANDLE;
+            VkFramebuffer multiview_framebuffer = VK_NULL_HANDLE;
+            std::vector<VkFramebuffer> layer_framebuffers{};
+        };
+    }
+
+#endif
@@ -0,0 +1,302 @@
+#include "vke_offscreen_target.hpp"
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <array>
+#include <limits>
+#include <stdexcept>
+
+namespace vke {
+
+    VkeOffscreenTarget::VkeOffscreenTarget(
+        VkeDevice &device, 
+        VkeMemoryPool &attachment_pool, 
+        VkExtent2D extent, 
+        uint32_t frames_in_flight
+    ) :
+        vke_device{device},
+        attachment_pool{attachment_pool},
+        extent{extent},
+        frames_in_flight{frames_in_flight}
+    {
+        depth_format = vke_device.findSupportedFormat(
+            {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        );
+
+        create_images();
+        create_render_pass();
+        create_framebuffers();
+        create_readback_buffers();
+        create_fences();
+    }
+
+    VkeOffscreenTarget::~VkeOffscreenTarget() {
+        if (!fences.empty()) {
+            vkWaitForFences(vke_device.device(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+        for (auto fence : fences) {
+            vkDestroyFence(vke_device.device(), fence, nullptr);
+        }
+        for (auto framebuffer : framebuffers) {
+            vkDestroyFramebuffer(vke_device.device(), framebuffer, nullptr);
+        }
+        vkDestroyRenderPass(vke_device.device(), render_pass, nullptr);
+
+        for (uint32_t i = 0; i < frames_in_flight; i++) {
+            vkDestroyImageView(vke_device.device(), color_image_views[i], nullptr);
+            vkDestroyImage(vke_device.device(), color_images[i], nullptr);
+            attachment_pool.free(color_allocations[i]);
+
+            vkDestroyImageView(vke_device.device(), depth_image_views[i], nullptr);
+            vkDestroyImage(vke_device.device(), depth_images[i], nullptr);
+            attachment_pool.free(depth_allocations[i]);
+        }
+    }
+
+    void VkeOffscreenTarget::create_images() {
+        color_images.resize(frames_in_flight);
+        color_image_views.resize(frames_in_flight);
+        color_allocations.resize(frames_in_flight);
+        depth_images.resize(frames_in_flight);
+        depth_image_views.resize(frames_in_flight);
+        depth_allocations.resize(frames_in_flight);
+
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent.width = extent.width;
+        image_info.extent.height = extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+
+        for (uint32_t i = 0; i < frames_in_flight; i++) {
+            image_info.format = COLOR_FORMAT;
+            image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            color_allocations[i] = attachment_pool.create_image(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, color_images[i]);
+
+            view_info.image = color_images[i];
+            view_info.format = COLOR_FORMAT;
+            view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            if (vkCreateImageView(vke_device.device(), &view_info, nullptr, &color_image_views[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen color image view");
+            }
+
+            image_info.format = depth_format;
+            image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            depth_allocations[i] = attachment_pool.create_image(
+                image_info, 
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+                depth_images[i], 
+                VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+            );
+
+            view_info.image = depth_images[i];
+            view_info.format = depth_format;
+            view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            if (vkCreateImageView(vke_device.device(), &view_info, nullptr, &depth_image_views[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen depth image view");
+            }
+        }
+    }
+
+    void VkeOffscreenTarget::create_render_pass() {
+        // same attachments as the swap chain render pass, except that color ends up ready for the copy
+        VkAttachmentDescription color_attachment{};
+        color_attachment.format = COLOR_FORMAT;
+        color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        VkAttachmentDescription depth_attachment{};
+        depth_attachment.format = depth_format;
+        depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference color_attachment_ref{};
+        color_attachment_ref.attachment = 0;
+        color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depth_attachment_ref{};
+        depth_attachment_ref.attachment = 1;
+        depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &color_attachment_ref;
+        subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // make the color writes visible to the readback copy
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = {color_attachment, depth_attachment};
+        VkRenderPassCreateInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        render_pass_info.pAttachments = attachments.data();
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &subpass;
+        render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        render_pass_info.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(vke_device.device(), &render_pass_info, nullptr, &render_pass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen render pass");
+        }
+    }
+
+    void VkeOffscreenTarget::create_framebuffers() {
+        framebuffers.resize(frames_in_flight);
+        for (uint32_t i = 0; i < frames_in_flight; i++) {
+            std::array<VkImageView, 2> attachments = {color_image_views[i], depth_image_views[i]};
+
+            VkFramebufferCreateInfo framebuffer_info{};
+            framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebuffer_info.renderPass = render_pass;
+            framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebuffer_info.pAttachments = attachments.data();
+            framebuffer_info.width = extent.width;
+            framebuffer_info.height = extent.height;
+            framebuffer_info.layers = 1;
+
+            if (vkCreateFramebuffer(vke_device.device(), &framebuffer_info, nullptr, &framebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen framebuffer");
+            }
+        }
+    }
+
+    void VkeOffscreenTarget::create_readback_buffers() {
+        readback_buffers.resize(frames_in_flight);
+        for (auto &buffer : readback_buffers) {
+            buffer = std::make_unique<VkeBuffer>(
+                vke_device,
+                get_frame_size(),
+                1,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            buffer->map();
+        }
+    }
+
+    void VkeOffscreenTarget::create_fences() {
+        fences.resize(frames_in_flight);
+
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        for (auto &fence : fences) {
+            if (vkCreateFence(vke_device.device(), &fence_info, nullptr, &fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen fence");
+            }
+        }
+    }
+
+    bool VkeOffscreenTarget::is_frame_complete(int frame_index) const {
+        return vkGetFenceStatus(vke_device.device(), fences[frame_index]) == VK_SUCCESS;
+    }
+
+    bool VkeOffscreenTarget::wait_for_frame(int frame_index) {
+        if (is_frame_complete(frame_index)) {
+            return false;
+        }
+        vkWaitForFences(vke_device.device(), 1, &fences[frame_index], VK_TRUE, std::numeric_limits<uint64_t>::max());
+        return true;
+    }
+
+    void VkeOffscreenTarget::record_readback(VkCommandBuffer command_buffer, int frame_index) {
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {extent.width, extent.height, 1};
+
+        vkCmdCopyImageToBuffer(
+            command_buffer,
+            color_images[frame_index],
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            readback_buffers[frame_index]->get_buffer(),
+            1,
+            &region
+        );
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = readback_buffers[frame_index]->get_buffer();
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr
+        );
+    }
+
+    void VkeOffscreenTarget::submit(VkCommandBuffer command_buffer, int frame_index) {
+        VKE_CPU_SCOPE("submit offscreen");
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer;
+
+        vkResetFences(vke_device.device(), 1, &fences[frame_index]);
+        if (vkQueueSubmit(vke_device.graphicsQueue(), 1, &submit_info, fences[frame_index]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit offscreen frame");
+        }
+    }
+
+    const uint8_t *VkeOffscreenTarget::get_pixels(int frame_index) const {
+        return static_cast<const uint8_t*>(readback_buffers[frame_index]->get_mapped_memory());
+    }
+}
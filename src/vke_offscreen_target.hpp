@@ -0,0 +1,73 @@
+#ifndef vke_offscreen_target_
+    #define vke_offscreen_target_
+
+    #include "vke_device.hpp"
+    #include "vke_buffer.hpp"
+    #include "vke_memory_pool.hpp"
+
+    // std
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+        // Stands in for the swap chain on headless devices. Every frame slot renders into its own color image
+        // which is copied into a host visible buffer at the end of the frame, so the pixels can be read once
+        // the slot's fence has signalled.
+        class VkeOffscreenTarget {
+            public:
+            // rgba keeps readback free of swizzling
+            static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+            VkeOffscreenTarget(VkeDevice &device, VkeMemoryPool &attachment_pool, VkExtent2D extent, uint32_t frames_in_flight);
+            ~VkeOffscreenTarget();
+
+            VkeOffscreenTarget(const VkeOffscreenTarget&) = delete;
+            VkeOffscreenTarget& operator=(const VkeOffscreenTarget&) = delete;
+
+            VkRenderPass get_render_pass() const { return render_pass; }
+            VkFramebuffer get_framebuffer(int frame_index) const { return framebuffers[frame_index]; }
+            VkExtent2D get_extent() const { return extent; }
+            float get_aspect_ratio() const { return static_cast<float>(extent.width) / static_cast<float>(extent.height); }
+            uint32_t get_frames_in_flight() const { return frames_in_flight; }
+            VkFence get_fence(int frame_index) const { return fences[frame_index]; }
+
+            bool is_frame_complete(int frame_index) const;
+            // blocks until the frame slot is free, returns false if it already was
+            bool wait_for_frame(int frame_index);
+
+            // copies the rendered image into the readback buffer, recorded after the render pass
+            void record_readback(VkCommandBuffer command_buffer, int frame_index);
+            void submit(VkCommandBuffer command_buffer, int frame_index);
+
+            // tightly packed rgba8 rows, only valid while the slot's fence is signalled
+            const uint8_t *get_pixels(int frame_index) const;
+            VkDeviceSize get_frame_size() const { return static_cast<VkDeviceSize>(extent.width) * extent.height * 4; }
+
+            private:
+            void create_images();
+            void create_render_pass();
+            void create_framebuffers();
+            void create_readback_buffers();
+            void create_fences();
+
+            VkeDevice &vke_device;
+            VkeMemoryPool &attachment_pool;
+            VkExtent2D extent;
+            uint32_t frames_in_flight;
+            VkFormat depth_format;
+
+            std::vector<VkImage> color_images;
+            std::vector<VkImageView> color_image_views;
+            std::vector<VkePoolAllocation> color_allocations;
+            std::vector<VkImage> depth_images;
+            std::vector<VkImageView> depth_image_views;
+            std::vector<VkePoolAllocation> depth_allocations;
+
+            VkRenderPass render_pass = VK_NULL_HANDLE;
+            std::vector<VkFramebuffer> framebuffers;
+            std::vector<std::unique_ptr<VkeBuffer>> readback_buffers;
+            std::vector<VkFence> fences;
+        };
+    }
+
+#endif
@@ -0,0 +1,93 @@
+#include "vke_overdraw_counter.hpp"
+
+// std
+#include <stdexcept>
+
+namespace vke {
+
+    VkeOverdrawCounter::VkeOverdrawCounter(VkeDevice &device, uint32_t frames_in_flight) :
+        vke_device{device},
+        supported{device.supportsPipelineStatistics()},
+        frames(frames_in_flight)
+    {
+        if (!supported) {
+            return;
+        }
+
+        VkQueryPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        pool_info.queryCount = 1;
+        pool_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+        for (auto &frame : frames) {
+            if (vkCreateQueryPool(vke_device.device(), &pool_info, nullptr, &frame.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline statistics query pool");
+            }
+        }
+    }
+
+    VkeOverdrawCounter::~VkeOverdrawCounter() {
+        for (auto &frame : frames) {
+            if (frame.pool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(vke_device.device(), frame.pool, nullptr);
+            }
+        }
+    }
+
+    void VkeOverdrawCounter::begin_frame(VkCommandBuffer command_buffer, int frame_index, VkExtent2D extent) {
+        if (!supported) {
+            return;
+        }
+
+        current_frame = frame_index;
+        auto &frame = frames[frame_index];
+        resolve(frame);
+
+        vkCmdResetQueryPool(command_buffer, frame.pool, 0, 1);
+        frame.pixels = static_cast<uint64_t>(extent.width) * extent.height;
+    }
+
+    void VkeOverdrawCounter::begin(VkCommandBuffer command_buffer) {
+        if (!supported || current_frame < 0) {
+            return;
+        }
+        vkCmdBeginQuery(command_buffer, frames[current_frame].pool, 0, 0);
+    }
+
+    void VkeOverdrawCounter::end(VkCommandBuffer command_buffer) {
+        if (!supported || current_frame < 0) {
+            return;
+        }
+        vkCmdEndQuery(command_buffer, frames[current_frame].pool, 0);
+        frames[current_frame].written = true;
+    }
+
+    void VkeOverdrawCounter::resolve(FrameQuery &frame) {
+        if (!frame.written) {
+            return;
+        }
+        frame.written = false;
+
+        uint64_t invocations = 0;
+        // no wait bit: the slot's fence signalled already
+        VkResult result = vkGetQueryPoolResults(
+            vke_device.device(),
+            frame.pool,
+            0,
+            1,
+            sizeof(invocations),
+            &invocations,
+            sizeof(invocations),
+            VK_QUERY_RESULT_64_BIT
+        );
+        if (result != VK_SUCCESS || frame.pixels == 0) {
+            return;
+        }
+
+        fragment_invocations = invocations;
+        overdraw = static_cast<float>(static_cast<double>(invocations) / frame.pixels);
+        overdraw_sum += overdraw;
+        resolved_frames++;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef vke_overdraw_counter_
+    #define vke_overdraw_counter_
+
+    #include "vke_device.hpp"
+
+    // std
+    #include <cstdint>
+    #include <vector>
+
+    namespace vke {
+        // Counts the fragment shader invocations of the draws between begin and end with a pipeline
+        // statistics query, divided by the pixels of the render area that is the average number of times
+        // a pixel was shaded. Like VkeGpuProfiler every frame slot owns a query pool that is read back
+        // without waiting when the slot comes around again.
+        class VkeOverdrawCounter {
+            public:
+            VkeOverdrawCounter(VkeDevice &device, uint32_t frames_in_flight);
+            ~VkeOverdrawCounter();
+
+            VkeOverdrawCounter(const VkeOverdrawCounter&) = delete;
+            VkeOverdrawCounter& operator=(const VkeOverdrawCounter&) = delete;
+
+            // false without the pipelineStatisticsQuery feature, all calls are no-ops then
+            bool is_supported() const { return supported; }
+
+            // reads the slot's previous frame and resets its query, must be called outside a render pass
+            void begin_frame(VkCommandBuffer command_buffer, int frame_index, VkExtent2D extent);
+            // inside one subpass, at most once per frame
+            void begin(VkCommandBuffer command_buffer);
+            void end(VkCommandBuffer command_buffer);
+
+            // of the last frame that was read back
+            uint64_t get_fragment_invocations() const { return fragment_invocations; }
+            float get_overdraw() const { return overdraw; }
+
+            // mean overdraw over the frames read back since the last reset
+            float get_mean_overdraw() const { return resolved_frames > 0 ? static_cast<float>(overdraw_sum / resolved_frames) : 0.f; }
+            void reset_statistics() { overdraw_sum = 0.0; resolved_frames = 0; }
+
+            private:
+            struct FrameQuery {
+                VkQueryPool pool = VK_NULL_HANDLE;
+                bool written = false;
+                uint64_t pixels = 0;
+            };
+
+            void resolve(FrameQuery &frame);
+
+            VkeDevice &vke_device;
+            bool supported;
+            std::vector<FrameQuery> frames;
+            int current_frame{-1};
+
+            uint64_t fragment_invocations = 0;
+            float overdraw = 0.f;
+            double overdraw_sum = 0.0;
+            uint32_t resolved_frames = 0;
+        };
+    }
+
+#endif
@@ -19,7 +19,9 @@ namespace vke {
     }
     VkePipeline::~VkePipeline() {
         vkDestroyShaderModule(vke_device.device(), vert_shader_module, nullptr);
-        vkDestroyShaderModule(vke_device.device(), fragment_shader_module, nullptr);
+        if (fragment_shader_module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(vke_device.device(), fragment_shader_module, nullptr);
+        }
         vkDestroyPipeline(vke_device.device(), graphics_pipeline, nullptr);
         
         std::cout << "Closed pipeline" << '\n';
@@ -56,17 +58,18 @@ namespace vke {
         "Cannot create graphics pipeline (no renderpass provided in config_info)");
 
         auto vert_code = readFile(vertex_shader_path);
-        auto frag_code = readFile(fragment_shader_path);
 
         // std::cout << "Vertex Shader Size: " << vert_code.size() << '\n';
-        // std::cout << "Fragment Shader Size: " << frag_code.size() << '\n';
 
         createShaderModule(vert_code, &vert_shader_module);
-        createShaderModule(frag_code, &fragment_shader_module);
+        bool has_fragment_shader = !fragment_shader_path.empty();
+        if (has_fragment_shader) {
+            createShaderModule(readFile(fragment_shader_path), &fragment_shader_module);
+        }
 
         VkPipelineShaderStageCreateInfo shader_stages[2];
         shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shader_stages[0].stage = config_info.mesh_shader ? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
         shader_stages[0].module = vert_shader_module;
         shader_stages[0].pName = "main";
         shader_stages[0].flags = 0;
@@ -81,8 +84,8 @@ namespace vke {
         shader_stages[1].pSpecializationInfo = nullptr;
 
 
-        auto binding_descriptions = VkeModel::Vertex::get_binding_descriptions();
-        auto attribute_descriptions = VkeModel::Vertex::get_attribute_descriptions();
+        const auto &binding_descriptions = config_info.binding_descriptions;
+        const auto &attribute_descriptions = config_info.attribute_descriptions;
         VkPipelineVertexInputStateCreateInfo vertex_input_info{};
 
         vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -101,10 +104,10 @@ namespace vke {
 
         VkGraphicsPipelineCreateInfo pipeline_info{};
         pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipeline_info.stageCount = 2;
+        pipeline_info.stageCount = has_fragment_shader ? 2 : 1;
         pipeline_info.pStages = shader_stages;
-        pipeline_info.pVertexInputState = &vertex_input_info;
-        pipeline_info.pInputAssemblyState = &config_info.input_assembly_info;
+        pipeline_info.pVertexInputState = config_info.mesh_shader ? nullptr : &vertex_input_info;
+        pipeline_info.pInputAssemblyState = config_info.mesh_shader ? nullptr : &config_info.input_assembly_info;
         pipeline_info.pViewportState = &config_info.viewport_info;
         pipeline_info.pRasterizationState = &config_info.rasterization_info;
         pipeline_info.pMultisampleState = &config_info.multisample_info;
@@ -139,6 +142,10 @@ namespace vke {
         vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
     }
 
+    void VkePipeline::bind(VkeCommandRecorder &recorder) {
+        recorder.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+    }
+
 
     void VkePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& config_info) {
 
@@ -232,5 +239,8 @@ namespace vke {
         config_info.dynamics_state_info.pDynamicStates = config_info.dynamics_state_enables.data();
         config_info.dynamics_state_info.dynamicStateCount = static_cast<uint32_t>(config_info.dynamics_state_enables.size());
         config_info.dynamics_state_info.flags = 0;
+
+        config_info.binding_descriptions = VkeModel::Vertex::get_binding_descriptions();
+        config_info.attribute_descriptions = VkeModel::Vertex::get_attribute_descriptions();
     }
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <vulkan/vulkan_core.h>
 
     #include "vke_device.hpp"
+    #include "vke_command_recorder.hpp"
 
     namespace vke {
 
@@ -25,14 +26,22 @@
             std::vector<VkDynamicState> dynamics_state_enables;
             VkPipelineDynamicStateCreateInfo dynamics_state_info;
 
+            // the full VkeModel::Vertex by default
+            std::vector<VkVertexInputBindingDescription> binding_descriptions{};
+            std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
+
             VkPipelineLayout pipeline_layout = nullptr;
             VkRenderPass render_pass = nullptr;
             uint32_t subpass = 0;
+
+            // the first shader is a VK_EXT_mesh_shader mesh shader, there is no vertex input or input assembly
+            bool mesh_shader = false;
         };
 
         class VkePipeline {
             // public
             public:
+            // an empty fragment_shader_path makes a pipeline without fragment stage, for depth only passes
             VkePipeline(
                 VkeDevice& device, 
                 const std::string& vertex_shader_path, 
@@ -48,6 +57,8 @@
             static void defaultPipelineConfigInfo(PipelineConfigInfo& config_info);
 
             void bind(VkCommandBuffer command_buffer);
+            // skipped if the pipeline is bound already
+            void bind(VkeCommandRecorder &recorder);
 
             // private
             private:
@@ -61,7 +72,7 @@
             
             VkPipeline graphics_pipeline;
             VkShaderModule vert_shader_module;
-            VkShaderModule fragment_shader_module;
+            VkShaderModule fragment_shader_module = VK_NULL_HANDLE;
         };
     }
 
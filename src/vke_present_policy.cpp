@@ -0,0 +1,125 @@
+#include "vke_present_policy.hpp"
+
+// std
+#include <algorithm>
+
+namespace vke {
+
+    namespace {
+        // exponential moving average factor for frame work times
+        constexpr float SMOOTHING = 0.1f;
+        // minimum time between two adaptive switches (seconds)
+        constexpr float MIN_SWITCH_INTERVAL = 1.f;
+        // switch to the tearing mode when the average work time exceeds the refresh period by this factor
+        constexpr float SLOW_THRESHOLD = 1.02f;
+        // and go back to vsync once there is this much headroom
+        constexpr float FAST_THRESHOLD = 0.85f;
+    }
+
+    const char* to_string(PresentPolicy policy) {
+        switch (policy) {
+            case PresentPolicy::Fifo: return "fifo";
+            case PresentPolicy::FifoRelaxed: return "fifo-relaxed";
+            case PresentPolicy::Mailbox: return "mailbox";
+            case PresentPolicy::Immediate: return "immediate";
+            case PresentPolicy::Adaptive: return "adaptive";
+        }
+        return "unknown";
+    }
+
+    bool parse_present_policy(const std::string &name, PresentPolicy &policy) {
+        for (auto candidate : {
+                PresentPolicy::Fifo, 
+                PresentPolicy::FifoRelaxed, 
+                PresentPolicy::Mailbox, 
+                PresentPolicy::Immediate, 
+                PresentPolicy::Adaptive}) {
+            if (name == to_string(candidate)) {
+                policy = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    PresentPolicy next_present_policy(PresentPolicy policy) {
+        switch (policy) {
+            case PresentPolicy::Fifo: return PresentPolicy::FifoRelaxed;
+            case PresentPolicy::FifoRelaxed: return PresentPolicy::Mailbox;
+            case PresentPolicy::Mailbox: return PresentPolicy::Immediate;
+            case PresentPolicy::Immediate: return PresentPolicy::Adaptive;
+            case PresentPolicy::Adaptive: return PresentPolicy::Fifo;
+        }
+        return PresentPolicy::Fifo;
+    }
+
+    VkPresentModeKHR mode_for_policy(PresentPolicy policy) {
+        switch (policy) {
+            case PresentPolicy::Fifo: return VK_PRESENT_MODE_FIFO_KHR;
+            case PresentPolicy::FifoRelaxed: return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            case PresentPolicy::Mailbox: return VK_PRESENT_MODE_MAILBOX_KHR;
+            case PresentPolicy::Immediate: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+            // start synchronized, the present controller relaxes it when needed
+            case PresentPolicy::Adaptive: return VK_PRESENT_MODE_FIFO_KHR;
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    VkePresentController::VkePresentController(
+        PresentPolicy policy, 
+        float refresh_rate, 
+        std::vector<VkPresentModeKHR> supported_modes
+    ) :
+        policy(policy),
+        refresh_period(1.f / (refresh_rate > 0.f ? refresh_rate : 60.f)),
+        supported_modes(std::move(supported_modes))
+    {
+        present_mode = supported_mode_for_policy(policy);
+    }
+
+    void VkePresentController::set_policy(PresentPolicy new_policy) {
+        policy = new_policy;
+        present_mode = supported_mode_for_policy(policy);
+        time_since_switch = 0.f;
+    }
+
+    VkPresentModeKHR VkePresentController::update(float work_time, float frame_time) {
+        average_work_time += SMOOTHING * (work_time - average_work_time);
+        time_since_switch += frame_time;
+
+        if (policy != PresentPolicy::Adaptive || time_since_switch < MIN_SWITCH_INTERVAL) {
+            return present_mode;
+        }
+
+        if (present_mode == VK_PRESENT_MODE_FIFO_KHR && average_work_time > SLOW_THRESHOLD * refresh_period) {
+            // missing vblanks: present late frames right away instead of waiting for the next one
+            present_mode = tearing_mode();
+            time_since_switch = 0.f;
+        } else if (present_mode != VK_PRESENT_MODE_FIFO_KHR && average_work_time < FAST_THRESHOLD * refresh_period) {
+            present_mode = VK_PRESENT_MODE_FIFO_KHR;
+            time_since_switch = 0.f;
+        }
+
+        return present_mode;
+    }
+
+    VkPresentModeKHR VkePresentController::supported_mode_for_policy(PresentPolicy policy) const {
+        VkPresentModeKHR mode = mode_for_policy(policy);
+        // fifo is the only mode every implementation has to support
+        return is_supported(mode) ? mode : VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    VkPresentModeKHR VkePresentController::tearing_mode() const {
+        if (is_supported(VK_PRESENT_MODE_FIFO_RELAXED_KHR)) {
+            return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        }
+        if (is_supported(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    bool VkePresentController::is_supported(VkPresentModeKHR mode) const {
+        return std::find(supported_modes.begin(), supported_modes.end(), mode) != supported_modes.end();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef vke_present_policy_
+    #define vke_present_policy_
+
+    #include <vulkan/vulkan.h>
+
+    // std
+    #include <string>
+    #include <vector>
+
+    namespace vke {
+        enum class PresentPolicy {
+            Fifo,
+            FifoRelaxed,
+            Mailbox,
+            Immediate,
+            // fifo while frames keep up with the display, relaxed fifo (or immediate) when they don't
+            Adaptive
+        };
+
+        const char* to_string(PresentPolicy policy);
+        bool parse_present_policy(const std::string &name, PresentPolicy &policy);
+        PresentPolicy next_present_policy(PresentPolicy policy);
+        // the mode a policy starts with, whether or not the surface supports it
+        VkPresentModeKHR mode_for_policy(PresentPolicy policy);
+
+        // Chooses the present mode for the current policy. For the adaptive policy the decision is based
+        // on the cpu/gpu work time of a frame (without the time blocked on vsync), smoothed over several
+        // frames and held for a while after every switch because each switch recreates the swap chain.
+        class VkePresentController {
+            public:
+            VkePresentController(PresentPolicy policy, float refresh_rate, std::vector<VkPresentModeKHR> supported_modes);
+
+            void set_policy(PresentPolicy new_policy);
+            PresentPolicy get_policy() const { return policy; }
+
+            // feed the work time of the last frame (seconds), returns the mode to present with
+            VkPresentModeKHR update(float work_time, float frame_time);
+            VkPresentModeKHR get_present_mode() const { return present_mode; }
+
+            private:
+            // mode_for_policy, fifo where the surface lacks it
+            VkPresentModeKHR supported_mode_for_policy(PresentPolicy policy) const;
+            VkPresentModeKHR tearing_mode() const;
+            bool is_supported(VkPresentModeKHR mode) const;
+
+            PresentPolicy policy;
+            float refresh_period;
+            std::vector<VkPresentModeKHR> supported_modes;
+            VkPresentModeKHR present_mode;
+
+            float average_work_time{0.f};
+            float time_since_switch{0.f};
+        };
+    }
+
+#endif
@@ -0,0 +1,183 @@
+#include "vke_render_queue.hpp"
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+
+namespace vke {
+
+    VkeRadixSorter::VkeRadixSorter(uint32_t thread_count) : thread_count{std::max(thread_count, 1u)} {}
+
+    void VkeRadixSorter::start_workers() {
+        for (uint32_t chunk = static_cast<uint32_t>(workers.size()) + 1; chunk < thread_count; chunk++) {
+            workers.emplace_back(&VkeRadixSorter::worker_loop, this, chunk);
+        }
+    }
+
+    VkeRadixSorter::~VkeRadixSorter() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        task_ready.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void VkeRadixSorter::worker_loop(uint32_t chunk) {
+        uint64_t seen_generation = 0;
+        while (true) {
+            const std::function<void(uint32_t)> *current_task;
+            bool participates;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                task_ready.wait(lock, [&]() { return generation != seen_generation || stopping; });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+                current_task = task;
+                participates = chunk < task_chunks;
+            }
+
+            if (participates) {
+                (*current_task)(chunk);
+                std::lock_guard<std::mutex> lock{mutex};
+                if (--remaining == 0) {
+                    task_done.notify_one();
+                }
+            }
+        }
+    }
+
+    void VkeRadixSorter::run(uint32_t chunk_count, const std::function<void(uint32_t)> &chunk_task) {
+        if (chunk_count <= 1) {
+            chunk_task(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            task = &chunk_task;
+            task_chunks = chunk_count;
+            remaining = chunk_count - 1;
+            generation++;
+        }
+        task_ready.notify_all();
+
+        chunk_task(0);
+
+        std::unique_lock<std::mutex> lock{mutex};
+        task_done.wait(lock, [&]() { return remaining == 0; });
+        task = nullptr;
+    }
+
+    void VkeRadixSorter::sort(std::vector<Item> &items) {
+        VKE_CPU_SCOPE("radix sort");
+        const size_t count = items.size();
+        last_pass_count = 0;
+        if (count < 2) {
+            return;
+        }
+
+        uint32_t chunk_count = count < PARALLEL_THRESHOLD ? 1 : thread_count;
+        if (chunk_count > 1) {
+            start_workers();
+        }
+        auto chunk_begin = [&](uint32_t chunk) { return count * chunk / chunk_count; };
+        scratch.resize(count);
+        counts.resize(chunk_count);
+        offsets.resize(chunk_count);
+
+        // all digits at once, the totals tell which passes can be skipped
+        Item *source = items.data();
+        Item *destination = scratch.data();
+        run(chunk_count, [&](uint32_t chunk) {
+            auto &chunk_counts = counts[chunk];
+            for (auto &histogram : chunk_counts) {
+                histogram.fill(0);
+            }
+            for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); i++) {
+                uint64_t key = source[i].key;
+                for (uint32_t digit = 0; digit < DIGITS; digit++) {
+                    chunk_counts[digit][(key >> (digit * 8)) & 0xff]++;
+                }
+            }
+        });
+
+        std::array<bool, DIGITS> skip{};
+        for (uint32_t digit = 0; digit < DIGITS; digit++) {
+            uint32_t bucket = (source[0].key >> (digit * 8)) & 0xff;
+            size_t total = 0;
+            for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+                total += counts[chunk][digit][bucket];
+            }
+            skip[digit] = total == count;
+        }
+
+        bool first_pass = true;
+        for (uint32_t digit = 0; digit < DIGITS; digit++) {
+            if (skip[digit]) {
+                continue;
+            }
+            const uint32_t shift = digit * 8;
+
+            // the chunks hold other items than in the first count once a pass moved them
+            if (!first_pass) {
+                run(chunk_count, [&](uint32_t chunk) {
+                    auto &histogram = counts[chunk][digit];
+                    histogram.fill(0);
+                    for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); i++) {
+                        histogram[(source[i].key >> shift) & 0xff]++;
+                    }
+                });
+            }
+            first_pass = false;
+
+            // bucket by bucket, within a bucket chunk by chunk, which keeps the sort stable
+            uint32_t offset = 0;
+            for (uint32_t bucket = 0; bucket < BUCKETS; bucket++) {
+                for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+                    offsets[chunk][bucket] = offset;
+                    offset += counts[chunk][digit][bucket];
+                }
+            }
+
+            run(chunk_count, [&](uint32_t chunk) {
+                auto &chunk_offsets = offsets[chunk];
+                for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); i++) {
+                    destination[chunk_offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+                }
+            });
+            std::swap(source, destination);
+            last_pass_count++;
+        }
+
+        if (source != items.data()) {
+            items.swap(scratch);
+        }
+    }
+
+    VkeRenderQueue::VkeRenderQueue(uint32_t thread_count) : sorter{thread_count} {}
+
+    uint32_t VkeRenderQueue::depth_bucket(float depth) {
+        depth = std::max(depth, 0.f);
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        // the sign bit is 0, the exponent and the top of the mantissa remain
+        return bits >> (31 - DEPTH_BITS);
+    }
+
+    uint64_t VkeRenderQueue::make_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+        auto bits = [](uint32_t value, uint32_t count, uint32_t shift) {
+            return (static_cast<uint64_t>(value) & ((uint64_t{1} << count) - 1)) << shift;
+        };
+        return bits(pass, PASS_BITS, PASS_SHIFT)
+            | bits(pipeline, PIPELINE_BITS, PIPELINE_SHIFT)
+            | bits(material, MATERIAL_BITS, MATERIAL_SHIFT)
+            | bits(mesh, MESH_BITS, MESH_SHIFT)
+            | bits(depth_bucket(depth), DEPTH_BITS, DEPTH_SHIFT);
+    }
+}
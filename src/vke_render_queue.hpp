@@ -0,0 +1,156 @@
+#ifndef vke_render_queue_
+    #define vke_render_queue_
+
+    // std
+    #include <array>
+    #include <condition_variable>
+    #include <cstdint>
+    #include <functional>
+    #include <mutex>
+    #include <thread>
+    #include <vector>
+
+    namespace vke {
+        // Stable least significant digit radix sort of 64 bit keys with a 32 bit payload, one byte per pass.
+        // Passes whose byte is the same for every key are skipped, so keys that only use a few of their bits
+        // cost only a few passes. Large inputs are split into one chunk per thread: each thread counts the
+        // digits of its chunk, the counts are turned into per chunk offsets and each thread scatters its
+        // chunk, which keeps the order of equal digits across chunks.
+        class VkeRadixSorter {
+            public:
+            struct Item {
+                uint64_t key;
+                uint32_t value;
+            };
+
+            // below this many items the caller's thread sorts alone
+            static constexpr size_t PARALLEL_THRESHOLD = 16384;
+
+            // thread_count includes the calling thread, 1 sorts without worker threads, the workers start with
+            // the first sort past PARALLEL_THRESHOLD
+            explicit VkeRadixSorter(uint32_t thread_count);
+            ~VkeRadixSorter();
+
+            VkeRadixSorter(const VkeRadixSorter&) = delete;
+            VkeRadixSorter& operator=(const VkeRadixSorter&) = delete;
+
+            void sort(std::vector<Item> &items);
+
+            uint32_t get_thread_count() const { return thread_count; }
+            uint32_t get_started_workers() const { return static_cast<uint32_t>(workers.size()); }
+            // passes of the last sort that were not skipped
+            uint32_t get_last_pass_count() const { return last_pass_count; }
+
+            private:
+            static constexpr uint32_t DIGITS = 8;
+            static constexpr uint32_t BUCKETS = 256;
+            using Histogram = std::array<uint32_t, BUCKETS>;
+
+            // runs task(chunk) for every chunk, chunk 0 on the calling thread, and waits for all of them
+            void run(uint32_t chunk_count, const std::function<void(uint32_t)> &task);
+            void worker_loop(uint32_t chunk);
+            void start_workers();
+
+            std::vector<Item> scratch{};
+            // [chunk][digit], the digit counts of the first pass and the per pass counts after it
+            std::vector<std::array<Histogram, DIGITS>> counts{};
+            std::vector<Histogram> offsets{};
+            uint32_t last_pass_count = 0;
+
+            uint32_t thread_count;
+            std::vector<std::thread> workers{};
+            std::mutex mutex;
+            std::condition_variable task_ready;
+            std::condition_variable task_done;
+            const std::function<void(uint32_t)> *task = nullptr;
+            uint32_t task_chunks = 0;
+            uint64_t generation = 0;
+            uint32_t remaining = 0;
+            bool stopping = false;
+        };
+
+        // Draws of a frame as sort keys. The key orders by pass, pipeline, material and mesh first, so draws
+        // sharing state end up next to each other, and by depth last, front to back within one mesh. The
+        // payload is an index into whatever the caller keeps per draw. record walks the sorted draws and
+        // only reports the state that changed from the previous draw.
+        class VkeRenderQueue {
+            public:
+            static constexpr uint32_t PASS_BITS = 4;
+            static constexpr uint32_t PIPELINE_BITS = 8;
+            static constexpr uint32_t MATERIAL_BITS = 12;
+            static constexpr uint32_t MESH_BITS = 16;
+            static constexpr uint32_t DEPTH_BITS = 24;
+            static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+            static constexpr uint32_t DEPTH_SHIFT = 0;
+            static constexpr uint32_t MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+            static constexpr uint32_t MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+            static constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+            static constexpr uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+            // ids past their bit count wrap around, depth is the view space depth, negative depths count as 0
+            static uint64_t make_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+            // the top bits of the float, monotonic in depth for positive values
+            static uint32_t depth_bucket(float depth);
+
+            static uint32_t get_pass(uint64_t key) { return field(key, PASS_SHIFT, PASS_BITS); }
+            static uint32_t get_pipeline(uint64_t key) { return field(key, PIPELINE_SHIFT, PIPELINE_BITS); }
+            static uint32_t get_material(uint64_t key) { return field(key, MATERIAL_SHIFT, MATERIAL_BITS); }
+            static uint32_t get_mesh(uint64_t key) { return field(key, MESH_SHIFT, MESH_BITS); }
+
+            // thread_count as in VkeRadixSorter
+            explicit VkeRenderQueue(uint32_t thread_count);
+
+            void clear() { items.clear(); }
+            void add(uint64_t key, uint32_t draw) { items.push_back({key, draw}); }
+            void sort() { sorter.sort(items); }
+
+            const std::vector<VkeRadixSorter::Item> &get_items() const { return items; }
+            size_t size() const { return items.size(); }
+
+            // recorder.bind_pipeline(pipeline, draw), bind_material(material, draw) and bind_mesh(mesh, draw)
+            // are called when the field changes from the previous draw, a changed pass or pipeline rebinds
+            // material and mesh as well, recorder.draw(draw) is called for every draw
+            template<typename Recorder>
+            void record(Recorder &recorder) const;
+
+            private:
+            static uint32_t field(uint64_t key, uint32_t shift, uint32_t bits) {
+                return static_cast<uint32_t>((key >> shift) & ((uint64_t{1} << bits) - 1));
+            }
+
+            std::vector<VkeRadixSorter::Item> items{};
+            VkeRadixSorter sorter;
+        };
+
+        template<typename Recorder>
+        void VkeRenderQueue::record(Recorder &recorder) const {
+            // everything above the depth
+            constexpr uint64_t STATE_MASK = ~((uint64_t{1} << MESH_SHIFT) - 1);
+            uint64_t previous = 0;
+            bool first = true;
+            for (const auto &item : items) {
+                uint64_t state = item.key & STATE_MASK;
+                if (first || state != previous) {
+                    bool new_pipeline = first || (item.key >> PIPELINE_SHIFT) != (previous >> PIPELINE_SHIFT);
+                    bool new_material = new_pipeline || get_material(item.key) != get_material(previous);
+                    if (new_pipeline) {
+                        recorder.bind_pipeline(get_pipeline(item.key), item.value);
+                    }
+                    // vertex buffers survive a material change but not a pipeline change, their layout may differ
+                    bool new_mesh = new_pipeline || get_mesh(item.key) != get_mesh(previous);
+                    if (new_material) {
+                        recorder.bind_material(get_material(item.key), item.value);
+                    }
+                    if (new_mesh) {
+                        recorder.bind_mesh(get_mesh(item.key), item.value);
+                    }
+                    previous = state;
+                    first = false;
+                }
+                recorder.draw(item.value);
+            }
+        }
+    }
+
+#endif
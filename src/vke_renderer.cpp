@@ -1,4 +1,5 @@
 #include "vke_renderer.hpp"
+#include "vke_cpu_trace.hpp"
 #include <GLFW/glfw3.h>
 #include <iostream>
 
@@ -6,15 +7,30 @@
 // std
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 #include <array>
+#include <chrono>
 
 namespace vke {
 
-    VkeRenderer::VkeRenderer(VkeWindow &window, VkeDevice &device) :
+    VkeRenderer::VkeRenderer(VkeWindow &window, VkeDevice &device, const SwapChainConfig &config) :
+        VkeRenderer(&window, device, config, window.getExtent())
+    {}
+
+    VkeRenderer::VkeRenderer(VkeWindow *window, VkeDevice &device, const SwapChainConfig &config, VkExtent2D offscreen_extent) :
         vke_window(window),
-        vke_device(device)
+        vke_device(device),
+        swap_chain_config(config),
+        attachment_pool(device)
     {
-        recreate_swap_chain();
+        if (is_headless()) {
+            offscreen_target = std::make_unique<VkeOffscreenTarget>(vke_device, attachment_pool, offscreen_extent, swap_chain_config.framesInFlight);
+        } else {
+            // the first swap chain needs a surface, so this waits for a minimized window once at startup
+            while (!recreate_swap_chain()) {
+                glfwWaitEvents();
+            }
+        }
         create_command_buffers();
     }
 
@@ -23,8 +39,8 @@ namespace vke {
     }
 
     void VkeRenderer::create_command_buffers() {
-        // one command buffer per frame buffer
-        command_buffer.resize(VkeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        // one command buffer per frame in flight
+        command_buffer.resize(swap_chain_config.framesInFlight);
 
         VkCommandBufferAllocateInfo alloc_info{};
         alloc_info.sType  = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -43,35 +59,122 @@ namespace vke {
         command_buffer.clear();
     }
 
-    void VkeRenderer::recreate_swap_chain() {
-        auto extent = vke_window.getExtent();
-        while(extent.width == 0 || extent.height == 0) {
-            // width or height could be 0 temporarily, wait until window has non zero size
-            extent = vke_window.getExtent();
-            glfwWaitEvents();
+    VkRenderPass VkeRenderer::get_swap_chain_render_pass() const {
+        return is_headless() ? offscreen_target->get_render_pass() : vke_swap_chain->getRenderPass();
+    }
+
+    float VkeRenderer::get_aspect_ratio() const {
+        return is_headless() ? offscreen_target->get_aspect_ratio() : vke_swap_chain->extentAspectRatio();
+    }
+
+    VkExtent2D VkeRenderer::get_extent() const {
+        return is_headless() ? offscreen_target->get_extent() : vke_swap_chain->getSwapChainExtent();
+    }
+
+    size_t VkeRenderer::get_image_count() const {
+        // one offscreen image per frame slot
+        return is_headless() ? offscreen_target->get_frames_in_flight() : vke_swap_chain->imageCount();
+    }
+
+    bool VkeRenderer::is_frame_complete(int frame_index) const {
+        return is_headless() ? offscreen_target->is_frame_complete(frame_index) : vke_swap_chain->isFrameComplete(frame_index);
+    }
+
+    bool VkeRenderer::wait_for_next_frame_slot() {
+        return is_headless() ? offscreen_target->wait_for_frame(current_frame_index) : vke_swap_chain->waitForFrame(current_frame_index);
+    }
+
+    VkPresentModeKHR VkeRenderer::get_present_mode() const {
+        // nothing is presented, fifo is what comes closest to that
+        return is_headless() ? VK_PRESENT_MODE_FIFO_KHR : vke_swap_chain->getPresentMode();
+    }
+
+    bool VkeRenderer::is_minimized() const {
+        if (is_headless()) {
+            return false;
         }
+        auto extent = vke_window->getExtent();
+        return extent.width == 0 || extent.height == 0;
+    }
 
-        vkDeviceWaitIdle(vke_device.device());
+    bool VkeRenderer::recreate_swap_chain() {
+        // width or height could be 0 temporarily, keep the current swap chain until the window has a size again
+        if (is_minimized()) {
+            return false;
+        }
+        auto extent = vke_window->getExtent();
 
         if (vke_swap_chain == nullptr) {
-            vke_swap_chain = std::make_unique<VkeSwapChain>(vke_device, extent);
+            vke_swap_chain = std::make_unique<VkeSwapChain>(vke_device, attachment_pool, extent, swap_chain_config);
         } else {
+            // no device wait, the old swap chain is destroyed once the frames submitted to it are done
             std::shared_ptr<VkeSwapChain> old_swap_chain = std::move(vke_swap_chain);
-            vke_swap_chain = std::make_unique<VkeSwapChain>(vke_device, extent, old_swap_chain);
+            vke_swap_chain = std::make_unique<VkeSwapChain>(vke_device, attachment_pool, extent, swap_chain_config, old_swap_chain);
             
             if(!old_swap_chain -> compareSwapChainFormats(*vke_swap_chain.get())) {
                 throw std::runtime_error("swap chain image format has changed");
-            }        
+            }
+
+            retired_swap_chains.push_back({old_swap_chain, swap_chain_config.framesInFlight});
         }
+
+        if (swap_chain_config.memoryReport) {
+            vke_swap_chain->writeMemoryReport(std::cout);
+        }
+        return true;
+    }
+
+    void VkeRenderer::release_retired_swap_chains() {
+        // every submit waited on the fence of its frame slot first, after a full round of slots all
+        // work recorded against the retired swap chains has finished
+        for (auto &retired : retired_swap_chains) {
+            retired.frames_left--;
+        }
+        retired_swap_chains.erase(
+            std::remove_if(retired_swap_chains.begin(), retired_swap_chains.end(), 
+                [](const RetiredSwapChain &retired) { return retired.frames_left == 0; }),
+            retired_swap_chains.end()
+        );
+    }
+
+    void VkeRenderer::set_present_mode(VkPresentModeKHR mode) {
+        if (is_headless() || mode == swap_chain_config.presentMode) {
+            return;
+        }
+        swap_chain_config.presentMode = mode;
+        swap_chain_outdated = true;
+    }
+
+    std::vector<VkPresentModeKHR> VkeRenderer::get_supported_present_modes() const {
+        if (is_headless()) {
+            return {};
+        }
+        return vke_device.getSwapChainSupport().presentModes;
     }
 
     VkCommandBuffer VkeRenderer::begin_frame() { 
+        VKE_CPU_SCOPE("begin_frame");
         assert(!is_frame_started && "Cannot call begin_frame because it is already in progress");
+
+        if (swap_chain_outdated) {
+            if (!recreate_swap_chain()) {
+                return nullptr;
+            }
+            swap_chain_outdated = false;
+        }
         
-        auto result = vke_swap_chain -> acquireNextImage(&current_image_index);
+        auto wait_start = std::chrono::steady_clock::now();
+        VkResult result = VK_SUCCESS;
+        if (is_headless()) {
+            offscreen_target->wait_for_frame(current_frame_index);
+            current_image_index = current_frame_index;
+        } else {
+            result = vke_swap_chain -> acquireNextImage(&current_image_index);
+        }
+        last_wait_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - wait_start).count();
 
         if(result == VK_ERROR_OUT_OF_DATE_KHR) {
-            recreate_swap_chain();
+            swap_chain_outdated = !recreate_swap_chain();
             return nullptr;
         }
         
@@ -94,37 +197,54 @@ namespace vke {
     }
 
     void VkeRenderer::end_frame() { 
+        VKE_CPU_SCOPE("end_frame");
         assert(is_frame_started && "Cannot end frame because there is no frame started");
         auto command_buffer = get_current_command_buffer();
 
+        if (is_headless()) {
+            offscreen_target->record_readback(command_buffer, current_frame_index);
+        }
+
         if(vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer");
         }
 
+        if (is_headless()) {
+            offscreen_target->submit(command_buffer, current_frame_index);
+            is_frame_started = false;
+            current_frame_index = (current_frame_index + 1) % swap_chain_config.framesInFlight;
+            return;
+        }
+
         auto result = vke_swap_chain -> submitCommandBuffers(&command_buffer, &current_image_index);
+        release_retired_swap_chains();
         
-        if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vke_window.was_window_resized()) {
-            vke_window.reset_window_resized_flag();
-            recreate_swap_chain();
+        if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vke_window->was_window_resized()) {
+            vke_window->reset_window_resized_flag();
+            swap_chain_outdated = !recreate_swap_chain();
         } else if(result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image");
         }
 
         is_frame_started = false;
-        current_frame_index = (current_frame_index + 1) % VkeSwapChain::MAX_FRAMES_IN_FLIGHT;
+        current_frame_index = (current_frame_index + 1) % swap_chain_config.framesInFlight;
     }
 
-    void VkeRenderer::begin_swap_chain_render_pass(VkCommandBuffer command_buffer) {
+    void VkeRenderer::begin_swap_chain_render_pass(VkCommandBuffer command_buffer, VkSubpassContents contents) {
         assert(is_frame_started && "Cannot begin swap_chain_render_pass if frame hasn't started");
         assert(command_buffer == get_current_command_buffer() && "Cannot begin render pass on command buffer from different frame");
 
+        VkExtent2D extent = get_extent();
+
         VkRenderPassBeginInfo render_pass_info{};
         render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        render_pass_info.renderPass = vke_swap_chain -> getRenderPass();
-        render_pass_info.framebuffer = vke_swap_chain -> getFrameBuffer(current_image_index);
+        render_pass_info.renderPass = get_swap_chain_render_pass();
+        render_pass_info.framebuffer = is_headless() 
+            ? offscreen_target->get_framebuffer(current_frame_index) 
+            : vke_swap_chain -> getFrameBuffer(current_frame_index, current_image_index);
 
         render_pass_info.renderArea.offset = {0, 0};
-        render_pass_info.renderArea.extent = vke_swap_chain -> getSwapChainExtent();
+        render_pass_info.renderArea.extent = extent;
 
         std::array<VkClearValue, 2> clear_values{};
         clear_values[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
@@ -133,16 +253,19 @@ namespace vke {
         render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues = clear_values.data();
 
-        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, contents);
+        if (contents != VK_SUBPASS_CONTENTS_INLINE) {
+            return;
+        }
         
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(vke_swap_chain->getSwapChainExtent().width);
-        viewport.height = static_cast<float>(vke_swap_chain->getSwapChainExtent().height);
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        VkRect2D scissor{{0, 0}, vke_swap_chain->getSwapChainExtent()};
+        VkRect2D scissor{{0, 0}, extent};
         vkCmdSetViewport(command_buffer, 0, 1, &viewport);
         vkCmdSetScissor(command_buffer, 0, 1, &scissor);
     }
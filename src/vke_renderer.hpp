@@ -5,6 +5,8 @@
     #include "vke_window.hpp"
     #include "vke_device.hpp"
     #include "vke_swap_chain.hpp"
+    #include "vke_memory_pool.hpp"
+    #include "vke_offscreen_target.hpp"
 
     // std
     #include <memory>
@@ -14,17 +16,45 @@
     namespace vke {
         class VkeRenderer {
             public:
-            VkeRenderer(VkeWindow& window, VkeDevice& device);
+            VkeRenderer(VkeWindow& window, VkeDevice& device, const SwapChainConfig& config = {});
+            // without a window (headless device) frames are rendered into offscreen images of offscreen_extent
+            VkeRenderer(VkeWindow *window, VkeDevice& device, const SwapChainConfig& config, VkExtent2D offscreen_extent);
             ~VkeRenderer();
 
             VkeRenderer(const VkeRenderer&) = delete;
             VkeRenderer& operator=(const VkeRenderer&) = delete;
 
-            VkRenderPass get_swap_chain_render_pass() const { return vke_swap_chain->getRenderPass(); }
+            VkRenderPass get_swap_chain_render_pass() const;
 
-            float get_aspect_ratio() const { return vke_swap_chain->extentAspectRatio(); }
+            float get_aspect_ratio() const;
+            VkExtent2D get_extent() const;
+
+            bool is_headless() const { return vke_window == nullptr; }
+            // offscreen target of a headless renderer, nullptr otherwise
+            VkeOffscreenTarget *get_offscreen_target() const { return offscreen_target.get(); }
 
             bool is_frame_in_progress() const { return is_frame_started; }
+            // a minimized window has no surface to render to, begin_frame returns nullptr until it is restored
+            bool is_minimized() const;
+
+            uint32_t get_frames_in_flight() const { return swap_chain_config.framesInFlight; }
+            size_t get_image_count() const;
+            // true once the gpu has finished the last submission that used this frame slot
+            bool is_frame_complete(int frame_index) const;
+
+            // slot the next begin_frame will use
+            int get_next_frame_index() const { return current_frame_index; }
+            // blocks until the gpu released the next frame slot so input can be sampled right before recording,
+            // returns false if the slot was already free
+            bool wait_for_next_frame_slot();
+
+            // the swap chain is recreated with the new mode before the next frame starts
+            void set_present_mode(VkPresentModeKHR mode);
+            VkPresentModeKHR get_present_mode() const;
+            std::vector<VkPresentModeKHR> get_supported_present_modes() const;
+
+            // seconds the last begin_frame spent blocked on the frame fence and image acquisition
+            float get_last_wait_time() const { return last_wait_time; }
 
             VkCommandBuffer get_current_command_buffer() const { 
                 assert(is_frame_started && "Cannot fetch command buffer if there is no frame in progress");
@@ -40,23 +70,40 @@
             VkCommandBuffer begin_frame();
             void end_frame();
 
-            void begin_swap_chain_render_pass(VkCommandBuffer command_buffer);
+            // with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS viewport and scissor are left to the
+            // secondary command buffers
+            void begin_swap_chain_render_pass(VkCommandBuffer command_buffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
             void end_swap_chain_render_pass(VkCommandBuffer command_buffer);
 
             private:
+            struct RetiredSwapChain {
+                std::shared_ptr<VkeSwapChain> swap_chain;
+                // frames that still have to be submitted before all its work is known to be done
+                uint32_t frames_left;
+            };
+
             void create_command_buffers();
             void free_command_buffers();
-            void recreate_swap_chain();
+            // returns false if the window is minimized and the swap chain was kept
+            bool recreate_swap_chain();
+            void release_retired_swap_chains();
 
 
-            VkeWindow& vke_window;
+            VkeWindow *vke_window;
             VkeDevice& vke_device;
+            SwapChainConfig swap_chain_config;
+            // declared before the swap chains that allocate their depth images from it
+            VkeMemoryPool attachment_pool;
             std::unique_ptr<VkeSwapChain> vke_swap_chain;
+            std::vector<RetiredSwapChain> retired_swap_chains;
+            std::unique_ptr<VkeOffscreenTarget> offscreen_target;
             std::vector<VkCommandBuffer> command_buffer;
 
             uint32_t current_image_index;
             int current_frame_index{0};
             bool is_frame_started{false};
+            bool swap_chain_outdated{false};
+            float last_wait_time{0.f};
         };
     }
 
@@ -0,0 +1,82 @@
+#include "vke_secondary_command_cache.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+
+    VkeSecondaryCommandCache::VkeSecondaryCommandCache(VkeDevice &device, uint32_t frames_in_flight) :
+        vke_device{device},
+        slots(frames_in_flight)
+    {
+        std::vector<VkCommandBuffer> command_buffers(frames_in_flight);
+
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        alloc_info.commandPool = vke_device.getCommandPool();
+        alloc_info.commandBufferCount = frames_in_flight;
+
+        if (vkAllocateCommandBuffers(vke_device.device(), &alloc_info, command_buffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffers");
+        }
+        for (uint32_t i = 0; i < frames_in_flight; i++) {
+            slots[i].command_buffer = command_buffers[i];
+        }
+    }
+
+    VkeSecondaryCommandCache::~VkeSecondaryCommandCache() {
+        for (auto &slot : slots) {
+            vkFreeCommandBuffers(vke_device.device(), vke_device.getCommandPool(), 1, &slot.command_buffer);
+        }
+    }
+
+    VkCommandBuffer VkeSecondaryCommandCache::begin(int frame_index, VkRenderPass render_pass, VkExtent2D extent) {
+        auto &slot = slots[frame_index];
+
+        // any framebuffer of the render pass, the same recording is executed for every swap chain image
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = render_pass;
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = VK_NULL_HANDLE;
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        begin_info.pInheritanceInfo = &inheritance_info;
+
+        // begin resets the buffer, the pool was created with VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+        if (vkBeginCommandBuffer(slot.command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer");
+        }
+
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.maxDepth = 1.f;
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(slot.command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(slot.command_buffer, 0, 1, &scissor);
+        return slot.command_buffer;
+    }
+
+    void VkeSecondaryCommandCache::end(int frame_index) {
+        auto &slot = slots[frame_index];
+        if (vkEndCommandBuffer(slot.command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer");
+        }
+        slot.version = version;
+        slot.recorded_this_frame = true;
+    }
+
+    void VkeSecondaryCommandCache::execute(VkCommandBuffer primary_command_buffer, int frame_index) {
+        auto &slot = slots[frame_index];
+        assert(slot.version != 0 && "Cannot execute a secondary command buffer that was never recorded");
+
+        vkCmdExecuteCommands(primary_command_buffer, 1, &slot.command_buffer);
+        (slot.recorded_this_frame ? recorded_frames : reused_frames)++;
+        slot.recorded_this_frame = false;
+    }
+}
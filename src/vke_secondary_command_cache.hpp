@@ -0,0 +1,55 @@
+#ifndef vke_secondary_command_cache_
+    #define vke_secondary_command_cache_
+
+    #include "vke_device.hpp"
+
+    // std
+    #include <cstdint>
+    #include <vector>
+
+    namespace vke {
+        // One secondary command buffer per frame slot holding the draws of a render system. A slot is only
+        // recorded again after invalidate, otherwise the primary command buffer just executes what it holds.
+        // Slots are re-recorded after the renderer waited for their fence, so a buffer is never changed while
+        // the gpu may still read it. The render pass has to be begun with
+        // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, nothing else can be recorded inline in that subpass.
+        class VkeSecondaryCommandCache {
+            public:
+            VkeSecondaryCommandCache(VkeDevice &device, uint32_t frames_in_flight);
+            ~VkeSecondaryCommandCache();
+
+            VkeSecondaryCommandCache(const VkeSecondaryCommandCache&) = delete;
+            VkeSecondaryCommandCache& operator=(const VkeSecondaryCommandCache&) = delete;
+
+            // every slot is recorded again before its next use
+            void invalidate() { version++; }
+            bool is_valid(int frame_index) const { return slots[frame_index].version == version; }
+
+            // starts recording the slot for subpass 0 of render_pass, viewport and scissor cover extent since
+            // secondary command buffers do not inherit them
+            VkCommandBuffer begin(int frame_index, VkRenderPass render_pass, VkExtent2D extent);
+            void end(int frame_index);
+            void execute(VkCommandBuffer primary_command_buffer, int frame_index);
+
+            // executions right after a new recording and executions of an older one
+            uint64_t get_recorded_frames() const { return recorded_frames; }
+            uint64_t get_reused_frames() const { return reused_frames; }
+
+            private:
+            struct Slot {
+                VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+                // version of the recorded content, 0 was never recorded
+                uint64_t version = 0;
+                bool recorded_this_frame = false;
+            };
+
+            VkeDevice &vke_device;
+            std::vector<Slot> slots;
+            uint64_t version = 1;
+
+            uint64_t recorded_frames = 0;
+            uint64_t reused_frames = 0;
+        };
+    }
+
+#endif
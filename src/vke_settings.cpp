@@ -0,0 +1,173 @@
+#include "vke_settings.hpp"
+
+// std
+#include <stdexcept>
+#include <string>
+
+namespace vke {
+
+    namespace {
+        uint32_t parse_uint(const std::string &option, const char *value) {
+            try {
+                size_t consumed = 0;
+                unsigned long result = std::stoul(value, &consumed);
+                if (consumed != std::string(value).size()) {
+                    throw std::invalid_argument(value);
+                }
+                return static_cast<uint32_t>(result);
+            } catch (const std::logic_error&) {
+                throw std::runtime_error("invalid value '" + std::string(value) + "' for " + option);
+            }
+        }
+
+        float parse_float(const std::string &option, const char *value) {
+            try {
+                size_t consumed = 0;
+                float result = std::stof(value, &consumed);
+                if (consumed != std::string(value).size() || result < 0.f) {
+                    throw std::invalid_argument(value);
+                }
+                return result;
+            } catch (const std::logic_error&) {
+                throw std::runtime_error("invalid value '" + std::string(value) + "' for " + option);
+            }
+        }
+    }
+
+    SwapChainConfig VkeSettings::swap_chain_config() const {
+        SwapChainConfig config{};
+        config.framesInFlight = frames_in_flight;
+        config.imageCount = swap_chain_image_count;
+        config.memoryReport = memory_report;
+        config.presentMode = mode_for_policy(present_policy);
+        return config;
+    }
+
+    VkeSettings VkeSettings::from_args(int argc, char **argv) {
+        VkeSettings settings{};
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+
+            // options that take a value
+            auto next_value = [&]() -> const char* {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--frames-in-flight") {
+                settings.frames_in_flight = parse_uint(arg, next_value());
+                if (settings.frames_in_flight == 0 || settings.frames_in_flight > VkeSwapChain::MAX_SUPPORTED_FRAMES_IN_FLIGHT) {
+                    throw std::runtime_error(
+                        "--frames-in-flight must be between 1 and " + std::to_string(VkeSwapChain::MAX_SUPPORTED_FRAMES_IN_FLIGHT));
+                }
+            } else if (arg == "--image-count") {
+                settings.swap_chain_image_count = parse_uint(arg, next_value());
+            } else if (arg == "--present-mode") {
+                const char *value = next_value();
+                if (!parse_present_policy(value, settings.present_policy)) {
+                    throw std::runtime_error("unknown present mode " + std::string(value));
+                }
+            } else if (arg == "--target-fps") {
+                settings.target_fps = parse_float(arg, next_value());
+            } else if (arg == "--measure-latency") {
+                settings.measure_latency = true;
+            } else if (arg == "--memory-report") {
+                settings.memory_report = true;
+            } else if (arg == "--width") {
+                settings.width = parse_uint(arg, next_value());
+            } else if (arg == "--height") {
+                settings.height = parse_uint(arg, next_value());
+            } else if (arg == "--headless") {
+                settings.headless = true;
+            } else if (arg == "--frames") {
+                settings.frame_count = parse_uint(arg, next_value());
+            } else if (arg == "--output") {
+                // writing frames only makes sense for batch rendering
+                settings.output_directory = next_value();
+                settings.headless = true;
+            } else if (arg == "--image-format") {
+                const char *value = next_value();
+                if (!parse_image_file_format(value, settings.image_format)) {
+                    throw std::runtime_error("unknown image format " + std::string(value));
+                }
+            } else if (arg == "--writer-threads") {
+                settings.writer_threads = parse_uint(arg, next_value());
+            } else if (arg == "--gpu-profile") {
+                settings.gpu_profile = true;
+            } else if (arg == "--trace") {
+                settings.trace_path = next_value();
+            } else if (arg == "--bindless") {
+                settings.bindless = true;
+            } else if (arg == "--texture") {
+                settings.texture_path = next_value();
+            } else if (arg == "--texture-budget") {
+                settings.texture_budget_mb = parse_uint(arg, next_value());
+            } else if (arg == "--lod-error") {
+                settings.lod_error = parse_float(arg, next_value());
+            } else if (arg == "--meshlets") {
+                settings.meshlets = true;
+            } else if (arg == "--upload-budget") {
+                settings.upload_budget_kb = parse_uint(arg, next_value());
+            } else if (arg == "--lights") {
+                settings.light_count = parse_uint(arg, next_value());
+            } else if (arg == "--depth-prepass") {
+                settings.depth_prepass = true;
+            } else if (arg == "--overdraw") {
+                settings.overdraw = true;
+            } else if (arg == "--cache-commands") {
+                settings.cache_commands = true;
+            } else if (arg == "--views") {
+                const char *value = next_value();
+                if (!parse_view_layout(value, settings.view_layout)) {
+                    throw std::runtime_error("unknown view layout " + std::string(value));
+                }
+            } else if (arg == "--help" || arg == "-h") {
+                settings.show_help = true;
+            } else {
+                throw std::runtime_error("unknown option " + arg + "\n" + usage());
+            }
+        }
+
+        if (settings.width == 0 || settings.height == 0) {
+            throw std::runtime_error("--width and --height must not be 0");
+        }
+
+        return settings;
+    }
+
+    std::string VkeSettings::usage() {
+        return
+            "usage: vulkantest [options]\n"
+            "  --frames-in-flight <n>   frames the cpu may record ahead of the gpu (1-3)\n"
+            "  --image-count <n>        requested swap chain images (0 = min + 1)\n"
+            "  --present-mode <mode>    fifo, fifo-relaxed, mailbox, immediate or adaptive\n"
+            "                           (cycle at runtime with V)\n"
+            "  --target-fps <fps>       limit the frame rate (0 = unlimited)\n"
+            "  --measure-latency        report input-to-present latency and frame pacing\n"
+            "  --memory-report          print the attachment memory of each swap chain\n"
+            "  --width <px>             window or offscreen width (800)\n"
+            "  --height <px>            window or offscreen height (600)\n"
+            "  --headless               render offscreen without a window\n"
+            "  --frames <n>             frames to render when headless (300)\n"
+            "  --output <dir>           write every frame to dir (implies --headless)\n"
+            "  --image-format <format>  ppm, png or raw (png)\n"
+            "  --writer-threads <n>     threads encoding frames (0 = half the cores)\n"
+            "  --gpu-profile            report gpu time of render passes and systems\n"
+            "  --trace <file>           write a chrome trace of cpu and gpu scopes at exit\n"
+            "  --bindless               draw with bindless descriptors if the device supports them\n"
+            "  --texture <file>         binary ppm streamed onto the objects with --bindless\n"
+            "  --texture-budget <mb>    device memory for streamed texture mips (256)\n"
+            "  --lod-error <px>         screen space error of mesh lods (1, 0 = full meshes)\n"
+            "  --meshlets               cull and draw meshlets, with mesh shaders if supported\n"
+            "  --upload-budget <kb>     model data uploaded per frame while streaming (4096)\n"
+            "  --lights <n>             extra point lights around the scene, shaded clustered (0)\n"
+            "  --depth-prepass          lay down depth first, then shade with an EQUAL depth test\n"
+            "  --overdraw               report fragment shader invocations per pixel\n"
+            "  --cache-commands         re-submit the recorded draws while the scene is unchanged\n"
+            "  --views <layout>         single, split (side by side) or pip (overview inset)\n"
+            "  --help                   show this message\n";
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef vke_settings_
+    #define vke_settings_
+
+    #include "vke_definitions.hpp"
+    #include "vke_present_policy.hpp"
+    #include "vke_swap_chain.hpp"
+    #include "vke_frame_writer.hpp"
+    #include "vke_view.hpp"
+
+    // std
+    #include <string>
+
+    namespace vke {
+        // runtime configuration, filled from the command line so builds don't need to be changed
+        struct VkeSettings {
+            uint32_t frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+            // 0 lets the swap chain pick minImageCount + 1
+            uint32_t swap_chain_image_count = 0;
+            PresentPolicy present_policy = PresentPolicy::Mailbox;
+            // 0 renders as fast as the present mode allows
+            float target_fps = 0.f;
+            // prints input-to-present latency statistics periodically
+            bool measure_latency = false;
+            // prints the attachment memory of each swap chain
+            bool memory_report = false;
+            // window size, or the size of the offscreen images when headless
+            uint32_t width = 800;
+            uint32_t height = 600;
+            // render offscreen without window or surface, stops after frame_count frames
+            bool headless = false;
+            uint32_t frame_count = 300;
+            // headless frames are written here if set
+            std::string output_directory{};
+            ImageFileFormat image_format = ImageFileFormat::Png;
+            // 0 uses half of the hardware threads
+            uint32_t writer_threads = 0;
+            // prints gpu timestamp statistics periodically
+            bool gpu_profile = false;
+            // chrome trace of cpu and gpu scopes, written at exit if set
+            std::string trace_path{};
+            // per object data and textures through descriptor indexing, falls back if unsupported
+            bool bindless = false;
+            // ppm texture streamed onto the objects when bindless, a checkerboard if empty
+            std::string texture_path{};
+            // device memory textures may keep resident before their finest levels are evicted
+            uint32_t texture_budget_mb = 256;
+            // screen space error in pixels the mesh lod selection accepts, 0 disables lods
+            float lod_error = 1.f;
+            // split the models into meshlets and cull them per cluster, ignored with bindless
+            bool meshlets = false;
+            // bytes of streamed models copied to the gpu per frame
+            uint32_t upload_budget_kb = 4096;
+            // point lights scattered around the scene in addition to the main light
+            uint32_t light_count = 0;
+            // depth only pass before shading, simple render system only
+            bool depth_prepass = false;
+            // report fragment shader invocations per pixel, needs pipeline statistics queries
+            bool overdraw = false;
+            // reuse the recorded draws of the simple render system while the scene is unchanged
+            bool cache_commands = false;
+            // a second camera looking at the scene from above, simple render system only
+            VkeViewLayout view_layout = VkeViewLayout::Single;
+            bool show_help = false;
+
+            SwapChainConfig swap_chain_config() const;
+
+            static VkeSettings from_args(int argc, char **argv);
+            static std::string usage();
+        };
+    }
+
+#endif
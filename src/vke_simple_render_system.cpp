@@ -1,4 +1,6 @@
 #include "vke_simple_render_system.hpp"
+#include "vke_cpu_trace.hpp"
+#include "vke_mesh_lod.hpp"
 
 
 #define GLM_FORCE_RADIANS
@@ -9,7 +11,9 @@
 // std
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 #include <array>
+#include <thread>
 
 namespace vke {
 
@@ -20,8 +24,16 @@ namespace vke {
     };
 
 
-    VkeSimpleRenderSystem::VkeSimpleRenderSystem(VkeDevice &device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout) : 
-        vke_device(device)
+    VkeSimpleRenderSystem::VkeSimpleRenderSystem(
+        VkeDevice &device,
+        VkRenderPass render_pass,
+        VkDescriptorSetLayout global_set_layout,
+        uint32_t multiview_count
+    ) : 
+        vke_device(device),
+        render_pass(render_pass),
+        multiview_count(multiview_count),
+        render_queue{std::max(std::thread::hardware_concurrency() / 2, 1u)}
     {
         create_pipeline_layout(global_set_layout);
         create_pipeline(render_pass);
@@ -53,6 +65,15 @@ namespace vke {
         }
     }
 
+    std::string VkeSimpleRenderSystem::shader_path(const char *name) const {
+        // simple_shader.vert -> simple_shader_multiview.vert, built from the same source with MULTIVIEW defined
+        std::string file{name};
+        if (multiview_count > 0) {
+            file.insert(file.find('.'), "_multiview");
+        }
+        return "../shaders/" + file + ".spv";
+    }
+
     void VkeSimpleRenderSystem::create_pipeline(VkRenderPass render_pass) {
         assert(pipeline_layout != nullptr && "Cannot create pipeline before pipeline layout");
 
@@ -64,45 +85,296 @@ namespace vke {
         pipeline_config.pipeline_layout = pipeline_layout;
         vke_pipeline = std::make_unique<VkePipeline>(
             vke_device,
-            "../shaders/simple_shader.vert.spv",
-            "../shaders/simple_shader.frag.spv",
+            shader_path("simple_shader.vert"),
+            shader_path("simple_shader.frag"),
             pipeline_config
         );
     }
 
+    void VkeSimpleRenderSystem::create_prepass_pipelines() {
+        PipelineConfigInfo depth_config{};
+        VkePipeline::defaultPipelineConfigInfo(depth_config);
+        depth_config.render_pass = render_pass;
+        depth_config.pipeline_layout = pipeline_layout;
+        depth_config.binding_descriptions = VkeModel::Vertex::get_position_binding_descriptions();
+        depth_config.attribute_descriptions = VkeModel::Vertex::get_position_attribute_descriptions();
+        depth_config.color_blend_attachment.colorWriteMask = 0;
+        depth_pipeline = std::make_unique<VkePipeline>(
+            vke_device,
+            shader_path("depth_shader.vert"),
+            "",
+            depth_config
+        );
+
+        PipelineConfigInfo equal_config{};
+        VkePipeline::defaultPipelineConfigInfo(equal_config);
+        equal_config.render_pass = render_pass;
+        equal_config.pipeline_layout = pipeline_layout;
+        equal_config.depth_stencil_info.depthWriteEnable = VK_FALSE;
+        equal_config.depth_stencil_info.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        equal_pipeline = std::make_unique<VkePipeline>(
+            vke_device,
+            shader_path("simple_shader.vert"),
+            shader_path("simple_shader.frag"),
+            equal_config
+        );
+    }
+
+    void VkeSimpleRenderSystem::set_depth_prepass(bool enabled) {
+        depth_prepass = enabled;
+        if (enabled && !depth_pipeline) {
+            create_prepass_pipelines();
+        }
+        if (command_cache) {
+            command_cache->invalidate();
+        }
+    }
+
+    void VkeSimpleRenderSystem::set_command_caching(bool enabled, uint32_t frames_in_flight) {
+        command_cache = enabled ? std::make_unique<VkeSecondaryCommandCache>(vke_device, frames_in_flight) : nullptr;
+        cached_sets.assign(enabled ? frames_in_flight : 0, VK_NULL_HANDLE);
+    }
+
+    uint64_t VkeSimpleRenderSystem::scene_signature(const FrameInfo &frame_info) const {
+        // fnv-1a, far cheaper than the matrices, lod selection and sorting a recording needs
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&](const void *bytes, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                hash ^= static_cast<const uint8_t*>(bytes)[i];
+                hash *= 1099511628211ull;
+            }
+        };
+
+        for (auto &kv : frame_info.game_objects) {
+            const auto &obj = kv.second;
+            const VkeModel *model = obj.model.get();
+            add(&kv.first, sizeof(kv.first));
+            add(&model, sizeof(model));
+            add(&obj.transform.translation, sizeof(obj.transform.translation));
+            add(&obj.transform.rotation, sizeof(obj.transform.rotation));
+            add(&obj.transform.scale, sizeof(obj.transform.scale));
+        }
+        size_t object_count = frame_info.game_objects.size();
+        add(&object_count, sizeof(object_count));
+        add(&frame_info.extent, sizeof(frame_info.extent));
+        add(&lod_error, sizeof(lod_error));
+        if (lod_error > 0.f) {
+            // the lods follow the camera
+            const glm::mat4 &view = frame_info.camera.get_view();
+            add(&view, sizeof(view));
+            add(&frame_info.viewport_height, sizeof(frame_info.viewport_height));
+        }
+        return hash;
+    }
+
+    void VkeSimpleRenderSystem::push_constants(const Draw &draw) {
+        const auto &instance = view_culler.get_instances()[draw.instance];
+        SimplePushConstantData push{};
+        push.model_matrix = instance.model_matrix;
+        push.normal_matrix = instance.normal_matrix;
+        recorder.push_constants(
+            pipeline_layout,
+            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            0,
+            sizeof(SimplePushConstantData),
+            &push
+        );
+    }
+
+    uint32_t VkeSimpleRenderSystem::mesh_id(const VkeModel *model) {
+        auto found = mesh_ids.find(model);
+        if (found != mesh_ids.end()) {
+            return found->second;
+        }
+        // more meshes in one queue than key bits, the rest share the last id and the recorder compares models
+        if (mesh_ids.size() >= SHARED_MESH_ID) {
+            return SHARED_MESH_ID;
+        }
+        return mesh_ids.emplace(model, static_cast<uint32_t>(mesh_ids.size())).first->second;
+    }
+
     void VkeSimpleRenderSystem::render_game_objects(FrameInfo frame_info) {
-        vke_pipeline -> bind(frame_info.command_buffer);
+        VKE_CPU_SCOPE("render_game_objects");
+        if (!command_cache) {
+            VkeGpuScope gpu_scope{frame_info.profiler, frame_info.command_buffer, "render_game_objects"};
+            record_draws(frame_info, frame_info.command_buffer);
+            return;
+        }
 
-        // rebind everything from beginning
-        vkCmdBindDescriptorSets(
-            frame_info.command_buffer,
+        // timestamps can not be written inline here, the subpass only takes secondary command buffers
+        uint64_t signature = scene_signature(frame_info);
+        if (signature != cached_signature) {
+            command_cache->invalidate();
+            cached_signature = signature;
+        }
+        int frame_index = frame_info.frame_index;
+        if (!command_cache->is_valid(frame_index) || cached_sets[frame_index] != frame_info.global_descriptor_set) {
+            VkCommandBuffer command_buffer = command_cache->begin(frame_index, render_pass, frame_info.extent);
+            record_draws(frame_info, command_buffer);
+            command_cache->end(frame_index);
+            cached_sets[frame_index] = frame_info.global_descriptor_set;
+        } else {
+            // draw and triangle counts still describe the executed recording
+            recorder.reset_statistics();
+        }
+        command_cache->execute(frame_info.command_buffer, frame_index);
+    }
+
+    void VkeSimpleRenderSystem::render_views(FrameInfo frame_info, const std::vector<VkeView> &views) {
+        VKE_CPU_SCOPE("render_views");
+        VkeGpuScope gpu_scope{frame_info.profiler, frame_info.command_buffer, "render_views"};
+        cull_views(frame_info, views);
+
+        if (multiview_count > 0) {
+            queue_draws(*views[0].camera, frame_info.viewport_height, ~0u);
+            record_queue(frame_info.global_descriptor_set);
+            return;
+        }
+        for (uint32_t v = 0; v < views.size(); v++) {
+            record_culled_view(v);
+        }
+    }
+
+    void VkeSimpleRenderSystem::cull_views(const FrameInfo &frame_info, const std::vector<VkeView> &views) {
+        assert(!command_cache && "Cannot cache the draws of several views");
+        assert(!views.empty() && views.size() <= VkeViewCuller::MAX_VIEWS && "Unsupported view count");
+
+        frusta.clear();
+        for (const auto &view : views) {
+            frusta.emplace_back(view.camera->get_projection() * view.camera->get_view());
+        }
+        view_culler.cull(frame_info.game_objects, frusta.data(), static_cast<uint32_t>(frusta.size()));
+        culled_views = views;
+        begin_recording(frame_info.command_buffer);
+    }
+
+    void VkeSimpleRenderSystem::record_view(uint32_t view) {
+        assert(multiview_count == 0 && "A multiview pass draws all views at once");
+        // the render pass was begun past the recorder, which sets viewport and scissor
+        recorder.invalidate();
+        record_culled_view(view);
+    }
+
+    void VkeSimpleRenderSystem::record_culled_view(uint32_t v) {
+        assert(v < culled_views.size() && "View was not culled");
+        const auto &view = culled_views[v];
+        if (view.clear) {
+            std::array<VkClearAttachment, 2> clears{};
+            clears[0].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            clears[0].colorAttachment = 0;
+            clears[0].clearValue.color = {0.0f, 0.0f, 0.0f, 1.0f};
+            clears[1].aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            clears[1].clearValue.depthStencil = {1.0f, 0};
+            VkClearRect rect{view.area, 0, 1};
+            vkCmdClearAttachments(recorder.get_command_buffer(), static_cast<uint32_t>(clears.size()), clears.data(), 1, &rect);
+        }
+
+        VkViewport viewport = view.get_viewport();
+        recorder.set_viewport(0, 1, &viewport);
+        recorder.set_scissor(0, 1, &view.area);
+        queue_draws(*view.camera, static_cast<float>(view.area.extent.height), 1u << v);
+        record_queue(view.global_descriptor_set);
+    }
+
+    void VkeSimpleRenderSystem::record_draws(const FrameInfo &frame_info, VkCommandBuffer command_buffer) {
+        // a single view draws everything, only render_views culls
+        view_culler.cull(frame_info.game_objects, nullptr, 0);
+        begin_recording(command_buffer);
+        queue_draws(frame_info.camera, frame_info.viewport_height, ~0u);
+        record_queue(frame_info.global_descriptor_set);
+    }
+
+    void VkeSimpleRenderSystem::begin_recording(VkCommandBuffer command_buffer) {
+        draw_count = 0;
+        triangle_count = 0;
+        // other systems may have recorded into the command buffer, so nothing is assumed to be bound
+        recorder.begin(command_buffer);
+        recorder.reset_statistics();
+    }
+
+    void VkeSimpleRenderSystem::queue_draws(const VkeCamera &camera, float viewport_height, uint32_t view_mask) {
+        // grouped by pipeline and mesh, so their binds are only recorded once per group, and front to
+        // back within a mesh for the depth test
+        draws.clear();
+        render_queue.clear();
+        // freed models leave stale entries behind, start over before any key of this queue holds an id
+        if (mesh_ids.size() >= SHARED_MESH_ID) {
+            mesh_ids.clear();
+        }
+        const auto &instances = view_culler.get_instances();
+        for (uint32_t i = 0; i < instances.size(); i++) {
+            const auto &instance = instances[i];
+            if ((instance.view_mask & view_mask) == 0) continue;
+            const VkeModel &model = *instance.object->model;
+
+            uint32_t lod = lod_error > 0.f 
+                ? select_lod(model, instance.model_matrix, camera, viewport_height, lod_error) 
+                : 0;
+            float depth = (camera.get_view() * glm::vec4(glm::vec3(instance.sphere), 1.f)).z;
+            uint32_t mesh = mesh_id(&model);
+            uint32_t index = static_cast<uint32_t>(draws.size());
+            draws.push_back({i, lod});
+
+            if (depth_prepass && !model.has_position_buffer()) {
+                // nothing to draw the pre-pass with, the model is tested and shaded in one go
+                render_queue.add(VkeRenderQueue::make_key(1, SHADING_PIPELINE, 0, mesh, depth), index);
+            } else if (depth_prepass) {
+                // same lods in both passes, otherwise the EQUAL test fails where the meshes differ
+                render_queue.add(VkeRenderQueue::make_key(0, DEPTH_PIPELINE, 0, mesh, depth), index);
+                render_queue.add(VkeRenderQueue::make_key(1, EQUAL_PIPELINE, 0, mesh, depth), index);
+            } else {
+                render_queue.add(VkeRenderQueue::make_key(1, SHADING_PIPELINE, 0, mesh, depth), index);
+            }
+        }
+        render_queue.sort();
+    }
+
+    void VkeSimpleRenderSystem::record_queue(VkDescriptorSet global_descriptor_set) {
+        recorder.bind_descriptor_sets(
             VK_PIPELINE_BIND_POINT_GRAPHICS,
             pipeline_layout,
             0, 1,
-            &frame_info.global_descriptor_set,
-            0, 
-            nullptr
+            &global_descriptor_set
         );
 
-        for(auto& kv : frame_info.game_objects) {
-            auto& obj = kv.second;
-            if(obj.model == nullptr) continue;
-
-            SimplePushConstantData push{};
-            
-            push.model_matrix = obj.transform.mat4();
-            push.normal_matrix = obj.transform.normal_matrix();
+        struct QueueRecorder {
+            VkeSimpleRenderSystem &system;
+            uint32_t pipeline = SHADING_PIPELINE;
+            VkeModel *bound = nullptr;
 
-            vkCmdPushConstants(
-                frame_info.command_buffer,
-                pipeline_layout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(SimplePushConstantData),
-                &push
-            );
-            obj.model->bind(frame_info.command_buffer);
-            obj.model->draw(frame_info.command_buffer);
-        }
+            VkeModel &model_of(uint32_t draw) const {
+                return *system.view_culler.get_instances()[system.draws[draw].instance].object->model;
+            }
+            void bind_pipeline(uint32_t id, uint32_t) {
+                pipeline = id;
+                auto &bound = id == DEPTH_PIPELINE ? system.depth_pipeline : id == EQUAL_PIPELINE ? system.equal_pipeline : system.vke_pipeline;
+                bound->bind(system.recorder);
+            }
+            // the simple shader has no material
+            void bind_material(uint32_t, uint32_t) {}
+            void bind_mesh(uint32_t, uint32_t draw) {
+                bound = &model_of(draw);
+                if (pipeline == DEPTH_PIPELINE) {
+                    bound->bind_positions(system.recorder);
+                } else {
+                    bound->bind(system.recorder);
+                }
+            }
+            void draw(uint32_t index) {
+                const auto &draw = system.draws[index];
+                // models sharing SHARED_MESH_ID are not told apart by the key
+                if (&model_of(index) != bound) {
+                    bind_mesh(SHARED_MESH_ID, index);
+                }
+                system.push_constants(draw);
+                model_of(index).draw(system.recorder, draw.lod);
+                if (pipeline != DEPTH_PIPELINE) {
+                    system.draw_count++;
+                    system.triangle_count += model_of(index).get_triangle_count(draw.lod);
+                }
+            }
+        };
+        QueueRecorder queue_recorder{*this};
+        render_queue.record(queue_recorder);
     }
-}
\ No newline at end of file
+}
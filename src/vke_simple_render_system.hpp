@@ -2,36 +2,134 @@
     #define vke_simple_render_system_
 
     #include "vke_pipeline.hpp"
+    #include "vke_command_recorder.hpp"
     #include "vke_device.hpp"
     #include "vke_game_object.hpp"
     #include "vke_camera.hpp"
     #include "vke_frame_info.hpp"
+    #include "vke_render_queue.hpp"
+    #include "vke_secondary_command_cache.hpp"
+    #include "vke_view.hpp"
 
     // std
     #include <memory>
+    #include <string>
+    #include <unordered_map>
     #include <vector>
 
     namespace vke {
         class VkeSimpleRenderSystem {
             public:
-            VkeSimpleRenderSystem(VkeDevice &device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
+            // with multiview_count > 0 render_pass broadcasts every draw to that many views and the pipelines
+            // use the multiview shaders, which pick GlobalUBO::view_projections[gl_ViewIndex]
+            VkeSimpleRenderSystem(
+                VkeDevice &device,
+                VkRenderPass render_pass,
+                VkDescriptorSetLayout global_set_layout,
+                uint32_t multiview_count = 0
+            );
             ~VkeSimpleRenderSystem();
 
             VkeSimpleRenderSystem(const VkeSimpleRenderSystem&) = delete;
             VkeSimpleRenderSystem& operator=(const VkeSimpleRenderSystem&) = delete;
 
             void render_game_objects(FrameInfo frame_info);
+            // Draws the objects once per view into its area, the objects are culled against all views at once
+            // and share their matrices. With a multiview render pass the draws are recorded once for the union
+            // of the views, sorted and lod selected for the first one, the areas and sets of the views are then
+            // ignored in favor of the frame's. Not combined with command caching.
+            void render_views(FrameInfo frame_info, const std::vector<VkeView> &views);
+            // render_views in steps, for views that render into render passes of their own: the views are
+            // culled once, then each record_view call records one of them into the current render pass
+            void cull_views(const FrameInfo &frame_info, const std::vector<VkeView> &views);
+            void record_view(uint32_t view);
+
+            // largest simplification error in pixels a selected lod may show, 0 draws the full meshes
+            void set_lod_error(float pixels) { lod_error = pixels; }
+            // draws the objects depth only first, the shading pass then only runs the fragment shader for
+            // the visible surface since it tests with EQUAL and does not write depth. Only models made with
+            // positions, see VkeModel::Data::build_positions, take part, the others are shaded as without it.
+            void set_depth_prepass(bool enabled);
+            // records the draws into a secondary command buffer per frame slot and executes it again while the
+            // objects, their models and transforms, the render area and, if lods are selected, the camera are
+            // unchanged. The render pass must be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+            // and the global descriptor set of a frame slot must stay the same.
+            void set_command_caching(bool enabled, uint32_t frames_in_flight);
+            // null unless caching
+            const VkeSecondaryCommandCache *get_command_cache() const { return command_cache.get(); }
+
+            // statistics of the last render_game_objects or render_views call
+            uint32_t get_draw_count() const { return draw_count; }
+            uint64_t get_triangle_count() const { return triangle_count; }
+            // state changes left after sorting, depth pre-pass included
+            uint32_t get_pipeline_bind_count() const { return get_command_statistics().get_issued(VkeCommandRecorder::Command::BindPipeline); }
+            uint32_t get_vertex_bind_count() const { return get_command_statistics().get_issued(VkeCommandRecorder::Command::BindVertexBuffers); }
+            // commands recorded and dropped as redundant by the last call
+            const VkeCommandRecorder::Statistics &get_command_statistics() const { return recorder.get_statistics(); }
+            const VkeViewCuller &get_view_culler() const { return view_culler; }
             
             private:
+            // pipeline ids of the sort keys
+            enum PipelineId : uint32_t {
+                DEPTH_PIPELINE,
+                SHADING_PIPELINE,
+                EQUAL_PIPELINE
+            };
+
+            // an instance of the culler to draw in the current view, the render queue sorts indices into draws
+            struct Draw {
+                uint32_t instance;
+                uint32_t lod;
+            };
+
+            static constexpr uint32_t SHARED_MESH_ID = (1u << VkeRenderQueue::MESH_BITS) - 1;
+
+            uint32_t mesh_id(const VkeModel *model);
+
             void create_pipeline_layout(VkDescriptorSetLayout global_set_layout);
             void create_pipeline(VkRenderPass render_pass);
+            void create_prepass_pipelines();
+            std::string shader_path(const char *name) const;
+            void push_constants(const Draw &draw);
+            void record_draws(const FrameInfo &frame_info, VkCommandBuffer command_buffer);
+            void begin_recording(VkCommandBuffer command_buffer);
+            void record_culled_view(uint32_t view);
+            // sorts the instances visible in a view of view_mask into the render queue
+            void queue_draws(const VkeCamera &camera, float viewport_height, uint32_t view_mask);
+            void record_queue(VkDescriptorSet global_descriptor_set);
+            // changes with everything a cached recording depends on besides the frame slot's descriptor set
+            uint64_t scene_signature(const FrameInfo &frame_info) const;
             
 
 
             VkeDevice &vke_device;
+            VkRenderPass render_pass;
+            uint32_t multiview_count;
 
             std::unique_ptr<VkePipeline> vke_pipeline;
+            // made on the first set_depth_prepass(true)
+            std::unique_ptr<VkePipeline> depth_pipeline;
+            std::unique_ptr<VkePipeline> equal_pipeline;
             VkPipelineLayout pipeline_layout;
+
+            float lod_error = 1.f;
+            bool depth_prepass = false;
+            VkeViewCuller view_culler{};
+            std::vector<VkeFrustum> frusta{};
+            std::vector<VkeView> culled_views{};
+            std::vector<Draw> draws{};
+            VkeRenderQueue render_queue;
+            VkeCommandRecorder recorder{};
+
+            std::unique_ptr<VkeSecondaryCommandCache> command_cache{};
+            uint64_t cached_signature = 0;
+            // global set each slot was recorded with
+            std::vector<VkDescriptorSet> cached_sets{};
+            // small ids for the sort keys, kept across frames until they run out
+            std::unordered_map<const VkeModel*, uint32_t> mesh_ids{};
+
+            uint32_t draw_count = 0;
+            uint64_t triangle_count = 0;
         };
     }
 
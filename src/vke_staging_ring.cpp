@@ -0,0 +1,48 @@
+#include "vke_staging_ring.hpp"
+
+// std
+#include <algorithm>
+
+namespace vke {
+
+    VkeStagingRing::VkeStagingRing(VkeDevice &device, VkDeviceSize capacity, uint32_t frames_in_flight) :
+        capacity{capacity},
+        frame_ends(frames_in_flight, 0)
+    {
+        buffer = std::make_unique<VkeBuffer>(
+            device,
+            1,
+            static_cast<uint32_t>(capacity),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffer->map();
+    }
+
+    void VkeStagingRing::begin_frame(int frame_index) {
+        // frames complete in submission order, everything up to the slot's last allocation is done
+        tail = std::max(tail, frame_ends[frame_index]);
+        current_frame = frame_index;
+    }
+
+    bool VkeStagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) {
+        if (size > capacity) {
+            return false;
+        }
+
+        alignment = std::max<VkDeviceSize>(alignment, 1);
+        uint64_t start = (head + alignment - 1) / alignment * alignment;
+        if (start % capacity + size > capacity) {
+            // skip the rest of the ring instead of splitting the allocation
+            start = (start / capacity + 1) * capacity;
+        }
+        if (start + size - tail > capacity) {
+            return false;
+        }
+
+        offset = start % capacity;
+        head = start + size;
+        frame_ends[current_frame] = head;
+        return true;
+    }
+}
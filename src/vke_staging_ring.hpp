@@ -0,0 +1,48 @@
+#ifndef vke_staging_ring_
+    #define vke_staging_ring_
+
+    #include "vke_device.hpp"
+    #include "vke_buffer.hpp"
+
+    // std
+    #include <cstdint>
+    #include <memory>
+    #include <vector>
+
+    namespace vke {
+        // Persistently mapped host visible buffer that upload copies are recorded from. Allocations are
+        // handed out in a ring and belong to the frame they were made in, they are reclaimed when
+        // begin_frame is called for that frame slot again, after its fence signalled. Uploads never wait
+        // for the queue, when the ring is full allocate fails and the caller retries in a later frame.
+        class VkeStagingRing {
+            public:
+            VkeStagingRing(VkeDevice &device, VkDeviceSize capacity, uint32_t frames_in_flight);
+
+            VkeStagingRing(const VkeStagingRing&) = delete;
+            VkeStagingRing& operator=(const VkeStagingRing&) = delete;
+
+            void begin_frame(int frame_index);
+
+            // offset into get_buffer, the allocation is never split at the end of the ring
+            bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+            void *get_mapped(VkDeviceSize offset) const { return static_cast<uint8_t*>(buffer->get_mapped_memory()) + offset; }
+
+            VkBuffer get_buffer() const { return buffer->get_buffer(); }
+            VkDeviceSize get_capacity() const { return capacity; }
+            // bytes not yet reclaimed, including alignment and wrap around padding
+            VkDeviceSize get_used() const { return head - tail; }
+
+            private:
+            VkDeviceSize capacity;
+            std::unique_ptr<VkeBuffer> buffer;
+
+            // monotonic positions, the ring offset is position % capacity
+            uint64_t head = 0;
+            uint64_t tail = 0;
+            // head after the last allocation of each frame slot
+            std::vector<uint64_t> frame_ends;
+            int current_frame = 0;
+        };
+    }
+
+#endif
@@ -1,10 +1,12 @@
 #include "vke_swap_chain.hpp"
-#include "vke_definitions.hpp"
+#include "vke_cpu_trace.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <set>
@@ -12,21 +14,37 @@
 
 namespace vke {
 
-VkeSwapChain::VkeSwapChain(VkeDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+VkeSwapChain::VkeSwapChain(
+    VkeDevice &deviceRef,
+    VkeMemoryPool &attachmentPool,
+    VkExtent2D extent,
+    const SwapChainConfig &config)
+    : device{deviceRef}, attachmentPool{attachmentPool}, windowExtent{extent}, config{config} {
   init();
 }
 
-VkeSwapChain::VkeSwapChain(VkeDevice &deviceRef, VkExtent2D extent, std::shared_ptr<VkeSwapChain> previous) 
-  : device{deviceRef}, windowExtent{extent}, old_swap_chain{previous} 
+VkeSwapChain::VkeSwapChain(
+    VkeDevice &deviceRef,
+    VkeMemoryPool &attachmentPool,
+    VkExtent2D extent,
+    const SwapChainConfig &config,
+    std::shared_ptr<VkeSwapChain> previous)
+  : device{deviceRef}, attachmentPool{attachmentPool}, windowExtent{extent}, config{config}, old_swap_chain{previous} 
   {
     init();
 
+    // keep the frame slot in lockstep with the renderer, which does not restart at 0
+    currentFrame = previous->currentFrame % config.framesInFlight;
+
     // clean up
     old_swap_chain = nullptr;
   }
 
 void VkeSwapChain::init() {
+  if (config.framesInFlight == 0 || config.framesInFlight > MAX_SUPPORTED_FRAMES_IN_FLIGHT) {
+    throw std::runtime_error("unsupported number of frames in flight");
+  }
+
   createSwapChain();
   createImageViews();
   createRenderPass();
@@ -49,17 +67,29 @@ VkeSwapChain::~VkeSwapChain() {
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
     vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+    attachmentPool.free(depthImageAllocations[i]);
   }
 
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  // null if a newer swap chain took it over
+  if (renderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  }
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  // cleanup synchronization objects, empty if a newer swap chain took them over. the fences are
+  // normally signaled already since retired swap chains are kept until their frames finished
+  if (!inFlightFences.empty()) {
+    vkWaitForFences(
+        device.device(),
+        static_cast<uint32_t>(inFlightFences.size()),
+        inFlightFences.data(),
+        VK_TRUE,
+        std::numeric_limits<uint64_t>::max());
+  }
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device.device(), inFlightFences[i], nullptr);
@@ -67,6 +97,7 @@ VkeSwapChain::~VkeSwapChain() {
 }
 
 VkResult VkeSwapChain::acquireNextImage(uint32_t *imageIndex) {
+  VKE_CPU_SCOPE("acquireNextImage");
   vkWaitForFences(
       device.device(),
       1,
@@ -85,8 +116,26 @@ VkResult VkeSwapChain::acquireNextImage(uint32_t *imageIndex) {
   return result;
 }
 
+bool VkeSwapChain::isFrameComplete(int frameIndex) {
+  return vkGetFenceStatus(device.device(), inFlightFences[frameIndex]) == VK_SUCCESS;
+}
+
+bool VkeSwapChain::waitForFrame(int frameIndex) {
+  if (isFrameComplete(frameIndex)) {
+    return false;
+  }
+  vkWaitForFences(
+      device.device(),
+      1,
+      &inFlightFences[frameIndex],
+      VK_TRUE,
+      std::numeric_limits<uint64_t>::max());
+  return true;
+}
+
 VkResult VkeSwapChain::submitCommandBuffers(
     const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+  VKE_CPU_SCOPE("submitCommandBuffers");
   if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
     vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
   }
@@ -128,7 +177,7 @@ VkResult VkeSwapChain::submitCommandBuffers(
 
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % config.framesInFlight;
 
   return result;
 }
@@ -137,10 +186,13 @@ void VkeSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
   uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  if (config.imageCount > 0) {
+    imageCount = std::max(config.imageCount, swapChainSupport.capabilities.minImageCount);
+  }
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -216,8 +268,17 @@ void VkeSwapChain::createImageViews() {
 }
 
 void VkeSwapChain::createRenderPass() {
+  swapChainDepthFormat = findDepthFormat();
+
+  // a render pass only depends on the attachment formats, so a resize can keep the old one
+  if (old_swap_chain != nullptr && compareSwapChainFormats(*old_swap_chain)) {
+    renderPass = old_swap_chain->renderPass;
+    old_swap_chain->renderPass = VK_NULL_HANDLE;
+    return;
+  }
+
   VkAttachmentDescription depthAttachment{};
-  depthAttachment.format = findDepthFormat();
+  depthAttachment.format = swapChainDepthFormat;
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -276,38 +337,41 @@ void VkeSwapChain::createRenderPass() {
 }
 
 void VkeSwapChain::createFramebuffers() {
-  swapChainFramebuffers.resize(imageCount());
-  for (size_t i = 0; i < imageCount(); i++) {
-    std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
-
-    VkExtent2D swapChainExtent = getSwapChainExtent();
-    VkFramebufferCreateInfo framebufferInfo = {};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = renderPass;
-    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    framebufferInfo.pAttachments = attachments.data();
-    framebufferInfo.width = swapChainExtent.width;
-    framebufferInfo.height = swapChainExtent.height;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(
-            device.device(),
-            &framebufferInfo,
-            nullptr,
-            &swapChainFramebuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create framebuffer!");
+  swapChainFramebuffers.resize(config.framesInFlight * imageCount());
+  for (size_t frame = 0; frame < config.framesInFlight; frame++) {
+    for (size_t i = 0; i < imageCount(); i++) {
+      std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[frame]};
+
+      VkExtent2D swapChainExtent = getSwapChainExtent();
+      VkFramebufferCreateInfo framebufferInfo = {};
+      framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+      framebufferInfo.renderPass = renderPass;
+      framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+      framebufferInfo.pAttachments = attachments.data();
+      framebufferInfo.width = swapChainExtent.width;
+      framebufferInfo.height = swapChainExtent.height;
+      framebufferInfo.layers = 1;
+
+      if (vkCreateFramebuffer(
+              device.device(),
+              &framebufferInfo,
+              nullptr,
+              &swapChainFramebuffers[frame * imageCount() + i]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create framebuffer!");
+      }
     }
   }
 }
 
 void VkeSwapChain::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat();
-  swapChainDepthFormat = depthFormat;
+  VkFormat depthFormat = swapChainDepthFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
+  // depth is cleared on load and never stored, so frames that can't overlap on the gpu can share
+  // one image. only frames in flight need their own
+  depthImages.resize(config.framesInFlight);
+  depthImageAllocations.resize(config.framesInFlight);
+  depthImageViews.resize(config.framesInFlight);
 
   for (int i = 0; i < depthImages.size(); i++) {
     VkImageCreateInfo imageInfo{};
@@ -321,16 +385,17 @@ void VkeSwapChain::createDepthResources() {
     imageInfo.format = depthFormat;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
-    device.createImageWithInfo(
+    // tile based gpus keep transient attachments in tile memory and never back lazily allocated memory
+    depthImageAllocations[i] = attachmentPool.create_image(
         imageInfo,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         depthImages[i],
-        depthImageMemorys[i]);
+        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -350,11 +415,24 @@ void VkeSwapChain::createDepthResources() {
 }
 
 void VkeSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
   imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
+  // the fences guard frame slots rather than images, moving them over lets the first frames on the
+  // new swap chain wait for the work still running on the old one
+  if (old_swap_chain != nullptr && old_swap_chain->config.framesInFlight == config.framesInFlight) {
+    imageAvailableSemaphores = std::move(old_swap_chain->imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(old_swap_chain->renderFinishedSemaphores);
+    inFlightFences = std::move(old_swap_chain->inFlightFences);
+    old_swap_chain->imageAvailableSemaphores.clear();
+    old_swap_chain->renderFinishedSemaphores.clear();
+    old_swap_chain->inFlightFences.clear();
+    return;
+  }
+
+  imageAvailableSemaphores.resize(config.framesInFlight);
+  renderFinishedSemaphores.resize(config.framesInFlight);
+  inFlightFences.resize(config.framesInFlight);
+
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
@@ -362,7 +440,7 @@ void VkeSwapChain::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < config.framesInFlight; i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
@@ -373,6 +451,28 @@ void VkeSwapChain::createSyncObjects() {
   }
 }
 
+void VkeSwapChain::writeMemoryReport(std::ostream &out) {
+  constexpr double MIB = 1024.0 * 1024.0;
+  // swap chain images belong to the presentation engine and can't be queried, assume 4 bytes per pixel
+  double colorSize = 4.0 * swapChainExtent.width * swapChainExtent.height / MIB;
+  double depthSize = depthImageAllocations.empty() ? 0.0 : depthImageAllocations[0].size / MIB;
+  bool lazy = !depthImageAllocations.empty() &&
+              (depthImageAllocations[0].properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+  out << std::fixed << std::setprecision(2)
+      << "[memory] swap chain " << swapChainExtent.width << "x" << swapChainExtent.height
+      << ", " << imageCount() << " images, " << config.framesInFlight << " frames in flight, "
+      << presentModeName(presentMode) << '\n'
+      << "  color images: " << imageCount() << " x " << colorSize << " MiB (estimated)" << '\n'
+      << "  depth images: " << depthImages.size() << " x " << depthSize << " MiB, "
+      << (lazy ? "lazily allocated" : "device local") << '\n'
+      << "  depth saved over one per image: "
+      << (static_cast<double>(imageCount()) - static_cast<double>(depthImages.size())) * depthSize << " MiB" << '\n'
+      << "  framebuffers: " << swapChainFramebuffers.size() << '\n'
+      << "  attachment pool: " << attachmentPool.get_used_size() / MIB << " MiB used of "
+      << attachmentPool.get_reserved_size() / MIB << " MiB reserved" << '\n';
+}
+
 VkSurfaceFormatKHR VkeSwapChain::chooseSwapSurfaceFormat(
     const std::vector<VkSurfaceFormatKHR> &availableFormats) {
   for (const auto &availableFormat : availableFormats) {
@@ -387,29 +487,28 @@ VkSurfaceFormatKHR VkeSwapChain::chooseSwapSurfaceFormat(
 
 VkPresentModeKHR VkeSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
+  for (const auto &availablePresentMode : availablePresentModes) {
+    if (availablePresentMode == config.presentMode) {
+      std::cout << "Present mode: " << presentModeName(availablePresentMode) << std::endl;
+      return availablePresentMode;
+    }
+  }
 
-    #ifdef SYNC_MAILBOX
-      for (const auto &availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-          std::cout << "Present mode: Mailbox" << std::endl;
-          return availablePresentMode;
-        }
-      }
-    #elif defined SYNC_IMMEDIATE
-      for (const auto &availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-          std::cout << "Present mode: Immediate" << std::endl;
-          return availablePresentMode;
-        }
-      }
-    #else
-      throw std::runtime_error("no sync method selected");
-    #endif
-
+  // fifo is always available
   std::cout << "Present mode: V-Sync" << std::endl;
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char *VkeSwapChain::presentModeName(VkPresentModeKHR mode) {
+  switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR: return "V-Sync";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "Relaxed V-Sync";
+    default: return "Unknown";
+  }
+}
+
 VkExtent2D VkeSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
     return capabilities.currentExtent;
@@ -2,6 +2,7 @@
   #define vke_swap_chain_
 
 #include "vke_device.hpp"
+#include "vke_memory_pool.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -10,26 +11,57 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <ostream>
 
 namespace vke {
 
+struct SwapChainConfig {
+  uint32_t framesInFlight = 2;
+  // 0 requests minImageCount + 1, anything else is clamped to the surface limits
+  uint32_t imageCount = 0;
+  // falls back to fifo if the surface does not support it
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  // print the attachment memory of every created swap chain
+  bool memoryReport = false;
+};
+
 class VkeSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-  VkeSwapChain(VkeDevice &deviceRef, VkExtent2D windowExtent);
-  VkeSwapChain(VkeDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<VkeSwapChain> previous);
+  static constexpr uint32_t MAX_SUPPORTED_FRAMES_IN_FLIGHT = 3;
+
+  VkeSwapChain(
+      VkeDevice &deviceRef,
+      VkeMemoryPool &attachmentPool,
+      VkExtent2D windowExtent,
+      const SwapChainConfig &config);
+  // takes over the render pass and synchronization objects of previous where they are compatible,
+  // previous must be kept alive until the frames it submitted have finished
+  VkeSwapChain(
+      VkeDevice &deviceRef,
+      VkeMemoryPool &attachmentPool,
+      VkExtent2D windowExtent,
+      const SwapChainConfig &config,
+      std::shared_ptr<VkeSwapChain> previous);
   ~VkeSwapChain();
 
   VkeSwapChain(const VkeSwapChain &) = delete;
   VkeSwapChain& operator=(const VkeSwapChain &) = delete;
 
-  VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
+  // the depth attachment belongs to the frame slot, so there is a framebuffer per slot and image
+  VkFramebuffer getFrameBuffer(int frameIndex, int imageIndex) {
+    return swapChainFramebuffers[frameIndex * imageCount() + imageIndex];
+  }
   VkRenderPass getRenderPass() { return renderPass; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
   size_t imageCount() { return swapChainImages.size(); }
+  uint32_t framesInFlight() const { return config.framesInFlight; }
+  VkFence getInFlightFence(int frameIndex) { return inFlightFences[frameIndex]; }
+  bool isFrameComplete(int frameIndex);
+  // blocks until the frame slot is free, returns false if it already was
+  bool waitForFrame(int frameIndex);
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
+  VkPresentModeKHR getPresentMode() const { return presentMode; }
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
 
@@ -37,6 +69,9 @@ class VkeSwapChain {
     return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
   }
   VkFormat findDepthFormat();
+  static const char *presentModeName(VkPresentModeKHR mode);
+
+  void writeMemoryReport(std::ostream &out);
 
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
@@ -64,18 +99,21 @@ class VkeSwapChain {
   VkFormat swapChainImageFormat;
   VkFormat swapChainDepthFormat;
   VkExtent2D swapChainExtent;
+  VkPresentModeKHR presentMode;
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
 
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
+  std::vector<VkePoolAllocation> depthImageAllocations;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
   VkeDevice &device;
+  VkeMemoryPool &attachmentPool;
   VkExtent2D windowExtent;
+  SwapChainConfig config;
 
   VkSwapchainKHR swapChain;
   std::shared_ptr<VkeSwapChain> old_swap_chain;
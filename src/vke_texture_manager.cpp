@@ -0,0 +1,535 @@
+#include "vke_texture_manager.hpp"
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace vke {
+
+    namespace {
+        constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+        void transition_image(
+            VkCommandBuffer command_buffer,
+            VkImage image,
+            uint32_t base_level,
+            uint32_t level_count,
+            VkImageLayout old_layout,
+            VkImageLayout new_layout,
+            VkPipelineStageFlags src_stage,
+            VkAccessFlags src_access,
+            VkPipelineStageFlags dst_stage,
+            VkAccessFlags dst_access
+        ) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = src_access;
+            barrier.dstAccessMask = dst_access;
+            barrier.oldLayout = old_layout;
+            barrier.newLayout = new_layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = base_level;
+            barrier.subresourceRange.levelCount = level_count;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        VkBufferImageCopy level_copy(VkDeviceSize buffer_offset, uint32_t mip_level, const VkeImageData &level) {
+            VkBufferImageCopy region{};
+            region.bufferOffset = buffer_offset;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = mip_level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = {level.width, level.height, 1};
+            return region;
+        }
+    }
+
+    VkeTextureManager::VkeTextureManager(
+        VkeDevice &device,
+        VkeBindlessTable &bindless_table,
+        uint32_t frames_in_flight,
+        VkDeviceSize budget_bytes,
+        uint32_t worker_count,
+        VkDeviceSize staging_size
+    ) :
+        vke_device{device},
+        bindless_table{bindless_table},
+        frames_in_flight{frames_in_flight},
+        budget{budget_bytes},
+        staging{device, staging_size, frames_in_flight}
+    {
+        create_sampler();
+        create_placeholder();
+
+        for (uint32_t i = 0; i < std::max(worker_count, 1u); i++) {
+            workers.emplace_back(&VkeTextureManager::worker_loop, this);
+        }
+    }
+
+    VkeTextureManager::~VkeTextureManager() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        jobs_changed.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        // the owner waited for the device, nothing is in flight anymore
+        for (auto &texture : textures) {
+            bindless_table.release_sampled_image(texture.slot);
+            destroy(texture.gpu);
+        }
+        for (auto &retired : retired_images) {
+            destroy(retired.gpu);
+        }
+        bindless_table.release_sampled_image(placeholder_slot);
+        destroy(placeholder);
+        vkDestroySampler(vke_device.device(), sampler, nullptr);
+    }
+
+    void VkeTextureManager::create_sampler() {
+        VkSamplerCreateInfo sampler_info{};
+        sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        sampler_info.magFilter = VK_FILTER_LINEAR;
+        sampler_info.minFilter = VK_FILTER_LINEAR;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        // samplerAnisotropy is enabled on every device the engine picks
+        sampler_info.anisotropyEnable = VK_TRUE;
+        sampler_info.maxAnisotropy = vke_device.properties.limits.maxSamplerAnisotropy;
+        sampler_info.compareEnable = VK_FALSE;
+        sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+        // level 0 of a view is always the finest resident level
+        sampler_info.minLod = 0.f;
+        sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+        sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        sampler_info.unnormalizedCoordinates = VK_FALSE;
+
+        if (vkCreateSampler(vke_device.device(), &sampler_info, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture sampler!");
+        }
+    }
+
+    void VkeTextureManager::create_placeholder() {
+        VkeImageData white{1, 1, {255, 255, 255, 255}};
+        placeholder = create_image(white, 1);
+
+        VkDeviceSize offset = 0;
+        staging.allocate(white.get_size(), 4, offset);
+        std::memcpy(staging.get_mapped(offset), white.pixels.data(), white.get_size());
+
+        VkCommandBuffer command_buffer = vke_device.beginSingleTimeCommands();
+        transition_image(
+            command_buffer, placeholder.image, 0, 1,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT
+        );
+        VkBufferImageCopy region = level_copy(offset, 0, white);
+        vkCmdCopyBufferToImage(command_buffer, staging.get_buffer(), placeholder.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        transition_image(
+            command_buffer, placeholder.image, 0, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+        vke_device.endSingleTimeCommands(command_buffer);
+
+        placeholder_slot = bindless_table.add_sampled_image({sampler, placeholder.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+    }
+
+    VkeTextureManager::GpuImage VkeTextureManager::create_image(const VkeImageData &base, uint32_t level_count) {
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = TEXTURE_FORMAT;
+        image_info.extent = {base.width, base.height, 1};
+        image_info.mipLevels = level_count;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        // transfer source so the levels can be copied into the next image of the texture
+        image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        GpuImage gpu{};
+        vke_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, gpu.image, gpu.memory);
+
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = gpu.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = TEXTURE_FORMAT;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = level_count;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(vke_device.device(), &view_info, nullptr, &gpu.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+        return gpu;
+    }
+
+    void VkeTextureManager::destroy(GpuImage &gpu) {
+        if (gpu.image == VK_NULL_HANDLE) {
+            return;
+        }
+        vkDestroyImageView(vke_device.device(), gpu.view, nullptr);
+        vkDestroyImage(vke_device.device(), gpu.image, nullptr);
+        vke_device.freeMemory(gpu.memory);
+        gpu = GpuImage{};
+    }
+
+    VkeTextureManager::TextureId VkeTextureManager::load(const std::string &path) {
+        return add_job(path, {});
+    }
+
+    VkeTextureManager::TextureId VkeTextureManager::create(VkeImageData image) {
+        return add_job({}, std::move(image));
+    }
+
+    VkeTextureManager::TextureId VkeTextureManager::add_job(std::string path, VkeImageData image) {
+        TextureId texture = static_cast<TextureId>(textures.size());
+        textures.emplace_back();
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back({texture, std::move(path), std::move(image)});
+            pending_loads++;
+        }
+        jobs_changed.notify_one();
+        return texture;
+    }
+
+    void VkeTextureManager::worker_loop() {
+        VkeCpuTrace::set_thread_name("texture loader");
+        while (true) {
+            std::unique_lock<std::mutex> lock{mutex};
+            jobs_changed.wait(lock, [&]() { return !jobs.empty() || stopping; });
+            if (stopping) {
+                return;
+            }
+            LoadJob job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+
+            LoadResult result{job.texture, {}, {}};
+            try {
+                VKE_CPU_SCOPE("load texture");
+                VkeImageData image = job.path.empty() ? std::move(job.image) : VkeImageData::load(job.path);
+                if (image.width == 0 || image.height == 0 || image.get_size() != static_cast<size_t>(image.width) * image.height * 4) {
+                    throw std::runtime_error("invalid texture image " + job.path);
+                }
+                result.levels = generate_mip_chain(std::move(image));
+            } catch (const std::exception &e) {
+                result.error = e.what();
+            }
+
+            lock.lock();
+            results.push_back(std::move(result));
+            pending_loads--;
+        }
+    }
+
+    void VkeTextureManager::collect_loads() {
+        std::vector<LoadResult> finished{};
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            finished.swap(results);
+        }
+        for (auto &result : finished) {
+            auto &texture = textures[result.texture];
+            if (!result.error.empty()) {
+                // the texture keeps showing the placeholder
+                std::cerr << "failed to load texture: " << result.error << '\n';
+                texture.state = State::Failed;
+                totals.failed_loads++;
+                continue;
+            }
+            texture.levels = std::move(result.levels);
+            texture.state = State::Ready;
+        }
+    }
+
+    void VkeTextureManager::request(TextureId texture, float screen_size) {
+        auto &entry = textures[texture];
+        if (entry.requested_frame != frame_number) {
+            entry.requested_frame = frame_number;
+            entry.requested_size = 0.f;
+        }
+        entry.requested_size = std::max(entry.requested_size, screen_size);
+    }
+
+    uint32_t VkeTextureManager::tail_level(const Texture &texture) const {
+        uint32_t level = 0;
+        while (level + 1 < texture.levels.size() && std::max(texture.levels[level].width, texture.levels[level].height) > TAIL_SIZE) {
+            level++;
+        }
+        return level;
+    }
+
+    uint32_t VkeTextureManager::wanted_level(const Texture &texture) const {
+        uint32_t tail = tail_level(texture);
+        if (texture.requested_frame != frame_number || texture.requested_size < 1.f) {
+            return tail;
+        }
+
+        // one texel per pixel, assuming the texture is mapped once over the object
+        float largest = static_cast<float>(std::max(texture.levels[0].width, texture.levels[0].height));
+        float level = std::floor(std::log2(largest / texture.requested_size));
+        uint32_t wanted = level <= 0.f ? 0 : std::min(static_cast<uint32_t>(level), tail);
+
+        // a level is uploaded in one piece, it has to fit into the staging ring
+        while (wanted < tail && texture.levels[wanted].get_size() > staging.get_capacity()) {
+            wanted++;
+        }
+        return wanted;
+    }
+
+    VkDeviceSize VkeTextureManager::level_bytes(const Texture &texture, uint32_t first_level) const {
+        VkDeviceSize size = 0;
+        for (uint32_t level = first_level; level < texture.levels.size(); level++) {
+            size += texture.levels[level].get_size();
+        }
+        return size;
+    }
+
+    bool VkeTextureManager::set_resident_level(VkCommandBuffer command_buffer, Texture &texture, uint32_t first_level) {
+        const uint32_t level_count = static_cast<uint32_t>(texture.levels.size());
+        GpuImage old = texture.gpu;
+        const bool has_old = old.image != VK_NULL_HANDLE;
+
+        // levels the old image does not hold come through the staging ring, the rest is copied on the gpu
+        const uint32_t copy_begin = has_old ? std::max(old.base_level, first_level) : level_count;
+        VkDeviceSize upload_size = 0;
+        for (uint32_t level = first_level; level < copy_begin; level++) {
+            upload_size += texture.levels[level].get_size();
+        }
+        VkDeviceSize staging_offset = 0;
+        VkDeviceSize alignment = std::max<VkDeviceSize>(vke_device.properties.limits.optimalBufferCopyOffsetAlignment, 4);
+        if (upload_size > 0 && !staging.allocate(upload_size, alignment, staging_offset)) {
+            return false;
+        }
+
+        GpuImage gpu = create_image(texture.levels[first_level], level_count - first_level);
+        gpu.base_level = first_level;
+        gpu.size = level_bytes(texture, first_level);
+
+        transition_image(
+            command_buffer, gpu.image, 0, level_count - first_level,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT
+        );
+
+        if (upload_size > 0) {
+            std::vector<VkBufferImageCopy> regions{};
+            VkDeviceSize offset = staging_offset;
+            for (uint32_t level = first_level; level < copy_begin; level++) {
+                const auto &data = texture.levels[level];
+                std::memcpy(staging.get_mapped(offset), data.pixels.data(), data.get_size());
+                regions.push_back(level_copy(offset, level - first_level, data));
+                // level sizes are multiples of the texel size, which is all the following offsets need
+                offset += data.get_size();
+            }
+            vkCmdCopyBufferToImage(
+                command_buffer,
+                staging.get_buffer(),
+                gpu.image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(regions.size()),
+                regions.data()
+            );
+        }
+
+        if (copy_begin < level_count) {
+            // frames still in flight may sample the old image, the barrier waits for their fragment shaders
+            transition_image(
+                command_buffer, old.image, copy_begin - old.base_level, level_count - copy_begin,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT
+            );
+
+            std::vector<VkImageCopy> regions{};
+            for (uint32_t level = copy_begin; level < level_count; level++) {
+                VkImageCopy region{};
+                region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - old.base_level, 0, 1};
+                region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - first_level, 0, 1};
+                region.extent = {texture.levels[level].width, texture.levels[level].height, 1};
+                regions.push_back(region);
+            }
+            vkCmdCopyImage(
+                command_buffer,
+                old.image,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                gpu.image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(regions.size()),
+                regions.data()
+            );
+        }
+
+        transition_image(
+            command_buffer, gpu.image, 0, level_count - first_level,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+
+        // in flight frames keep the old slot, this and later frames use the new one
+        uint32_t slot = bindless_table.add_sampled_image({sampler, gpu.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+        bindless_table.release_sampled_image(texture.slot);
+        texture.slot = slot;
+
+        if (has_old) {
+            if (first_level < old.base_level) {
+                totals.streamed_levels += old.base_level - first_level;
+            } else {
+                totals.evicted_levels += first_level - old.base_level;
+            }
+            resident_bytes -= old.size;
+            retired_images.push_back({old, frame_number});
+        }
+        texture.gpu = gpu;
+        resident_bytes += gpu.size;
+        totals.uploaded_bytes += upload_size;
+        return true;
+    }
+
+    void VkeTextureManager::evict(VkCommandBuffer command_buffer, VkDeviceSize needed) {
+        while (resident_bytes + needed > budget) {
+            Texture *victim = nullptr;
+            for (auto &texture : textures) {
+                if (texture.gpu.image == VK_NULL_HANDLE || texture.gpu.base_level >= tail_level(texture)) {
+                    continue;
+                }
+                if (texture.requested_frame == frame_number && texture.gpu.base_level >= wanted_level(texture)) {
+                    continue;
+                }
+                if (victim == nullptr || texture.requested_frame < victim->requested_frame) {
+                    victim = &texture;
+                }
+            }
+            if (victim == nullptr) {
+                return;
+            }
+            // only copies on the gpu, never needs the staging ring
+            set_resident_level(command_buffer, *victim, victim->gpu.base_level + 1);
+        }
+    }
+
+    void VkeTextureManager::update(VkCommandBuffer command_buffer, int frame_index) {
+        VKE_CPU_SCOPE("texture streaming");
+
+        staging.begin_frame(frame_index);
+
+        // the command buffers that copied from retired images have completed
+        auto first_kept = std::stable_partition(retired_images.begin(), retired_images.end(), [&](const RetiredImage &retired) {
+            return retired.frame + frames_in_flight <= frame_number;
+        });
+        for (auto it = retired_images.begin(); it != first_kept; ++it) {
+            destroy(it->gpu);
+        }
+        retired_images.erase(retired_images.begin(), first_kept);
+
+        collect_loads();
+
+        uint32_t updates = 0;
+        std::vector<Texture*> upgrades{};
+        for (auto &texture : textures) {
+            if (texture.state != State::Ready) {
+                continue;
+            }
+            if (texture.gpu.image == VK_NULL_HANDLE) {
+                // the tail levels make a newly loaded texture visible as soon as possible
+                if (updates < MAX_UPDATES_PER_FRAME) {
+                    uint32_t tail = tail_level(texture);
+                    evict(command_buffer, level_bytes(texture, tail));
+                    if (set_resident_level(command_buffer, texture, tail)) {
+                        updates++;
+                    }
+                }
+            } else if (wanted_level(texture) < texture.gpu.base_level) {
+                upgrades.push_back(&texture);
+            }
+        }
+
+        // largest on screen first, one level per texture and frame
+        std::sort(upgrades.begin(), upgrades.end(), [](const Texture *a, const Texture *b) {
+            return a->requested_size > b->requested_size;
+        });
+        for (auto *texture : upgrades) {
+            if (updates >= MAX_UPDATES_PER_FRAME) {
+                break;
+            }
+            uint32_t level = texture->gpu.base_level - 1;
+            VkDeviceSize needed = texture->levels[level].get_size();
+            evict(command_buffer, needed);
+            if (resident_bytes + needed > budget) {
+                continue;
+            }
+            if (!set_resident_level(command_buffer, *texture, level)) {
+                // the ring is full until older frames complete
+                break;
+            }
+            updates++;
+        }
+
+        // the budget may have been lowered
+        evict(command_buffer, 0);
+
+        frame_number++;
+    }
+
+    uint32_t VkeTextureManager::get_slot(TextureId texture) const {
+        if (texture >= textures.size() || textures[texture].slot == VkeBindlessTable::INVALID_SLOT) {
+            return placeholder_slot;
+        }
+        return textures[texture].slot;
+    }
+
+    uint32_t VkeTextureManager::get_resident_level(TextureId texture) const {
+        const auto &entry = textures[texture];
+        return entry.gpu.image == VK_NULL_HANDLE ? static_cast<uint32_t>(entry.levels.size()) : entry.gpu.base_level;
+    }
+
+    VkeTextureManager::Statistics VkeTextureManager::get_statistics() const {
+        Statistics statistics = totals;
+        statistics.texture_count = static_cast<uint32_t>(textures.size());
+        statistics.resident_bytes = resident_bytes;
+        statistics.budget_bytes = budget;
+        std::lock_guard<std::mutex> lock{mutex};
+        statistics.pending_loads = pending_loads;
+        return statistics;
+    }
+
+    float VkeTextureManager::projected_size(const VkeCamera &camera, glm::vec3 center, float radius, float viewport_height) {
+        glm::vec4 view_center = camera.get_view() * glm::vec4(center, 1.f);
+        if (view_center.z <= -radius) {
+            return 0.f;
+        }
+        // the camera is inside the sphere
+        if (view_center.z <= radius) {
+            return viewport_height;
+        }
+        // projection[1][1] is 1 / tan(fov_y / 2), the diameter covers radius / z of the half height
+        return std::min(radius * camera.get_projection()[1][1] * viewport_height / view_center.z, viewport_height);
+    }
+}
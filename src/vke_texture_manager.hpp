@@ -0,0 +1,171 @@
+#ifndef vke_texture_manager_
+    #define vke_texture_manager_
+
+    #include "vke_device.hpp"
+    #include "vke_bindless_table.hpp"
+    #include "vke_camera.hpp"
+    #include "vke_image_data.hpp"
+    #include "vke_staging_ring.hpp"
+
+    // std
+    #include <condition_variable>
+    #include <cstdint>
+    #include <deque>
+    #include <memory>
+    #include <mutex>
+    #include <string>
+    #include <thread>
+    #include <vector>
+
+    namespace vke {
+        // Streams textures into bindless sampled image slots. Images are decoded and their mip chains built
+        // on worker threads, the cpu copy of the chain is kept. On the gpu a texture only holds the levels
+        // from its resident level down to 1x1: every frame the finest level wanted by its requested screen
+        // size is streamed in one level at a time through the staging ring, and when the memory budget is
+        // exceeded the finest level of the least recently used textures is dropped again.
+        // Changing the resident levels builds a new image, copies the levels both images share on the gpu
+        // and moves the texture to a new slot, the old image and slot are released once no frame in flight
+        // can sample them. Until a texture is resident its slot shows a white placeholder.
+        class VkeTextureManager {
+            public:
+            using TextureId = uint32_t;
+            static constexpr TextureId INVALID_TEXTURE = ~0u;
+
+            struct Statistics {
+                uint32_t texture_count = 0;
+                uint32_t pending_loads = 0;
+                uint32_t failed_loads = 0;
+                VkDeviceSize resident_bytes = 0;
+                VkDeviceSize budget_bytes = 0;
+                // totals since creation
+                VkDeviceSize uploaded_bytes = 0;
+                uint64_t streamed_levels = 0;
+                uint64_t evicted_levels = 0;
+            };
+
+            VkeTextureManager(
+                VkeDevice &device,
+                VkeBindlessTable &bindless_table,
+                uint32_t frames_in_flight,
+                VkDeviceSize budget_bytes,
+                uint32_t worker_count,
+                VkDeviceSize staging_size = 32 * 1024 * 1024
+            );
+            ~VkeTextureManager();
+
+            VkeTextureManager(const VkeTextureManager&) = delete;
+            VkeTextureManager& operator=(const VkeTextureManager&) = delete;
+
+            // both return immediately, decoding and mip generation happen on the workers
+            TextureId load(const std::string &path);
+            TextureId create(VkeImageData image);
+
+            // screen size in pixels the texture covers this frame, the largest request of a frame counts
+            void request(TextureId texture, float screen_size);
+            // records uploads into the frame's command buffer, call after begin_frame and before the render pass
+            void update(VkCommandBuffer command_buffer, int frame_index);
+
+            // slot for the object data of this frame, changes whenever the resident levels change
+            uint32_t get_slot(TextureId texture) const;
+            // finest level on the gpu, the mip count while not resident
+            uint32_t get_resident_level(TextureId texture) const;
+
+            void set_budget(VkDeviceSize budget_bytes) { budget = budget_bytes; }
+            Statistics get_statistics() const;
+
+            // diameter in pixels of a sphere seen through camera
+            static float projected_size(const VkeCamera &camera, glm::vec3 center, float radius, float viewport_height);
+
+            private:
+            // the levels of a texture on the gpu
+            struct GpuImage {
+                VkImage image = VK_NULL_HANDLE;
+                VkDeviceMemory memory = VK_NULL_HANDLE;
+                VkImageView view = VK_NULL_HANDLE;
+                uint32_t base_level = 0;
+                VkDeviceSize size = 0;
+            };
+
+            enum class State {
+                Loading,
+                Ready,
+                Failed
+            };
+
+            struct Texture {
+                State state = State::Loading;
+                // finest first
+                std::vector<VkeImageData> levels{};
+                GpuImage gpu{};
+                uint32_t slot = VkeBindlessTable::INVALID_SLOT;
+                float requested_size = 0.f;
+                // last frame the texture was requested in, the least recently used are evicted first
+                uint64_t requested_frame = 0;
+            };
+
+            struct LoadJob {
+                TextureId texture;
+                std::string path;
+                VkeImageData image;
+            };
+
+            struct LoadResult {
+                TextureId texture;
+                std::vector<VkeImageData> levels;
+                std::string error;
+            };
+
+            struct RetiredImage {
+                GpuImage gpu;
+                uint64_t frame;
+            };
+
+            TextureId add_job(std::string path, VkeImageData image);
+            void worker_loop();
+            void collect_loads();
+
+            uint32_t tail_level(const Texture &texture) const;
+            uint32_t wanted_level(const Texture &texture) const;
+            VkDeviceSize level_bytes(const Texture &texture, uint32_t first_level) const;
+            // rebuilds the texture's image with first_level as finest level, false if the staging ring is full
+            bool set_resident_level(VkCommandBuffer command_buffer, Texture &texture, uint32_t first_level);
+            // drops finest levels until needed more bytes fit, textures used this frame are only trimmed
+            // down to what they requested
+            void evict(VkCommandBuffer command_buffer, VkDeviceSize needed);
+            GpuImage create_image(const VkeImageData &base, uint32_t level_count);
+            void destroy(GpuImage &gpu);
+            void create_sampler();
+            void create_placeholder();
+
+            // smallest levels are always resident once a texture is loaded
+            static constexpr uint32_t TAIL_SIZE = 32;
+            // image rebuilds recorded per frame at most
+            static constexpr uint32_t MAX_UPDATES_PER_FRAME = 16;
+
+            VkeDevice &vke_device;
+            VkeBindlessTable &bindless_table;
+            uint32_t frames_in_flight;
+            VkDeviceSize budget;
+            VkeStagingRing staging;
+
+            VkSampler sampler = VK_NULL_HANDLE;
+            GpuImage placeholder{};
+            uint32_t placeholder_slot = VkeBindlessTable::INVALID_SLOT;
+
+            std::vector<Texture> textures{};
+            std::vector<RetiredImage> retired_images{};
+            uint64_t frame_number = 0;
+            VkDeviceSize resident_bytes = 0;
+            Statistics totals{};
+
+            mutable std::mutex mutex;
+            std::condition_variable jobs_changed;
+            std::deque<LoadJob> jobs;
+            std::vector<LoadResult> results;
+            uint32_t pending_loads = 0;
+            bool stopping = false;
+            std::vector<std::thread> workers;
+        };
+    }
+
+#endif
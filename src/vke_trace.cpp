@@ -0,0 +1,76 @@
+#include "vke_trace.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+namespace vke {
+
+    namespace {
+        void write_json_string(std::ostream &out, const std::string &value) {
+            out << '"';
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    out << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    out << ' ';
+                } else {
+                    out << c;
+                }
+            }
+            out << '"';
+        }
+    }
+
+    int64_t trace_clock_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    void write_chrome_trace(std::ostream &out, const std::vector<TraceEvent> &events) {
+        // tracks become threads of a single process, numbered in order of appearance
+        std::map<std::string, int> track_ids{};
+        for (auto &event : events) {
+            track_ids.emplace(event.track, static_cast<int>(track_ids.size()) + 1);
+        }
+
+        int64_t origin = events.empty() ? 0 : events.front().start_ns;
+        for (auto &event : events) {
+            origin = std::min(origin, event.start_ns);
+        }
+
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (auto &[track, id] : track_ids) {
+            out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":";
+            write_json_string(out, track);
+            out << "}}";
+            first = false;
+        }
+
+        out << std::fixed << std::setprecision(3);
+        for (auto &event : events) {
+            out << (first ? "" : ",\n") << "{\"ph\":\"X\",\"name\":";
+            write_json_string(out, event.name);
+            // timestamps are in microseconds
+            out << ",\"pid\":1,\"tid\":" << track_ids[event.track]
+                << ",\"ts\":" << (event.start_ns - origin) / 1000.0
+                << ",\"dur\":" << event.duration_ns / 1000.0 << "}";
+            first = false;
+        }
+        out << "\n]}\n";
+    }
+
+    void write_chrome_trace(const std::string &path, const std::vector<TraceEvent> &events) {
+        std::ofstream file{path};
+        if (!file) {
+            throw std::runtime_error("failed to open trace file " + path);
+        }
+        write_chrome_trace(file, events);
+    }
+}
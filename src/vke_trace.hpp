@@ -0,0 +1,27 @@
+#ifndef vke_trace_
+    #define vke_trace_
+
+    // std
+    #include <cstdint>
+    #include <ostream>
+    #include <string>
+    #include <vector>
+
+    namespace vke {
+        struct TraceEvent {
+            std::string name;
+            // events of the same track end up on one row of the trace viewer
+            std::string track;
+            int64_t start_ns;
+            int64_t duration_ns;
+        };
+
+        // nanoseconds on the steady clock, the time base of all trace events
+        int64_t trace_clock_ns();
+
+        // writes the chrome trace event format, readable by chrome://tracing and ui.perfetto.dev
+        void write_chrome_trace(std::ostream &out, const std::vector<TraceEvent> &events);
+        void write_chrome_trace(const std::string &path, const std::vector<TraceEvent> &events);
+    }
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef vke_utils_
     #define vke_utils_
 
+#include <cstddef>
+#include <functional>
+
 namespace vke {
 
 // check https://stackoverflow.com/a/57595105
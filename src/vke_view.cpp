@@ -0,0 +1,92 @@
+#include "vke_view.hpp"
+#include "vke_cpu_trace.hpp"
+
+// std
+#include <algorithm>
+
+namespace vke {
+
+    VkViewport VkeView::get_viewport() const {
+        VkViewport viewport{};
+        viewport.x = static_cast<float>(area.offset.x);
+        viewport.y = static_cast<float>(area.offset.y);
+        viewport.width = static_cast<float>(area.extent.width);
+        viewport.height = static_cast<float>(area.extent.height);
+        viewport.minDepth = 0.f;
+        viewport.maxDepth = 1.f;
+        return viewport;
+    }
+
+    const char *to_string(VkeViewLayout layout) {
+        switch (layout) {
+            case VkeViewLayout::Single: return "single";
+            case VkeViewLayout::SplitScreen: return "split";
+            case VkeViewLayout::PictureInPicture: return "pip";
+        }
+        return "unknown";
+    }
+
+    bool parse_view_layout(const std::string &name, VkeViewLayout &layout) {
+        for (auto candidate : {VkeViewLayout::Single, VkeViewLayout::SplitScreen, VkeViewLayout::PictureInPicture}) {
+            if (name == to_string(candidate)) {
+                layout = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<VkRect2D> layout_view_areas(VkeViewLayout layout, VkExtent2D extent) {
+        VkRect2D full{{0, 0}, extent};
+        switch (layout) {
+            case VkeViewLayout::Single:
+                return {full};
+            case VkeViewLayout::SplitScreen: {
+                uint32_t left_width = extent.width / 2;
+                return {
+                    {{0, 0}, {left_width, extent.height}},
+                    {{static_cast<int32_t>(left_width), 0}, {extent.width - left_width, extent.height}}
+                };
+            }
+            case VkeViewLayout::PictureInPicture: {
+                VkExtent2D inset{std::max(extent.width / 4, 1u), std::max(extent.height / 4, 1u)};
+                int32_t margin = static_cast<int32_t>(std::min(extent.width, extent.height) / 32);
+                VkOffset2D offset{std::max(static_cast<int32_t>(extent.width - inset.width) - margin, 0), margin};
+                return {full, {offset, inset}};
+            }
+        }
+        return {full};
+    }
+
+    void VkeViewCuller::cull(VkeGameObject::Map &objects, const VkeFrustum *frusta, uint32_t frustum_count) {
+        VKE_CPU_SCOPE("cull views");
+        frustum_count = std::min(frustum_count, MAX_VIEWS);
+        instances.clear();
+        visible_counts.assign(frustum_count, 0);
+        object_count = 0;
+        sphere_tests = 0;
+
+        for (auto &kv : objects) {
+            auto &obj = kv.second;
+            if (obj.model == nullptr) continue;
+            object_count++;
+
+            glm::mat4 model_matrix = obj.transform.mat4();
+            glm::vec3 center{model_matrix * glm::vec4(obj.model->get_bounding_center(), 1.f)};
+            glm::vec3 scale = glm::abs(obj.transform.scale);
+            float radius = obj.model->get_bounding_radius() * std::max(scale.x, std::max(scale.y, scale.z));
+
+            uint32_t view_mask = frustum_count == 0 ? ~0u : 0u;
+            for (uint32_t view = 0; view < frustum_count; view++) {
+                if (frusta[view].intersects_sphere(center, radius)) {
+                    view_mask |= 1u << view;
+                    visible_counts[view]++;
+                }
+            }
+            sphere_tests += frustum_count;
+            if (view_mask == 0) continue;
+
+            instances.push_back({&obj, model_matrix, obj.transform.normal_matrix(), glm::vec4(center, radius), view_mask});
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef vke_view_
+    #define vke_view_
+
+    #include "vke_camera.hpp"
+    #include "vke_frustum.hpp"
+    #include "vke_game_object.hpp"
+
+    // std
+    #include <cstdint>
+    #include <string>
+    #include <vector>
+    #include <vulkan/vulkan_core.h>
+
+    namespace vke {
+        // A camera rendering into an area of the render target, see VkeSimpleRenderSystem::render_views
+        struct VkeView {
+            const VkeCamera *camera = nullptr;
+            // in pixels of the render target
+            VkRect2D area{};
+            // camera and lights of this view, bound at set 0
+            VkDescriptorSet global_descriptor_set = VK_NULL_HANDLE;
+            // color and depth of the area are cleared first, for views drawn over another one
+            bool clear = false;
+
+            VkViewport get_viewport() const;
+            float get_aspect_ratio() const { return static_cast<float>(area.extent.width) / static_cast<float>(area.extent.height); }
+        };
+
+        // how the views of the app share the window
+        enum class VkeViewLayout {
+            Single,
+            // two views side by side
+            SplitScreen,
+            // a second view in a quarter sized inset at the top right
+            PictureInPicture
+        };
+
+        bool parse_view_layout(const std::string &name, VkeViewLayout &layout);
+        const char *to_string(VkeViewLayout layout);
+        // areas of the views of layout in a render target of extent, the main view first
+        std::vector<VkRect2D> layout_view_areas(VkeViewLayout layout, VkExtent2D extent);
+
+        // Culls the objects against the frusta of all views of a frame at once. Every object is transformed
+        // once, its matrices and bounding sphere are shared by all views it is visible in, instead of being
+        // computed again by every view.
+        class VkeViewCuller {
+            public:
+            // bits of the view masks
+            static constexpr uint32_t MAX_VIEWS = 32;
+
+            struct Instance {
+                VkeGameObject *object;
+                glm::mat4 model_matrix;
+                glm::mat4 normal_matrix;
+                // world space bounding sphere, w is the radius
+                glm::vec4 sphere;
+                // bit v is set if the sphere intersects the frustum of view v
+                uint32_t view_mask;
+            };
+
+            // objects without a model or outside all frusta are dropped, without frusta every object is kept
+            // with all bits of its mask set
+            void cull(VkeGameObject::Map &objects, const VkeFrustum *frusta, uint32_t frustum_count);
+
+            const std::vector<Instance> &get_instances() const { return instances; }
+
+            // statistics of the last cull
+            uint32_t get_object_count() const { return object_count; }
+            // objects visible in view, 0 for views past the frustum count
+            uint32_t get_visible_count(uint32_t view) const { return view < visible_counts.size() ? visible_counts[view] : 0; }
+            uint64_t get_sphere_tests() const { return sphere_tests; }
+
+            private:
+            std::vector<Instance> instances{};
+            std::vector<uint32_t> visible_counts{};
+            uint32_t object_count = 0;
+            uint64_t sphere_tests = 0;
+        };
+    }
+
+#endif
@@ -45,6 +45,12 @@ namespace vke {
             return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
         }
 
+        float VkeWindow::get_refresh_rate() const {
+            GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+            const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+            return mode && mode->refreshRate > 0 ? static_cast<float>(mode->refreshRate) : 60.f;
+        }
+
         void VkeWindow::frame_buffer_resize_callback(GLFWwindow *window, int width, int height) {
             auto vke_window = reinterpret_cast<VkeWindow *>(glfwGetWindowUserPointer(window));
             vke_window -> frame_buffer_resized = true;
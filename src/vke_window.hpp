@@ -20,6 +20,8 @@
             void createWindowSurface(VkInstance instance, VkSurfaceKHR * surface);
 
             VkExtent2D getExtent();
+            // refresh rate of the primary monitor, 60 if it can't be queried
+            float get_refresh_rate() const;
             bool was_window_resized() { return frame_buffer_resized; }
             void reset_window_resized_flag() { frame_buffer_resized = false; }
 